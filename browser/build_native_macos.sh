@@ -24,10 +24,10 @@ if [ -z "$DEVELOPER_ID" ]; then
     exit 1
 fi
 
-# Check if dart is installed
-if ! command -v dart &> /dev/null; then
-    echo "Error: dart is not installed"
-    echo "Please install dart first using: brew install dart"
+# Check if cmake is installed
+if ! command -v cmake &> /dev/null; then
+    echo "Error: cmake is not installed"
+    echo "Please install cmake first using: brew install cmake"
     exit 1
 fi
 
@@ -42,12 +42,12 @@ build_and_process() {
     local binary_path="$temp_dir/$APP_NAME"
     
     echo "Building for $arch..."
-    cd native
-    dart pub get
-    
-    # Compile native executable
-    dart compile exe src/main.dart --target-os macos --output "$binary_path"
-    cd ..
+    # Compile the C++ host (../native/host)
+    cmake -S ../native -B "$temp_dir/build" -DCMAKE_BUILD_TYPE=Release \
+        -DCMAKE_OSX_ARCHITECTURES="arm64;x86_64" \
+        -DROUTINE_BUILD_TESTS=OFF -DROUTINE_BUILD_BENCHMARKS=OFF -DROUTINE_BUILD_TOOLS=OFF
+    cmake --build "$temp_dir/build" --target routine_nmh
+    cp "$temp_dir/build/routine_nmh" "$binary_path"
     
     echo "Signing binary with entitlements..."
     codesign --force --options runtime --entitlements "$ENTITLEMENTS_FILE" --sign "$DEVELOPER_ID" "$binary_path"
@@ -64,7 +64,7 @@ build_and_process() {
     echo "Build completed successfully!"
 }
 
-# Build for both architectures (Dart produces a universal binary)
+# Build for both architectures (a universal binary)
 build_and_process "universal" "native_macos"
 
 echo "All builds completed successfully!"
@@ -1 +1,4 @@
-dart compile exe native/src/main.dart --output ../assets/extension/native_windows.exe
\ No newline at end of file
+# Builds the C++ native messaging host (native/host) into the app's assets.
+cmake -S ../native -B ../native/build-nmh -DROUTINE_BUILD_TESTS=OFF -DROUTINE_BUILD_BENCHMARKS=OFF -DROUTINE_BUILD_TOOLS=OFF
+cmake --build ../native/build-nmh --config Release --target routine_nmh
+Copy-Item ../native/build-nmh/Release/routine_nmh.exe ../assets/extension/native_windows.exe
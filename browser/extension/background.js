@@ -8,6 +8,19 @@ const RECONNECT_INTERVAL = 5000; // Attempt reconnection every 2 seconds to matc
 // block config
 let sites = [];
 let allowList = false;
+// Generation of the site list last applied; the host numbers updates so
+// patches can be checked against it.
+let generation = 0;
+
+// Sites as a trie of labels read right to left ("com" -> "example"), so a
+// host is matched on label boundaries in O(labels): "example.com" matches
+// "www.example.com" but not "notexample.com". The host sends sites in the
+// punycode form URL.hostname uses. A '' key marks a listed site.
+let siteTrie = new Map();
+
+// Dynamic rule id of each site's rule, so patches can remove them
+const siteRuleIds = new Map();
+let nextRuleId = 1;
 
 // Lock mechanism for rule updates
 let isUpdatingRules = false;
@@ -35,7 +48,8 @@ async function connectToNative() {
     
     // Send browser type as first message after connecting
     port = chrome.runtime.connectNative(hostName);
-    port.postMessage({ action: 'browser_info', data: { browser: browserType } });
+    // policyVersion 1: we understand patchBlockedSites
+    port.postMessage({ action: 'browser_info', data: { browser: browserType, policyVersion: 1 } });
     console.log(`Connected to native messaging host for ${browserType}`);
 
     port.onMessage.addListener((message) => {
@@ -46,6 +60,8 @@ async function connectToNative() {
         // Update blocked sites list
         sites = message.data.sites;
         allowList = message.data.allowList;
+        generation = message.data.generation ?? 0;
+        buildSiteTrie();
         
         // Re-register blocking rules with new patterns
         registerBlockingRules();
@@ -54,6 +70,22 @@ async function connectToNative() {
         checkAndRedirectBlockedTabs();
         
         console.log("Updated blocked sites:", sites, allowList);
+      } else if (message.action === "patchBlockedSites") {
+        if (message.data.base !== generation) {
+          // We missed an update; ask for the whole list again
+          console.log(`Patch for generation ${message.data.base}, have ${generation}; requesting resync`);
+          port.postMessage({ action: 'resyncBlockedSites', data: { generation } });
+          return;
+        }
+        generation = message.data.generation;
+        const removed = new Set(message.data.remove);
+        sites = sites.filter(site => !removed.has(site)).concat(message.data.add);
+        buildSiteTrie();
+
+        patchBlockingRules(message.data.add, message.data.remove);
+        checkAndRedirectBlockedTabs();
+
+        console.log(`Patched blocked sites: +${message.data.add.length} -${message.data.remove.length}, generation ${generation}`);
       }
     });
     
@@ -62,6 +94,7 @@ async function connectToNative() {
       console.log("Disconnected from native host", error ? error.message : "", hostName);
       port = null;
       isAppConnected = false;  // Reset app connection state
+      generation = 0;  // The next host starts over with a full list
       registerBlockingRules();  // Re-register rules with new connection state
       
       // Start reconnection attempts
@@ -92,19 +125,41 @@ function scheduleReconnect() {
   }, RECONNECT_INTERVAL);
 }
 
+function buildSiteTrie() {
+  siteTrie = new Map();
+  for (const site of sites) {
+    const labels = site.toLowerCase().split('.');
+    let node = siteTrie;
+    for (let i = labels.length - 1; i >= 0; i--) {
+      let child = node.get(labels[i]);
+      if (!child) {
+        child = new Map();
+        node.set(labels[i], child);
+      }
+      node = child;
+    }
+    node.set('', true);
+  }
+}
+
+// Whether hostname is a listed site or a subdomain of one
+function hostMatchesSites(hostname) {
+  const labels = hostname.replace(/\.$/, '').split('.');
+  let node = siteTrie;
+  for (let i = labels.length - 1; i >= 0; i--) {
+    node = node.get(labels[i]);
+    if (!node) return false;
+    if (node.has('')) return true;
+  }
+  return false;
+}
+
 // Check if a URL matches any blocked sites
 function isUrlBlocked(url) {
   try {
-    const urlObj = new URL(url);
-    const hostname = urlObj.hostname;
-    
-    if (allowList) {
-      // In allowlist mode, site is blocked if it's not in the sites list
-      return !sites.some(site => hostname.endsWith(site));
-    } else {
-      // In blocklist mode, site is blocked if it's in the sites list
-      return sites.some(site => hostname.endsWith(site));
-    }
+    const hostname = new URL(url).hostname;
+    // In allowlist mode, a site is blocked unless it's listed
+    return allowList ? !hostMatchesSites(hostname) : hostMatchesSites(hostname);
   } catch (e) {
     console.error('Error parsing URL:', e);
     return false;
@@ -130,6 +185,51 @@ async function checkOpenTabs() {
   }
 }
 
+// The rule for one site: allowed in allowlist mode, redirected otherwise
+function siteRule(site, id) {
+  if (allowList) {
+    return {
+      id,
+      priority: 1,
+      action: { type: 'allow' },
+      condition: {
+        urlFilter: `||${site}`,
+        resourceTypes: ['main_frame', 'sub_frame', 'stylesheet', 'script', 'image', 'font', 'object', 'xmlhttprequest', 'ping', 'media', 'websocket', 'other']
+      }
+    };
+  }
+  return {
+    id,
+    priority: 1,
+    action: { 
+      type: 'redirect',
+      redirect: { url: 'https://www.routineblocker.com/blocked.html' }
+    },
+    condition: {
+      urlFilter: `||${site}`,
+      resourceTypes: ['main_frame']
+    }
+  };
+}
+
+function addSiteRule(rules, site) {
+  const id = nextRuleId++;
+  siteRuleIds.set(site, id);
+  rules.push(siteRule(site, id));
+}
+
+function finishRuleUpdate() {
+  isUpdatingRules = false;
+
+  // If there's a pending update, process it
+  if (pendingRuleUpdate) {
+    pendingRuleUpdate = false;
+    console.log('Processing pending rule update');
+    // Use setTimeout to prevent stack overflow with recursive async calls
+    setTimeout(() => registerBlockingRules(), 0);
+  }
+}
+
 // Register blocking rules using declarativeNetRequest
 async function registerBlockingRules() {
   // If already updating rules, schedule a follow-up update
@@ -154,27 +254,20 @@ async function registerBlockingRules() {
     }
     
     const rules = [];
-    let ruleId = 1;
+    siteRuleIds.clear();
+    nextRuleId = 1;
 
     if (allowList) {
       // Allowlist mode: Block everything except specified sites
       
       // First add rules for allowed sites (priority 1)
       for (const site of sites) {
-        rules.push({
-          id: ruleId++,
-          priority: 1,
-          action: { type: 'allow' },
-          condition: {
-            urlFilter: `||${site}`,
-            resourceTypes: ['main_frame', 'sub_frame', 'stylesheet', 'script', 'image', 'font', 'object', 'xmlhttprequest', 'ping', 'media', 'websocket', 'other']
-          }
-        });
+        addSiteRule(rules, site);
       }
 
       // Then add catch-all redirect rule with lower priority (0)
       rules.push({
-        id: ruleId++,
+        id: nextRuleId++,
         priority: 0,
         action: { 
           type: 'redirect',
@@ -188,18 +281,7 @@ async function registerBlockingRules() {
     } else {
       // Blocklist mode: Only block specified sites
       for (const site of sites) {
-        rules.push({
-          id: ruleId++,
-          priority: 1,
-          action: { 
-            type: 'redirect',
-            redirect: { url: 'https://www.routineblocker.com/blocked.html' }
-          },
-          condition: {
-            urlFilter: `||${site}`,
-            resourceTypes: ['main_frame']
-          }
-        });
+        addSiteRule(rules, site);
       }
     }
 
@@ -215,15 +297,44 @@ async function registerBlockingRules() {
   } catch (error) {
     console.error('Error updating blocking rules:', error);
   } finally {
-    isUpdatingRules = false;
-
-    // If there's a pending update, process it
-    if (pendingRuleUpdate) {
-      pendingRuleUpdate = false;
-      console.log('Processing pending rule update');
-      // Use setTimeout to prevent stack overflow with recursive async calls
-      setTimeout(() => registerBlockingRules(), 0);
+    finishRuleUpdate();
+  }
+}
+
+// Apply a patch to the registered rules instead of rebuilding all of them
+async function patchBlockingRules(added, removed) {
+  if (isUpdatingRules) {
+    // The follow-up rebuild reads the already patched site list
+    pendingRuleUpdate = true;
+    return;
+  }
+
+  isUpdatingRules = true;
+
+  try {
+    const removeRuleIds = [];
+    for (const site of removed) {
+      const id = siteRuleIds.get(site);
+      if (id !== undefined) {
+        removeRuleIds.push(id);
+        siteRuleIds.delete(site);
+      }
+    }
+    const addRules = [];
+    for (const site of added) {
+      addSiteRule(addRules, site);
     }
+
+    await chrome.declarativeNetRequest.updateDynamicRules({ removeRuleIds, addRules });
+
+    console.log(`Patched blocking rules: ${addRules.length} added, ${removeRuleIds.length} removed`);
+
+    await checkOpenTabs();
+  } catch (error) {
+    console.error('Error patching blocking rules, rebuilding:', error);
+    pendingRuleUpdate = true;
+  } finally {
+    finishRuleUpdate();
   }
 }
 
@@ -253,22 +364,7 @@ function shouldBlockUrl(url) {
   if (!isAppConnected || sites.length === 0) {
     return false;
   }
-  
-  try {
-    const urlObj = new URL(url);
-    const hostname = urlObj.hostname;
-    
-    if (allowList) {
-      // Allowlist mode: block if not in the allowed sites
-      return !sites.some(site => hostname === site || hostname.endsWith('.' + site));
-    } else {
-      // Blocklist mode: block if in the blocked sites
-      return sites.some(site => hostname === site || hostname.endsWith('.' + site));
-    }
-  } catch (error) {
-    console.error('Error parsing URL:', url, error);
-    return false;
-  }
+  return isUrlBlocked(url);
 }
 
 // Function to check and redirect currently open tabs that are now blocked
@@ -1,8 +1,10 @@
 import 'dart:async';
+import 'dart:convert';
 import 'package:routine_blocker/setup.dart';
 import 'package:flutter/services.dart';
 import 'package:routine_blocker/constants.dart';
 import 'package:routine_blocker/models/installed_app.dart';
+import 'package:routine_blocker/models/routine.dart';
 import 'package:routine_blocker/util.dart';
 
 
@@ -13,11 +15,73 @@ class BrowserControlMessage {
   BrowserControlMessage({required this.bundleId, required this.controllable});
 }
 
+// How the blocking lists of the routines that are on changed since the
+// native engine last answered. With [reset] the lists start over from
+// [added].
+class PolicyChange {
+  final bool allowList;
+  final bool reset;
+  final Map<String, List<String>> added;
+  final Map<String, List<String>> removed;
+
+  PolicyChange({required this.allowList, required this.reset, required this.added, required this.removed});
+
+  factory PolicyChange.fromMap(Map<dynamic, dynamic> map) {
+    Map<String, List<String>> lists(Map<dynamic, dynamic> items) => {
+      for (final kind in const ['apps', 'sites', 'categories'])
+        kind: List<String>.from(items[kind] ?? const []),
+    };
+    return PolicyChange(
+      allowList: map['allowList'],
+      reset: map['reset'],
+      added: lists(map['added']),
+      removed: lists(map['removed']),
+    );
+  }
+
+  bool changed(String kind) => reset || added[kind]!.isNotEmpty || removed[kind]!.isNotEmpty;
+}
+
+// Which routines the native schedule engine has on, when that next changes
+// (null for never), and what that did to the blocking lists.
+class ScheduleState {
+  final Set<String> active;
+  final DateTime? next;
+  final PolicyChange? policy;
+
+  ScheduleState({required this.active, required this.next, this.policy});
+}
+
+// Foreground time per app and day from the native usage tracker, one row
+// per app and day, and how much of today's budget each budgeted app has
+// left.
+class UsageReport {
+  final List<DateTime> days;
+  final List<String> apps;
+  final List<Duration> used;
+  final Map<String, Duration> remaining;
+
+  UsageReport({required this.days, required this.apps, required this.used, required this.remaining});
+
+  factory UsageReport.fromMap(Map<dynamic, dynamic> map) {
+    return UsageReport(
+      days: [for (final int day in map['days']) DateTime.fromMillisecondsSinceEpoch(day)],
+      apps: List<String>.from(map['apps']),
+      used: [for (final int ms in map['ms']) Duration(milliseconds: ms)],
+      remaining: {
+        for (final entry in (map['remaining'] as Map).entries)
+          entry.key as String: Duration(milliseconds: entry.value as int),
+      },
+    );
+  }
+}
+
 class DesktopChannel {
   static final DesktopChannel _instance = DesktopChannel._();
   static DesktopChannel get instance => _instance;
 
   final _platform = const MethodChannel(kAppName);
+  final _runningApps = const EventChannel('$kAppName/running_apps');
   final _browserControllabilityController = StreamController<BrowserControlMessage>.broadcast();
   Future<void> Function()? _systemWakeHandler;
   DesktopChannel._();
@@ -41,6 +105,101 @@ class DesktopChannel {
       'allowList': allowList,
     });
   }
+  // Compiles the routines' schedules and lists natively. [done] names the
+  // routines whose conditions are met, which stay off; [full] asks for the
+  // whole policy rather than what changed. Returns null where the platform
+  // has no schedule engine.
+  Future<ScheduleState?> updateSchedule(List<Routine> routines, {required Set<String> done, bool full = false}) async {
+    return _invokeSchedule('updateSchedule', {
+      'full': full,
+      'done': done.toList(),
+      'routines': routines.map((r) {
+        int days = 0;
+        for (int i = 0; i < 7; i++) {
+          if (r.days[i]) days |= 1 << i;
+        }
+        return {
+          'id': r.id,
+          'days': days,
+          'start': r.startTime,
+          'end': r.endTime,
+          'pausedUntil': r.pausedUntil?.millisecondsSinceEpoch ?? 0,
+          'snoozedUntil': r.snoozedUntil?.millisecondsSinceEpoch ?? 0,
+          'allow': r.allow,
+          'apps': r.apps,
+          'sites': r.sites,
+          'categories': r.categories,
+        };
+      }).toList(),
+    });
+  }
+  Future<ScheduleState?> evaluateSchedule({required Set<String> done, bool full = false}) async {
+    return _invokeSchedule('evaluateSchedule', {
+      'full': full,
+      'done': done.toList(),
+    });
+  }
+  Future<ScheduleState?> _invokeSchedule(String method, dynamic arguments) async {
+    try {
+      final result = await _platform.invokeMethod(method, arguments);
+      final int next = result['next'];
+      final policy = result['policy'];
+      return ScheduleState(
+        active: Set<String>.from(result['active']),
+        next: next < 0 ? null : DateTime.fromMillisecondsSinceEpoch(next),
+        policy: policy == null ? null : PolicyChange.fromMap(policy),
+      );
+    } on MissingPluginException {
+      return null;
+    } catch (e, st) {
+      Util.report('error evaluating schedule with $method', e, st);
+      return null;
+    }
+  }
+  /// Enforcement counters and latency histograms from the native runner, or
+  /// null where it keeps none. [trace] turns span recording on or off, and
+  /// [tracePath] writes the spans so far as a Chrome trace-event file.
+  Future<Map<String, dynamic>?> getEnforcementStats({bool? trace, String? tracePath}) async {
+    try {
+      final String json = await _platform.invokeMethod('getEnforcementStats', {
+        if (trace != null) 'trace': trace,
+        if (tracePath != null) 'tracePath': tracePath,
+      });
+      return jsonDecode(json) as Map<String, dynamic>;
+    } on MissingPluginException {
+      return null;
+    } catch (e, st) {
+      Util.report('error getting enforcement stats', e, st);
+      return null;
+    }
+  }
+  /// Caps each app's foreground time per day, in minutes by executable
+  /// path. The runner minimises an app once it is out of time.
+  Future<void> setUsageBudgets(Map<String, int> minutes) async {
+    try {
+      await _platform.invokeMethod('setUsageBudgets', {'budgets': minutes});
+    } on MissingPluginException {
+      return;
+    } catch (e, st) {
+      Util.report('error setting usage budgets', e, st);
+    }
+  }
+  /// Foreground time per app for the local days from [from] to [to], in one
+  /// call, or null where the runner keeps none.
+  Future<UsageReport?> getUsage(DateTime from, DateTime to) async {
+    try {
+      final result = await _platform.invokeMethod('getUsage', {
+        'from': from.millisecondsSinceEpoch,
+        'to': to.millisecondsSinceEpoch,
+      });
+      return UsageReport.fromMap(result);
+    } on MissingPluginException {
+      return null;
+    } catch (e, st) {
+      Util.report('error getting usage', e, st);
+      return null;
+    }
+  }
   Future<void> setStartOnLogin(bool enabled) async {
     try {
       await _platform.invokeMethod('setStartOnLogin', enabled);
@@ -57,31 +216,59 @@ class DesktopChannel {
       return false;
     }
   }
+  InstalledApp? _toInstalledApp(dynamic app) {
+    final String name = app['name'];
+    final String path = app['path'];
+    final String? displayName = app['displayName'];
+    if (name.isEmpty || 
+        path.toLowerCase().contains('\\windows\\system32\\') ||
+        path.toLowerCase().contains('\\windows\\syswow64\\')) {
+      return null;
+    }
+    return InstalledApp(name: displayName ?? name, filePath: path);
+  }
   Future<List<InstalledApp>> getRunningApplications() async {
     List<InstalledApp> installedApps = [];
     try {
       final List<dynamic> runningApps = await _platform.invokeMethod('getRunningApplications');
       for (final app in runningApps) {
-        final String name = app['name'];
-        final String path = app['path'];
-        final String? displayName = app['displayName'];
-        if (name.isEmpty || 
-            path.toLowerCase().contains('\\windows\\system32\\') ||
-            path.toLowerCase().contains('\\windows\\syswow64\\')) {
-          continue;
-        }
-        if (!installedApps.any((existingApp) => existingApp.filePath == path)) {
-          installedApps.add(InstalledApp(
-            name: displayName ?? name,
-            filePath: path
-          ));
+        final installedApp = _toInstalledApp(app);
+        if (installedApp != null && !installedApps.any((existingApp) => existingApp.filePath == installedApp.filePath)) {
+          installedApps.add(installedApp);
         }
       }
+    } on PlatformException catch (e, st) {
+      // A newer call superseded this one and delivers the list instead.
+      if (e.code != 'cancelled') {
+        Util.report('error retrieving installed applications', e, st);
+      }
     } catch (e, st) {
       Util.report('error retrieving installed applications', e, st);
     }
     return installedApps;
   }
+  // Emits the running applications after every batch the native side
+  // streams: first as they are discovered, then as processes start and exit.
+  Stream<List<InstalledApp>> watchRunningApplications() {
+    final Map<String, InstalledApp> installedApps = {};
+    return _runningApps.receiveBroadcastStream().map((event) {
+      final List<dynamic> apps = event['apps'];
+      for (final app in apps) {
+        final installedApp = _toInstalledApp(app);
+        if (installedApp == null) {
+          continue;
+        }
+        if (event['event'] == 'removed') {
+          installedApps.remove(installedApp.filePath);
+        } else {
+          installedApps.putIfAbsent(installedApp.filePath, () => installedApp);
+        }
+      }
+      return installedApps.values.toList();
+    }).handleError((e, st) {
+      Util.report('error streaming running applications', e, st);
+    });
+  }
   void registerSystemWakeHandler(Future<void> Function() handler) {
     _systemWakeHandler = handler;
     _platform.setMethodCallHandler(_handleMethodCall);
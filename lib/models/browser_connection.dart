@@ -7,6 +7,9 @@ class BrowserConnection {
   final Socket socket;
   List<int> buffer = [];
   int? len;
+  // Whether the extension applies patchBlockedSites; the native host then
+  // gets site lists as snapshots and sends the browser only the changes.
+  bool policyDeltas = false;
 
   BrowserConnection({required this.socket});
 
@@ -17,4 +20,29 @@ class BrowserConnection {
     socket.add(lengthBytes.buffer.asUint8List());
     socket.add(messageBytes);
   }
-}
\ No newline at end of file
+
+  // Sends the site list as a policy snapshot (host/policy_sync.h): "RPS1",
+  // a flags byte, a varint count and each site as a varint length and UTF-8.
+  void sendPolicySnapshot(List<String> sites, bool allowList, {bool resync = false}) {
+    final body = BytesBuilder(copy: false)
+      ..add(ascii.encode('RPS1'))
+      ..addByte((resync ? 1 : 0) | (allowList ? 2 : 0));
+    _addVarint(body, sites.length);
+    for (final site in sites) {
+      final bytes = utf8.encode(site);
+      _addVarint(body, bytes.length);
+      body.add(bytes);
+    }
+    final lengthBytes = ByteData(4)..setUint32(0, body.length, Endian.little);
+    socket.add(lengthBytes.buffer.asUint8List());
+    socket.add(body.takeBytes());
+  }
+
+  static void _addVarint(BytesBuilder out, int value) {
+    while (value >= 0x80) {
+      out.addByte((value & 0x7f) | 0x80);
+      value >>= 7;
+    }
+    out.addByte(value);
+  }
+}
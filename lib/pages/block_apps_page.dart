@@ -4,6 +4,7 @@ import 'package:routine_blocker/setup.dart';
 import 'package:routine_blocker/util.dart';
 import 'package:flutter/material.dart';
 import 'package:file_picker/file_picker.dart';
+import 'dart:async';
 import 'dart:io' show Platform;
 import '../services/desktop_service.dart';
 import '../constants.dart';
@@ -33,6 +34,7 @@ class _BlockAppsPageState extends State<BlockAppsPage> with SingleTickerProvider
   late List<String> _selectedCategories;
   List<InstalledApp> _availableApps = [];
   bool _isLoadingApps = true;
+  StreamSubscription<List<InstalledApp>>? _appsSubscription;
   String _appSearchQuery = '';
   String _folderSearchQuery = '';
   final TextEditingController _appSearchController = TextEditingController();
@@ -55,6 +57,7 @@ class _BlockAppsPageState extends State<BlockAppsPage> with SingleTickerProvider
 
   @override
   void dispose() {
+    _appsSubscription?.cancel();
     _tabController.dispose();
     _appSearchController.dispose();
     _folderSearchController.dispose();
@@ -67,7 +70,21 @@ class _BlockAppsPageState extends State<BlockAppsPage> with SingleTickerProvider
       _isLoadingApps = true;
     });
 
-    final List<InstalledApp> apps = Util.isDesktop() ? await DesktopService.instance.getInstalledApps() : await MobileService().getInstalledApps();
+    if (Util.isDesktop()) {
+      // Desktop apps arrive in batches; show each as soon as it lands.
+      await _appsSubscription?.cancel();
+      _appsSubscription = DesktopService.instance.watchInstalledApps().listen((apps) {
+        if (!mounted) return;
+        setState(() {
+          _availableApps = apps;
+          _isLoadingApps = false;
+        });
+      });
+      return;
+    }
+
+    final List<InstalledApp> apps = await MobileService().getInstalledApps();
+    if (!mounted) return;
     setState(() {
       _availableApps = apps;
       _isLoadingApps = false;
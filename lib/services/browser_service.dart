@@ -8,7 +8,7 @@ import 'package:routine_blocker/util.dart';
 import 'package:file_picker/file_picker.dart';
 import 'package:flutter/material.dart';
 import 'package:flutter/services.dart';
-import 'dart:io' show Directory, File, Platform, Process, ServerSocket, InternetAddress;
+import 'dart:io' show Directory, File, Platform, Process, ServerSocket, Socket, InternetAddress, InternetAddressType;
 import 'dart:typed_data' show ByteData, Uint8List;
 import 'package:path_provider/path_provider.dart';
 import 'dart:convert';
@@ -400,10 +400,25 @@ class BrowserService with ChangeNotifier {
   }
 
   ServerSocket? _server;
+  // The abstract Unix domain socket native hosts try before TCP on Linux.
+  ServerSocket? _localServer;
+  static const String _localSocketName = '@com.solidsoft.routine';
+  int _nextSocketId = 0;
 
   Future<void> startServer() async {
     if (_server != null) return;
 
+    if (Platform.isLinux) {
+      try {
+        _localServer = await ServerSocket.bind(
+            InternetAddress(_localSocketName, type: InternetAddressType.unix), 0);
+        logger.i("set up a server listening at $_localSocketName");
+        _localServer!.listen(_handleNmhSocket);
+      } catch (e) {
+        logger.i('Socket $_localSocketName is not available: $e');
+      }
+    }
+
     try {
       ServerSocket? server;
       int? boundPort;
@@ -425,44 +440,41 @@ class BrowserService with ChangeNotifier {
       
       _server = server;
       
-      _server!.listen((socket) {
-        logger.i('NMH connected from ${socket.remoteAddress.address}');
-
-        final connection = BrowserConnection(socket: socket);
-        final socketId = socket.remoteAddress.address;
-        _pendingConnections[socketId] = connection;
-
-        socket.listen(
-          (data) async {
-            await _handlePendingData(socketId, data);
-          },
-          onError: (error) {
-            logger.e('Error from NMH socket: $error');
-            _pendingConnections.remove(socketId);
-          },
-          onDone: () {
-            logger.i('NMH socket closed');
-            final browser = _connections.entries.firstWhereOrNull((entry) => entry.value.socket == socket)?.key;
-            if (browser != null) {
-              _handleDisconnect(browser);
-            } else {
-              _pendingConnections.remove(socketId);
-            }
-          },
-        );
-      });
+      _server!.listen(_handleNmhSocket);
     } catch (e, st) {
       Util.report('Error starting TCP server', e, st);
     }
   }
 
-  Future<void> _handlePendingData(String socketId, List<int> data) async {
-    final connection = _pendingConnections[socketId];
-    if (connection == null) {
-      logger.w('No pending connection found for socket $socketId');
-      return;
-    }
+  void _handleNmhSocket(Socket socket) {
+    // Every TCP peer is 127.0.0.1 and Unix domain peers have no address.
+    final socketId = '${_nextSocketId++}';
+    logger.i('NMH connected as socket $socketId');
+
+    final connection = BrowserConnection(socket: socket);
+    _pendingConnections[socketId] = connection;
+
+    socket.listen(
+      (data) async {
+        await _handleSocketData(socketId, connection, data);
+      },
+      onError: (error) {
+        logger.e('Error from NMH socket: $error');
+        _pendingConnections.remove(socketId);
+      },
+      onDone: () {
+        logger.i('NMH socket closed');
+        final browser = _connections.entries.firstWhereOrNull((entry) => entry.value.socket == socket)?.key;
+        if (browser != null) {
+          _handleDisconnect(browser);
+        } else {
+          _pendingConnections.remove(socketId);
+        }
+      },
+    );
+  }
 
+  Future<void> _handleSocketData(String socketId, BrowserConnection connection, List<int> data) async {
     logger.i('Received ${data.length} bytes from socket $socketId');
     connection.buffer.addAll(data);
     
@@ -481,7 +493,7 @@ class BrowserService with ChangeNotifier {
 
         try {
           final decoded = json.decode(message) as Map<String, dynamic>;
-          await _handlePendingMessage(socketId, decoded);
+          await _handleMessage(socketId, connection, decoded);
         } catch (e, st) {
           logger.e('Error decoding message from NMH: $e');
           Util.report('Error decoding message from NMH', e, st);
@@ -493,8 +505,8 @@ class BrowserService with ChangeNotifier {
     }
   }
 
-  Future<void> _handlePendingMessage(String socketId, Map<String, dynamic> message) async {
-    logger.i('Received message from pending NMH: $message');
+  Future<void> _handleMessage(String socketId, BrowserConnection connection, Map<String, dynamic> message) async {
+    logger.i('Received message from NMH: $message');
     
     final action = message['action'] as String?;
     final data = message['data'] as Map<String, dynamic>?;
@@ -507,13 +519,18 @@ class BrowserService with ChangeNotifier {
           orElse: () => Browser.firefox
         );
         
-        final connection = _pendingConnections.remove(socketId);
-        if (connection != null) {
+        connection.policyDeltas = (data['policyVersion'] as int? ?? 0) >= 1;
+        if (_pendingConnections.remove(socketId) != null) {
           _connections[browser] = connection;
           _connectionStreamController.add(true);
           await _saveBrowserConnection(browser);
         }
       }
+    } else if (action == 'resyncBlockedSites') {
+      logger.i('Extension on socket $socketId asked for a full site list');
+      if (connection.policyDeltas) {
+        connection.sendPolicySnapshot(_blockedSites, _allowList, resync: true);
+      }
     }
   }
 
@@ -532,6 +549,32 @@ class BrowserService with ChangeNotifier {
     }
   }
 
+  // The site list last sent, for extensions that ask for a resync.
+  List<String> _blockedSites = [];
+  bool _allowList = false;
+
+  Future<void> sendBlockedSites(List<String> sites, bool allowList) async {
+    _blockedSites = List<String>.from(sites);
+    _allowList = allowList;
+    for (final entry in _connections.entries.toList()) {
+      final connection = entry.value;
+      if (!connection.policyDeltas) {
+        await _sendToBrowser(entry.key, 'updateBlockedSites', {
+          'sites': _blockedSites,
+          'allowList': allowList,
+        });
+        continue;
+      }
+      try {
+        // The host diffs snapshots and sends the browser only the changes.
+        connection.sendPolicySnapshot(_blockedSites, allowList);
+        await connection.socket.flush();
+      } catch (e, st) {
+        Util.report('Failed to send site list to NMH for ${entry.key}', e, st);
+      }
+    }
+  }
+
   Future<void> sendToBrowser(String action, Map<String, dynamic> data, {Browser? browser}) async {
     if (browser != null) {
       await _sendToBrowser(browser, action, data);
@@ -580,6 +623,8 @@ class BrowserService with ChangeNotifier {
     _connections.clear();
     _server?.close();
     _server = null;
+    _localServer?.close();
+    _localServer = null;
     _connectionStreamController.close();
     controllableListener?.cancel();
   }
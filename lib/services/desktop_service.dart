@@ -21,16 +21,25 @@ class DesktopService extends PlatformService {
 
   final cron = Cron();
   final List<ScheduledTask> _scheduledTasks = [];
+  // Wakes the app at the next schedule transition the native engine reports.
+  Timer? _scheduleTimer;
+  List<Routine> _routines = [];
+  // Timers stall while the machine sleeps and miss clock changes; never
+  // trust one for longer than this.
+  static const _maxScheduleWait = Duration(hours: 1);
 
   DesktopService();
 
   static DesktopService get instance => _instance;
 
   final _desktopChannel = DesktopChannel.instance;
-  List<String> _cachedSites = [];
-  List<String> _cachedApps = [];
-  List<String> _cachedCategories = [];
+  Set<String> _cachedSites = {};
+  Set<String> _cachedApps = {};
+  Set<String> _cachedCategories = {};
   bool _isAllowList = false;
+  // Whether the cached lists match the native aggregator's, so its changes
+  // can be folded in; until then ask it for everything.
+  bool _policySynced = false;
   StreamSubscription? _routineSubscription;
   StreamSubscription? _appSubscription;
   StreamSubscription? _strictModeSettingsSubscription;
@@ -39,6 +48,7 @@ class DesktopService extends PlatformService {
   @override
   Future<void> init() async {
     _stopWatching();
+    _policySynced = false;
 
     await _desktopChannel.signalEngineReady();
 
@@ -80,6 +90,8 @@ class DesktopService extends PlatformService {
       task.cancel();
     }
     _scheduledTasks.clear();
+    _scheduleTimer?.cancel();
+    _scheduleTimer = null;
   }
 
   Future<void> _stopWatching() async {
@@ -97,9 +109,23 @@ class DesktopService extends PlatformService {
   }
   
   void onRoutinesUpdated(List<Routine> routines) async {
-    Util.scheduleEvaluationTimes(routines, _scheduledTasks, () async {
+    _routines = routines;
+    final schedule = await _desktopChannel.updateSchedule(routines,
+        done: _doneRoutines(), full: !_policySynced);
+    if (schedule != null) {
+      for (final task in _scheduledTasks) {
+        task.cancel();
+      }
+      _scheduledTasks.clear();
+      _applySchedule(schedule);
+    } else {
+      _policySynced = false;
+      _scheduleTimer?.cancel();
+      Util.scheduleEvaluationTimes(routines, _scheduledTasks, () async {
+        evaluate(routines);
+      });
       evaluate(routines);
-    });
+    }
 
     PackageInfo packageInfo = await PackageInfo.fromPlatform();
 
@@ -109,12 +135,76 @@ class DesktopService extends PlatformService {
         appPath: Platform.resolvedExecutable
       );
     }
-    
-    evaluate(routines);
   }
 
-  void evaluate(List<Routine> routines) {
-    routines = routines.where((r) => r.isActive && !r.isPaused && !r.areConditionsMet).toList();
+  // Routines whose conditions are met, which stay off whatever their
+  // schedule says.
+  Set<String> _doneRoutines() =>
+      _routines.where((r) => r.areConditionsMet).map((r) => r.id).toSet();
+
+  // Blocks for the routines the schedule engine has on, then sleeps until
+  // it says that changes.
+  void _applySchedule(ScheduleState schedule) {
+    _scheduleTimer?.cancel();
+    final policy = schedule.policy;
+    if (policy != null) {
+      _applyPolicy(policy);
+    } else {
+      evaluate(_routines, active: schedule.active);
+    }
+
+    final next = schedule.next;
+    var wait = next == null ? _maxScheduleWait : next.difference(DateTime.now());
+    if (wait > _maxScheduleWait) {
+      wait = _maxScheduleWait;
+    }
+    // Land just past the transition rather than just before it.
+    _scheduleTimer = Timer(wait + const Duration(milliseconds: 50), () async {
+      final schedule = await _desktopChannel.evaluateSchedule(
+          done: _doneRoutines(), full: !_policySynced);
+      if (schedule != null) {
+        _applySchedule(schedule);
+      } else {
+        // The engine may have moved on without us hearing of it.
+        _policySynced = false;
+      }
+    });
+  }
+
+  // Folds what the native aggregator says changed into the cached lists and
+  // passes on only the lists that did; most schedule boundaries leave the
+  // browsers or the app blocker, if not both, alone.
+  void _applyPolicy(PolicyChange change) {
+    final modeChanged = change.allowList != _isAllowList;
+    final lists = {
+      'apps': _cachedApps,
+      'sites': _cachedSites,
+      'categories': _cachedCategories,
+    };
+    lists.forEach((kind, items) {
+      if (change.reset) {
+        items.clear();
+      }
+      items.removeAll(change.removed[kind]!);
+      items.addAll(change.added[kind]!);
+    });
+    _isAllowList = change.allowList;
+    _policySynced = true;
+
+    if (modeChanged || change.changed('apps') || change.changed('categories')) {
+      updateAppList();
+    }
+    if (modeChanged || change.changed('sites')) {
+      updateBlockedSites();
+    }
+  }
+
+  // Rebuilds the lists in Dart, where there is no native aggregator.
+  // [active] is the routines the schedule engine has on; without it each
+  // routine checks its own schedule.
+  void evaluate(List<Routine> routines, {Set<String>? active}) {
+    routines = routines.where((r) =>
+        (active?.contains(r.id) ?? (r.isActive && !r.isPaused)) && !r.areConditionsMet).toList();
 
     Set<String> apps = {}; 
     Set<String> sites = {};
@@ -139,9 +229,9 @@ class DesktopService extends PlatformService {
       sites.addAll(routine.sites.where((s) => !excludeSites.contains(s)));
       categories.addAll(routine.categories.where((c) => !excludeCategories.contains(c)));
     }
-    _cachedSites = sites.toList();
-    _cachedApps = apps.toList();
-    _cachedCategories = categories.toList();
+    _cachedSites = sites;
+    _cachedApps = apps;
+    _cachedCategories = categories;
     _isAllowList = allowList;
     updateAppList();
     updateBlockedSites();
@@ -158,16 +248,13 @@ class DesktopService extends PlatformService {
 
     await _desktopChannel.updateBlockingList(
       apps: apps,
-      sites: _cachedSites,
-      categories: _cachedCategories,
+      sites: _cachedSites.toList(),
+      categories: _cachedCategories.toList(),
       allowList: _isAllowList,
     );
   }
   Future<void> updateBlockedSites() async {
-    await BrowserService.instance.sendToBrowser('updateBlockedSites', {
-      'sites': _cachedSites,
-      'allowList': _isAllowList,
-    });
+    await BrowserService.instance.sendBlockedSites(_cachedSites.toList(), _isAllowList);
   }
 
   Future<void> setStartOnLogin(bool enabled) async {
@@ -225,7 +312,7 @@ class DesktopService extends PlatformService {
   Future<List<InstalledApp>> getInstalledApps() async {
     List<InstalledApp> installedApps = [];
 
-    if (Platform.isWindows) {
+    if (Platform.isWindows || Platform.isLinux) {
       installedApps = await _desktopChannel.getRunningApplications();
     } else if (Platform.isMacOS) {  
       Directory appDir = Directory('/Applications');
@@ -247,4 +334,14 @@ class DesktopService extends PlatformService {
     installedApps.sort((a, b) => (a.name).compareTo(b.name));
     return installedApps;
   }
+
+  Stream<List<InstalledApp>> watchInstalledApps() {
+    if (Platform.isWindows || Platform.isLinux) {
+      return _desktopChannel.watchRunningApplications().map((installedApps) {
+        installedApps.sort((a, b) => (a.name).compareTo(b.name));
+        return installedApps;
+      });
+    }
+    return Stream.fromFuture(getInstalledApps());
+  }
 }
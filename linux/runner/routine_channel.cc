@@ -0,0 +1,816 @@
+#include "routine_channel.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "core/desktop_session.h"
+#include "linux/proc_fs.h"
+#include "linux/x11_foreground_source.h"
+
+namespace {
+
+constexpr char kChannelName[] = "com.solidsoft.routine";
+constexpr char kAppsChannelName[] = "com.solidsoft.routine/running_apps";
+
+// Small enough that the picker shows its first rows while the rest of the
+// processes are still being described.
+constexpr size_t kAppBatchSize = 16;
+
+// Fallback poll for focus changes the X11 events missed.
+constexpr guint kPollIntervalMs = 2000;
+
+bool ReadStringList(FlValue* list, std::vector<std::string>* items) {
+  if (list == nullptr || fl_value_get_type(list) != FL_VALUE_TYPE_LIST) {
+    return false;
+  }
+  for (size_t i = 0; i < fl_value_get_length(list); ++i) {
+    FlValue* item = fl_value_get_list_value(list, i);
+    if (fl_value_get_type(item) == FL_VALUE_TYPE_STRING) {
+      items->emplace_back(fl_value_get_string(item));
+    }
+  }
+  return true;
+}
+
+int64_t ReadInt(FlValue* map, const char* key, int64_t fallback) {
+  FlValue* value = fl_value_lookup_string(map, key);
+  return value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_INT
+             ? fl_value_get_int(value)
+             : fallback;
+}
+
+// Epoch milliseconds to seconds, rounded up so a pause is never cut short.
+int64_t CeilSeconds(int64_t milliseconds) {
+  return milliseconds > 0 ? (milliseconds + 999) / 1000 : 0;
+}
+
+bool ReadBool(FlValue* map, const char* key) {
+  FlValue* value = fl_value_lookup_string(map, key);
+  return value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_BOOL &&
+         fl_value_get_bool(value);
+}
+
+// One {"id", "days", "start", "end", "pausedUntil", "snoozedUntil", "allow",
+// "apps", "sites", "categories"} entry of updateSchedule; the "until"s are
+// epoch milliseconds.
+bool ReadRoutine(FlValue* entry, std::string* id,
+                 routine::RoutineSchedule* schedule,
+                 routine::RoutinePolicy* policy) {
+  if (fl_value_get_type(entry) != FL_VALUE_TYPE_MAP) {
+    return false;
+  }
+  FlValue* value = fl_value_lookup_string(entry, "id");
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+    return false;
+  }
+  *id = fl_value_get_string(value);
+  schedule->days = static_cast<uint8_t>(ReadInt(entry, "days", 0) & 0x7f);
+  schedule->start_minute = static_cast<int32_t>(ReadInt(entry, "start", -1));
+  schedule->end_minute = static_cast<int32_t>(ReadInt(entry, "end", -1));
+  schedule->paused_until = CeilSeconds(ReadInt(entry, "pausedUntil", 0));
+  schedule->snoozed_until = CeilSeconds(ReadInt(entry, "snoozedUntil", 0));
+  policy->allow = ReadBool(entry, "allow");
+  std::pair<const char*, std::vector<std::string>*> lists[] = {
+      {"apps", &policy->items.apps},
+      {"sites", &policy->items.sites},
+      {"categories", &policy->items.categories}};
+  for (const auto& [key, items] : lists) {
+    FlValue* list = fl_value_lookup_string(entry, key);
+    if (list != nullptr && !ReadStringList(list, items)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+FlValue* NewStringList(const std::vector<std::string>& items) {
+  FlValue* list = fl_value_new_list();
+  for (const std::string& item : items) {
+    fl_value_append_take(list, fl_value_new_string(item.c_str()));
+  }
+  return list;
+}
+
+FlValue* NewPolicyItems(const routine::PolicyItems& items) {
+  FlValue* map = fl_value_new_map();
+  fl_value_set_string_take(map, "apps", NewStringList(items.apps));
+  fl_value_set_string_take(map, "sites", NewStringList(items.sites));
+  fl_value_set_string_take(map, "categories",
+                           NewStringList(items.categories));
+  return map;
+}
+
+gboolean RunPostedTask(gpointer data) {
+  (*static_cast<routine::WorkerPool::Task*>(data))();
+  return G_SOURCE_REMOVE;
+}
+
+void DeletePostedTask(gpointer data) {
+  delete static_cast<routine::WorkerPool::Task*>(data);
+}
+
+// Runs |task| on the main loop, where every method call is answered.
+void PostToMainContext(routine::WorkerPool::Task task) {
+  g_main_context_invoke_full(nullptr, G_PRIORITY_DEFAULT, RunPostedTask,
+                             new routine::WorkerPool::Task(std::move(task)),
+                             DeletePostedTask);
+}
+
+void Respond(FlMethodCall* method_call, FlMethodResponse* response) {
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to respond to %s: %s",
+              fl_method_call_get_name(method_call), error->message);
+  }
+}
+
+FlValue* AppToValue(const routine::RunningApp& app) {
+  FlValue* entry = fl_value_new_map();
+  fl_value_set_string_take(entry, "name", fl_value_new_string(app.name.c_str()));
+  fl_value_set_string_take(entry, "displayName",
+                           fl_value_new_string(app.display_name.c_str()));
+  fl_value_set_string_take(entry, "path", fl_value_new_string(app.path.c_str()));
+  return entry;
+}
+
+const char* ChangeName(routine::AppEventBatcher::Change change) {
+  return change == routine::AppEventBatcher::Change::kAdded ? "added"
+                                                            : "removed";
+}
+
+// {"event": "added" | "removed" | "listed", "apps": [...]}
+FlValue* AppEventToValue(const char* event,
+                         const std::vector<routine::RunningApp>& apps) {
+  FlValue* value = fl_value_new_map();
+  fl_value_set_string_take(value, "event", fl_value_new_string(event));
+  FlValue* list = fl_value_new_list();
+  for (const auto& app : apps) {
+    fl_value_append_take(list, AppToValue(app));
+  }
+  fl_value_set_string_take(value, "apps", list);
+  return value;
+}
+
+// Sends |event| if |listener| is still the one listening.
+void SendAppEvent(const std::weak_ptr<FlEventChannel>& listener,
+                  FlValue* event) {
+  const auto channel = listener.lock();
+  if (!channel) {
+    return;
+  }
+  g_autoptr(GError) error = nullptr;
+  if (!fl_event_channel_send(channel.get(), event, nullptr, &error)) {
+    g_warning("Failed to send running app event: %s", error->message);
+  }
+}
+
+std::string MetadataCachePath() {
+  g_autofree gchar* directory =
+      g_build_filename(g_get_user_cache_dir(), "routine", nullptr);
+  if (g_mkdir_with_parents(directory, 0700) != 0) {
+    return std::string();
+  }
+  g_autofree gchar* path =
+      g_build_filename(directory, "exe_metadata.bin", nullptr);
+  return path;
+}
+
+// Daily foreground time per app, kept with the user's data since it is not
+// a cache.
+std::string UsagePath() {
+  g_autofree gchar* directory =
+      g_build_filename(g_get_user_data_dir(), "routine", nullptr);
+  if (g_mkdir_with_parents(directory, 0700) != 0) {
+    return std::string();
+  }
+  g_autofree gchar* path = g_build_filename(directory, "usage.bin", nullptr);
+  return path;
+}
+
+routine::UsageTracker::Options UsageOptions() {
+  routine::UsageTracker::Options options;
+  options.path = UsagePath();
+  return options;
+}
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// ROUTINE_ENFORCE=freeze or throttle stops blocked apps through the cgroup
+// freezer; ROUTINE_CPU_PERCENT sets the throttle, 10% of a CPU by default.
+routine::Enforcer::Mode EnforcementMode() {
+  const char* mode = std::getenv("ROUTINE_ENFORCE");
+  return mode != nullptr && (g_strcmp0(mode, "freeze") == 0 ||
+                             g_strcmp0(mode, "throttle") == 0)
+             ? routine::Enforcer::Mode::kFreeze
+             : routine::Enforcer::Mode::kMinimize;
+}
+
+routine::CgroupFreezer::Options FreezerOptions() {
+  routine::CgroupFreezer::Options options;
+  if (g_strcmp0(std::getenv("ROUTINE_ENFORCE"), "throttle") == 0) {
+    const char* percent = std::getenv("ROUTINE_CPU_PERCENT");
+    options.cpu_percent = percent != nullptr ? std::atoi(percent) : 10;
+    if (options.cpu_percent <= 0) {
+      options.cpu_percent = 1;
+    }
+  }
+  return options;
+}
+
+// Splits "address", "address:port" or "[v6 address]:port".
+void SplitHostPort(const std::string& value, std::string* address,
+                   uint16_t* port) {
+  std::string host = value;
+  const size_t colon = value.rfind(':');
+  if (!value.empty() && value[0] == '[') {
+    const size_t close = value.find(']');
+    host = value.substr(1, close == std::string::npos ? std::string::npos
+                                                       : close - 1);
+    if (close != std::string::npos && colon == close + 1) {
+      *port = static_cast<uint16_t>(std::atoi(value.c_str() + colon + 1));
+    }
+  } else if (colon != std::string::npos && value.find(':') == colon) {
+    host = value.substr(0, colon);
+    *port = static_cast<uint16_t>(std::atoi(value.c_str() + colon + 1));
+  }
+  *address = host;
+}
+
+// The first nameserver in resolv.conf that is not on loopback, where the
+// sinkhole itself, or a local stub such as systemd-resolved, listens.
+std::string SystemNameserver() {
+  std::ifstream resolv("/etc/resolv.conf");
+  std::string line;
+  while (std::getline(resolv, line)) {
+    std::istringstream fields(line);
+    std::string keyword;
+    std::string address;
+    if (fields >> keyword >> address && keyword == "nameserver" &&
+        address.rfind("127.", 0) != 0 && address != "::1") {
+      return address;
+    }
+  }
+  return std::string();
+}
+
+// Starts the DNS sinkhole if ROUTINE_DNS_LISTEN names an address to listen
+// on. ROUTINE_DNS_UPSTREAM overrides the resolver it relays to, and
+// ROUTINE_DNS_ANSWER=sinkhole answers blocked names with 0.0.0.0 instead of
+// NXDOMAIN.
+std::unique_ptr<routine::DnsSinkhole> StartDnsSinkhole() {
+  const char* listen = std::getenv("ROUTINE_DNS_LISTEN");
+  if (listen == nullptr) {
+    return nullptr;
+  }
+  routine::DnsSinkhole::Options options;
+  SplitHostPort(listen, &options.listen_address, &options.listen_port);
+  const char* upstream = std::getenv("ROUTINE_DNS_UPSTREAM");
+  SplitHostPort(upstream != nullptr ? upstream : SystemNameserver(),
+                &options.upstream_address, &options.upstream_port);
+  const char* answer = std::getenv("ROUTINE_DNS_ANSWER");
+  if (answer != nullptr && g_strcmp0(answer, "sinkhole") == 0) {
+    options.block_answer = routine::DnsSinkhole::BlockAnswer::kSinkhole;
+  }
+
+  auto sinkhole = std::make_unique<routine::DnsSinkhole>(options);
+  if (!sinkhole->Start()) {
+    g_warning("Could not start the DNS sinkhole on %s relaying to %s", listen,
+              options.upstream_address.c_str());
+    return nullptr;
+  }
+  g_message("Blocking sites over DNS on %s", listen);
+  return sinkhole;
+}
+
+std::string BaseName(const std::string& path) {
+  const size_t slash = path.find_last_of('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+}  // namespace
+
+RoutineChannel::RoutineChannel(FlPluginRegistry* registry)
+    : cgroup_freezer_(routine::ProcFs(), FreezerOptions()),
+      enforcer_(&policy_, routine::ProcFs(), EnforcementMode(),
+                [this](uint64_t window) { return x11_.Iconify(window); },
+                &enforcement_stats_, &cgroup_freezer_),
+      exec_blocker_(&enforcer_, &process_tree_),
+      exec_guard_(&policy_, routine::ExecGuard::Options()),
+      usage_(UsageOptions(), &time_zone_),
+      metadata_cache_(MetadataCachePath()),
+      // A single worker: it only has to keep slow handlers off the main
+      // loop, and the process table is not thread-safe.
+      worker_pool_(1, PostToMainContext) {
+  // Before anything that enforces runs.
+  if (EnforcementMode() == routine::Enforcer::Mode::kFreeze) {
+    if (cgroup_freezer_.Open()) {
+      g_message("Freezing blocked applications in %s",
+                cgroup_freezer_.root().c_str());
+    } else {
+      g_warning("cgroup v2 freezer unavailable, suspending instead");
+    }
+  }
+  enforcer_.set_process_tree(&process_tree_);
+
+  g_autoptr(FlPluginRegistrar) registrar =
+      fl_plugin_registry_get_registrar_for_plugin(registry, "RoutineChannel");
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  channel_ = fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                                   kChannelName, FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(channel_, HandleMethodCall, this,
+                                            nullptr);
+  apps_channel_ =
+      fl_event_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                           kAppsChannelName, FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(apps_channel_, HandleAppsListen,
+                                       HandleAppsCancel, this, nullptr);
+
+  foreground_tracker_ = std::make_unique<routine::ForegroundTracker>(
+      std::make_unique<routine::X11ForegroundSource>(),
+      [this](const routine::ForegroundWindow& window) {
+        const bool blocked = enforcer_.Enforce(window);
+        if (blocked) {
+          g_message("Blocking application with pid %ld",
+                    static_cast<long>(window.pid));
+        }
+        // A blocked window is gone before it is used.
+        const std::string exe = blocked || window.pid <= 0
+                                    ? std::string()
+                                    : routine::ProcFs().ReadExe(window.pid);
+        if (usage_.Focus(exe, NowMs())) {
+          g_message("Application with pid %ld is out of time for today",
+                    static_cast<long>(window.pid));
+          x11_.Iconify(window.window);
+        }
+      },
+      std::chrono::milliseconds(kPollIntervalMs), &enforcement_stats_);
+  // Time on the bare desktop or a locked screen counts for no app.
+  foreground_tracker_->set_unfocus_handler(
+      [this] { usage_.Focus(std::string(), NowMs()); });
+  // ROUTINE_TRACE=1 records trace spans from startup, for traces of the
+  // first enforcement.
+  if (std::getenv("ROUTINE_TRACE") != nullptr) {
+    enforcement_stats_.trace.set_enabled(true);
+  }
+  if (!foreground_tracker_->Start()) {
+    g_warning("X11 focus events unavailable, polling only");
+  }
+  poll_source_ = g_timeout_add(kPollIntervalMs, HandlePollTimer, this);
+
+  if (exec_blocker_.Start()) {
+    g_message("Blocking applications at exec time");
+  }
+  if (exec_guard_.Start()) {
+    g_message("Denying blocked executables before they run");
+  }
+  dns_sinkhole_ = StartDnsSinkhole();
+}
+
+RoutineChannel::~RoutineChannel() {
+  if (poll_source_ != 0) {
+    g_source_remove(poll_source_);
+  }
+  foreground_tracker_.reset();
+  apps_listener_.reset();
+  g_clear_object(&apps_channel_);
+  g_clear_object(&channel_);
+}
+
+void RoutineChannel::HandleMethodCall(FlMethodChannel* channel,
+                                      FlMethodCall* method_call,
+                                      gpointer user_data) {
+  auto* self = static_cast<RoutineChannel*>(user_data);
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (g_strcmp0(method, "engineReady") == 0) {
+    g_message("Received engineReady");
+    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (g_strcmp0(method, "updateAppList") == 0) {
+    g_message("Received updateAppList");
+    response = self->UpdateAppList(args);
+  } else if (g_strcmp0(method, "updateSchedule") == 0) {
+    g_message("Received updateSchedule");
+    response = self->UpdateSchedule(args);
+  } else if (g_strcmp0(method, "evaluateSchedule") == 0) {
+    response = self->EvaluateSchedule(args);
+  } else if (g_strcmp0(method, "getEnforcementStats") == 0) {
+    response = self->GetEnforcementStats(args);
+  } else if (g_strcmp0(method, "setUsageBudgets") == 0) {
+    response = self->SetUsageBudgets(args);
+  } else if (g_strcmp0(method, "getUsage") == 0) {
+    response = self->GetUsage(args);
+  } else if (g_strcmp0(method, "setStartOnLogin") == 0) {
+    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (g_strcmp0(method, "getStartOnLogin") == 0) {
+    g_autoptr(FlValue) result = fl_value_new_bool(FALSE);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (g_strcmp0(method, "getRunningApplications") == 0) {
+    g_message("Received getRunningApplications");
+    self->SubmitRunningApplications(method_call);
+    return;
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  Respond(method_call, response);
+}
+
+gboolean RoutineChannel::HandlePollTimer(gpointer user_data) {
+  auto* self = static_cast<RoutineChannel*>(user_data);
+  self->enforcement_stats_.timer_wakeups.Mark();
+  self->foreground_tracker_->Poll();
+  // The focused app ran out of time while it had focus.
+  if (self->usage_.Tick(NowMs())) {
+    self->foreground_tracker_->Refresh();
+  }
+  if (self->apps_listener_) {
+    self->SubmitAppsRescan();
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+FlMethodErrorResponse* RoutineChannel::HandleAppsListen(FlEventChannel* channel,
+                                                        FlValue* args,
+                                                        gpointer user_data) {
+  auto* self = static_cast<RoutineChannel*>(user_data);
+  self->apps_listener_.reset(FL_EVENT_CHANNEL(g_object_ref(channel)),
+                             g_object_unref);
+  const std::weak_ptr<FlEventChannel> listener = self->apps_listener_;
+
+  // Start with what the table already knows, then stream the newcomers as
+  // they are described; "listed" marks the end of the initial listing.
+  self->worker_pool_.Submit(
+      "runningApps.listen",
+      [self, listener](const routine::CancellationToken& token) {
+        auto events = std::make_unique<routine::AppEventBatcher>(
+            kAppBatchSize, [listener](routine::AppEventBatcher::Batch batch) {
+              std::shared_ptr<FlValue> event(
+                  AppEventToValue(ChangeName(batch.change), batch.apps),
+                  fl_value_unref);
+              PostToMainContext(
+                  [listener, event] { SendAppEvent(listener, event.get()); });
+            });
+        for (const auto& app : self->running_processes_.Apps()) {
+          events->AppAdded(app);
+        }
+        // Swapped in before the previous listener's batcher goes away.
+        self->running_processes_.set_observer(events.get());
+        self->app_events_ = std::move(events);
+        self->UpdateRunningProcesses(token);
+        return routine::WorkerPool::Task([listener] {
+          g_autoptr(FlValue) event = AppEventToValue("listed", {});
+          SendAppEvent(listener, event);
+        });
+      },
+      [] {});
+  return nullptr;
+}
+
+FlMethodErrorResponse* RoutineChannel::HandleAppsCancel(FlEventChannel* channel,
+                                                        FlValue* args,
+                                                        gpointer user_data) {
+  auto* self = static_cast<RoutineChannel*>(user_data);
+  self->apps_listener_.reset();
+  self->worker_pool_.Submit(
+      "runningApps.cancel",
+      [self](const routine::CancellationToken&) {
+        self->running_processes_.set_observer(nullptr);
+        self->app_events_.reset();
+        return routine::WorkerPool::Task([] {});
+      },
+      [] {});
+  return nullptr;
+}
+
+FlMethodResponse* RoutineChannel::UpdateAppList(FlValue* args) {
+  std::vector<std::string> apps;
+  std::vector<std::string> sites;
+  std::vector<std::string> categories;
+  FlValue* allow = nullptr;
+
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP ||
+      !ReadStringList(fl_value_lookup_string(args, "apps"), &apps) ||
+      !ReadStringList(fl_value_lookup_string(args, "categories"),
+                      &categories) ||
+      (allow = fl_value_lookup_string(args, "allowList")) == nullptr ||
+      fl_value_get_type(allow) != FL_VALUE_TYPE_BOOL) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "Arguments for updateAppList are invalid", nullptr, nullptr));
+  }
+
+  routine::RuleSet::Options options;
+  options.allow_list = fl_value_get_bool(allow);
+
+  routine::RuleSet::Builder builder{options};
+  builder.AddExempt(routine::ProcFs().ReadExe(getpid()));
+  routine::AddLinuxSession(options.allow_list, &builder);
+  for (const auto& app : apps) {
+    builder.AddApp(app);
+  }
+  for (const auto& category : categories) {
+    builder.AddDirectory(category);
+  }
+  policy_.Set(builder.Build());
+
+  if (dns_sinkhole_ &&
+      ReadStringList(fl_value_lookup_string(args, "sites"), &sites)) {
+    dns_sinkhole_->SetSites(options.allow_list, sites);
+  }
+
+  // The focused app may have just become blocked, and suspended ones
+  // unblocked.
+  foreground_tracker_->Refresh();
+  enforcer_.Reconcile();
+  exec_guard_.Reconcile();
+
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+FlMethodResponse* RoutineChannel::UpdateSchedule(FlValue* args) {
+  FlValue* list = nullptr;
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP ||
+      (list = fl_value_lookup_string(args, "routines")) == nullptr ||
+      fl_value_get_type(list) != FL_VALUE_TYPE_LIST) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "Arguments for updateSchedule are invalid", nullptr, nullptr));
+  }
+
+  const size_t count = fl_value_get_length(list);
+  std::vector<routine::RoutineSchedule> schedules(count);
+  std::vector<routine::RoutinePolicy> policies(count);
+  std::vector<std::string> ids(count);
+  for (size_t i = 0; i < count; ++i) {
+    if (!ReadRoutine(fl_value_get_list_value(list, i), &ids[i], &schedules[i],
+                     &policies[i])) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "Arguments for updateSchedule are invalid", nullptr, nullptr));
+    }
+  }
+  schedule_ = std::make_unique<routine::ScheduleIndex>(schedules);
+
+  // Only routines that changed while on move the policy.
+  const std::unordered_set<std::string> kept(ids.begin(), ids.end());
+  for (const std::string& id : schedule_ids_) {
+    if (kept.count(id) == 0) {
+      routine_policies_.RemoveRoutine(id);
+    }
+  }
+  for (size_t i = 0; i < count; ++i) {
+    routine_policies_.SetRoutine(ids[i], std::move(policies[i]));
+  }
+  schedule_ids_ = std::move(ids);
+  return EvaluateSchedule(args);
+}
+
+FlMethodResponse* RoutineChannel::EvaluateSchedule(FlValue* args) {
+  bool full = false;
+  // Routines whose conditions the app found done; they stay off whatever
+  // their schedule says.
+  std::vector<std::string> done_ids;
+  if (args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    full = ReadBool(args, "full");
+    ReadStringList(fl_value_lookup_string(args, "done"), &done_ids);
+  }
+  const std::unordered_set<std::string> done(done_ids.begin(),
+                                             done_ids.end());
+
+  const int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+  // {"active": [routine ids], "next": epoch ms, or -1 for never,
+  //  "policy": {"allowList", "reset", "added": {"apps", "sites",
+  //  "categories"}, "removed": {...}}}
+  FlValue* active = fl_value_new_list();
+  int64_t next = routine::ScheduleIndex::kNever;
+  if (schedule_) {
+    std::vector<bool> on(schedule_ids_.size());
+    for (const uint32_t index : schedule_->ActiveAt(now, time_zone_)) {
+      fl_value_append_take(active,
+                           fl_value_new_string(schedule_ids_[index].c_str()));
+      on[index] = true;
+    }
+    next = schedule_->NextTransition(now, time_zone_);
+    for (size_t i = 0; i < schedule_ids_.size(); ++i) {
+      routine_policies_.SetActive(
+          schedule_ids_[i], on[i] && done.count(schedule_ids_[i]) == 0);
+    }
+  }
+
+  routine::PolicyDelta delta = routine_policies_.TakeDelta();
+  if (full && !delta.reset) {
+    delta.reset = true;
+    delta.added = routine_policies_.Effective();
+    delta.removed = routine::PolicyItems();
+  }
+  FlValue* policy = fl_value_new_map();
+  fl_value_set_string_take(policy, "allowList",
+                           fl_value_new_bool(delta.allow_list));
+  fl_value_set_string_take(policy, "reset", fl_value_new_bool(delta.reset));
+  fl_value_set_string_take(policy, "added", NewPolicyItems(delta.added));
+  fl_value_set_string_take(policy, "removed", NewPolicyItems(delta.removed));
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "active", active);
+  fl_value_set_string_take(
+      result, "next",
+      fl_value_new_int(next == routine::ScheduleIndex::kNever ? -1
+                                                              : next * 1000));
+  fl_value_set_string_take(result, "policy", policy);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+FlMethodResponse* RoutineChannel::GetEnforcementStats(FlValue* args) {
+  const bool has_args =
+      args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP;
+  FlValue* trace = has_args ? fl_value_lookup_string(args, "trace") : nullptr;
+  if (trace != nullptr && fl_value_get_type(trace) == FL_VALUE_TYPE_BOOL) {
+    enforcement_stats_.trace.set_enabled(fl_value_get_bool(trace));
+  }
+  FlValue* trace_path =
+      has_args ? fl_value_lookup_string(args, "tracePath") : nullptr;
+  if (trace_path != nullptr &&
+      fl_value_get_type(trace_path) == FL_VALUE_TYPE_STRING &&
+      !enforcement_stats_.trace.WriteTo(fl_value_get_string(trace_path))) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "trace_failed", "Could not write the trace file", nullptr));
+  }
+
+  routine::EnforcementExtras extras;
+  extras.cache = policy_.cache_stats();
+  const std::string json = routine::EnforcementStatsJson(
+      enforcement_stats_, extras, std::chrono::steady_clock::now());
+  g_autoptr(FlValue) result = fl_value_new_string(json.c_str());
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+FlMethodResponse* RoutineChannel::SetUsageBudgets(FlValue* args) {
+  FlValue* budgets = args != nullptr &&
+                             fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                         ? fl_value_lookup_string(args, "budgets")
+                         : nullptr;
+  if (budgets == nullptr || fl_value_get_type(budgets) != FL_VALUE_TYPE_MAP) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "Arguments for setUsageBudgets are invalid", nullptr, nullptr));
+  }
+  std::vector<std::pair<std::string, int64_t>> minutes;
+  for (size_t i = 0; i < fl_value_get_length(budgets); ++i) {
+    FlValue* path = fl_value_get_map_key(budgets, i);
+    FlValue* limit = fl_value_get_map_value(budgets, i);
+    if (fl_value_get_type(path) == FL_VALUE_TYPE_STRING &&
+        fl_value_get_type(limit) == FL_VALUE_TYPE_INT) {
+      minutes.emplace_back(fl_value_get_string(path), fl_value_get_int(limit));
+    }
+  }
+  usage_.SetBudgets(minutes);
+
+  // The focused app may have just run out of time.
+  foreground_tracker_->Refresh();
+
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+FlMethodResponse* RoutineChannel::GetUsage(FlValue* args) {
+  const int64_t now = NowMs();
+  const bool has_args =
+      args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP;
+  const int64_t first_day =
+      usage_.LocalDay(has_args ? ReadInt(args, "from", now) : now);
+  const int64_t last_day =
+      usage_.LocalDay(has_args ? ReadInt(args, "to", now) : now);
+  const routine::UsageTracker::Totals totals =
+      usage_.Query(first_day, last_day, now);
+
+  // {"days": [start of day, epoch ms], "apps": [paths], "ms": [foreground
+  //  ms], "remaining": {path: ms left today}}, one row per app and day.
+  FlValue* days = fl_value_new_list();
+  FlValue* apps = fl_value_new_list();
+  FlValue* ms = fl_value_new_list();
+  for (size_t i = 0; i < totals.days.size(); ++i) {
+    fl_value_append_take(days,
+                         fl_value_new_int(usage_.DayStart(totals.days[i])));
+    fl_value_append_take(apps, fl_value_new_string(totals.apps[i].c_str()));
+    fl_value_append_take(ms, fl_value_new_int(totals.ms[i]));
+  }
+  FlValue* remaining = fl_value_new_map();
+  for (const auto& [path, left] : usage_.RemainingAll(now)) {
+    fl_value_set_string_take(remaining, path.c_str(), fl_value_new_int(left));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "days", days);
+  fl_value_set_string_take(result, "apps", apps);
+  fl_value_set_string_take(result, "ms", ms);
+  fl_value_set_string_take(result, "remaining", remaining);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+void RoutineChannel::SubmitRunningApplications(FlMethodCall* method_call) {
+  // Enumeration touches every running process; answer from the worker so
+  // the window keeps painting meanwhile.
+  std::shared_ptr<FlMethodCall> call(FL_METHOD_CALL(g_object_ref(method_call)),
+                                     g_object_unref);
+  worker_pool_.Submit(
+      fl_method_call_get_name(method_call),
+      [this, call](const routine::CancellationToken& token) {
+        std::shared_ptr<FlMethodResponse> response(
+            GetRunningApplications(token), g_object_unref);
+        return [call, response] { Respond(call.get(), response.get()); };
+      },
+      [call] {
+        g_autoptr(FlMethodResponse) response =
+            FL_METHOD_RESPONSE(fl_method_error_response_new(
+                "cancelled", "Superseded by a newer request", nullptr));
+        Respond(call.get(), response);
+      });
+}
+
+void RoutineChannel::SubmitAppsRescan() {
+  // Picks up processes that started or exited since the last enumeration;
+  // only the changes reach the listener.
+  worker_pool_.Submit(
+      "runningApps.rescan",
+      [this](const routine::CancellationToken& token) {
+        if (app_events_) {
+          UpdateRunningProcesses(token);
+        }
+        return routine::WorkerPool::Task([] {});
+      },
+      [] {});
+}
+
+FlMethodResponse* RoutineChannel::GetRunningApplications(
+    const routine::CancellationToken& token) {
+  if (UpdateRunningProcesses(token).cancelled) {
+    // Nobody will see this; the cancelled callback answers instead.
+    return FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_list();
+  for (const auto& app : running_processes_.Apps()) {
+    fl_value_append_take(result, AppToValue(app));
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+routine::ProcessTable::Diff RoutineChannel::UpdateRunningProcesses(
+    const routine::CancellationToken& token) {
+  routine::ProcFs proc;
+  // Without a window list fall back to every process of the current user.
+  const auto client_pids = x11_.ClientPids();
+  const uid_t uid = getuid();
+
+  // One small read of /proc/<pid>/stat per process tells us which ones are
+  // new; only those get their exe resolved.
+  std::vector<routine::ProcessKey> current;
+  for (const int64_t pid : proc.ListPids()) {
+    routine::ProcessInfo info;
+    if ((!client_pids || client_pids->count(pid) != 0) &&
+        proc.ReadStat(pid, &info)) {
+      current.push_back(routine::ProcessKey{pid, info.start_time});
+    }
+  }
+
+  auto describe = [&](const routine::ProcessKey& key) {
+    std::optional<routine::RunningApp> app;
+    const auto info = proc.Read(key.pid);
+    if (info && !info->exe.empty() && (client_pids || info->uid == uid)) {
+      const routine::ExeMetadata metadata = metadata_cache_.Get(
+          info->exe, [this](const std::string& exe) {
+            routine::ExeMetadata read;
+            if (auto entry = desktop_entries_.Find(exe)) {
+              read.display_name = entry->name;
+              read.icon = entry->icon;
+            }
+            return read;
+          });
+      const std::string name = BaseName(info->exe);
+      app = routine::RunningApp{
+          name, metadata.display_name.empty() ? name : metadata.display_name,
+          info->exe};
+    }
+    return app;
+  };
+  const auto diff = running_processes_.Update(current, describe, &token);
+  if (app_events_) {
+    app_events_->Flush();
+  }
+  return diff;
+}
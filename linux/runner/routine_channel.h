@@ -0,0 +1,136 @@
+#ifndef RUNNER_ROUTINE_CHANNEL_H_
+#define RUNNER_ROUTINE_CHANNEL_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/app_event_batcher.h"
+#include "core/enforcement_stats.h"
+#include "core/foreground_tracker.h"
+#include "core/metadata_cache.h"
+#include "core/policy_aggregator.h"
+#include "core/policy_store.h"
+#include "core/process_table.h"
+#include "core/process_tree.h"
+#include "core/schedule_index.h"
+#include "core/time_zone.h"
+#include "core/usage_tracker.h"
+#include "core/worker_pool.h"
+#include "linux/cgroup_freezer.h"
+#include "linux/desktop_entries.h"
+#include "linux/dns_sinkhole.h"
+#include "linux/enforcer.h"
+#include "linux/exec_blocker.h"
+#include "linux/exec_guard.h"
+#include "linux/x11_session.h"
+
+// The native side of the com.solidsoft.routine method channel: the same
+// contract DesktopChannel uses on Windows, backed by the shared routine_core
+// matcher. Enforcement follows X11 focus changes and minimises blocked
+// windows; with CAP_NET_ADMIN blocked apps are also suspended as they exec,
+// and with CAP_SYS_ADMIN their exec is denied outright. ROUTINE_ENFORCE=freeze
+// freezes blocked apps' process trees in a cgroup instead of minimising
+// them, and ROUTINE_ENFORCE=throttle limits their CPU.
+// With ROUTINE_DNS_LISTEN set, a loopback DNS sinkhole refuses blocked sites
+// to every program, not just browsers with the extension.
+// Foreground time is counted per app and day, and apps over their daily
+// budget are minimised.
+// The running_apps event channel streams the picker's app list.
+class RoutineChannel {
+ public:
+  explicit RoutineChannel(FlPluginRegistry* registry);
+  ~RoutineChannel();
+
+  RoutineChannel(const RoutineChannel&) = delete;
+  RoutineChannel& operator=(const RoutineChannel&) = delete;
+
+ private:
+  static void HandleMethodCall(FlMethodChannel* channel,
+                               FlMethodCall* method_call, gpointer user_data);
+  static gboolean HandlePollTimer(gpointer user_data);
+  static FlMethodErrorResponse* HandleAppsListen(FlEventChannel* channel,
+                                                 FlValue* args,
+                                                 gpointer user_data);
+  static FlMethodErrorResponse* HandleAppsCancel(FlEventChannel* channel,
+                                                 FlValue* args,
+                                                 gpointer user_data);
+
+  FlMethodResponse* UpdateAppList(FlValue* args);
+  // Compiles the routines' schedules and takes in their lists, then answers
+  // as EvaluateSchedule().
+  FlMethodResponse* UpdateSchedule(FlValue* args);
+  // Which routines are on now, when that next changes, and how the blocking
+  // policy changed since the last answer: all of it if |args| has "full",
+  // and with the routines its "done" list names off.
+  FlMethodResponse* EvaluateSchedule(FlValue* args);
+  // The enforcement counters and latencies as JSON. |args| may turn tracing
+  // on or off with "trace" and write the spans kept so far to "tracePath".
+  FlMethodResponse* GetEnforcementStats(FlValue* args);
+  // Replaces the daily budgets with |args|' "budgets", minutes by path.
+  FlMethodResponse* SetUsageBudgets(FlValue* args);
+  // Foreground time per app and day between |args|' "from" and "to", and
+  // what each budgeted app has left today, in one answer.
+  FlMethodResponse* GetUsage(FlValue* args);
+  void SubmitRunningApplications(FlMethodCall* method_call);
+  // Runs on the worker thread.
+  FlMethodResponse* GetRunningApplications(
+      const routine::CancellationToken& token);
+  void SubmitAppsRescan();
+  // Runs on the worker thread. Reconciles running_processes_ with the
+  // processes running now and flushes the changes to the app stream.
+  routine::ProcessTable::Diff UpdateRunningProcesses(
+      const routine::CancellationToken& token);
+
+  FlMethodChannel* channel_ = nullptr;
+  FlEventChannel* apps_channel_ = nullptr;
+  // The current listener of apps_channel_, null while nobody listens.
+  // Replaced on every listen, so events queued for an earlier listener find
+  // their pointer expired. Main loop only.
+  std::shared_ptr<FlEventChannel> apps_listener_;
+  guint poll_source_ = 0;
+
+  routine::PolicyStore policy_;
+  // Recorded into by the tracker, the enforcer and the poll timer. Before
+  // them, so it outlives them.
+  routine::EnforcementStats enforcement_stats_;
+  // The routines' schedules, indexed by position in schedule_ids_. Main
+  // loop only.
+  std::unique_ptr<routine::ScheduleIndex> schedule_;
+  std::vector<std::string> schedule_ids_;
+  // What the routines that are on block, by routine id. Main loop only.
+  routine::PolicyAggregator routine_policies_;
+  routine::SystemTimeZone time_zone_;
+  routine::X11Session x11_;
+  // Used by enforcer_ when ROUTINE_ENFORCE asks for it.
+  routine::CgroupFreezer cgroup_freezer_;
+  // Who started whom, kept by exec_blocker_ for enforcer_ to block what
+  // blocked apps start. Empty unless exec_blocker_ runs.
+  routine::ProcessTree process_tree_;
+  routine::Enforcer enforcer_;
+  routine::ExecBlocker exec_blocker_;
+  routine::ExecGuard exec_guard_;
+  // Null unless ROUTINE_DNS_LISTEN asks for it.
+  std::unique_ptr<routine::DnsSinkhole> dns_sinkhole_;
+  // Fed by the tracker and ticked by the poll timer; minimises apps whose
+  // budget is used up. Before the tracker, so it outlives it.
+  routine::UsageTracker usage_;
+  std::unique_ptr<routine::ForegroundTracker> foreground_tracker_;
+
+  // Processes seen by the last getRunningApplications or app stream rescan,
+  // so later ones only inspect newcomers.
+  routine::ProcessTable running_processes_;
+  // Observes running_processes_ while the app stream is listened to.
+  // Worker thread only.
+  std::unique_ptr<routine::AppEventBatcher> app_events_;
+  // Desktop entry names and icons, persisted per executable version.
+  routine::MetadataCache metadata_cache_;
+  routine::DesktopEntries desktop_entries_;
+
+  // Last, so it is joined before anything its work touches goes away.
+  routine::WorkerPool worker_pool_;
+};
+
+#endif  // RUNNER_ROUTINE_CHANNEL_H_
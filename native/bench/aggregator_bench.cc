@@ -0,0 +1,115 @@
+// Measures PolicyAggregator against rebuilding the effective lists from
+// every routine the way DesktopService.evaluate does at each schedule
+// boundary.
+//
+//   aggregator_bench [routines] [items per routine]
+//
+// Builds |routines| (default 1000) block routines of |items| (default 50)
+// apps, sites and categories each, drawn from a pool shared between
+// routines, with half of them on, and reports the cost of flipping one
+// routine and taking the delta, of the full rebuild, and how many items the
+// delta carries against the full lists.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "core/policy_aggregator.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double MicrosSince(Clock::time_point start, size_t count) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start)
+             .count() /
+         count;
+}
+
+size_t Count(const routine::PolicyItems& items) {
+  return items.apps.size() + items.sites.size() + items.categories.size();
+}
+
+// DesktopService.evaluate for block routines: the union of every list.
+size_t Rebuild(const std::vector<routine::RoutinePolicy>& routines,
+               const std::vector<bool>& active) {
+  std::unordered_set<std::string> apps;
+  std::unordered_set<std::string> sites;
+  std::unordered_set<std::string> categories;
+  for (size_t i = 0; i < routines.size(); ++i) {
+    if (!active[i]) {
+      continue;
+    }
+    const routine::PolicyItems& items = routines[i].items;
+    apps.insert(items.apps.begin(), items.apps.end());
+    sites.insert(items.sites.begin(), items.sites.end());
+    categories.insert(items.categories.begin(), items.categories.end());
+  }
+  return apps.size() + sites.size() + categories.size();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t routine_count = argc > 1 ? std::atoi(argv[1]) : 1000;
+  const size_t item_count = argc > 2 ? std::atoi(argv[2]) : 50;
+  const size_t pool = std::max<size_t>(routine_count * item_count / 4, 1);
+  const size_t flips = argc > 3 ? std::atoi(argv[3]) : 500;
+
+  std::mt19937 random(1);
+  std::uniform_int_distribution<size_t> pick(0, pool - 1);
+  std::vector<routine::RoutinePolicy> routines(routine_count);
+  std::vector<bool> active(routine_count);
+  routine::PolicyAggregator aggregator;
+  for (size_t i = 0; i < routine_count; ++i) {
+    for (size_t j = 0; j < item_count; ++j) {
+      routines[i].items.apps.push_back("/usr/bin/app" +
+                                       std::to_string(pick(random)));
+      routines[i].items.sites.push_back("site" + std::to_string(pick(random)) +
+                                        ".com");
+      routines[i].items.categories.push_back("/opt/dir" +
+                                             std::to_string(pick(random)));
+    }
+    aggregator.SetRoutine(std::to_string(i), routines[i]);
+    active[i] = i % 2 == 0;
+    aggregator.SetActive(std::to_string(i), active[i]);
+  }
+  aggregator.TakeDelta();
+
+  std::uniform_int_distribution<size_t> routine_pick(0, routine_count - 1);
+  std::vector<size_t> order(flips);
+  for (size_t& index : order) {
+    index = routine_pick(random);
+  }
+
+  size_t delta_items = 0;
+  auto start = Clock::now();
+  for (const size_t index : order) {
+    active[index] = !active[index];
+    aggregator.SetActive(std::to_string(index), active[index]);
+    const routine::PolicyDelta delta = aggregator.TakeDelta();
+    delta_items += Count(delta.added) + Count(delta.removed);
+  }
+  const double incremental = MicrosSince(start, flips);
+
+  size_t full_items = 0;
+  start = Clock::now();
+  for (const size_t index : order) {
+    active[index] = !active[index];
+    full_items += Rebuild(routines, active);
+  }
+  const double rebuild = MicrosSince(start, flips);
+
+  std::printf("%zu routines, %zu items of each kind per routine\n",
+              routine_count, item_count);
+  std::printf("  flip one routine + delta: %10.2f us, %8.1f items sent\n",
+              incremental, static_cast<double>(delta_items) / flips);
+  std::printf("  full rebuild:             %10.2f us, %8.1f items sent\n",
+              rebuild, static_cast<double>(full_items) / flips);
+  return 0;
+}
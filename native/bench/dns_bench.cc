@@ -0,0 +1,256 @@
+// Load test for DnsSinkhole: closed-loop clients on loopback, each with one
+// query outstanding, against a stand-in upstream that answers every query
+// with an A record at once.
+//
+//   dns_bench [clients] [seconds] [sites]
+//
+// Reports queries per second and latency percentiles for the upstream
+// asked directly, and through the sinkhole for cached names, names never
+// seen before (so every query is relayed) and blocked names. The gap
+// between "direct" and "uncached" is the relay's cost; "cached" and
+// "blocked" never leave the sinkhole.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/dns_message.h"
+#include "linux/dns_sinkhole.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void Append16(uint16_t value, std::string* out) {
+  out->push_back(static_cast<char>(value >> 8));
+  out->push_back(static_cast<char>(value));
+}
+
+std::string Query(uint16_t id, const std::string& name) {
+  std::string query;
+  for (const uint16_t field : {id, uint16_t{0x0100}, uint16_t{1},
+                               uint16_t{0}, uint16_t{0}, uint16_t{0}}) {
+    Append16(field, &query);
+  }
+  size_t start = 0;
+  while (start < name.size()) {
+    size_t dot = name.find('.', start);
+    if (dot == std::string::npos) {
+      dot = name.size();
+    }
+    query.push_back(static_cast<char>(dot - start));
+    query.append(name, start, dot - start);
+    start = dot + 1;
+  }
+  query.push_back('\0');
+  Append16(routine::kDnsTypeA, &query);
+  Append16(routine::kDnsClassIn, &query);
+  return query;
+}
+
+int BindLoopback(uint16_t* port) {
+  const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+  socklen_t size = sizeof(address);
+  getsockname(fd, reinterpret_cast<sockaddr*>(&address), &size);
+  *port = ntohs(address.sin_port);
+  timeval timeout = {0, 200 * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  return fd;
+}
+
+// Answers each query with one A record, as fast as it can.
+class Upstream {
+ public:
+  Upstream() : fd_(BindLoopback(&port_)), thread_([this] { Serve(); }) {}
+  ~Upstream() {
+    stopping_ = true;
+    thread_.join();
+    close(fd_);
+  }
+
+  uint16_t port() const { return port_; }
+
+ private:
+  void Serve() {
+    char buffer[512];
+    while (!stopping_) {
+      sockaddr_storage from;
+      socklen_t from_size = sizeof(from);
+      const ssize_t size =
+          recvfrom(fd_, buffer, sizeof(buffer), 0,
+                   reinterpret_cast<sockaddr*>(&from), &from_size);
+      if (size < static_cast<ssize_t>(routine::kDnsHeaderSize)) {
+        continue;
+      }
+      std::string response(buffer, static_cast<size_t>(size));
+      response[2] = static_cast<char>(0x81);
+      response[3] = static_cast<char>(0x80);
+      response[7] = 1;
+      Append16(0xc000 | routine::kDnsHeaderSize, &response);
+      Append16(routine::kDnsTypeA, &response);
+      Append16(routine::kDnsClassIn, &response);
+      Append16(0, &response);
+      Append16(300, &response);
+      Append16(4, &response);
+      response.append("\x5d\xb8\xd8\x22", 4);
+      sendto(fd_, response.data(), response.size(), 0,
+             reinterpret_cast<sockaddr*>(&from), from_size);
+    }
+  }
+
+  uint16_t port_ = 0;
+  const int fd_;
+  std::atomic<bool> stopping_{false};
+  std::thread thread_;
+};
+
+struct Result {
+  uint64_t answered = 0;
+  uint64_t lost = 0;
+  double seconds = 0;
+  std::vector<uint32_t> latencies_ns;
+};
+
+// Runs |clients| threads that each ask |port| for names from |name| until
+// |duration| is up, one query at a time.
+template <typename NameFn>
+Result Load(uint16_t port, int clients, std::chrono::seconds duration,
+            NameFn name) {
+  std::vector<std::vector<uint32_t>> latencies(clients);
+  std::atomic<uint64_t> lost{0};
+  const Clock::time_point start = Clock::now();
+  const Clock::time_point deadline = start + duration;
+  std::vector<std::thread> threads;
+  for (int c = 0; c < clients; ++c) {
+    threads.emplace_back([&, c] {
+      uint16_t unused;
+      const int fd = BindLoopback(&unused);
+      sockaddr_in to = {};
+      to.sin_family = AF_INET;
+      to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      to.sin_port = htons(port);
+      char buffer[512];
+      for (uint64_t i = 0; Clock::now() < deadline; ++i) {
+        const uint16_t id = static_cast<uint16_t>(i);
+        const std::string query = Query(id, name(c, i));
+        const Clock::time_point sent = Clock::now();
+        sendto(fd, query.data(), query.size(), 0,
+               reinterpret_cast<sockaddr*>(&to), sizeof(to));
+        ssize_t size;
+        // Skip late answers to queries already given up on.
+        while ((size = recv(fd, buffer, sizeof(buffer), 0)) >= 2 &&
+               routine::DnsId(std::string_view(buffer, 2)) != id) {
+        }
+        if (size < 0) {
+          lost.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        latencies[c].push_back(static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - sent)
+                .count()));
+      }
+      close(fd);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  Result result;
+  result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  result.lost = lost.load();
+  for (const auto& client : latencies) {
+    result.latencies_ns.insert(result.latencies_ns.end(), client.begin(),
+                               client.end());
+  }
+  result.answered = result.latencies_ns.size();
+  std::sort(result.latencies_ns.begin(), result.latencies_ns.end());
+  return result;
+}
+
+double PercentileMicros(const std::vector<uint32_t>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  const size_t index = std::min(sorted.size() - 1,
+                                static_cast<size_t>(p * sorted.size()));
+  return sorted[index] / 1e3;
+}
+
+void Print(const char* label, const Result& result) {
+  std::printf("%-9s %10.0f qps  p50 %7.1f us  p99 %7.1f us  lost %llu\n",
+              label, result.answered / result.seconds,
+              PercentileMicros(result.latencies_ns, 0.50),
+              PercentileMicros(result.latencies_ns, 0.99),
+              static_cast<unsigned long long>(result.lost));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int clients = argc > 1 ? std::atoi(argv[1]) : 4;
+  const std::chrono::seconds duration(argc > 2 ? std::atoi(argv[2]) : 2);
+  const int sites = std::max(1, argc > 3 ? std::atoi(argv[3]) : 1000);
+
+  Upstream upstream;
+  routine::DnsSinkhole::Options options;
+  options.listen_port = 0;
+  options.upstream_address = "127.0.0.1";
+  options.upstream_port = upstream.port();
+  options.cache.capacity = 1 << 16;
+  routine::DnsSinkhole sinkhole(options);
+  if (!sinkhole.Start()) {
+    std::fprintf(stderr, "cannot start the sinkhole\n");
+    return 1;
+  }
+  std::vector<std::string> blocked;
+  for (int i = 0; i < sites; ++i) {
+    blocked.push_back("blocked" + std::to_string(i) + ".com");
+  }
+  sinkhole.SetSites(false, blocked);
+
+  std::printf("%d clients, %lld s each, %d blocked sites\n", clients,
+              static_cast<long long>(duration.count()), sites);
+  const auto hot = [](int, uint64_t i) {
+    return "site" + std::to_string(i % 256) + ".example.com";
+  };
+  Print("direct", Load(upstream.port(), clients, duration, hot));
+  Print("cached", Load(sinkhole.port(), clients, duration, hot));
+  Print("uncached", Load(sinkhole.port(), clients, duration,
+                         [](int c, uint64_t i) {
+                           return "u" + std::to_string(i) + ".c" +
+                                  std::to_string(c) + ".example.com";
+                         }));
+  Print("blocked", Load(sinkhole.port(), clients, duration,
+                        [sites](int, uint64_t i) {
+                          return "www.blocked" + std::to_string(i % sites) +
+                                 ".com";
+                        }));
+
+  const routine::DnsSinkhole::Stats stats = sinkhole.stats();
+  std::printf("sinkhole: %llu queries, %llu cached, %llu forwarded, "
+              "%llu blocked, %llu timeouts\n",
+              static_cast<unsigned long long>(stats.queries),
+              static_cast<unsigned long long>(stats.cached),
+              static_cast<unsigned long long>(stats.forwarded),
+              static_cast<unsigned long long>(stats.blocked),
+              static_cast<unsigned long long>(stats.timeouts));
+  sinkhole.Stop();
+  return 0;
+}
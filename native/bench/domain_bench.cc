@@ -0,0 +1,167 @@
+// Measures site matching against large lists: DomainMatcher (the label
+// trie the host and core share), PolicyBlob::MatchesSite (binary search per
+// label-aligned suffix) and the linear suffix scan the extension used to do.
+//
+//   domain_bench [domains] [lookups]
+//
+// Lists of 1k, 10k and |domains| (default 100k) synthetic domains are
+// queried with hosts of two to six labels, half of them listed. A trie
+// lookup should cost about the same at every list size and grow only with
+// the labels in the host.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/domain_matcher.h"
+#include "core/policy_blob.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr const char* kTlds[] = {"com", "net", "org", "io", "de", "co.uk"};
+
+std::string RandomLabel(std::mt19937* random) {
+  static constexpr char kLetters[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+  std::uniform_int_distribution<int> size(4, 12);
+  std::uniform_int_distribution<int> letter(0, sizeof(kLetters) - 2);
+  std::string label(size(*random), 'a');
+  for (char& c : label) {
+    c = kLetters[letter(*random)];
+  }
+  return label;
+}
+
+std::vector<std::string> MakeDomains(size_t count, std::mt19937* random) {
+  std::uniform_int_distribution<int> tld(0, std::size(kTlds) - 1);
+  std::vector<std::string> domains;
+  domains.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    domains.push_back(RandomLabel(random) + "." + kTlds[tld(*random)]);
+  }
+  return domains;
+}
+
+// Hosts of exactly |labels| labels: subdomains of listed domains for even
+// indices, unlisted look-alikes for odd ones.
+std::vector<std::string> MakeHosts(const std::vector<std::string>& domains,
+                                   int labels, size_t count,
+                                   std::mt19937* random) {
+  std::uniform_int_distribution<size_t> pick(0, domains.size() - 1);
+  std::vector<std::string> hosts;
+  hosts.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    std::string host = i % 2 == 0 ? domains[pick(*random)]
+                                   : "x" + RandomLabel(random) + ".com";
+    int have = 1;
+    for (const char c : host) {
+      have += c == '.';
+    }
+    for (; have < labels; ++have) {
+      host = RandomLabel(random) + "." + host;
+    }
+    hosts.push_back(std::move(host));
+  }
+  return hosts;
+}
+
+template <typename Match>
+double NanosPerLookup(const std::vector<std::string>& hosts, Match match,
+                      size_t* hits) {
+  *hits = 0;
+  const Clock::time_point start = Clock::now();
+  for (const auto& host : hosts) {
+    *hits += match(host) ? 1 : 0;
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+             .count() /
+         hosts.size();
+}
+
+bool LinearScan(const std::vector<std::string>& domains,
+                const std::string& host) {
+  for (const auto& domain : domains) {
+    if (host.size() >= domain.size() &&
+        host.compare(host.size() - domain.size(), domain.size(), domain) ==
+            0 &&
+        (host.size() == domain.size() ||
+         host[host.size() - domain.size() - 1] == '.')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t max_domains = argc > 1 ? std::atoi(argv[1]) : 100000;
+  const size_t lookups = argc > 2 ? std::atoi(argv[2]) : 200000;
+
+  std::mt19937 random(42);
+  const std::vector<std::string> all = MakeDomains(max_domains, &random);
+
+  std::printf("%8s %6s %12s %12s %12s\n", "domains", "labels", "trie ns",
+              "blob ns", "linear ns");
+  for (const size_t count : {size_t{1000}, size_t{10000}, max_domains}) {
+    if (count > max_domains) {
+      continue;
+    }
+    const std::vector<std::string> domains(all.begin(), all.begin() + count);
+
+    const Clock::time_point build_start = Clock::now();
+    routine::DomainMatcher matcher;
+    for (const auto& domain : domains) {
+      matcher.Add(domain);
+    }
+    const double build_ms = std::chrono::duration<double, std::milli>(
+                                Clock::now() - build_start)
+                                .count();
+    routine::PolicyBlob::Source source;
+    source.sites = domains;
+    const std::string bytes = routine::PolicyBlob::Compile(source);
+    routine::PolicyBlob blob;
+    if (!blob.Open(bytes)) {
+      std::fprintf(stderr, "blob did not open\n");
+      return 1;
+    }
+
+    for (int labels = 2; labels <= 6; ++labels) {
+      const std::vector<std::string> hosts =
+          MakeHosts(domains, labels, lookups, &random);
+      size_t trie_hits;
+      size_t blob_hits;
+      size_t linear_hits;
+      const double trie = NanosPerLookup(
+          hosts, [&](const std::string& host) { return matcher.Matches(host); },
+          &trie_hits);
+      const double blob_ns = NanosPerLookup(
+          hosts, [&](const std::string& host) { return blob.MatchesSite(host); },
+          &blob_hits);
+      // The scan is O(domains); a sample is enough to time it.
+      const std::vector<std::string> sample(
+          hosts.begin(), hosts.begin() + std::min<size_t>(hosts.size(), 200));
+      const double linear = NanosPerLookup(
+          sample,
+          [&](const std::string& host) { return LinearScan(domains, host); },
+          &linear_hits);
+      if (trie_hits != blob_hits) {
+        std::fprintf(stderr, "trie and blob disagree: %zu vs %zu hits\n",
+                     trie_hits, blob_hits);
+        return 1;
+      }
+      std::printf("%8zu %6d %12.1f %12.1f %12.1f\n", count, labels, trie,
+                  blob_ns, linear);
+    }
+    std::printf("%8zu built in %.1f ms, blob %zu bytes\n", count, build_ms,
+                bytes.size());
+  }
+  return 0;
+}
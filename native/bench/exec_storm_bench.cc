@@ -0,0 +1,134 @@
+// Measures how many exec events per second ExecBlocker keeps up with while a
+// synthetic load generator forks and execs /bin/true as fast as it can.
+//
+//   exec_storm_bench [threads] [seconds] [rules]
+//
+// Subscribing to the proc connector needs CAP_NET_ADMIN, so run it as root.
+// It also reports the ceiling of the handler alone, replaying batches of
+// exec events without the kernel in the loop.
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "linux/exec_blocker.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::unique_ptr<const routine::RuleSet> SyntheticRules(int count) {
+  routine::RuleSet::Builder builder{routine::RuleSet::Options()};
+  for (int i = 0; i < count; ++i) {
+    builder.AddApp("/opt/app" + std::to_string(i) + "/bin/app");
+    builder.AddDirectory("/opt/suite" + std::to_string(i));
+  }
+  return builder.Build();
+}
+
+uint64_t Generate(int threads, std::chrono::seconds duration) {
+  std::atomic<uint64_t> spawned{0};
+  const Clock::time_point deadline = Clock::now() + duration;
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back([&] {
+      while (Clock::now() < deadline) {
+        const pid_t child = fork();
+        if (child == 0) {
+          execl("/bin/true", "true", static_cast<char*>(nullptr));
+          _exit(127);
+        }
+        if (child > 0) {
+          waitpid(child, nullptr, 0);
+          spawned.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return spawned.load();
+}
+
+double Seconds(Clock::duration duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int threads = argc > 1 ? std::atoi(argv[1]) : 4;
+  const int seconds = argc > 2 ? std::atoi(argv[2]) : 5;
+  const int rules = argc > 3 ? std::atoi(argv[3]) : 1000;
+
+  routine::PolicyStore policy;
+  policy.Set(SyntheticRules(rules));
+  routine::Enforcer enforcer(&policy, routine::ProcFs(),
+                             routine::Enforcer::Mode::kSuspend, nullptr);
+
+  // Handler ceiling: full batches of execs of a long-lived child, which
+  // exercises /proc/<pid>/exe and the policy lookup for every event.
+  {
+    const pid_t idle = fork();
+    if (idle == 0) {
+      for (;;) {
+        pause();
+      }
+    }
+    routine::ExecBlocker blocker(&enforcer);
+    std::vector<routine::ProcEvent> batch(routine::ProcConnector::kMaxBatch);
+    for (auto& event : batch) {
+      event.type = routine::ProcEvent::Type::kExec;
+      event.pid = idle;
+    }
+    const Clock::time_point start = Clock::now();
+    size_t handled = 0;
+    while (Clock::now() - start < std::chrono::seconds(1)) {
+      blocker.HandleBatch(batch, false);
+      handled += batch.size();
+    }
+    std::printf("handler    %12.0f execs/s\n",
+                handled / Seconds(Clock::now() - start));
+    kill(idle, SIGKILL);
+    waitpid(idle, nullptr, 0);
+  }
+
+  routine::ExecBlocker blocker(&enforcer);
+  if (!blocker.Start()) {
+    std::fprintf(stderr, "proc connector unavailable (needs CAP_NET_ADMIN)\n");
+    return 1;
+  }
+
+  const Clock::time_point start = Clock::now();
+  const uint64_t spawned = Generate(threads, std::chrono::seconds(seconds));
+  const double elapsed = Seconds(Clock::now() - start);
+  // Let the event thread drain what is still queued.
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  blocker.Stop();
+
+  const routine::ExecBlocker::Stats stats = blocker.stats();
+  std::printf("generator  %12.0f execs/s (%d threads, %d rules)\n",
+              spawned / elapsed, threads, rules);
+  std::printf("handled    %12.0f execs/s (%llu of %llu)\n",
+              stats.execs / elapsed,
+              static_cast<unsigned long long>(stats.execs),
+              static_cast<unsigned long long>(spawned));
+  std::printf("batch      %12.1f execs/wakeup\n",
+              stats.batches ? double(stats.execs) / stats.batches : 0.0);
+  std::printf("latency    %12.1f us mean, %.1f us max\n",
+              stats.execs ? stats.total_latency_ns / 1e3 / stats.execs : 0.0,
+              stats.max_latency_ns / 1e3);
+  std::printf("overruns   %12llu\n",
+              static_cast<unsigned long long>(stats.overruns));
+  return 0;
+}
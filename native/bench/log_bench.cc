@@ -0,0 +1,100 @@
+// Measures what Logger::Log() costs its caller and how many messages per
+// second the flusher gets to disk, with several threads logging at once.
+//
+//   log_bench [threads] [messages per thread] [directory]
+//
+// The call cost is measured on bursts that fit in the queue. Throughput is
+// measured by retrying dropped messages until all of them are written.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/logger.h"
+#include "core/mapped_file.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Seconds(Clock::duration duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+// The shape of the runner's focus messages.
+std::string Message(int thread) {
+  return "Focused application: C:\\Program Files\\App" +
+         std::to_string(thread) + "\\app.exe";
+}
+
+void RunThreads(int threads, const std::function<void(int)>& body) {
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back(body, t);
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int threads = argc > 1 ? std::atoi(argv[1]) : 4;
+  const int messages = argc > 2 ? std::atoi(argv[2]) : 200000;
+  const std::string directory = argc > 3 ? argv[3] : ".";
+
+  routine::Logger::Options options;
+  options.path = directory + "/log_bench.rlog";
+  options.capacity = 1 << 16;
+  options.max_file_size = 8 << 20;
+  options.flush_interval = std::chrono::milliseconds(50);
+
+  routine::Logger logger(options);
+
+  std::vector<double> call_ns(threads);
+  const int burst = static_cast<int>(options.capacity) / threads;
+  RunThreads(threads, [&](int t) {
+    const std::string message = Message(t);
+    const Clock::time_point begin = Clock::now();
+    for (int i = 0; i < burst; ++i) {
+      logger.Log(routine::Logger::Level::kInfo, message);
+    }
+    call_ns[t] = Seconds(Clock::now() - begin) * 1e9 / burst;
+  });
+  logger.Flush();
+
+  const routine::Logger::Stats before = logger.stats();
+  const Clock::time_point start = Clock::now();
+  RunThreads(threads, [&](int t) {
+    const std::string message = Message(t);
+    for (int i = 0; i < messages; ++i) {
+      while (!logger.Log(routine::Logger::Level::kInfo, message)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  logger.Flush();
+  const double elapsed = Seconds(Clock::now() - start);
+  const routine::Logger::Stats after = logger.stats();
+
+  std::printf("Log()      %12.1f ns/call (worst of %d threads, %d each)\n",
+              *std::max_element(call_ns.begin(), call_ns.end()), threads,
+              burst);
+  std::printf("written    %12.0f msgs/s (%llu)\n",
+              (after.written - before.written) / elapsed,
+              static_cast<unsigned long long>(after.written - before.written));
+  std::printf("rotations  %12llu\n",
+              static_cast<unsigned long long>(after.rotations));
+
+  routine::RemoveFile(options.path);
+  for (int i = 1; i <= options.max_rotated_files; ++i) {
+    routine::RemoveFile(options.path + "." + std::to_string(i) + ".lz");
+  }
+  return 0;
+}
@@ -0,0 +1,191 @@
+// Measures a native messaging host the way a browser and the Routine app
+// see it: start-up time until it connects, message round trips through it,
+// streaming throughput and its peak RSS.
+//
+//   nmh_bench [messages] [size] -- <host command> [args...]
+//
+// The bench plays the app, binding the first free loopback port in
+// 54320-54330 as the app does and echoing every message back, and the
+// browser, talking to the host over its stdin and stdout. Run it against
+// routine_nmh and the Dart host (`dart run browser/native/src/main.dart`, or
+// the compiled binary) to compare them; keep the app closed meanwhile.
+
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "host/forwarder.h"
+#include "host/stream.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Micros(Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+std::string Frame(size_t size) {
+  std::string frame(4 + size, 'x');
+  for (int i = 0; i < 4; ++i) {
+    frame[i] = static_cast<char>(size >> (8 * i));
+  }
+  // Hosts that decode messages expect JSON.
+  if (size >= 2) {
+    frame[4] = '"';
+    frame.back() = '"';
+  }
+  return frame;
+}
+
+bool ReadExactly(int fd, char* data, size_t size) {
+  while (size > 0) {
+    const int64_t read =
+        routine::ReadSome(routine::Stream{fd, false}, data, size);
+    if (read <= 0) {
+      return false;
+    }
+    data += read;
+    size -= static_cast<size_t>(read);
+  }
+  return true;
+}
+
+int Listen(int* port) {
+  for (*port = 54320; *port <= 54330; ++*port) {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(*port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&address),
+             sizeof(address)) == 0 &&
+        listen(fd, 1) == 0) {
+      return fd;
+    }
+    close(fd);
+  }
+  return -1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int separator = 1;
+  while (separator < argc && std::strcmp(argv[separator], "--") != 0) {
+    ++separator;
+  }
+  if (separator + 1 >= argc) {
+    std::fprintf(stderr,
+                 "usage: %s [messages] [size] -- <host command> [args...]\n",
+                 argv[0]);
+    return 2;
+  }
+  const int messages = separator > 1 ? std::atoi(argv[1]) : 10000;
+  const size_t size = separator > 2 ? std::atoi(argv[2]) : 200;
+
+  int port = 0;
+  const int listener = Listen(&port);
+  if (listener < 0) {
+    std::fprintf(stderr, "ports 54320-54330 are all taken\n");
+    return 1;
+  }
+
+  int to_host[2];
+  int from_host[2];
+  if (pipe(to_host) != 0 || pipe(from_host) != 0) {
+    return 1;
+  }
+  const Clock::time_point spawned = Clock::now();
+  const pid_t host = fork();
+  if (host == 0) {
+    dup2(to_host[0], STDIN_FILENO);
+    dup2(from_host[1], STDOUT_FILENO);
+    close(to_host[1]);
+    close(from_host[0]);
+    execvp(argv[separator + 1], argv + separator + 1);
+    _exit(127);
+  }
+  close(to_host[0]);
+  close(from_host[1]);
+
+  const int app = accept(listener, nullptr, nullptr);
+  const Clock::time_point connected = Clock::now();
+  close(listener);
+  if (app < 0) {
+    return 1;
+  }
+  // The app side: echo every message back.
+  std::thread echo([app] {
+    routine::Forwarder forwarder(routine::Stream{app, true},
+                                 routine::Stream{app, true},
+                                 routine::Forwarder::Options());
+    forwarder.Run();
+  });
+  echo.detach();
+
+  const std::string frame = Frame(size);
+  std::string reply(frame.size(), '\0');
+  const routine::Stream browser{to_host[1], false};
+
+  // Round trips, one message in flight.
+  std::vector<double> round_trips;
+  round_trips.reserve(messages);
+  for (int i = 0; i < messages; ++i) {
+    const Clock::time_point sent = Clock::now();
+    if (!routine::WriteAll(browser, frame.data(), frame.size()) ||
+        !ReadExactly(from_host[0], reply.data(), reply.size())) {
+      std::fprintf(stderr, "host stopped relaying after %d messages\n", i);
+      return 1;
+    }
+    round_trips.push_back(Micros(Clock::now() - sent));
+  }
+  std::sort(round_trips.begin(), round_trips.end());
+
+  // Streaming: the browser writes as fast as the host reads.
+  const Clock::time_point start = Clock::now();
+  std::thread writer([&] {
+    for (int i = 0; i < messages; ++i) {
+      routine::WriteAll(browser, frame.data(), frame.size());
+    }
+  });
+  std::vector<char> sink(frame.size() * 64);
+  size_t expected = frame.size() * messages;
+  while (expected > 0) {
+    const int64_t read = routine::ReadSome(
+        routine::Stream{from_host[0], false}, sink.data(),
+        std::min(sink.size(), expected));
+    if (read <= 0) {
+      break;
+    }
+    expected -= static_cast<size_t>(read);
+  }
+  const double elapsed = Micros(Clock::now() - start) / 1e6;
+  writer.join();
+
+  close(to_host[1]);
+  int status = 0;
+  rusage usage{};
+  wait4(host, &status, 0, &usage);
+
+  std::printf("startup    %12.1f ms until connected\n",
+              Micros(connected - spawned) / 1e3);
+  std::printf("round trip %12.1f us p50, %.1f us p99 (%zu byte messages)\n",
+              round_trips[round_trips.size() / 2],
+              round_trips[round_trips.size() * 99 / 100], size);
+  std::printf("throughput %12.0f msgs/s, %.1f MB/s\n", messages / elapsed,
+              messages * static_cast<double>(frame.size()) / elapsed / 1e6);
+  std::printf("peak rss   %12ld KiB\n", usage.ru_maxrss);
+  return 0;
+}
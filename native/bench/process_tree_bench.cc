@@ -0,0 +1,167 @@
+// Measures ProcessTree on synthetic process trees shaped like a desktop
+// session: shells, launchers and browsers with chains of helpers below
+// them.
+//
+//   process_tree_bench [processes] [rules]
+//
+// For 1000 and |processes| (default 10000) processes, blocking |rules|
+// (default 1000) apps, it reports the cost of seeding the tree from a
+// shuffled /proc scan, of a fork, exec and exit event, and of attributing
+// a random process to a blocked ancestor, against finding its ancestry
+// from a fresh scan the way the tree-less enforcer has to.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/policy_store.h"
+#include "core/process_tree.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double NanosSince(Clock::time_point start, size_t count) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+             .count() /
+         count;
+}
+
+std::string AppPath(size_t app) {
+  return "/opt/app" + std::to_string(app) + "/bin/app";
+}
+
+// |count| processes below init. Most are started by something recent, as
+// helpers start helpers, which builds the deep chains; the rest by any
+// process at all.
+std::vector<routine::ProcessTree::Seed> SyntheticTree(size_t count,
+                                                      size_t apps,
+                                                      std::mt19937* random) {
+  std::uniform_int_distribution<size_t> app(0, apps - 1);
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::vector<routine::ProcessTree::Seed> processes = {{1, 0, "/sbin/init"}};
+  for (size_t i = 1; i < count; ++i) {
+    const size_t recent = i > 16 ? i - 16 : 0;
+    const size_t parent = std::uniform_int_distribution<size_t>(
+        percent(*random) < 70 ? recent : 0, i - 1)(*random);
+    // Half of them exec, the rest run what their parent runs.
+    const std::string exe = percent(*random) < 50
+                                ? AppPath(app(*random))
+                                : processes[parent].exe;
+    processes.push_back({static_cast<int64_t>(i + 1),
+                         processes[parent].pid, exe});
+  }
+  return processes;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t max_processes = argc > 1 ? std::atoi(argv[1]) : 10000;
+  const size_t rules = argc > 2 ? std::atoi(argv[2]) : 1000;
+  // Blocked apps are one in twenty of those running.
+  const size_t apps = rules * 20;
+
+  routine::PolicyStore policy;
+  routine::RuleSet::Builder builder{routine::RuleSet::Options()};
+  for (size_t i = 0; i < rules; ++i) {
+    builder.AddApp(AppPath(i * 20));
+  }
+  policy.Set(builder.Build());
+  const auto is_blocked = [&](const std::string& exe) {
+    return policy.IsBlocked(exe);
+  };
+
+  std::printf("%9s %9s %9s %9s %9s %9s %9s %9s\n", "processes", "reset us",
+              "event ns", "lookup ns", "rescan us", "depth", "max depth",
+              "blocked");
+  for (const size_t count : {size_t{1000}, max_processes}) {
+    if (count > max_processes) {
+      continue;
+    }
+    std::mt19937 random(1);
+    std::vector<routine::ProcessTree::Seed> processes =
+        SyntheticTree(count, apps, &random);
+    std::vector<routine::ProcessTree::Seed> scan = processes;
+    std::shuffle(scan.begin(), scan.end(), random);
+
+    routine::ProcessTree tree;
+    constexpr size_t kResets = 20;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < kResets; ++i) {
+      tree.Reset(scan);
+    }
+    const double reset_us = NanosSince(start, kResets) / 1e3;
+
+    std::uniform_int_distribution<size_t> pick(0, count - 1);
+    constexpr size_t kLookups = 200000;
+    std::vector<int64_t> pids(kLookups);
+    for (int64_t& pid : pids) {
+      pid = processes[pick(random)].pid;
+    }
+
+    size_t blocked = 0;
+    start = Clock::now();
+    for (const int64_t pid : pids) {
+      blocked += tree.FindInLineage(pid, is_blocked).empty() ? 0 : 1;
+    }
+    const double lookup_ns = NanosSince(start, kLookups);
+
+    size_t total_depth = 0;
+    size_t max_depth = 0;
+    for (const int64_t pid : pids) {
+      size_t depth = 0;
+      tree.FindInLineage(pid, [&](const std::string&) {
+        ++depth;
+        return false;
+      });
+      total_depth += depth;
+      max_depth = std::max(max_depth, depth);
+    }
+
+    // Without a tree: every lookup indexes a fresh scan, then walks it.
+    constexpr size_t kRescans = 200;
+    size_t rescan_blocked = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < kRescans; ++i) {
+      std::unordered_map<int64_t, const routine::ProcessTree::Seed*> by_pid;
+      for (const auto& process : scan) {
+        by_pid[process.pid] = &process;
+      }
+      for (auto it = by_pid.find(pids[i]); it != by_pid.end();
+           it = by_pid.find(it->second->ppid)) {
+        if (is_blocked(it->second->exe)) {
+          ++rescan_blocked;
+          break;
+        }
+      }
+    }
+    const double rescan_us = NanosSince(start, kRescans) / 1e3;
+
+    // Steady churn: short-lived children of random processes.
+    constexpr size_t kChurn = 200000;
+    int64_t next_pid = static_cast<int64_t>(count) + 1;
+    start = Clock::now();
+    for (size_t i = 0; i < kChurn; ++i) {
+      const int64_t pid = next_pid++;
+      tree.Fork(pid, pids[i % kLookups]);
+      tree.Exec(pid, "/bin/true");
+      tree.Exit(pid);
+    }
+    const double event_ns = NanosSince(start, kChurn * 3);
+
+    std::printf("%9zu %9.1f %9.1f %9.1f %9.1f %9.1f %9zu %8.1f%%\n", count,
+                reset_us, event_ns, lookup_ns, rescan_us,
+                static_cast<double>(total_depth) / kLookups, max_depth,
+                100.0 * blocked / kLookups);
+    if (rescan_blocked == 42 || tree.size() != count) {
+      std::printf("\n");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,193 @@
+// Google Benchmark suite for the blocking core, the counterpart of
+// routine_tests. Each benchmark takes its size as an argument, so a change
+// in how something scales shows up as well as a change in its constant.
+//
+//   routine_bench [--benchmark_filter=<regex>] [--benchmark_format=json]
+//
+// bench/baseline.json holds a reference run; see README.md for refreshing
+// and comparing against it.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "core/policy_blob.h"
+#include "core/policy_store.h"
+#include "core/rule_set.h"
+
+namespace routine {
+namespace {
+
+// Windows-style paths, as BlockManager::Set() gets them.
+std::string AppPath(size_t i) {
+  return "C:\\Program Files\\Vendor" + std::to_string(i % 97) + "\\App" +
+         std::to_string(i) + "\\bin\\app" + std::to_string(i) + ".exe";
+}
+
+std::string DirectoryPath(size_t i) {
+  return "C:\\Games\\Library" + std::to_string(i % 31) + "\\Title" +
+         std::to_string(i);
+}
+
+RuleSet::Options WindowsOptions() {
+  RuleSet::Options options;
+  options.ignore_case = true;
+  return options;
+}
+
+// What BlockManager::Set() compiles: |apps| apps, a tenth as many
+// directories and the runner's exemptions.
+RuleSet::Builder WindowsRules(size_t apps) {
+  RuleSet::Builder builder(WindowsOptions());
+  builder.AddExempt("C:\\Windows\\explorer.exe");
+  builder.AddExempt("C:\\Program Files\\Routine\\routine.exe");
+  for (size_t i = 0; i < apps; ++i) {
+    builder.AddApp(AppPath(i));
+  }
+  for (size_t i = 0; i < apps / 10; ++i) {
+    builder.AddDirectory(DirectoryPath(i));
+  }
+  return builder;
+}
+
+// Compiling the rules and publishing them, BlockManager::Set() less the
+// Win32 calls.
+void BM_PolicySet(benchmark::State& state) {
+  const RuleSet::Builder builder = WindowsRules(state.range(0));
+  PolicyStore store;
+  for (auto _ : state) {
+    store.Set(builder.Build());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PolicySet)->Arg(10)->Arg(1000)->Arg(100000)
+    ->Unit(benchmark::kMicrosecond);
+
+// BlockManager::IsBlocked() on the focus path: the same few windows over
+// and over, so answered from the verdict cache.
+void BM_IsBlockedCached(benchmark::State& state) {
+  PolicyStore store;
+  store.Set(WindowsRules(state.range(0)).Build());
+  const std::string blocked = AppPath(state.range(0) / 2);
+  const std::string allowed = "C:\\Program Files\\Other\\other.exe";
+  bool flip = false;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(store.IsBlocked(flip ? blocked : allowed));
+    flip = !flip;
+  }
+}
+BENCHMARK(BM_IsBlockedCached)->Arg(10)->Arg(1000)->Arg(100000);
+
+// A rule lookup with no cache in front, half of the paths listed.
+void BM_IsBlockedUncached(benchmark::State& state) {
+  const std::unique_ptr<const RuleSet> rules =
+      WindowsRules(state.range(0)).Build();
+  std::vector<std::string> paths;
+  std::mt19937 random(1);
+  for (size_t i = 0; i < 1024; ++i) {
+    paths.push_back(i % 2 == 0 ? AppPath(random() % state.range(0))
+                               : AppPath(state.range(0) + random()));
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(rules->IsBlocked(paths[i++ & 1023]));
+  }
+}
+BENCHMARK(BM_IsBlockedUncached)->Arg(10)->Arg(1000)->Arg(100000);
+
+// Directory rules matched by whole path components, for paths |depth|
+// components below a listed directory, against 1000 directories.
+void BM_DirectoryPrefix(benchmark::State& state) {
+  RuleSet::Builder builder(WindowsOptions());
+  for (size_t i = 0; i < 1000; ++i) {
+    builder.AddDirectory(DirectoryPath(i));
+  }
+  const std::unique_ptr<const RuleSet> rules = builder.Build();
+
+  std::vector<std::string> paths;
+  for (size_t i = 0; i < 256; ++i) {
+    // Odd paths share a listed directory's name but not its components.
+    std::string path = DirectoryPath(i * 3) + (i % 2 == 0 ? "" : "Demo");
+    for (int64_t level = 1; level < state.range(0); ++level) {
+      path += "\\sub" + std::to_string(level);
+    }
+    paths.push_back(path + "\\game.exe");
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(rules->IsBlocked(paths[i++ & 255]));
+  }
+}
+BENCHMARK(BM_DirectoryPrefix)->Arg(1)->Arg(4)->Arg(16);
+
+// The verdict cache under a working set of |range(0)| distinct paths
+// against its default 4096 entries: from all hits to constant eviction.
+void BM_CacheChurn(benchmark::State& state) {
+  PolicyStore store;
+  store.Set(WindowsRules(1000).Build());
+  std::vector<std::string> paths;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    paths.push_back(AppPath(i));
+  }
+  std::mt19937 random(1);
+  std::uniform_int_distribution<size_t> pick(0, paths.size() - 1);
+  std::vector<size_t> order(4096);
+  for (size_t& index : order) {
+    index = pick(random);
+  }
+
+  const VerdictCache::Stats before = store.cache_stats();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(store.IsBlocked(paths[order[i++ & 4095]]));
+  }
+  const VerdictCache::Stats after = store.cache_stats();
+  const double lookups = static_cast<double>(after.hits - before.hits +
+                                             after.misses - before.misses);
+  state.counters["hitRate"] =
+      lookups > 0 ? (after.hits - before.hits) / lookups : 0;
+  state.counters["evictionsPerLookup"] = benchmark::Counter(
+      static_cast<double>(after.evictions - before.evictions),
+      benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_CacheChurn)->Arg(1024)->Arg(4096)->Arg(65536);
+
+// Compiling a policy into its relocatable blob.
+void BM_PolicyBlobCompile(benchmark::State& state) {
+  PolicyBlob::Source source;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    source.apps.push_back(AppPath(i));
+  }
+  for (int64_t i = 0; i < state.range(0) / 10; ++i) {
+    source.directories.push_back(DirectoryPath(i));
+  }
+  source.ignore_case = true;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    const std::string blob = PolicyBlob::Compile(source);
+    bytes = blob.size();
+    benchmark::DoNotOptimize(blob.data());
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_PolicyBlobCompile)->Arg(10)->Arg(1000)->Arg(100000)
+    ->Unit(benchmark::kMicrosecond);
+
+// Adopting a compiled blob, as when it is read back from disk: validation
+// only, nothing is decoded.
+void BM_PolicyBlobLoad(benchmark::State& state) {
+  const std::string blob(WindowsRules(state.range(0)).Build()->blob().bytes());
+  for (auto _ : state) {
+    std::unique_ptr<const RuleSet> rules = RuleSet::FromBlob(blob);
+    benchmark::DoNotOptimize(rules.get());
+  }
+  state.SetBytesProcessed(state.iterations() * blob.size());
+}
+BENCHMARK(BM_PolicyBlobLoad)->Arg(10)->Arg(1000)->Arg(100000);
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,108 @@
+// routine_bench's native messaging host benchmarks: the site snapshots the
+// app sends and the framing the host relays them in. Built where
+// routine_host is.
+
+#include <benchmark/benchmark.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "host/forwarder.h"
+#include "host/policy_sync.h"
+
+namespace routine {
+namespace {
+
+SitePolicy Sites(size_t count) {
+  SitePolicy policy;
+  for (size_t i = 0; i < count; ++i) {
+    policy.sites.push_back("site" + std::to_string(i) + ".example.com");
+  }
+  return policy;
+}
+
+void BM_SnapshotSerialize(benchmark::State& state) {
+  const SitePolicy policy = Sites(state.range(0));
+  size_t bytes = 0;
+  for (auto _ : state) {
+    const std::string snapshot = SerializeSnapshot(policy, false);
+    bytes = snapshot.size();
+    benchmark::DoNotOptimize(snapshot.data());
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_SnapshotSerialize)->Arg(10)->Arg(1000)->Arg(100000);
+
+void BM_SnapshotParse(benchmark::State& state) {
+  const std::string snapshot =
+      SerializeSnapshot(Sites(state.range(0)), false);
+  SitePolicy policy;
+  bool resync = false;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ParseSnapshot(snapshot, &policy, &resync));
+  }
+  state.SetBytesProcessed(state.iterations() * snapshot.size());
+}
+BENCHMARK(BM_SnapshotParse)->Arg(10)->Arg(1000)->Arg(100000);
+
+// Relays 1 MiB of native messaging frames of |range(0)| bytes each through
+// a Forwarder between two socket pairs, a writer and a reader thread on
+// either side, as the host does between the browser and the app.
+void BM_Framing(benchmark::State& state) {
+  const uint32_t size = static_cast<uint32_t>(state.range(0));
+  std::string frame(4, '\0');
+  for (int i = 0; i < 4; ++i) {
+    frame[i] = static_cast<char>(size >> (8 * i));
+  }
+  frame += "{\"action\":\"sync\",\"data\":\"";
+  frame.resize(4 + size - 2, 'x');
+  frame += "\"}";
+  std::string batch;
+  while (batch.size() + frame.size() <= (1 << 20)) {
+    batch += frame;
+  }
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    int in[2];
+    int out[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, in) != 0 ||
+        socketpair(AF_UNIX, SOCK_STREAM, 0, out) != 0) {
+      state.SkipWithError("socketpair failed");
+      break;
+    }
+    state.ResumeTiming();
+
+    std::thread writer([&] {
+      WriteAll(Stream{in[1], true}, batch.data(), batch.size());
+      close(in[1]);
+    });
+    std::thread reader([&] {
+      char buffer[64 * 1024];
+      while (::read(out[0], buffer, sizeof(buffer)) > 0) {
+      }
+    });
+    Forwarder forwarder(Stream{in[0], true}, Stream{out[1], true},
+                        Forwarder::Options());
+    forwarder.Run();
+    close(out[1]);
+    writer.join();
+    reader.join();
+
+    state.PauseTiming();
+    close(in[0]);
+    close(out[0]);
+    state.ResumeTiming();
+  }
+  state.SetBytesProcessed(state.iterations() * batch.size());
+  state.SetItemsProcessed(state.iterations() * (batch.size() / frame.size()));
+}
+BENCHMARK(BM_Framing)->Arg(64)->Arg(4096)->Arg(65536)->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,158 @@
+// Measures ScheduleIndex against re-walking every routine the way
+// DesktopService.evaluate does on each cron tick.
+//
+//   schedule_bench [routines] [queries]
+//
+// For 100, 1000 and |routines| (default 10000) random routines it reports
+// the build time, the cost of ActiveAt() and NextTransition() at random
+// instants over a year, and of the linear walk; and how many wakeups a week
+// the single transition timer takes against the cron tasks the app
+// registers, one per distinct start and end minute, each firing daily.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "core/schedule_index.h"
+#include "core/time_zone.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double NanosSince(Clock::time_point start, size_t count) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+             .count() /
+         count;
+}
+
+// Routine.isActive, one routine at a time.
+bool Active(const routine::RoutineSchedule& routine, int64_t utc,
+            const routine::TimeZone& zone) {
+  if (routine.paused_until > utc || routine.snoozed_until > utc) {
+    return false;
+  }
+  const int64_t local = zone.ToLocal(utc);
+  const int64_t days = local / 86400;
+  const int day = static_cast<int>((days + 3) % 7);
+  const int minutes = static_cast<int>(local % 86400 / 60);
+  auto on = [&](int d) { return (routine.days & (1 << d)) != 0; };
+  if (routine.start_minute == -1) {
+    return on(day);
+  }
+  if (routine.end_minute < routine.start_minute) {
+    return minutes >= routine.start_minute ? on(day)
+           : minutes < routine.end_minute  ? on((day + 6) % 7)
+                                           : false;
+  }
+  return on(day) && minutes >= routine.start_minute &&
+         minutes < routine.end_minute;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t max_routines = argc > 1 ? std::atoi(argv[1]) : 10000;
+  const size_t queries = argc > 2 ? std::atoi(argv[2]) : 100000;
+
+  // 2024-01-01 00:00 UTC, and a year after.
+  const int64_t year_start = 1704067200;
+  const int64_t year_end = year_start + 366 * 86400;
+  const routine::SystemTimeZone system_zone;
+  const routine::FixedOffsetTimeZone fixed_zone(-5 * 3600);
+
+  std::mt19937 random(1);
+  std::uniform_int_distribution<int> days(1, 0x7f);
+  std::uniform_int_distribution<int> quarter(0, 96);
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::uniform_int_distribution<int64_t> instant(year_start, year_end);
+
+  std::vector<routine::RoutineSchedule> all;
+  for (size_t i = 0; i < max_routines; ++i) {
+    routine::RoutineSchedule routine;
+    routine.days = static_cast<uint8_t>(days(random));
+    if (percent(random) >= 10) {
+      routine.start_minute = quarter(random) * 15;
+      routine.end_minute = quarter(random) * 15;
+    }
+    if (percent(random) < 5) {
+      routine.paused_until = instant(random);
+    }
+    all.push_back(routine);
+  }
+  std::vector<int64_t> instants(queries);
+  for (auto& t : instants) {
+    t = instant(random);
+  }
+
+  std::printf("%8s %10s %10s %10s %10s %10s %9s %9s\n", "routines",
+              "build us", "active ns", "next ns", "next sys", "linear ns",
+              "timer/wk", "cron/wk");
+  for (const size_t count : {size_t{100}, size_t{1000}, max_routines}) {
+    if (count > max_routines) {
+      continue;
+    }
+    const std::vector<routine::RoutineSchedule> routines(
+        all.begin(), all.begin() + count);
+
+    Clock::time_point start = Clock::now();
+    const routine::ScheduleIndex index(routines);
+    const double build_us = NanosSince(start, 1000);
+
+    size_t sink = 0;
+    start = Clock::now();
+    for (const int64_t t : instants) {
+      sink += index.ActiveAt(t, fixed_zone).size();
+    }
+    const double active_ns = NanosSince(start, instants.size());
+
+    start = Clock::now();
+    for (const int64_t t : instants) {
+      sink += static_cast<size_t>(index.NextTransition(t, fixed_zone));
+    }
+    const double next_ns = NanosSince(start, instants.size());
+
+    const size_t system_queries = std::min<size_t>(instants.size(), 2000);
+    start = Clock::now();
+    for (size_t i = 0; i < system_queries; ++i) {
+      sink += static_cast<size_t>(index.NextTransition(instants[i],
+                                                       system_zone));
+    }
+    const double next_system_ns = NanosSince(start, system_queries);
+
+    const size_t linear_queries = std::min<size_t>(instants.size(), 2000);
+    start = Clock::now();
+    for (size_t i = 0; i < linear_queries; ++i) {
+      for (const auto& routine : routines) {
+        sink += Active(routine, instants[i], fixed_zone) ? 1 : 0;
+      }
+    }
+    const double linear_ns = NanosSince(start, linear_queries);
+
+    // Wakeups over one week of following NextTransition().
+    size_t wakeups = 0;
+    for (int64_t t = year_start + 30 * 86400; t < year_start + 37 * 86400;
+         t = index.NextTransition(t, fixed_zone)) {
+      ++wakeups;
+    }
+    std::set<int> cron_minutes = {0};
+    for (const auto& routine : routines) {
+      if (routine.start_minute != -1) {
+        cron_minutes.insert(routine.start_minute % 1440);
+        cron_minutes.insert(routine.end_minute % 1440);
+      }
+    }
+
+    std::printf("%8zu %10.1f %10.1f %10.1f %10.1f %10.1f %9zu %9zu\n", count,
+                build_us, active_ns, next_ns, next_system_ns, linear_ns,
+                wakeups, cron_minutes.size() * 7);
+    if (sink == 42) {
+      std::printf("\n");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,249 @@
+// Compares the transports the native messaging host can use to reach the
+// Routine app: the abstract Unix domain socket, loopback TCP (the fallback)
+// and the shared-memory ring meant for bulk rule pushes.
+//
+//   transport_bench [iterations] [size] [bulk size]
+//
+// For each transport a forked child plays the app and echoes every message;
+// the bench reports the cost of connecting (sockets only) and round trips
+// with one message in flight, for small messages and for bulk pushes.
+
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "host/forwarder.h"
+#include "host/shm_ring.h"
+#include "host/stream.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Micros(Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+std::string Frame(size_t size) {
+  std::string frame(4 + size, 'x');
+  for (int i = 0; i < 4; ++i) {
+    frame[i] = static_cast<char>(size >> (8 * i));
+  }
+  return frame;
+}
+
+bool ReadExactly(routine::Stream from, char* data, size_t size) {
+  while (size > 0) {
+    const int64_t read = routine::ReadSome(from, data, size);
+    if (read <= 0) {
+      return false;
+    }
+    data += read;
+    size -= static_cast<size_t>(read);
+  }
+  return true;
+}
+
+void Report(const char* transport, const char* what,
+            std::vector<double> samples) {
+  if (samples.empty()) {
+    return;
+  }
+  std::sort(samples.begin(), samples.end());
+  std::printf("%-6s %-18s %9.1f us p50, %9.1f us p99\n", transport, what,
+              samples[samples.size() / 2],
+              samples[samples.size() * 99 / 100]);
+}
+
+// Forks the app side: accepts connections on |listener| one at a time and
+// echoes each until it closes.
+pid_t ForkEchoServer(int listener) {
+  const pid_t child = fork();
+  if (child == 0) {
+    for (;;) {
+      const int fd = accept(listener, nullptr, nullptr);
+      if (fd < 0) {
+        _exit(1);
+      }
+      routine::Forwarder::Options options;
+      options.max_message_size = 64 * 1024 * 1024;
+      routine::Forwarder forwarder(routine::Stream{fd, true},
+                                   routine::Stream{fd, true}, options);
+      forwarder.Run();
+      close(fd);
+    }
+  }
+  return child;
+}
+
+void BenchSocket(const char* transport, int listener,
+                 const std::function<routine::Stream()>& connect,
+                 int iterations, size_t size, size_t bulk_size) {
+  const pid_t server = ForkEchoServer(listener);
+
+  std::vector<double> connects;
+  for (int i = 0; i < iterations; ++i) {
+    const Clock::time_point start = Clock::now();
+    const routine::Stream stream = connect();
+    connects.push_back(Micros(Clock::now() - start));
+    if (stream.handle < 0) {
+      std::fprintf(stderr, "%s: connect failed\n", transport);
+      break;
+    }
+    routine::Close(stream);
+  }
+  Report(transport, "connect", connects);
+
+  const routine::Stream stream = connect();
+  for (const size_t message_size : {size, bulk_size}) {
+    const std::string frame = Frame(message_size);
+    std::string reply(frame.size(), '\0');
+    std::vector<double> round_trips;
+    // Bulk pushes take long enough that fewer samples do.
+    const int count = message_size == size ? iterations : iterations / 10 + 1;
+    for (int i = 0; i < count; ++i) {
+      const Clock::time_point sent = Clock::now();
+      if (!routine::WriteAll(stream, frame.data(), frame.size()) ||
+          !ReadExactly(stream, reply.data(), reply.size())) {
+        std::fprintf(stderr, "%s: echo failed\n", transport);
+        break;
+      }
+      round_trips.push_back(Micros(Clock::now() - sent));
+    }
+    const std::string what =
+        "round trip " + std::to_string(message_size) + "B";
+    Report(transport, what.c_str(), round_trips);
+  }
+  routine::Close(stream);
+
+  kill(server, SIGKILL);
+  waitpid(server, nullptr, 0);
+  close(listener);
+}
+
+int ListenAbstract(const std::string& name) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path + 1, name.data(), name.size());
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (bind(fd, reinterpret_cast<const sockaddr*>(&address),
+           static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 +
+                                  name.size())) != 0 ||
+      listen(fd, 128) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int ListenLoopback(int* port) {
+  const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t address_size = sizeof(address);
+  if (bind(fd, reinterpret_cast<const sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(fd, 128) != 0 ||
+      getsockname(fd, reinterpret_cast<sockaddr*>(&address),
+                  &address_size) != 0) {
+    close(fd);
+    return -1;
+  }
+  *port = ntohs(address.sin_port);
+  return fd;
+}
+
+void BenchRing(int iterations, size_t size, size_t bulk_size) {
+  auto requests = routine::ShmRing::Create(2 * bulk_size + 64);
+  auto replies = routine::ShmRing::Create(2 * bulk_size + 64);
+  if (requests == nullptr || replies == nullptr) {
+    std::fprintf(stderr, "ring: create failed\n");
+    return;
+  }
+
+  const pid_t server = fork();
+  if (server == 0) {
+    auto in = routine::ShmRing::Map(dup(requests->fd()));
+    auto out = routine::ShmRing::Map(dup(replies->fd()));
+    std::string message;
+    for (;;) {
+      while (!in->TryRead(&message)) {
+        in->WaitReadable(std::chrono::milliseconds(1000));
+      }
+      while (!out->TryWrite(message.data(), message.size())) {
+        out->WaitWritable(message.size(), std::chrono::milliseconds(1000));
+      }
+    }
+  }
+
+  std::string reply;
+  for (const size_t message_size : {size, bulk_size}) {
+    const std::string message(message_size, 'x');
+    std::vector<double> round_trips;
+    const int count = message_size == size ? iterations : iterations / 10 + 1;
+    for (int i = 0; i < count; ++i) {
+      const Clock::time_point sent = Clock::now();
+      if (!requests->TryWrite(message.data(), message.size())) {
+        std::fprintf(stderr, "ring: %zu bytes do not fit\n", message_size);
+        break;
+      }
+      while (!replies->TryRead(&reply)) {
+        replies->WaitReadable(std::chrono::milliseconds(1000));
+      }
+      round_trips.push_back(Micros(Clock::now() - sent));
+    }
+    const std::string what =
+        "round trip " + std::to_string(message_size) + "B";
+    Report("ring", what.c_str(), round_trips);
+  }
+
+  kill(server, SIGKILL);
+  waitpid(server, nullptr, 0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int iterations = argc > 1 ? std::atoi(argv[1]) : 10000;
+  const size_t size = argc > 2 ? std::atoi(argv[2]) : 256;
+  const size_t bulk_size = argc > 3 ? std::atoi(argv[3]) : 256 * 1024;
+
+  const std::string name =
+      "routine_transport_bench." + std::to_string(getpid());
+  const int local = ListenAbstract(name);
+  if (local < 0) {
+    std::fprintf(stderr, "couldn't listen on the abstract socket\n");
+    return 1;
+  }
+  BenchSocket(
+      "uds", local, [&] { return routine::ConnectLocal(name.c_str()); },
+      iterations, size, bulk_size);
+
+  int port = 0;
+  const int loopback = ListenLoopback(&port);
+  if (loopback < 0) {
+    std::fprintf(stderr, "couldn't listen on loopback\n");
+    return 1;
+  }
+  BenchSocket(
+      "tcp", loopback, [&] { return routine::ConnectLoopback(port, port); },
+      iterations, size, bulk_size);
+
+  BenchRing(iterations, size, bulk_size);
+  return 0;
+}
@@ -0,0 +1,44 @@
+#include "core/app_event_batcher.h"
+
+#include <utility>
+
+namespace routine {
+
+AppEventBatcher::AppEventBatcher(size_t batch_size, Sink sink)
+    : batch_size_(batch_size > 0 ? batch_size : 1), sink_(std::move(sink)) {
+  pending_.apps.reserve(batch_size_);
+}
+
+AppEventBatcher::~AppEventBatcher() = default;
+
+void AppEventBatcher::AppAdded(const RunningApp& app) {
+  Append(Change::kAdded, app);
+}
+
+void AppEventBatcher::AppRemoved(const RunningApp& app) {
+  Append(Change::kRemoved, app);
+}
+
+void AppEventBatcher::Flush() {
+  if (pending_.apps.empty()) {
+    return;
+  }
+  Batch batch;
+  batch.change = pending_.change;
+  batch.apps.reserve(batch_size_);
+  std::swap(batch, pending_);
+  sink_(std::move(batch));
+}
+
+void AppEventBatcher::Append(Change change, const RunningApp& app) {
+  if (pending_.change != change) {
+    Flush();
+    pending_.change = change;
+  }
+  pending_.apps.push_back(app);
+  if (pending_.apps.size() >= batch_size_) {
+    Flush();
+  }
+}
+
+}  // namespace routine
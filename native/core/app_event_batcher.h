@@ -0,0 +1,53 @@
+#ifndef ROUTINE_CORE_APP_EVENT_BATCHER_H_
+#define ROUTINE_CORE_APP_EVENT_BATCHER_H_
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "core/process_table.h"
+
+namespace routine {
+
+// Turns ProcessTable changes into the batches the running-apps event stream
+// sends, so the picker can show the first apps before enumeration finishes
+// and afterwards only hears about what changed.
+//
+// Consecutive changes of the same kind are grouped. A batch goes to the sink
+// when it is full, when the kind of change switches (keeping the order an
+// app was added and removed in) or on Flush().
+class AppEventBatcher : public ProcessTable::Observer {
+ public:
+  enum class Change { kAdded, kRemoved };
+
+  struct Batch {
+    Change change = Change::kAdded;
+    std::vector<RunningApp> apps;
+  };
+
+  using Sink = std::function<void(Batch)>;
+
+  AppEventBatcher(size_t batch_size, Sink sink);
+  ~AppEventBatcher() override;
+
+  AppEventBatcher(const AppEventBatcher&) = delete;
+  AppEventBatcher& operator=(const AppEventBatcher&) = delete;
+
+  // ProcessTable::Observer:
+  void AppAdded(const RunningApp& app) override;
+  void AppRemoved(const RunningApp& app) override;
+
+  // Hands over whatever is pending, e.g. at the end of an Update().
+  void Flush();
+
+ private:
+  void Append(Change change, const RunningApp& app);
+
+  const size_t batch_size_;
+  Sink sink_;
+  Batch pending_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_APP_EVENT_BATCHER_H_
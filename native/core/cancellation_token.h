@@ -0,0 +1,30 @@
+#ifndef ROUTINE_CORE_CANCELLATION_TOKEN_H_
+#define ROUTINE_CORE_CANCELLATION_TOKEN_H_
+
+#include <atomic>
+#include <memory>
+
+namespace routine {
+
+// Shared between whoever starts a piece of work and the work itself, so the
+// former can ask the latter to stop early. Copies share state.
+class CancellationToken {
+ public:
+  CancellationToken() : cancelled_(std::make_shared<std::atomic<bool>>()) {}
+
+  void Cancel() const { cancelled_->store(true, std::memory_order_relaxed); }
+  bool IsCancelled() const {
+    return cancelled_->load(std::memory_order_relaxed);
+  }
+
+  bool operator==(const CancellationToken& other) const {
+    return cancelled_ == other.cancelled_;
+  }
+
+ private:
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_CANCELLATION_TOKEN_H_
@@ -0,0 +1,100 @@
+#include "core/desktop_session.h"
+
+#include <filesystem>
+#include <system_error>
+
+namespace routine {
+
+// Each list ends with nullptr.
+const char* const kWindowsSessionExecutables[] = {
+    "C:\\Windows\\explorer.exe",
+    nullptr,
+};
+
+const char* const kWindowsSessionDirectories[] = {
+    "C:\\Windows\\SystemApps",
+    nullptr,
+};
+
+const char* const kLinuxSessionExecutables[] = {
+    // Shells and panels.
+    "/usr/bin/gnome-shell",
+    "/usr/bin/plasmashell",
+    "/usr/bin/kwin_x11",
+    "/usr/bin/kwin_wayland",
+    "/usr/bin/xfce4-panel",
+    "/usr/bin/xfdesktop",
+    "/usr/bin/xfwm4",
+    "/usr/bin/cinnamon",
+    "/usr/bin/mate-panel",
+    "/usr/bin/lxpanel",
+    "/usr/bin/lxqt-panel",
+    // Screen lockers.
+    "/usr/bin/xscreensaver",
+    "/usr/bin/light-locker",
+    "/usr/bin/i3lock",
+    "/usr/bin/swaylock",
+    // Display servers.
+    "/usr/bin/Xorg",
+    "/usr/lib/xorg/Xorg",
+    "/usr/libexec/Xorg",
+    "/usr/bin/Xwayland",
+    nullptr,
+};
+
+const char* const kLinuxSessionDirectories[] = {
+    "/usr/libexec",
+    "/usr/lib/*/libexec",
+    "/usr/lib/libexec",
+    nullptr,
+};
+
+namespace {
+
+// Adds |pattern| below |root|, once for every directory its "*" matches.
+void AddDirectoryPattern(const std::string& root, const std::string& pattern,
+                         RuleSet::Builder* builder) {
+  const size_t star = pattern.find("/*/");
+  if (star == std::string::npos) {
+    builder->AddDirectory(root + pattern);
+    return;
+  }
+  const std::string parent = root + pattern.substr(0, star);
+  const std::string rest = pattern.substr(star + 2);
+  std::error_code error;
+  for (std::filesystem::directory_iterator it(parent, error), end;
+       !error && it != end; it.increment(error)) {
+    if (it->is_directory(error)) {
+      builder->AddDirectory(it->path().string() + rest);
+    }
+  }
+}
+
+}  // namespace
+
+void AddWindowsSession(bool allow_list, RuleSet::Builder* builder) {
+  for (const char* const* exe = kWindowsSessionExecutables; *exe; ++exe) {
+    builder->AddExempt(*exe);
+  }
+  if (!allow_list) {
+    return;
+  }
+  for (const char* const* dir = kWindowsSessionDirectories; *dir; ++dir) {
+    builder->AddDirectory(*dir);
+  }
+}
+
+void AddLinuxSession(bool allow_list, RuleSet::Builder* builder,
+                     const std::string& root) {
+  for (const char* const* exe = kLinuxSessionExecutables; *exe; ++exe) {
+    builder->AddExempt(root + *exe);
+  }
+  if (!allow_list) {
+    return;
+  }
+  for (const char* const* dir = kLinuxSessionDirectories; *dir; ++dir) {
+    AddDirectoryPattern(root, *dir, builder);
+  }
+}
+
+}  // namespace routine
@@ -0,0 +1,30 @@
+#ifndef ROUTINE_CORE_DESKTOP_SESSION_H_
+#define ROUTINE_CORE_DESKTOP_SESSION_H_
+
+#include <string>
+
+#include "core/rule_set.h"
+
+namespace routine {
+
+// The parts of the desktop session no routine may block: the shell, panels,
+// screen locker and display server. Blocking them, as an allow list that
+// does not name them would, takes the whole desktop with it.
+//
+// The executables are exempt under any list. The directories hold session
+// helpers and are allowed under an allow list; a "*" component stands for
+// every directory at that level, such as a multiarch triplet.
+extern const char* const kWindowsSessionExecutables[];
+extern const char* const kWindowsSessionDirectories[];
+extern const char* const kLinuxSessionExecutables[];
+extern const char* const kLinuxSessionDirectories[];
+
+// Adds the session's exemptions to |builder|, which lists an allow list if
+// |allow_list|. |root| is prepended to every Linux path, for tests.
+void AddWindowsSession(bool allow_list, RuleSet::Builder* builder);
+void AddLinuxSession(bool allow_list, RuleSet::Builder* builder,
+                     const std::string& root = std::string());
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_DESKTOP_SESSION_H_
@@ -0,0 +1,92 @@
+#include "core/dns_cache.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace routine {
+
+DnsCache::DnsCache(Options options) : options_(options) {
+  index_.reserve(options_.capacity);
+}
+
+void DnsCache::Insert(const DnsQuestion& question, std::string_view response,
+                      const DnsResponseInfo& info, Clock::time_point now) {
+  const uint32_t ttl = std::min(
+      info.ttl, info.negative ? options_.max_negative_ttl : options_.max_ttl);
+  if (ttl == 0 || options_.capacity == 0) {
+    return;
+  }
+
+  std::string key = question.CacheKey();
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    entries_.erase(it->second);
+    index_.erase(it);
+  } else if (index_.size() >= options_.capacity) {
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Entry entry;
+  entry.key = key;
+  entry.response.assign(response);
+  entry.ttl_offsets = info.ttl_offsets;
+  entry.stored = now;
+  entry.expires = now + std::chrono::seconds(ttl);
+  entry.negative = info.negative;
+  entries_.push_front(std::move(entry));
+  index_.emplace(std::move(key), entries_.begin());
+}
+
+bool DnsCache::Lookup(const DnsQuestion& question, uint16_t id,
+                      Clock::time_point now, std::string* response) {
+  auto it = index_.find(question.CacheKey());
+  if (it == index_.end() || now >= it->second->expires) {
+    if (it != index_.end()) {
+      entries_.erase(it->second);
+      index_.erase(it);
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  entries_.splice(entries_.begin(), entries_, it->second);
+  const Entry& entry = *it->second;
+  *response = entry.response;
+  SetDnsId(id, response->data());
+  const uint32_t age = static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::seconds>(now - entry.stored)
+          .count());
+  if (age > 0) {
+    for (const uint16_t offset : entry.ttl_offsets) {
+      char* field = response->data() + offset;
+      uint32_t ttl = 0;
+      for (int i = 0; i < 4; ++i) {
+        ttl = ttl << 8 | static_cast<uint8_t>(field[i]);
+      }
+      ttl = ttl > age ? ttl - age : 0;
+      for (int i = 3; i >= 0; --i) {
+        field[i] = static_cast<char>(ttl);
+        ttl >>= 8;
+      }
+    }
+  }
+
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  if (entry.negative) {
+    negative_hits_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+DnsCache::Stats DnsCache::stats() const {
+  Stats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.negative_hits = negative_hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}  // namespace routine
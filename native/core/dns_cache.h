@@ -0,0 +1,85 @@
+#ifndef ROUTINE_CORE_DNS_CACHE_H_
+#define ROUTINE_CORE_DNS_CACHE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "core/dns_message.h"
+
+namespace routine {
+
+// Upstream DNS responses kept for their TTL, answers and NXDOMAIN/no-data
+// alike, so repeated lookups never leave the machine. Hits are served as
+// the upstream's bytes with the client's id and every TTL aged by the time
+// spent in the cache. Least recently used entries go first when full.
+//
+// Not thread-safe; stats() may be read from any thread.
+class DnsCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    size_t capacity = 4096;
+    // Caps on how long an answer and a negative answer are kept, whatever
+    // their TTL says.
+    uint32_t max_ttl = 3600;
+    uint32_t max_negative_ttl = 900;
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    // Hits on NXDOMAIN or empty answers; included in |hits|.
+    uint64_t negative_hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  explicit DnsCache(Options options);
+
+  DnsCache(const DnsCache&) = delete;
+  DnsCache& operator=(const DnsCache&) = delete;
+
+  // Keeps |response| to |question| if |info| says it may be cached.
+  void Insert(const DnsQuestion& question, std::string_view response,
+              const DnsResponseInfo& info, Clock::time_point now);
+
+  // On a hit, stores the cached answer to |question| with |id| and aged to
+  // |now| in |response|.
+  bool Lookup(const DnsQuestion& question, uint16_t id, Clock::time_point now,
+              std::string* response);
+
+  size_t size() const { return index_.size(); }
+  Stats stats() const;
+
+ private:
+  struct Entry {
+    std::string key;
+    std::string response;
+    std::vector<uint16_t> ttl_offsets;
+    Clock::time_point stored;
+    Clock::time_point expires;
+    bool negative = false;
+  };
+  using EntryList = std::list<Entry>;
+
+  const Options options_;
+  // Most recently used first.
+  EntryList entries_;
+  std::unordered_map<std::string, EntryList::iterator> index_;
+
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> negative_hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> evictions_{0};
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_DNS_CACHE_H_
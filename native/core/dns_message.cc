@@ -0,0 +1,314 @@
+#include "core/dns_message.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace routine {
+
+namespace {
+
+// Header flag bits, in the third and fourth bytes.
+constexpr uint8_t kQr = 0x80;
+constexpr uint8_t kOpcodeMask = 0x78;
+constexpr uint8_t kTc = 0x02;
+constexpr uint8_t kRd = 0x01;
+constexpr uint8_t kRa = 0x80;
+constexpr uint8_t kCd = 0x10;
+constexpr uint8_t kRcodeMask = 0x0f;
+
+constexpr size_t kMaxName = 255;
+// Compression pointers followed while reading one name; more is a loop.
+constexpr int kMaxPointers = 16;
+// The smallest resource record: the root name, then type, class, TTL and
+// RDLENGTH.
+constexpr size_t kMinRecord = 11;
+
+uint16_t Load16(std::string_view message, size_t offset) {
+  return static_cast<uint16_t>(static_cast<uint8_t>(message[offset]) << 8 |
+                               static_cast<uint8_t>(message[offset + 1]));
+}
+
+uint32_t Load32(std::string_view message, size_t offset) {
+  return static_cast<uint32_t>(Load16(message, offset)) << 16 |
+         Load16(message, offset + 2);
+}
+
+void Append16(uint16_t value, std::string* out) {
+  out->push_back(static_cast<char>(value >> 8));
+  out->push_back(static_cast<char>(value));
+}
+
+void Append32(uint32_t value, std::string* out) {
+  Append16(static_cast<uint16_t>(value >> 16), out);
+  Append16(static_cast<uint16_t>(value), out);
+}
+
+void Store16(uint16_t value, std::string* out, size_t offset) {
+  (*out)[offset] = static_cast<char>(value >> 8);
+  (*out)[offset + 1] = static_cast<char>(value);
+}
+
+// Moves |*offset| past the name there. Returns false if it runs off the end
+// or uses reserved label types.
+bool SkipName(std::string_view message, size_t* offset) {
+  size_t at = *offset;
+  for (;;) {
+    if (at >= message.size()) {
+      return false;
+    }
+    const uint8_t length = static_cast<uint8_t>(message[at]);
+    if ((length & 0xc0) == 0xc0) {
+      if (at + 2 > message.size()) {
+        return false;
+      }
+      *offset = at + 2;
+      return true;
+    }
+    if ((length & 0xc0) != 0) {
+      return false;
+    }
+    if (length == 0) {
+      *offset = at + 1;
+      return true;
+    }
+    at += 1 + length;
+  }
+}
+
+// Reads the name at |*offset| in lower case and dotted form, following
+// compression pointers, and moves |*offset| past it. Queries never need
+// pointers, so |allow_pointers| is false for them.
+bool ReadName(std::string_view message, size_t* offset, bool allow_pointers,
+              std::string* name) {
+  name->clear();
+  size_t at = *offset;
+  size_t end = 0;
+  size_t wire_size = 1;
+  int pointers = 0;
+  for (;;) {
+    if (at >= message.size()) {
+      return false;
+    }
+    const uint8_t length = static_cast<uint8_t>(message[at]);
+    if ((length & 0xc0) == 0xc0) {
+      if (!allow_pointers || at + 2 > message.size() ||
+          ++pointers > kMaxPointers) {
+        return false;
+      }
+      if (end == 0) {
+        end = at + 2;
+      }
+      at = Load16(message, at) & 0x3fff;
+      continue;
+    }
+    if ((length & 0xc0) != 0) {
+      return false;
+    }
+    if (length == 0) {
+      *offset = end != 0 ? end : at + 1;
+      return true;
+    }
+    wire_size += 1 + length;
+    if (wire_size > kMaxName || at + 1 + length > message.size()) {
+      return false;
+    }
+    if (!name->empty()) {
+      name->push_back('.');
+    }
+    for (size_t i = at + 1; i < at + 1 + length; ++i) {
+      const char c = message[i];
+      name->push_back(c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a')
+                                           : c);
+    }
+    at += 1 + length;
+  }
+}
+
+// The header and question of |query| turned into a response with |rcode|
+// and |answers| answer records to follow.
+std::string ResponseHeader(std::string_view query, size_t question_end,
+                           uint8_t rcode, uint16_t answers) {
+  std::string response(query.substr(0, question_end));
+  const uint8_t flags = static_cast<uint8_t>(query[2]);
+  const uint8_t flags2 = static_cast<uint8_t>(query[3]);
+  response[2] = static_cast<char>(kQr | (flags & kRd));
+  response[3] = static_cast<char>(kRa | (flags2 & kCd) | rcode);
+  Store16(1, &response, 4);
+  Store16(answers, &response, 6);
+  Store16(0, &response, 8);
+  Store16(0, &response, 10);
+  return response;
+}
+
+}  // namespace
+
+std::string DnsQuestion::CacheKey() const {
+  std::string key = name;
+  key.push_back('\0');
+  Append16(type, &key);
+  Append16(klass, &key);
+  key.push_back(static_cast<char>((edns ? 1 : 0) | (dnssec_ok ? 2 : 0) |
+                                  (checking_disabled ? 4 : 0)));
+  return key;
+}
+
+bool ParseDnsQuery(std::string_view message, DnsQuestion* question,
+                   size_t* question_end) {
+  if (message.size() < kDnsHeaderSize) {
+    return false;
+  }
+  const uint8_t flags = static_cast<uint8_t>(message[2]);
+  if ((flags & (kQr | kOpcodeMask)) != 0 || Load16(message, 4) != 1 ||
+      Load16(message, 6) != 0 || Load16(message, 8) != 0) {
+    return false;
+  }
+
+  size_t offset = kDnsHeaderSize;
+  if (!ReadName(message, &offset, false, &question->name) ||
+      offset + 4 > message.size()) {
+    return false;
+  }
+  question->type = Load16(message, offset);
+  question->klass = Load16(message, offset + 2);
+  question->checking_disabled = (message[3] & kCd) != 0;
+  question->edns = false;
+  question->dnssec_ok = false;
+  offset += 4;
+  *question_end = offset;
+
+  // The additional section may carry the client's EDNS OPT record.
+  const uint16_t additional = Load16(message, 10);
+  for (uint16_t i = 0; i < additional; ++i) {
+    if (!SkipName(message, &offset) || offset + 10 > message.size()) {
+      return false;
+    }
+    const uint16_t type = Load16(message, offset);
+    const uint32_t ttl = Load32(message, offset + 4);
+    const size_t end = offset + 10 + Load16(message, offset + 8);
+    if (end > message.size()) {
+      return false;
+    }
+    if (type == kDnsTypeOpt) {
+      question->edns = true;
+      // The OPT TTL holds the extended rcode, version and the DO bit.
+      question->dnssec_ok = (ttl & 0x8000) != 0;
+    }
+    offset = end;
+  }
+  return true;
+}
+
+std::string BuildDnsBlockedResponse(std::string_view query,
+                                    size_t question_end,
+                                    const DnsQuestion& question, bool sinkhole,
+                                    uint32_t ttl) {
+  if (!sinkhole) {
+    return ResponseHeader(query, question_end, kDnsNxDomain, 0);
+  }
+  size_t address_size = 0;
+  if (question.klass == kDnsClassIn) {
+    if (question.type == kDnsTypeA) {
+      address_size = 4;
+    } else if (question.type == kDnsTypeAaaa) {
+      address_size = 16;
+    }
+  }
+  std::string response = ResponseHeader(query, question_end, kDnsNoError,
+                                        address_size != 0 ? 1 : 0);
+  if (address_size != 0) {
+    // A pointer to the question's name, then the unspecified address.
+    Append16(0xc000 | kDnsHeaderSize, &response);
+    Append16(question.type, &response);
+    Append16(kDnsClassIn, &response);
+    Append32(ttl, &response);
+    Append16(static_cast<uint16_t>(address_size), &response);
+    response.append(address_size, '\0');
+  }
+  return response;
+}
+
+std::string BuildDnsErrorResponse(std::string_view query, size_t question_end,
+                                  uint8_t rcode) {
+  return ResponseHeader(query, question_end, rcode, 0);
+}
+
+bool ScanDnsResponse(std::string_view response, const DnsQuestion& question,
+                     DnsResponseInfo* info) {
+  if (response.size() < kDnsHeaderSize ||
+      response.size() > std::numeric_limits<uint16_t>::max()) {
+    return false;
+  }
+  const uint8_t flags = static_cast<uint8_t>(response[2]);
+  if ((flags & kQr) == 0 || (flags & kOpcodeMask) != 0 ||
+      Load16(response, 4) != 1) {
+    return false;
+  }
+
+  size_t offset = kDnsHeaderSize;
+  std::string name;
+  if (!ReadName(response, &offset, true, &name) ||
+      offset + 4 > response.size() || name != question.name ||
+      Load16(response, offset) != question.type ||
+      Load16(response, offset + 2) != question.klass) {
+    return false;
+  }
+  offset += 4;
+
+  info->rcode = static_cast<uint8_t>(response[3]) & kRcodeMask;
+  info->truncated = (flags & kTc) != 0;
+  info->ttl_offsets.clear();
+
+  const uint16_t answers = Load16(response, 6);
+  const uint32_t records = uint32_t{answers} + Load16(response, 8) +
+                           Load16(response, 10);
+  // Counts the rest of the message cannot hold are a lie.
+  if (records > (response.size() - offset) / kMinRecord) {
+    return false;
+  }
+  uint32_t min_ttl = std::numeric_limits<uint32_t>::max();
+  uint32_t negative_ttl = 0;
+  for (uint32_t i = 0; i < records; ++i) {
+    if (!SkipName(response, &offset) || offset + 10 > response.size()) {
+      return false;
+    }
+    const uint16_t type = Load16(response, offset);
+    uint32_t ttl = Load32(response, offset + 4);
+    const size_t rdata = offset + 10;
+    const size_t end = rdata + Load16(response, offset + 8);
+    if (end > response.size()) {
+      return false;
+    }
+    if (type != kDnsTypeOpt) {
+      // RFC 2181: a TTL with the top bit set is zero.
+      if (ttl > 0x7fffffff) {
+        ttl = 0;
+      }
+      info->ttl_offsets.push_back(static_cast<uint16_t>(offset + 4));
+      min_ttl = std::min(min_ttl, ttl);
+    }
+    if (type == kDnsTypeSoa && i >= answers) {
+      // MNAME, RNAME, then serial, refresh, retry, expire and minimum.
+      size_t at = rdata;
+      if (SkipName(response, &at) && SkipName(response, &at) &&
+          at + 20 <= end) {
+        negative_ttl = std::min(ttl, Load32(response, at + 16));
+      }
+    }
+    offset = end;
+  }
+
+  info->negative = info->rcode == kDnsNxDomain ||
+                   (info->rcode == kDnsNoError && answers == 0);
+  if (info->truncated) {
+    info->ttl = 0;
+  } else if (info->negative) {
+    info->ttl = negative_ttl;
+  } else if (info->rcode == kDnsNoError) {
+    info->ttl = min_ttl;
+  } else {
+    info->ttl = 0;
+  }
+  return true;
+}
+
+}  // namespace routine
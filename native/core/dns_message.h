@@ -0,0 +1,100 @@
+#ifndef ROUTINE_CORE_DNS_MESSAGE_H_
+#define ROUTINE_CORE_DNS_MESSAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace routine {
+
+// Just enough of RFC 1035 wire format for a stub resolver that answers some
+// names itself and relays the rest: the question of a query, answers that
+// refuse it, and what a cache needs to know about an upstream response.
+
+constexpr size_t kDnsHeaderSize = 12;
+
+constexpr uint16_t kDnsTypeA = 1;
+constexpr uint16_t kDnsTypeSoa = 6;
+constexpr uint16_t kDnsTypeAaaa = 28;
+constexpr uint16_t kDnsTypeOpt = 41;
+constexpr uint16_t kDnsClassIn = 1;
+
+constexpr uint8_t kDnsNoError = 0;
+constexpr uint8_t kDnsServFail = 2;
+constexpr uint8_t kDnsNxDomain = 3;
+
+struct DnsQuestion {
+  // Lower case, without the trailing root dot; empty for the root.
+  std::string name;
+  uint16_t type = 0;
+  uint16_t klass = 0;
+  // The query carries an EDNS OPT record, so the client takes answers
+  // larger than 512 bytes.
+  bool edns = false;
+  // EDNS DO: the client wants DNSSEC records.
+  bool dnssec_ok = false;
+  // Header CD: the client validates DNSSEC itself.
+  bool checking_disabled = false;
+
+  // Tells apart questions whose answers differ: by name, type, class and
+  // the flags that change what the answer holds.
+  std::string CacheKey() const;
+};
+
+inline uint16_t DnsId(std::string_view message) {
+  return message.size() < 2
+             ? 0
+             : static_cast<uint16_t>(
+                   static_cast<uint8_t>(message[0]) << 8 |
+                   static_cast<uint8_t>(message[1]));
+}
+
+inline void SetDnsId(uint16_t id, char* message) {
+  message[0] = static_cast<char>(id >> 8);
+  message[1] = static_cast<char>(id);
+}
+
+// Parses a standard query (QR clear, opcode 0) with exactly one question.
+// |question_end| receives the offset just past the question. Returns false
+// for responses, other opcodes and anything malformed.
+bool ParseDnsQuery(std::string_view message, DnsQuestion* question,
+                   size_t* question_end);
+
+// The answer to a blocked |query|, which ParseDnsQuery() accepted with
+// |question_end|: NXDOMAIN, or with |sinkhole| an A 0.0.0.0 or AAAA ::
+// record (no data for other types) valid for |ttl| seconds.
+std::string BuildDnsBlockedResponse(std::string_view query,
+                                    size_t question_end,
+                                    const DnsQuestion& question, bool sinkhole,
+                                    uint32_t ttl);
+
+// An answer to |query| with only a response code, e.g. SERVFAIL when the
+// upstream resolver does not reply.
+std::string BuildDnsErrorResponse(std::string_view query, size_t question_end,
+                                  uint8_t rcode);
+
+// What a cache needs to know about an upstream response.
+struct DnsResponseInfo {
+  uint8_t rcode = 0;
+  bool truncated = false;
+  // How long the response may be served from a cache: the smallest TTL of
+  // its records, or for NXDOMAIN and empty answers the SOA's negative TTL
+  // (RFC 2308). Zero means do not cache.
+  uint32_t ttl = 0;
+  // Whether it is an NXDOMAIN or empty answer.
+  bool negative = false;
+  // Offsets of every record's TTL field, OPT records excepted, so a cached
+  // copy can be aged.
+  std::vector<uint16_t> ttl_offsets;
+};
+
+// Checks that |response| answers |question| and summarises it. Returns
+// false if it is malformed, not a response or for another question.
+bool ScanDnsResponse(std::string_view response, const DnsQuestion& question,
+                     DnsResponseInfo* info);
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_DNS_MESSAGE_H_
@@ -0,0 +1,373 @@
+#include "core/domain_matcher.h"
+
+#include <limits>
+
+#include "core/path.h"
+
+namespace routine {
+
+namespace {
+
+constexpr size_t kMaxLabelSize = 63;
+constexpr size_t kMaxNameSize = 253;
+constexpr size_t kInitialCapacity = 16;
+
+// RFC 3492 parameters.
+constexpr uint32_t kBase = 36;
+constexpr uint32_t kTMin = 1;
+constexpr uint32_t kTMax = 26;
+constexpr uint32_t kSkew = 38;
+constexpr uint32_t kDamp = 700;
+constexpr uint32_t kInitialBias = 72;
+constexpr uint32_t kInitialN = 0x80;
+
+// Decodes the code point at |*pos| and moves past it. Rejects overlong
+// forms, surrogates and values past U+10FFFF.
+bool DecodeUtf8(std::string_view text, size_t* pos, uint32_t* code_point) {
+  const uint8_t lead = static_cast<uint8_t>(text[*pos]);
+  size_t length;
+  uint32_t value;
+  uint32_t min;
+  if (lead < 0x80) {
+    *code_point = lead;
+    ++*pos;
+    return true;
+  } else if ((lead & 0xe0) == 0xc0) {
+    length = 2;
+    value = lead & 0x1f;
+    min = 0x80;
+  } else if ((lead & 0xf0) == 0xe0) {
+    length = 3;
+    value = lead & 0x0f;
+    min = 0x800;
+  } else if ((lead & 0xf8) == 0xf0) {
+    length = 4;
+    value = lead & 0x07;
+    min = 0x10000;
+  } else {
+    return false;
+  }
+  if (text.size() - *pos < length) {
+    return false;
+  }
+  for (size_t i = 1; i < length; ++i) {
+    const uint8_t byte = static_cast<uint8_t>(text[*pos + i]);
+    if ((byte & 0xc0) != 0x80) {
+      return false;
+    }
+    value = (value << 6) | (byte & 0x3f);
+  }
+  if (value < min || value > 0x10ffff || (value >= 0xd800 && value <= 0xdfff)) {
+    return false;
+  }
+  *code_point = value;
+  *pos += length;
+  return true;
+}
+
+uint32_t ToLower(uint32_t c) {
+  if (c < 0x80) {
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+  }
+  // Latin-1, Greek and the main Cyrillic capitals sit 0x20 below their
+  // small letters.
+  if ((c >= 0xc0 && c <= 0xde && c != 0xd7) ||
+      (c >= 0x391 && c <= 0x3ab && c != 0x3a2) ||
+      (c >= 0x410 && c <= 0x42f)) {
+    return c + 0x20;
+  }
+  if (c >= 0x400 && c <= 0x40f) {
+    return c + 0x50;
+  }
+  if (c == 0x178) {
+    return 0xff;
+  }
+  // Latin Extended-A pairs each capital with the next code point.
+  if ((c >= 0x100 && c <= 0x137 && c != 0x130) || (c >= 0x14a && c <= 0x177)) {
+    return c | 1;
+  }
+  if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17e)) {
+    return (c & 1) != 0 ? c + 1 : c;
+  }
+  return c;
+}
+
+bool IsLabelSeparator(uint32_t c) {
+  // '.', and the ideographic and fullwidth full stops IDNA treats as dots.
+  return c == '.' || c == 0x3002 || c == 0xff0e || c == 0xff61;
+}
+
+char EncodeDigit(uint64_t digit) {
+  return static_cast<char>(digit < 26 ? 'a' + digit : '0' + (digit - 26));
+}
+
+uint64_t Adapt(uint64_t delta, uint64_t points, bool first) {
+  delta = first ? delta / kDamp : delta / 2;
+  delta += delta / points;
+  uint64_t k = 0;
+  while (delta > ((kBase - kTMin) * kTMax) / 2) {
+    delta /= kBase - kTMin;
+    k += kBase;
+  }
+  return k + (kBase - kTMin + 1) * delta / (delta + kSkew);
+}
+
+// Appends the RFC 3492 encoding of |label|. Labels are at most a few hundred
+// code points, so the 64-bit delta cannot overflow.
+void AppendPunycode(const std::vector<uint32_t>& label, std::string* out) {
+  size_t basic = 0;
+  for (const uint32_t c : label) {
+    if (c < 0x80) {
+      out->push_back(static_cast<char>(c));
+      ++basic;
+    }
+  }
+  if (basic > 0) {
+    out->push_back('-');
+  }
+
+  uint64_t n = kInitialN;
+  uint64_t delta = 0;
+  uint64_t bias = kInitialBias;
+  size_t handled = basic;
+  while (handled < label.size()) {
+    uint64_t next = std::numeric_limits<uint64_t>::max();
+    for (const uint32_t c : label) {
+      if (c >= n && c < next) {
+        next = c;
+      }
+    }
+    delta += (next - n) * (handled + 1);
+    n = next;
+    for (const uint32_t c : label) {
+      if (c < n) {
+        ++delta;
+      } else if (c == n) {
+        uint64_t q = delta;
+        for (uint64_t k = kBase;; k += kBase) {
+          const uint64_t t =
+              k <= bias ? kTMin : k >= bias + kTMax ? kTMax : k - bias;
+          if (q < t) {
+            break;
+          }
+          out->push_back(EncodeDigit(t + (q - t) % (kBase - t)));
+          q = (q - t) / (kBase - t);
+        }
+        out->push_back(EncodeDigit(q));
+        bias = Adapt(delta, handled + 1, handled == basic);
+        delta = 0;
+        ++handled;
+      }
+    }
+    ++delta;
+    ++n;
+  }
+}
+
+uint64_t HashLabel(uint32_t parent, std::string_view label) {
+  uint64_t hash = 14695981039346656037ull ^ parent;
+  for (const char c : label) {
+    hash ^= static_cast<uint8_t>(FoldAscii(c));
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+}  // namespace
+
+bool NormalizeDomain(std::string_view domain, std::string* ascii) {
+  ascii->clear();
+  if (domain.substr(0, 2) == "*.") {
+    domain.remove_prefix(2);
+  }
+  while (!domain.empty() && domain.front() == '.') {
+    domain.remove_prefix(1);
+  }
+  while (!domain.empty() && domain.back() == '.') {
+    domain.remove_suffix(1);
+  }
+
+  std::vector<uint32_t> label;
+  bool non_ascii = false;
+  auto finish_label = [&] {
+    if (label.empty()) {
+      return false;
+    }
+    const size_t start = ascii->size();
+    if (non_ascii) {
+      ascii->append("xn--");
+      AppendPunycode(label, ascii);
+    } else {
+      ascii->append(label.begin(), label.end());
+    }
+    label.clear();
+    non_ascii = false;
+    return ascii->size() - start <= kMaxLabelSize;
+  };
+
+  size_t pos = 0;
+  while (pos < domain.size()) {
+    uint32_t c;
+    if (!DecodeUtf8(domain, &pos, &c)) {
+      return false;
+    }
+    if (IsLabelSeparator(c)) {
+      if (!finish_label()) {
+        return false;
+      }
+      ascii->push_back('.');
+      continue;
+    }
+    c = ToLower(c);
+    if (c >= 0x80) {
+      non_ascii = true;
+    } else if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                 c == '-' || c == '_')) {
+      return false;
+    }
+    label.push_back(c);
+  }
+  return finish_label() && ascii->size() <= kMaxNameSize;
+}
+
+DomainMatcher::DomainMatcher() { Clear(); }
+
+bool DomainMatcher::Add(std::string_view domain) {
+  std::string ascii;
+  if (!NormalizeDomain(domain, &ascii)) {
+    return false;
+  }
+  uint32_t node = 0;
+  std::string_view rest = ascii;
+  while (!rest.empty()) {
+    const size_t dot = rest.rfind('.');
+    const std::string_view label =
+        dot == std::string_view::npos ? rest : rest.substr(dot + 1);
+    rest = dot == std::string_view::npos ? std::string_view()
+                                         : rest.substr(0, dot);
+    const uint64_t hash = HashLabel(node, label);
+    uint32_t child = Find(node, label, hash);
+    if (child == 0) {
+      child = Insert(node, label, hash);
+    } else if (terminal_[child]) {
+      // Already listed itself or through a parent.
+      return true;
+    }
+    node = child;
+  }
+  terminal_[node] = true;
+  ++size_;
+  return true;
+}
+
+bool DomainMatcher::Matches(std::string_view host) const {
+  while (!host.empty() && host.back() == '.') {
+    host.remove_suffix(1);
+  }
+  if (size_ == 0 || host.empty()) {
+    return false;
+  }
+  for (const char c : host) {
+    if (static_cast<uint8_t>(c) >= 0x80) {
+      std::string ascii;
+      return NormalizeDomain(host, &ascii) && MatchesAscii(ascii);
+    }
+  }
+  return MatchesAscii(host);
+}
+
+bool DomainMatcher::MatchesAscii(std::string_view host) const {
+  uint32_t node = 0;
+  while (!host.empty()) {
+    const size_t dot = host.rfind('.');
+    const std::string_view label =
+        dot == std::string_view::npos ? host : host.substr(dot + 1);
+    if (label.empty()) {
+      return false;
+    }
+    node = Find(node, label, HashLabel(node, label));
+    if (node == 0) {
+      return false;
+    }
+    if (terminal_[node]) {
+      return true;
+    }
+    host = dot == std::string_view::npos ? std::string_view()
+                                         : host.substr(0, dot);
+  }
+  return false;
+}
+
+void DomainMatcher::Clear() {
+  table_.assign(kInitialCapacity, Edge());
+  edge_count_ = 0;
+  terminal_.assign(1, false);
+  labels_.clear();
+  size_ = 0;
+}
+
+uint32_t DomainMatcher::Find(uint32_t parent, std::string_view label,
+                             uint64_t hash) const {
+  const size_t mask = table_.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    const Edge& edge = table_[i];
+    if (edge.child == 0) {
+      return 0;
+    }
+    if (edge.hash != hash || edge.parent != parent ||
+        edge.label_size != label.size()) {
+      continue;
+    }
+    const char* stored = labels_.data() + edge.label_offset;
+    size_t j = 0;
+    while (j < label.size() && FoldAscii(label[j]) == stored[j]) {
+      ++j;
+    }
+    if (j == label.size()) {
+      return edge.child;
+    }
+  }
+}
+
+uint32_t DomainMatcher::Insert(uint32_t parent, std::string_view label,
+                               uint64_t hash) {
+  if ((edge_count_ + 1) * 2 > table_.size()) {
+    Grow();
+  }
+  Edge edge;
+  edge.hash = hash;
+  edge.parent = parent;
+  edge.child = static_cast<uint32_t>(terminal_.size());
+  edge.label_offset = static_cast<uint32_t>(labels_.size());
+  edge.label_size = static_cast<uint32_t>(label.size());
+  // Labels reach here normalized, so already lower case.
+  labels_.append(label);
+  terminal_.push_back(false);
+
+  const size_t mask = table_.size() - 1;
+  size_t i = hash & mask;
+  while (table_[i].child != 0) {
+    i = (i + 1) & mask;
+  }
+  table_[i] = edge;
+  ++edge_count_;
+  return edge.child;
+}
+
+void DomainMatcher::Grow() {
+  std::vector<Edge> old(table_.size() * 2);
+  old.swap(table_);
+  const size_t mask = table_.size() - 1;
+  for (const Edge& edge : old) {
+    if (edge.child == 0) {
+      continue;
+    }
+    size_t i = edge.hash & mask;
+    while (table_[i].child != 0) {
+      i = (i + 1) & mask;
+    }
+    table_[i] = edge;
+  }
+}
+
+}  // namespace routine
@@ -0,0 +1,78 @@
+#ifndef ROUTINE_CORE_DOMAIN_MATCHER_H_
+#define ROUTINE_CORE_DOMAIN_MATCHER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace routine {
+
+// Converts a domain as a user typed it into the ASCII form browsers put in
+// URL hostnames: lower case, no wildcard ("*.") or root dots, and every
+// non-ASCII label punycode-encoded ("bücher.de" -> "xn--bcher-kva.de").
+// Ideographic full stops separate labels like '.'. Letters are lowered for
+// Latin, Greek and Cyrillic; this is not a full UTS #46 mapping (there is
+// no NFC), which the app's site lists have not needed.
+//
+// Returns false, leaving |ascii| unspecified, if |domain| is not valid
+// UTF-8 or not a host name: empty labels, characters other than letters,
+// digits, '-' and '_', labels over 63 bytes or a name over 253.
+bool NormalizeDomain(std::string_view domain, std::string* ascii);
+
+// A set of domains that matches a host when the host is one of them or a
+// subdomain of one, on label boundaries: "example.com" matches
+// "www.example.com" but not "notexample.com".
+//
+// Domains are stored as a trie of labels read right to left ("com" ->
+// "example" -> "www"), its edges in one open-addressed hash table keyed by
+// parent node and label. A lookup hashes each label of the host once and
+// stops at the first listed domain or missing edge, so it costs O(labels in
+// the host) whatever the number of domains. ASCII hosts, which is what URL
+// parsers hand out, are matched without allocating.
+//
+// Not thread-safe while adding; lookups on a set no longer changing may run
+// concurrently.
+class DomainMatcher {
+ public:
+  DomainMatcher();
+
+  // Lists |domain| after NormalizeDomain(). Returns false if it is invalid.
+  bool Add(std::string_view domain);
+
+  bool Matches(std::string_view host) const;
+
+  void Clear();
+
+  // Domains listed and not already covered by a parent added before them.
+  size_t size() const { return size_; }
+
+ private:
+  struct Edge {
+    uint64_t hash = 0;
+    uint32_t parent = 0;
+    // Zero for empty slots; the root is node 0 and never a child.
+    uint32_t child = 0;
+    uint32_t label_offset = 0;
+    uint32_t label_size = 0;
+  };
+
+  // Returns the child of |parent| labelled |label| (compared ASCII
+  // case-insensitively), or 0.
+  uint32_t Find(uint32_t parent, std::string_view label, uint64_t hash) const;
+  uint32_t Insert(uint32_t parent, std::string_view label, uint64_t hash);
+  void Grow();
+  bool MatchesAscii(std::string_view host) const;
+
+  std::vector<Edge> table_;
+  size_t edge_count_ = 0;
+  // Indexed by node.
+  std::vector<bool> terminal_;
+  std::string labels_;
+  size_t size_ = 0;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_DOMAIN_MATCHER_H_
@@ -0,0 +1,275 @@
+#include "core/enforcement_stats.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+
+namespace routine {
+
+namespace {
+
+int CurrentProcessId() {
+#ifdef _WIN32
+  return _getpid();
+#else
+  return static_cast<int>(getpid());
+#endif
+}
+
+// Small, stable thread numbers for the trace's "tid".
+uint32_t TraceThreadId() {
+  static std::atomic<uint32_t> next_id{1};
+  thread_local const uint32_t id =
+      next_id.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+
+void AppendFormat(std::string* out, const char* format, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+void AppendFormat(std::string* out, const char* format, ...) {
+  char buffer[512];
+  va_list args;
+  va_start(args, format);
+  const int size = std::vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (size > 0) {
+    out->append(buffer,
+                std::min(static_cast<size_t>(size), sizeof(buffer) - 1));
+  }
+}
+
+void AppendHistogram(std::string* out, const char* name,
+                     const LatencyHistogram::Snapshot& snapshot) {
+  AppendFormat(out,
+               "\"%s\":{\"count\":%" PRIu64 ",\"meanNs\":%" PRIu64
+               ",\"p50Ns\":%" PRIu64 ",\"p90Ns\":%" PRIu64
+               ",\"p99Ns\":%" PRIu64 ",\"maxNs\":%" PRIu64 ",\"buckets\":[",
+               name, snapshot.count,
+               snapshot.count > 0 ? snapshot.sum_ns / snapshot.count : 0,
+               snapshot.QuantileNanos(0.5), snapshot.QuantileNanos(0.9),
+               snapshot.QuantileNanos(0.99), snapshot.max_ns);
+  bool first = true;
+  for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+    if (snapshot.buckets[i] == 0) {
+      continue;
+    }
+    const uint64_t upper = i == 0 ? 0 : (uint64_t{1} << i) - 1;
+    AppendFormat(out, "%s[%" PRIu64 ",%" PRIu64 "]", first ? "" : ",", upper,
+                 snapshot.buckets[i]);
+    first = false;
+  }
+  out->append("]}");
+}
+
+}  // namespace
+
+uint64_t LatencyHistogram::Snapshot::QuantileNanos(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  const double target = std::clamp(q, 0.0, 1.0) * static_cast<double>(count);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBuckets; ++i) {
+    seen += buckets[i];
+    if (buckets[i] > 0 && static_cast<double>(seen) >= target) {
+      const uint64_t upper = i == 0 ? 0 : (uint64_t{1} << i) - 1;
+      return std::min(upper, max_ns);
+    }
+  }
+  return max_ns;
+}
+
+LatencyHistogram::LatencyHistogram() {
+  for (auto& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t LatencyHistogram::BucketFor(uint64_t nanos) {
+  size_t width = 0;
+  while (nanos != 0 && width < kBuckets - 1) {
+    nanos >>= 1;
+    ++width;
+  }
+  return width;
+}
+
+void LatencyHistogram::Record(std::chrono::nanoseconds latency) {
+  const uint64_t nanos =
+      latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+  buckets_[BucketFor(nanos)].fetch_add(1, std::memory_order_relaxed);
+  sum_ns_.fetch_add(nanos, std::memory_order_relaxed);
+  uint64_t max = max_ns_.load(std::memory_order_relaxed);
+  while (nanos > max && !max_ns_.compare_exchange_weak(
+                            max, nanos, std::memory_order_relaxed)) {
+  }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::Load() const {
+  Snapshot snapshot;
+  for (size_t i = 0; i < kBuckets; ++i) {
+    snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  // Recorders may be mid-way; take the count from the buckets so the
+  // quantiles add up.
+  for (const uint64_t bucket : snapshot.buckets) {
+    snapshot.count += bucket;
+  }
+  snapshot.sum_ns = sum_ns_.load(std::memory_order_relaxed);
+  snapshot.max_ns = max_ns_.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+void RateMeter::Mark(Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++total_;
+  recent_.push_back(now);
+  while (now - recent_.front() >= std::chrono::minutes(1)) {
+    recent_.pop_front();
+  }
+}
+
+uint64_t RateMeter::total() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return total_;
+}
+
+uint64_t RateMeter::LastMinute(Clock::time_point now) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (!recent_.empty() &&
+         now - recent_.front() >= std::chrono::minutes(1)) {
+    recent_.pop_front();
+  }
+  return recent_.size();
+}
+
+TraceRecorder::TraceRecorder(size_t capacity)
+    : origin_(Clock::now()), capacity_(std::max<size_t>(capacity, 1)) {
+  spans_.reserve(capacity_);
+}
+
+void TraceRecorder::Complete(const char* name, Clock::time_point start,
+                             Clock::time_point end) {
+  if (!enabled()) {
+    return;
+  }
+  Span span;
+  span.name = name;
+  span.start_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin_)
+          .count();
+  span.duration_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+          .count();
+  span.thread = TraceThreadId();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (spans_.size() < capacity_) {
+    spans_.push_back(span);
+  } else {
+    spans_[next_] = span;
+    next_ = (next_ + 1) % spans_.size();
+  }
+}
+
+std::string TraceRecorder::ToJson() const {
+  const int pid = CurrentProcessId();
+  std::string json = "{\"traceEvents\":[";
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < spans_.size(); ++i) {
+    const Span& span = spans_[(next_ + i) % spans_.size()];
+    AppendFormat(&json,
+                 "%s{\"name\":\"%s\",\"cat\":\"enforcement\",\"ph\":\"X\","
+                 "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%" PRIu32 "}",
+                 i == 0 ? "" : ",", span.name, span.start_ns / 1000.0,
+                 span.duration_ns / 1000.0, pid, span.thread);
+  }
+  json.append("],\"displayTimeUnit\":\"ns\"}");
+  return json;
+}
+
+bool TraceRecorder::WriteTo(const std::string& path) const {
+  const std::string json = ToJson();
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  const bool written =
+      std::fwrite(json.data(), 1, json.size(), file) == json.size();
+  return std::fclose(file) == 0 && written;
+}
+
+size_t TraceRecorder::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return spans_.size();
+}
+
+ScopedLatency::~ScopedLatency() {
+  if (histogram_ == nullptr && trace_ == nullptr) {
+    return;
+  }
+  const auto end = std::chrono::steady_clock::now();
+  if (histogram_ != nullptr) {
+    histogram_->Record(end - start_);
+  }
+  if (trace_ != nullptr) {
+    trace_->Complete(name_, start_, end);
+  }
+}
+
+std::string EnforcementStatsJson(const EnforcementStats& stats,
+                                 const EnforcementExtras& extras,
+                                 std::chrono::steady_clock::time_point now) {
+  std::string json = "{";
+  AppendFormat(&json, "\"uptimeSeconds\":%.3f,",
+               std::chrono::duration<double>(now - stats.start).count());
+  AppendHistogram(&json, "focusToEnforcement",
+                  stats.focus_to_enforcement.Load());
+  json.push_back(',');
+  AppendHistogram(&json, "isBlocked", stats.is_blocked.Load());
+  json.push_back(',');
+  AppendHistogram(&json, "pollTick", stats.poll_tick.Load());
+
+  const uint64_t lookups = extras.cache.hits + extras.cache.misses;
+  AppendFormat(&json,
+               ",\"cache\":{\"hits\":%" PRIu64 ",\"misses\":%" PRIu64
+               ",\"evictions\":%" PRIu64 ",\"hitRate\":%.4f}",
+               extras.cache.hits, extras.cache.misses, extras.cache.evictions,
+               lookups > 0 ? static_cast<double>(extras.cache.hits) /
+                                 static_cast<double>(lookups)
+                           : 0.0);
+  AppendFormat(&json,
+               ",\"openProcessFailures\":%" PRIu64
+               ",\"imagePathFailures\":%" PRIu64,
+               stats.open_process_failures.Load(),
+               stats.image_path_failures.Load());
+  if (extras.log_bytes_written >= 0) {
+    AppendFormat(&json, ",\"logBytesWritten\":%" PRId64,
+                 extras.log_bytes_written);
+  }
+  if (extras.log_messages_dropped >= 0) {
+    AppendFormat(&json, ",\"logMessagesDropped\":%" PRId64,
+                 extras.log_messages_dropped);
+  }
+  AppendFormat(&json,
+               ",\"timerWakeups\":%" PRIu64
+               ",\"timerWakeupsLastMinute\":%" PRIu64
+               ",\"tracing\":%s,\"traceSpans\":%zu}",
+               stats.timer_wakeups.total(),
+               stats.timer_wakeups.LastMinute(now),
+               stats.trace.enabled() ? "true" : "false", stats.trace.size());
+  return json;
+}
+
+}  // namespace routine
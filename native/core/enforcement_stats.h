@@ -0,0 +1,187 @@
+#ifndef ROUTINE_CORE_ENFORCEMENT_STATS_H_
+#define ROUTINE_CORE_ENFORCEMENT_STATS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core/sharded_counter.h"
+#include "core/verdict_cache.h"
+
+namespace routine {
+
+// A latency distribution in power-of-two nanosecond buckets that any thread
+// records into without a lock. Quantiles come out as bucket upper bounds,
+// so within a factor of two, which is what a regression hunt needs.
+class LatencyHistogram {
+ public:
+  // Bucket 0 holds zero; bucket i holds [2^(i-1), 2^i) ns. The last one
+  // also takes everything longer, from about 18 minutes.
+  static constexpr size_t kBuckets = 42;
+
+  struct Snapshot {
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+    uint64_t max_ns = 0;
+    std::array<uint64_t, kBuckets> buckets{};
+
+    // The upper bound of the bucket holding quantile |q| in [0, 1], capped
+    // at the maximum; zero if nothing was recorded.
+    uint64_t QuantileNanos(double q) const;
+  };
+
+  LatencyHistogram();
+
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  void Record(std::chrono::nanoseconds latency);
+  Snapshot Load() const;
+
+  static size_t BucketFor(uint64_t nanos);
+
+ private:
+  std::array<std::atomic<uint64_t>, kBuckets> buckets_;
+  std::atomic<uint64_t> sum_ns_{0};
+  std::atomic<uint64_t> max_ns_{0};
+};
+
+// Counts events and how many fell in the last minute, for timer wakeups.
+class RateMeter {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  void Mark() { Mark(Clock::now()); }
+  void Mark(Clock::time_point now);
+
+  uint64_t total() const;
+  // Events in the minute up to |now|.
+  uint64_t LastMinute(Clock::time_point now) const;
+
+ private:
+  mutable std::mutex mutex_;
+  uint64_t total_ = 0;
+  // Event times within the last minute, oldest first.
+  mutable std::deque<Clock::time_point> recent_;
+};
+
+// Keeps the last spans recorded while enabled, for a dump in the Chrome
+// trace-event format that chrome://tracing and Perfetto open. Disabled, a
+// span costs one relaxed load.
+class TraceRecorder {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t kDefaultCapacity = 4096;
+
+  explicit TraceRecorder(size_t capacity = kDefaultCapacity);
+
+  TraceRecorder(const TraceRecorder&) = delete;
+  TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+  void set_enabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Records a complete ("X") event on the calling thread. |name| must
+  // outlive the recorder; pass string literals.
+  void Complete(const char* name, Clock::time_point start,
+                Clock::time_point end);
+
+  // {"traceEvents": [...]}, oldest span first, times in microseconds since
+  // the recorder was created.
+  std::string ToJson() const;
+  // Writes ToJson() to |path|. Returns false on I/O errors.
+  bool WriteTo(const std::string& path) const;
+
+  size_t size() const;
+
+ private:
+  struct Span {
+    const char* name = nullptr;
+    int64_t start_ns = 0;
+    int64_t duration_ns = 0;
+    uint32_t thread = 0;
+  };
+
+  const Clock::time_point origin_;
+  const size_t capacity_;
+  std::atomic<bool> enabled_{false};
+  mutable std::mutex mutex_;
+  std::vector<Span> spans_;
+  // Next slot to overwrite once spans_ is full.
+  size_t next_ = 0;
+};
+
+// What the runners measure on the enforcement path. Every member is safe
+// to record into from any thread.
+struct EnforcementStats {
+  // A focus change arriving to the runner having acted on it, minimised or
+  // let be.
+  LatencyHistogram focus_to_enforcement;
+  // One policy lookup made while enforcing, cache hit or not.
+  LatencyHistogram is_blocked;
+  // One fallback poll of the focused window.
+  LatencyHistogram poll_tick;
+  // Processes that could not be opened (OpenProcess, /proc/<pid> gone).
+  ShardedCounter open_process_failures;
+  // Processes whose executable path could not be read
+  // (QueryFullProcessImageNameW, /proc/<pid>/exe).
+  ShardedCounter image_path_failures;
+  // Wakeups of the runner's periodic timers.
+  RateMeter timer_wakeups;
+  TraceRecorder trace;
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+};
+
+// Times a scope into |histogram| and, while tracing, into |trace| as
+// |name|. Either may be null.
+class ScopedLatency {
+ public:
+  ScopedLatency(LatencyHistogram* histogram, TraceRecorder* trace,
+                const char* name)
+      : histogram_(histogram),
+        trace_(trace != nullptr && trace->enabled() ? trace : nullptr),
+        name_(name),
+        start_(histogram != nullptr || trace_ != nullptr
+                   ? std::chrono::steady_clock::now()
+                   : std::chrono::steady_clock::time_point()) {}
+  ~ScopedLatency();
+
+  ScopedLatency(const ScopedLatency&) = delete;
+  ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+ private:
+  LatencyHistogram* histogram_;
+  TraceRecorder* trace_;
+  const char* name_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Extra figures a runner adds to the report; negative means not available
+// on this platform.
+struct EnforcementExtras {
+  VerdictCache::Stats cache;
+  int64_t log_bytes_written = -1;
+  int64_t log_messages_dropped = -1;
+};
+
+// The getEnforcementStats answer: a JSON object of counters, each
+// histogram's count, mean, p50/p90/p99 and max in nanoseconds with its
+// non-empty buckets as [upper bound ns, count] pairs, the verdict cache hit
+// rate and timer wakeups over the last minute.
+std::string EnforcementStatsJson(const EnforcementStats& stats,
+                                 const EnforcementExtras& extras,
+                                 std::chrono::steady_clock::time_point now);
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_ENFORCEMENT_STATS_H_
@@ -0,0 +1,104 @@
+#include "core/foreground_tracker.h"
+
+#include <utility>
+
+#include "core/enforcement_stats.h"
+
+namespace routine {
+
+ForegroundTracker::ForegroundTracker(std::unique_ptr<ForegroundSource> source,
+                                     Handler handler,
+                                     Clock::duration poll_interval,
+                                     EnforcementStats* enforcement_stats)
+    : source_(std::move(source)),
+      handler_(std::move(handler)),
+      poll_interval_(poll_interval),
+      enforcement_stats_(enforcement_stats) {}
+
+ForegroundTracker::~ForegroundTracker() {
+  Stop();
+}
+
+bool ForegroundTracker::Start() {
+  event_driven_ = source_->Start(
+      [this](const ForegroundWindow& window) { OnEvent(window); });
+
+  if (auto current = source_->Current()) {
+    Deliver(*current, false);
+  }
+  return event_driven_;
+}
+
+void ForegroundTracker::Stop() {
+  if (event_driven_) {
+    source_->Stop();
+    event_driven_ = false;
+  }
+}
+
+void ForegroundTracker::Poll(Clock::time_point now) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (event_driven_ && now - last_event_ < poll_interval_) {
+      ++stats_.skipped_polls;
+      return;
+    }
+    ++stats_.polls;
+  }
+
+  ScopedLatency latency(
+      enforcement_stats_ ? &enforcement_stats_->poll_tick : nullptr,
+      enforcement_stats_ ? &enforcement_stats_->trace : nullptr, "poll");
+  if (auto current = source_->Current()) {
+    Deliver(*current, false);
+  }
+}
+
+void ForegroundTracker::Refresh() {
+  if (auto current = source_->Current()) {
+    Deliver(*current, true);
+  }
+}
+
+ForegroundTracker::Stats ForegroundTracker::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void ForegroundTracker::OnEvent(const ForegroundWindow& window) {
+  const Clock::time_point arrived = Clock::now();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    last_event_ = arrived;
+    ++stats_.events;
+  }
+  if (Deliver(window, false) && enforcement_stats_ != nullptr) {
+    const Clock::time_point enforced = Clock::now();
+    enforcement_stats_->focus_to_enforcement.Record(enforced - arrived);
+    enforcement_stats_->trace.Complete("enforce", arrived, enforced);
+  }
+}
+
+bool ForegroundTracker::Deliver(const ForegroundWindow& window, bool force) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!force && last_ && *last_ == window) {
+      return false;
+    }
+    last_ = window;
+    ++stats_.deliveries;
+  }
+
+  // The handler may minimise windows and so cause further focus events;
+  // never hold the lock across it.
+  if (window.window == 0) {
+    if (unfocus_handler_) {
+      unfocus_handler_();
+    }
+    return false;
+  }
+  handler_(window);
+  return true;
+}
+
+}  // namespace routine
@@ -0,0 +1,119 @@
+#ifndef ROUTINE_CORE_FOREGROUND_TRACKER_H_
+#define ROUTINE_CORE_FOREGROUND_TRACKER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace routine {
+
+struct EnforcementStats;
+
+struct ForegroundWindow {
+  // Native window handle (HWND, X11 window id); zero when nothing has focus.
+  uint64_t window = 0;
+  // Owning process id; zero when unknown.
+  int64_t pid = 0;
+
+  bool operator==(const ForegroundWindow& other) const {
+    return window == other.window && pid == other.pid;
+  }
+  bool operator!=(const ForegroundWindow& other) const {
+    return !(*this == other);
+  }
+};
+
+// A platform backend that reports which window has input focus.
+class ForegroundSource {
+ public:
+  using Callback = std::function<void(const ForegroundWindow&)>;
+
+  virtual ~ForegroundSource() = default;
+
+  // Starts pushing focus changes to |callback|, on whichever thread the
+  // backend uses. Returns false when event delivery is unavailable, in which
+  // case only Current() is used.
+  virtual bool Start(Callback callback) = 0;
+  virtual void Stop() = 0;
+
+  // Queries the focused window synchronously.
+  virtual std::optional<ForegroundWindow> Current() = 0;
+};
+
+// Turns a ForegroundSource into enforcement calls.
+//
+// The handler runs only when focus actually moves to a different window.
+// Poll() is a fallback for missed or unavailable events: it is meant to be
+// driven by a slow platform timer and does nothing while events are flowing.
+class ForegroundTracker {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Handler = std::function<void(const ForegroundWindow&)>;
+
+  struct Stats {
+    uint64_t events = 0;
+    uint64_t polls = 0;
+    uint64_t skipped_polls = 0;
+    uint64_t deliveries = 0;
+  };
+
+  // When |enforcement_stats| is given, it must outlive the tracker and
+  // receives the time from each focus event to the handler returning, and
+  // the duration of each poll that is not skipped.
+  ForegroundTracker(std::unique_ptr<ForegroundSource> source, Handler handler,
+                    Clock::duration poll_interval,
+                    EnforcementStats* enforcement_stats = nullptr);
+  ~ForegroundTracker();
+
+  ForegroundTracker(const ForegroundTracker&) = delete;
+  ForegroundTracker& operator=(const ForegroundTracker&) = delete;
+
+  // Runs instead of the handler when focus moves to no window at all (the
+  // desktop, a locked screen), which the handler never sees. Set before
+  // Start().
+  void set_unfocus_handler(std::function<void()> handler) {
+    unfocus_handler_ = std::move(handler);
+  }
+
+  // Starts event delivery and handles the current window. Returns whether
+  // the source is event driven; polling works either way.
+  bool Start();
+  void Stop();
+
+  // Fallback poll. Skipped when an event arrived within the poll interval.
+  void Poll() { Poll(Clock::now()); }
+  void Poll(Clock::time_point now);
+
+  // Handles the current window even if it has not changed, e.g. after the
+  // block policy changed underneath it.
+  void Refresh();
+
+  bool event_driven() const { return event_driven_; }
+  Stats stats() const;
+
+ private:
+  void OnEvent(const ForegroundWindow& window);
+  // Returns whether the handler ran.
+  bool Deliver(const ForegroundWindow& window, bool force);
+
+  std::unique_ptr<ForegroundSource> source_;
+  Handler handler_;
+  std::function<void()> unfocus_handler_;
+  Clock::duration poll_interval_;
+  EnforcementStats* const enforcement_stats_;
+  std::atomic<bool> event_driven_{false};
+
+  mutable std::mutex mutex_;
+  std::optional<ForegroundWindow> last_;
+  Clock::time_point last_event_;
+  Stats stats_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_FOREGROUND_TRACKER_H_
@@ -0,0 +1,174 @@
+#include "core/log_format.h"
+
+#include <cstring>
+#include <utility>
+
+#include "core/lz.h"
+
+namespace routine {
+
+namespace {
+
+constexpr char kLogMagic[] = "RTLG";
+constexpr char kCompressedMagic[] = "RTLZ";
+constexpr uint32_t kLogVersion = 1;
+constexpr size_t kCompressedHeaderSize = 16;
+constexpr uint8_t kTimeBaseTag = 0xFF;
+
+void PutFixed(uint64_t value, size_t size, std::string* output) {
+  for (size_t i = 0; i < size; ++i) {
+    output->push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+uint64_t GetFixed(const char* data, size_t size) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    value |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+  }
+  return value;
+}
+
+void PutVarint(uint64_t value, std::string* output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+bool GetVarint(std::string_view data, size_t* pos, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (*pos >= data.size()) {
+      return false;
+    }
+    const uint8_t byte = static_cast<uint8_t>(data[(*pos)++]);
+    *value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t ZigZag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+bool HasHeader(std::string_view data, const char* magic) {
+  return data.size() >= kLogHeaderSize &&
+         std::memcmp(data.data(), magic, 4) == 0 &&
+         GetFixed(data.data() + 4, 4) == kLogVersion;
+}
+
+}  // namespace
+
+char LogLevelLetter(LogLevel level) {
+  switch (level) {
+    case LogLevel::kDebug:
+      return 'D';
+    case LogLevel::kInfo:
+      return 'I';
+    case LogLevel::kWarning:
+      return 'W';
+    case LogLevel::kError:
+      return 'E';
+  }
+  return '?';
+}
+
+void AppendLogHeader(std::string* output) {
+  output->append(kLogMagic, 4);
+  PutFixed(kLogVersion, 4, output);
+}
+
+void AppendLogTimeBase(int64_t time_us, std::string* output) {
+  output->push_back(static_cast<char>(kTimeBaseTag));
+  PutVarint(ZigZag(time_us), output);
+}
+
+void AppendLogRecord(int64_t previous_us, int64_t time_us, uint32_t thread,
+                     LogLevel level, std::string_view message,
+                     std::string* output) {
+  output->push_back(static_cast<char>(level));
+  PutVarint(ZigZag(time_us - previous_us), output);
+  PutVarint(thread, output);
+  PutVarint(message.size(), output);
+  output->append(message);
+}
+
+std::string CompressLog(std::string_view log) {
+  std::string output(kCompressedMagic, 4);
+  PutFixed(kLogVersion, 4, &output);
+  PutFixed(log.size(), 8, &output);
+  output += LzCompress(log);
+  return output;
+}
+
+bool DecodeLog(std::string_view data, std::vector<LogRecord>* records,
+               size_t* valid_size) {
+  if (valid_size != nullptr) {
+    *valid_size = 0;
+  }
+  if (HasHeader(data, kCompressedMagic) &&
+      data.size() >= kCompressedHeaderSize) {
+    const uint64_t size = GetFixed(data.data() + 8, 8);
+    std::string log;
+    log.reserve(static_cast<size_t>(size));
+    if (!LzDecompress(data.substr(kCompressedHeaderSize), &log)) {
+      DecodeLog(log, records);
+      return false;
+    }
+    return DecodeLog(log, records) && log.size() == size;
+  }
+  if (!HasHeader(data, kLogMagic)) {
+    return false;
+  }
+
+  size_t pos = kLogHeaderSize;
+  int64_t time_us = 0;
+  while (pos < data.size()) {
+    if (valid_size != nullptr) {
+      *valid_size = pos;
+    }
+    const uint8_t tag = static_cast<uint8_t>(data[pos++]);
+    uint64_t value = 0;
+    if (tag == kTimeBaseTag) {
+      if (!GetVarint(data, &pos, &value)) {
+        return false;
+      }
+      time_us = UnZigZag(value);
+      continue;
+    }
+    if (tag > static_cast<uint8_t>(LogLevel::kError)) {
+      return false;
+    }
+
+    LogRecord record;
+    record.level = static_cast<LogLevel>(tag);
+    uint64_t thread = 0;
+    uint64_t size = 0;
+    if (!GetVarint(data, &pos, &value) || !GetVarint(data, &pos, &thread) ||
+        !GetVarint(data, &pos, &size) || size > data.size() - pos) {
+      return false;
+    }
+    time_us += UnZigZag(value);
+    record.time_us = time_us;
+    record.thread = static_cast<uint32_t>(thread);
+    record.message.assign(data.data() + pos, static_cast<size_t>(size));
+    pos += static_cast<size_t>(size);
+    records->push_back(std::move(record));
+  }
+  if (valid_size != nullptr) {
+    *valid_size = pos;
+  }
+  return true;
+}
+
+}  // namespace routine
@@ -0,0 +1,62 @@
+#ifndef ROUTINE_CORE_LOG_FORMAT_H_
+#define ROUTINE_CORE_LOG_FORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace routine {
+
+// The on-disk format of Logger's files, shared with the offline decoder.
+//
+// A log file starts with "RTLG" and a u32 version, followed by records:
+//   u8 tag       0xFF: a new time base, followed by varint microseconds
+//                since the Unix epoch. Written once per writer session.
+//                Otherwise the record's level.
+//   varint       zigzag microseconds since the previous record or base
+//   varint       thread number
+//   varint       message size, then the UTF-8 message
+// Integers are little-endian and varints LEB128. A rotated file is the same
+// bytes compressed by LzCompress behind "RTLZ", a u32 version and the u64
+// uncompressed size.
+
+enum class LogLevel : uint8_t { kDebug, kInfo, kWarning, kError };
+
+struct LogRecord {
+  int64_t time_us = 0;
+  uint32_t thread = 0;
+  LogLevel level = LogLevel::kInfo;
+  std::string message;
+};
+
+constexpr size_t kLogHeaderSize = 8;
+
+// One letter per level, as the decoder prints it.
+char LogLevelLetter(LogLevel level);
+
+// Appends the header of a new log file.
+void AppendLogHeader(std::string* output);
+
+// Appends a time base record; later deltas are relative to |time_us|.
+void AppendLogTimeBase(int64_t time_us, std::string* output);
+
+// Appends a record |previous_us| after the previous one.
+void AppendLogRecord(int64_t previous_us, int64_t time_us, uint32_t thread,
+                     LogLevel level, std::string_view message,
+                     std::string* output);
+
+// Wraps a whole log file for rotation.
+std::string CompressLog(std::string_view log);
+
+// Decodes a log file, plain or compressed, appending its records. Returns
+// false if it is not a log or is truncated or corrupt; the records before
+// the damage are still appended. |valid_size|, if given, receives the size
+// of the undamaged prefix of a plain log.
+bool DecodeLog(std::string_view data, std::vector<LogRecord>* records,
+               size_t* valid_size = nullptr);
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_LOG_FORMAT_H_
@@ -0,0 +1,268 @@
+#include "core/logger.h"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "core/mapped_file.h"
+
+namespace routine {
+
+namespace {
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 2;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// Small, stable numbers are cheaper to store than native thread ids.
+uint32_t ThreadNumber() {
+  static std::atomic<uint32_t> next_number{1};
+  thread_local const uint32_t number =
+      next_number.fetch_add(1, std::memory_order_relaxed);
+  return number;
+}
+
+}  // namespace
+
+Logger::Logger(Options options)
+    : options_(std::move(options)),
+      mask_(RoundUpToPowerOfTwo(options_.capacity) - 1),
+      slots_(new Slot[mask_ + 1]) {
+  for (size_t i = 0; i <= mask_; ++i) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  OpenLog();
+  thread_ = std::thread(&Logger::Run, this);
+}
+
+Logger::~Logger() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+  if (file_ != nullptr) {
+    std::fclose(file_);
+  }
+}
+
+bool Logger::Log(Level level, std::string_view message) {
+  if (!IsEnabled(level)) {
+    return false;
+  }
+
+  // A bounded MPMC queue in the style of Dmitry Vyukov's: each slot's
+  // sequence says whose turn it is, so producers only contend on the
+  // enqueue position and never wait for each other.
+  uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  Slot* slot;
+  for (;;) {
+    slot = &slots_[pos & mask_];
+    const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    const int64_t turn = static_cast<int64_t>(sequence - pos);
+    if (turn == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (turn < 0) {
+      // Full: the flusher has not freed this slot since the last lap.
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  const size_t size =
+      message.size() < kMaxMessageSize ? message.size() : kMaxMessageSize;
+  slot->time_us = NowMicros();
+  slot->thread = ThreadNumber();
+  slot->level = level;
+  slot->size = static_cast<uint8_t>(size);
+  std::memcpy(slot->text, message.data(), size);
+  slot->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+void Logger::Flush() {
+  const uint64_t target = enqueue_pos_.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (flushed_pos_ < target && !stopping_) {
+    flush_requested_ = true;
+    wake_.notify_one();
+    // A producer may still be filling a slot it claimed; check again soon.
+    flushed_.wait_for(lock, std::chrono::milliseconds(10));
+  }
+}
+
+Logger::Stats Logger::stats() const {
+  Stats stats;
+  stats.written = written_.load(std::memory_order_relaxed);
+  stats.dropped = dropped_.load(std::memory_order_relaxed);
+  stats.rotations = rotations_.load(std::memory_order_relaxed);
+  stats.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void Logger::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    wake_.wait_for(lock, options_.flush_interval,
+                   [this] { return stopping_ || flush_requested_; });
+    flush_requested_ = false;
+    const bool stopping = stopping_;
+
+    lock.unlock();
+    Drain();
+    lock.lock();
+
+    flushed_pos_ = dequeue_pos_;
+    flushed_.notify_all();
+    if (stopping) {
+      return;
+    }
+  }
+}
+
+void Logger::Drain() {
+  for (;;) {
+    Slot& slot = slots_[dequeue_pos_ & mask_];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+      break;
+    }
+
+    if (!time_base_written_) {
+      AppendLogTimeBase(slot.time_us, &buffer_);
+      last_time_us_ = slot.time_us;
+      time_base_written_ = true;
+    }
+    AppendLogRecord(last_time_us_, slot.time_us, slot.thread, slot.level,
+                    std::string_view(slot.text, slot.size), &buffer_);
+    last_time_us_ = slot.time_us;
+    // Hand the slot back to producers for the next lap.
+    slot.sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+    ++dequeue_pos_;
+    written_.fetch_add(1, std::memory_order_relaxed);
+
+    if (file_ != nullptr &&
+        file_size_ + buffer_.size() >= options_.max_file_size) {
+      Write();
+      Rotate();
+    }
+  }
+  Write();
+}
+
+void Logger::Write() {
+  if (buffer_.empty()) {
+    return;
+  }
+  if (file_ != nullptr) {
+    if (std::fwrite(buffer_.data(), 1, buffer_.size(), file_) ==
+        buffer_.size()) {
+      std::fflush(file_);
+      bytes_written_.fetch_add(buffer_.size(), std::memory_order_relaxed);
+    }
+    file_size_ += buffer_.size();
+  }
+  buffer_.clear();
+}
+
+bool Logger::OpenLog() {
+  file_size_ = 0;
+  time_base_written_ = false;
+  if (options_.path.empty()) {
+    return false;
+  }
+
+  // Append to a previous session's log only if it is intact; a torn tail
+  // would hide everything written after it.
+  MappedFile existing;
+  if (existing.Open(options_.path) && existing.size() > 0) {
+    std::vector<LogRecord> records;
+    size_t valid_size = 0;
+    if (DecodeLog(std::string_view(
+                      reinterpret_cast<const char*>(existing.data()),
+                      existing.size()),
+                  &records, &valid_size)) {
+      existing.Close();
+      file_ = OpenFile(options_.path, "ab");
+      file_size_ = valid_size;
+      return file_ != nullptr;
+    }
+    existing.Close();
+    if (valid_size > 0) {
+      // Keep what is readable as if it had been rotated.
+      Rotate();
+      return file_ != nullptr;
+    }
+  }
+
+  file_ = OpenFile(options_.path, "wb");
+  if (file_ == nullptr) {
+    return false;
+  }
+  AppendLogHeader(&buffer_);
+  Write();
+  return true;
+}
+
+void Logger::Rotate() {
+  if (file_ != nullptr) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+
+  if (options_.max_rotated_files > 0) {
+    RemoveFile(RotatedPath(options_.max_rotated_files));
+    for (int i = options_.max_rotated_files - 1; i > 0; --i) {
+      ReplaceFile(RotatedPath(i), RotatedPath(i + 1));
+    }
+
+    MappedFile current;
+    if (current.Open(options_.path)) {
+      const std::string compressed = CompressLog(std::string_view(
+          reinterpret_cast<const char*>(current.data()), current.size()));
+      current.Close();
+      // Written aside and renamed, so a crash never leaves half a file.
+      const std::string temporary = RotatedPath(1) + ".tmp";
+      if (std::FILE* file = OpenFile(temporary, "wb")) {
+        const bool written =
+            std::fwrite(compressed.data(), 1, compressed.size(), file) ==
+            compressed.size();
+        if (std::fclose(file) == 0 && written) {
+          ReplaceFile(temporary, RotatedPath(1));
+        } else {
+          RemoveFile(temporary);
+        }
+      }
+    }
+  }
+  rotations_.fetch_add(1, std::memory_order_relaxed);
+
+  file_ = OpenFile(options_.path, "wb");
+  file_size_ = 0;
+  time_base_written_ = false;
+  if (file_ != nullptr) {
+    AppendLogHeader(&buffer_);
+    Write();
+  }
+}
+
+std::string Logger::RotatedPath(int index) const {
+  return options_.path + "." + std::to_string(index) + ".lz";
+}
+
+}  // namespace routine
@@ -0,0 +1,133 @@
+#ifndef ROUTINE_CORE_LOGGER_H_
+#define ROUTINE_CORE_LOGGER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "core/log_format.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+// Padding the queue positions to their own cache lines is the point.
+#pragma warning(disable : 4324)
+#endif
+
+namespace routine {
+
+// An asynchronous log sink. Log() copies the message into a bounded
+// lock-free multi-producer queue and returns; a background thread drains it
+// in batches into the binary format of log_format.h, rotates the file once
+// it outgrows |max_file_size| and compresses the rotated copies.
+//
+// Log() never blocks and never touches the disk: when the queue is full the
+// message is dropped and counted, so enforcement cannot stall on logging.
+class Logger {
+ public:
+  using Level = LogLevel;
+
+  struct Options {
+    // UTF-8 path of the current log. Rotated logs are kept next to it as
+    // "<path>.1.lz" (newest) to "<path>.<max_rotated_files>.lz".
+    std::string path;
+    Level level = Level::kInfo;
+    // Messages that can wait for the flusher; rounded up to a power of two.
+    size_t capacity = 1024;
+    uint64_t max_file_size = 1 << 20;
+    int max_rotated_files = 3;
+    std::chrono::milliseconds flush_interval{500};
+  };
+
+  struct Stats {
+    uint64_t written = 0;
+    uint64_t dropped = 0;
+    uint64_t rotations = 0;
+    // Bytes of encoded records that reached the file.
+    uint64_t bytes_written = 0;
+  };
+
+  // Longer messages are truncated.
+  static constexpr size_t kMaxMessageSize = 230;
+
+  explicit Logger(Options options);
+  // Writes out everything logged so far.
+  ~Logger();
+
+  Logger(const Logger&) = delete;
+  Logger& operator=(const Logger&) = delete;
+
+  // Lets callers skip formatting messages that would be filtered out.
+  bool IsEnabled(Level level) const { return level >= options_.level; }
+
+  // Safe from any thread. Returns false if the message was filtered out or
+  // dropped.
+  bool Log(Level level, std::string_view message);
+
+  // Blocks until everything logged before the call is on disk.
+  void Flush();
+
+  Stats stats() const;
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    int64_t time_us = 0;
+    uint32_t thread = 0;
+    Level level = Level::kInfo;
+    uint8_t size = 0;
+    char text[kMaxMessageSize];
+  };
+
+  void Run();
+  // Moves published messages from the queue to |buffer_| and the file.
+  void Drain();
+  void Write();
+  bool OpenLog();
+  void Rotate();
+  std::string RotatedPath(int index) const;
+
+  const Options options_;
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+
+  alignas(64) std::atomic<uint64_t> enqueue_pos_{0};
+  alignas(64) std::atomic<uint64_t> dropped_{0};
+
+  // Flusher thread only.
+  uint64_t dequeue_pos_ = 0;
+  std::FILE* file_ = nullptr;
+  uint64_t file_size_ = 0;
+  int64_t last_time_us_ = 0;
+  bool time_base_written_ = false;
+  std::string buffer_;
+
+  std::atomic<uint64_t> written_{0};
+  std::atomic<uint64_t> rotations_{0};
+  std::atomic<uint64_t> bytes_written_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable flushed_;
+  // Everything before this queue position has been written.
+  uint64_t flushed_pos_ = 0;
+  bool flush_requested_ = false;
+  bool stopping_ = false;
+
+  std::thread thread_;
+};
+
+}  // namespace routine
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif  // ROUTINE_CORE_LOGGER_H_
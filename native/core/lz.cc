@@ -0,0 +1,148 @@
+#include "core/lz.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace routine {
+
+namespace {
+
+constexpr size_t kMinMatch = 4;
+constexpr size_t kMaxOffset = 0xFFFF;
+constexpr int kHashBits = 13;
+constexpr uint32_t kNoPosition = UINT32_MAX;
+
+uint32_t Load32(const char* data) {
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+uint32_t Hash(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+// The part of |length| that does not fit in a token nibble.
+void PutLength(size_t length, std::string* output) {
+  for (; length >= 255; length -= 255) {
+    output->push_back(static_cast<char>(255));
+  }
+  output->push_back(static_cast<char>(length));
+}
+
+void PutSequence(std::string_view literals, size_t offset, size_t match,
+                 std::string* output) {
+  const size_t match_code = match == 0 ? 0 : match - kMinMatch;
+  const uint8_t token = static_cast<uint8_t>(
+      (literals.size() < 15 ? literals.size() : 15) << 4 |
+      (match_code < 15 ? match_code : 15));
+  output->push_back(static_cast<char>(token));
+  if (literals.size() >= 15) {
+    PutLength(literals.size() - 15, output);
+  }
+  output->append(literals);
+  if (match == 0) {
+    return;
+  }
+  output->push_back(static_cast<char>(offset & 0xFF));
+  output->push_back(static_cast<char>(offset >> 8));
+  if (match_code >= 15) {
+    PutLength(match_code - 15, output);
+  }
+}
+
+bool GetLength(std::string_view input, size_t* pos, size_t* length) {
+  for (;;) {
+    if (*pos >= input.size()) {
+      return false;
+    }
+    const uint8_t byte = static_cast<uint8_t>(input[(*pos)++]);
+    *length += byte;
+    if (byte != 255) {
+      return true;
+    }
+  }
+}
+
+}  // namespace
+
+std::string LzCompress(std::string_view input) {
+  std::string output;
+  output.reserve(input.size() / 2 + 16);
+  std::vector<uint32_t> table(size_t{1} << kHashBits, kNoPosition);
+
+  const char* data = input.data();
+  size_t anchor = 0;
+  size_t pos = 0;
+  while (pos + kMinMatch <= input.size()) {
+    const uint32_t sequence = Load32(data + pos);
+    uint32_t& slot = table[Hash(sequence)];
+    const uint32_t candidate = slot;
+    slot = static_cast<uint32_t>(pos);
+    if (candidate == kNoPosition || pos - candidate > kMaxOffset ||
+        Load32(data + candidate) != sequence) {
+      ++pos;
+      continue;
+    }
+
+    size_t match = kMinMatch;
+    while (pos + match < input.size() &&
+           data[candidate + match] == data[pos + match]) {
+      ++match;
+    }
+    PutSequence(input.substr(anchor, pos - anchor), pos - candidate, match,
+                &output);
+    pos += match;
+    anchor = pos;
+  }
+  if (anchor < input.size()) {
+    PutSequence(input.substr(anchor), 0, 0, &output);
+  }
+  return output;
+}
+
+bool LzDecompress(std::string_view input, std::string* output) {
+  size_t pos = 0;
+  while (pos < input.size()) {
+    const uint8_t token = static_cast<uint8_t>(input[pos++]);
+
+    size_t literals = token >> 4;
+    if (literals == 15 && !GetLength(input, &pos, &literals)) {
+      return false;
+    }
+    if (literals > input.size() - pos) {
+      return false;
+    }
+    output->append(input.data() + pos, literals);
+    pos += literals;
+    if (pos == input.size()) {
+      break;
+    }
+
+    if (input.size() - pos < 2) {
+      return false;
+    }
+    const size_t offset = static_cast<uint8_t>(input[pos]) |
+                          static_cast<size_t>(static_cast<uint8_t>(
+                              input[pos + 1]))
+                              << 8;
+    pos += 2;
+    size_t match = token & 0x0F;
+    if (match == 15 && !GetLength(input, &pos, &match)) {
+      return false;
+    }
+    match += kMinMatch;
+    if (offset == 0 || offset > output->size()) {
+      return false;
+    }
+    // Byte by byte: the match may overlap what it is copying.
+    size_t from = output->size() - offset;
+    for (size_t i = 0; i < match; ++i) {
+      output->push_back((*output)[from + i]);
+    }
+  }
+  return true;
+}
+
+}  // namespace routine
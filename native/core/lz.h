@@ -0,0 +1,24 @@
+#ifndef ROUTINE_CORE_LZ_H_
+#define ROUTINE_CORE_LZ_H_
+
+#include <string>
+#include <string_view>
+
+namespace routine {
+
+// A small LZ77 codec in the spirit of LZ4's block format, used to compress
+// rotated logs without pulling a compression library into both runners.
+//
+// The stream is a series of sequences: a token byte (literal count in the
+// high nibble, match length minus four in the low one, 15 meaning more
+// length bytes follow), the literals, then a little-endian 16-bit offset
+// back into the output and the match. The last sequence has no match.
+std::string LzCompress(std::string_view input);
+
+// Appends the decompressed |input| to |output|. Returns false if |input| is
+// malformed; |output| then holds whatever was decoded before the error.
+bool LzDecompress(std::string_view input, std::string* output);
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_LZ_H_
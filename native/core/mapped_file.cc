@@ -0,0 +1,151 @@
+#include "core/mapped_file.h"
+
+#ifdef _WIN32
+#include <share.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+
+namespace routine {
+
+#ifdef _WIN32
+namespace {
+
+std::wstring Widen(const std::string& utf8) {
+  const int size = MultiByteToWideChar(CP_UTF8, 0, utf8.data(),
+                                       static_cast<int>(utf8.size()), nullptr,
+                                       0);
+  std::wstring wide(size, L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, utf8.data(), static_cast<int>(utf8.size()),
+                      wide.data(), size);
+  return wide;
+}
+
+}  // namespace
+#endif
+
+MappedFile::~MappedFile() { Close(); }
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path) {
+  Close();
+  HANDLE file = CreateFileW(Widen(path).c_str(), GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE |
+                                FILE_SHARE_DELETE,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return false;
+  }
+  if (size.QuadPart == 0) {
+    CloseHandle(file);
+    return true;
+  }
+
+  mapping_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping_ == nullptr) {
+    return false;
+  }
+  data_ = static_cast<const uint8_t*>(
+      MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  if (data_ == nullptr) {
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+    return false;
+  }
+  size_ = static_cast<size_t>(size.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(mapping_);
+  }
+  data_ = nullptr;
+  mapping_ = nullptr;
+  size_ = 0;
+}
+
+std::FILE* OpenFile(const std::string& path, const char* mode) {
+  // Shared, so the file can stay mapped while it is appended to.
+  return _wfsopen(Widen(path).c_str(), Widen(mode).c_str(), _SH_DENYNO);
+}
+
+bool ReplaceFile(const std::string& from, const std::string& to) {
+  return MoveFileExW(Widen(from).c_str(), Widen(to).c_str(),
+                     MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+bool RemoveFile(const std::string& path) {
+  return DeleteFileW(Widen(path).c_str()) != 0;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+  Close();
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    close(fd);
+    return false;
+  }
+  if (status.st_size == 0) {
+    close(fd);
+    return true;
+  }
+
+  void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  data_ = static_cast<const uint8_t*>(data);
+  size_ = static_cast<size_t>(status.st_size);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+std::FILE* OpenFile(const std::string& path, const char* mode) {
+  return std::fopen(path.c_str(), mode);
+}
+
+bool ReplaceFile(const std::string& from, const std::string& to) {
+  return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+bool RemoveFile(const std::string& path) {
+  return std::remove(path.c_str()) == 0;
+}
+
+#endif
+
+}  // namespace routine
@@ -0,0 +1,47 @@
+#ifndef ROUTINE_CORE_MAPPED_FILE_H_
+#define ROUTINE_CORE_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace routine {
+
+// A read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Maps the UTF-8 |path|. Returns false if it cannot be opened. An empty
+  // file maps successfully with size() zero.
+  bool Open(const std::string& path);
+  void Close();
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void* mapping_ = nullptr;
+#endif
+};
+
+// fopen() for UTF-8 paths on every platform.
+std::FILE* OpenFile(const std::string& path, const char* mode);
+
+// rename() that replaces |to| if it exists, on every platform.
+bool ReplaceFile(const std::string& from, const std::string& to);
+
+// remove() for UTF-8 paths on every platform.
+bool RemoveFile(const std::string& path);
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_MAPPED_FILE_H_
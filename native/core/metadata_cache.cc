@@ -0,0 +1,285 @@
+#include "core/metadata_cache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#include "core/path.h"
+
+namespace routine {
+
+namespace {
+
+// File layout, in native byte order (the cache never leaves the machine):
+//
+//   header:  "RTMC" u32 version
+//   record:  u32 body_size  u32 checksum  body
+//   body:    u64 size  i64 mtime  u16 lengths[5]
+//            path display_name product_name icon version
+constexpr char kMagic[4] = {'R', 'T', 'M', 'C'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kFileHeaderSize = 8;
+constexpr size_t kRecordHeaderSize = 8;
+constexpr size_t kFieldCount = 5;
+constexpr size_t kBodyHeaderSize = 16 + 2 * kFieldCount;
+
+// Superseded records tolerated before the file is rewritten on open.
+constexpr size_t kMinSupersededForCompaction = 64;
+
+template <typename T>
+T LoadValue(const uint8_t* bytes) {
+  T value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+template <typename T>
+void StoreValue(std::vector<uint8_t>* out, T value) {
+  const size_t offset = out->size();
+  out->resize(offset + sizeof(value));
+  std::memcpy(out->data() + offset, &value, sizeof(value));
+}
+
+uint32_t Checksum(const uint8_t* body, size_t size) {
+  return static_cast<uint32_t>(HashBytes(
+      std::string_view(reinterpret_cast<const char*>(body), size), false));
+}
+
+// Returns the size of the well-formed record at |record|, or zero.
+size_t RecordSize(const uint8_t* record, size_t available) {
+  if (available < kRecordHeaderSize + kBodyHeaderSize) {
+    return 0;
+  }
+  const uint32_t body_size = LoadValue<uint32_t>(record);
+  if (body_size < kBodyHeaderSize ||
+      body_size > available - kRecordHeaderSize) {
+    return 0;
+  }
+  const uint8_t* body = record + kRecordHeaderSize;
+  size_t strings = 0;
+  for (size_t i = 0; i < kFieldCount; ++i) {
+    strings += LoadValue<uint16_t>(body + 16 + 2 * i);
+  }
+  if (kBodyHeaderSize + strings != body_size ||
+      LoadValue<uint32_t>(record + 4) != Checksum(body, body_size)) {
+    return 0;
+  }
+  return kRecordHeaderSize + body_size;
+}
+
+// The |index|th string field of a well-formed record.
+std::string_view Field(const uint8_t* record, size_t index) {
+  const uint8_t* body = record + kRecordHeaderSize;
+  const char* strings =
+      reinterpret_cast<const char*>(body + kBodyHeaderSize);
+  for (size_t i = 0; i < index; ++i) {
+    strings += LoadValue<uint16_t>(body + 16 + 2 * i);
+  }
+  return std::string_view(strings, LoadValue<uint16_t>(body + 16 + 2 * index));
+}
+
+FileStamp Stamp(const uint8_t* record) {
+  const uint8_t* body = record + kRecordHeaderSize;
+  FileStamp stamp;
+  stamp.size = LoadValue<uint64_t>(body);
+  stamp.mtime = LoadValue<int64_t>(body + 8);
+  return stamp;
+}
+
+std::vector<uint8_t> Encode(const std::string& exe, const FileStamp& stamp,
+                            const ExeMetadata& metadata) {
+  std::string_view fields[kFieldCount] = {
+      exe, metadata.display_name, metadata.product_name, metadata.icon,
+      metadata.version};
+  for (auto& field : fields) {
+    field = field.substr(0, UINT16_MAX);
+  }
+
+  std::vector<uint8_t> record(kRecordHeaderSize);
+  StoreValue(&record, stamp.size);
+  StoreValue(&record, stamp.mtime);
+  for (const auto& field : fields) {
+    StoreValue(&record, static_cast<uint16_t>(field.size()));
+  }
+  for (const auto& field : fields) {
+    record.insert(record.end(), field.begin(), field.end());
+  }
+
+  const uint32_t body_size =
+      static_cast<uint32_t>(record.size() - kRecordHeaderSize);
+  const uint32_t checksum =
+      Checksum(record.data() + kRecordHeaderSize, body_size);
+  std::memcpy(record.data(), &body_size, sizeof(body_size));
+  std::memcpy(record.data() + 4, &checksum, sizeof(checksum));
+  return record;
+}
+
+bool WriteHeader(std::FILE* file) {
+  return std::fwrite(kMagic, 1, sizeof(kMagic), file) == sizeof(kMagic) &&
+         std::fwrite(&kVersion, sizeof(kVersion), 1, file) == 1;
+}
+
+}  // namespace
+
+MetadataCache::MetadataCache(std::string path) : path_(std::move(path)) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Load();
+}
+
+MetadataCache::~MetadataCache() {
+  if (log_ != nullptr) {
+    std::fclose(log_);
+  }
+}
+
+std::optional<ExeMetadata> MetadataCache::Lookup(const std::string& exe,
+                                                 const FileStamp& stamp) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(exe);
+  if (it == index_.end() || !(Stamp(it->second) == stamp)) {
+    ++stats_.misses;
+    return std::nullopt;
+  }
+  ++stats_.hits;
+
+  const uint8_t* record = it->second;
+  ExeMetadata metadata;
+  metadata.display_name = std::string(Field(record, 1));
+  metadata.product_name = std::string(Field(record, 2));
+  metadata.icon = std::string(Field(record, 3));
+  metadata.version = std::string(Field(record, 4));
+  return metadata;
+}
+
+void MetadataCache::Insert(const std::string& exe, const FileStamp& stamp,
+                           const ExeMetadata& metadata) {
+  std::vector<uint8_t> record = Encode(exe, stamp, metadata);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  Append(record);
+  appended_.push_back(std::move(record));
+  Index(appended_.back().data());
+}
+
+ExeMetadata MetadataCache::Get(const std::string& exe, const Reader& read) {
+  FileStamp stamp;
+  if (!Stat(exe, &stamp)) {
+    return read(exe);
+  }
+  if (auto cached = Lookup(exe, stamp)) {
+    return *cached;
+  }
+  // Read without the lock; a racing reader of the same file at worst
+  // inserts an identical record.
+  ExeMetadata metadata = read(exe);
+  Insert(exe, stamp, metadata);
+  return metadata;
+}
+
+bool MetadataCache::Stat(const std::string& path, FileStamp* stamp) {
+  std::error_code error;
+  const std::filesystem::path file = std::filesystem::u8path(path);
+  const auto size = std::filesystem::file_size(file, error);
+  if (error) {
+    return false;
+  }
+  const auto mtime = std::filesystem::last_write_time(file, error);
+  if (error) {
+    return false;
+  }
+  stamp->size = size;
+  stamp->mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+  return true;
+}
+
+size_t MetadataCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_.size();
+}
+
+MetadataCache::Stats MetadataCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void MetadataCache::Load() {
+  if (path_.empty()) {
+    return;
+  }
+
+  bool rewrite = true;
+  if (mapped_.Open(path_) && mapped_.size() >= kFileHeaderSize &&
+      std::memcmp(mapped_.data(), kMagic, sizeof(kMagic)) == 0 &&
+      LoadValue<uint32_t>(mapped_.data() + 4) == kVersion) {
+    // A torn tail would hide everything appended after it.
+    rewrite = IndexMapped() != mapped_.size() ||
+              (superseded_ >= kMinSupersededForCompaction &&
+               superseded_ > index_.size());
+  }
+
+  // Appending to a file without a valid header would lose every record, so
+  // persistence is off for this session if the rewrite fails.
+  if (!rewrite || Compact()) {
+    log_ = OpenFile(path_, "ab");
+  }
+}
+
+bool MetadataCache::Compact() {
+  const std::string temp = path_ + ".tmp";
+  std::FILE* file = OpenFile(temp, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  bool ok = WriteHeader(file);
+  for (const auto& [path, record] : index_) {
+    const size_t size = kRecordHeaderSize + LoadValue<uint32_t>(record);
+    ok = ok && std::fwrite(record, 1, size, file) == size;
+  }
+  ok = std::fclose(file) == 0 && ok;
+
+  // The index points into the old mapping, which has to go before the file
+  // can be replaced on Windows.
+  index_.clear();
+  superseded_ = 0;
+  mapped_.Close();
+  ok = ok && ReplaceFile(temp, path_);
+  if (!ok || !mapped_.Open(path_)) {
+    return false;
+  }
+  IndexMapped();
+  return true;
+}
+
+size_t MetadataCache::IndexMapped() {
+  size_t offset = kFileHeaderSize;
+  while (offset < mapped_.size()) {
+    const size_t size =
+        RecordSize(mapped_.data() + offset, mapped_.size() - offset);
+    if (size == 0) {
+      break;
+    }
+    Index(mapped_.data() + offset);
+    offset += size;
+  }
+  return offset;
+}
+
+void MetadataCache::Index(const uint8_t* record) {
+  const std::string_view path = Field(record, 0);
+  auto [it, inserted] = index_.insert_or_assign(path, record);
+  if (!inserted) {
+    ++superseded_;
+  }
+}
+
+void MetadataCache::Append(const std::vector<uint8_t>& record) {
+  if (log_ == nullptr) {
+    return;
+  }
+  if (std::fwrite(record.data(), 1, record.size(), log_) == record.size()) {
+    std::fflush(log_);
+  }
+}
+
+}  // namespace routine
@@ -0,0 +1,109 @@
+#ifndef ROUTINE_CORE_METADATA_CACHE_H_
+#define ROUTINE_CORE_METADATA_CACHE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "core/mapped_file.h"
+
+namespace routine {
+
+// Identifies one version of a file on disk.
+struct FileStamp {
+  uint64_t size = 0;
+  // Last write time in the file system's native units.
+  int64_t mtime = 0;
+
+  bool operator==(const FileStamp& other) const {
+    return size == other.size && mtime == other.mtime;
+  }
+};
+
+// What the app picker shows for an executable. Any field may be empty.
+struct ExeMetadata {
+  std::string display_name;
+  std::string product_name;
+  // Where to load the icon from: a path on Windows (the executable itself
+  // when it carries an icon resource), an icon theme name or path on Linux.
+  std::string icon;
+  std::string version;
+};
+
+// A persistent cache of ExeMetadata keyed by (path, size, mtime), so that
+// version resources and desktop entries are parsed once per binary version
+// rather than on every enumeration.
+//
+// The cache file is an append-only log of checksummed records. It is
+// memory-mapped when the cache is opened and entries are decoded straight
+// from the mapping on lookup; new entries are appended as they are
+// inserted. A torn trailing record from a crash is discarded, and the file
+// is rewritten once superseded records outnumber live ones.
+//
+// Thread-safe.
+class MetadataCache {
+ public:
+  using Reader = std::function<ExeMetadata(const std::string& path)>;
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+  // Opens or creates the cache at |path|. An empty path keeps the cache in
+  // memory only.
+  explicit MetadataCache(std::string path);
+  ~MetadataCache();
+
+  MetadataCache(const MetadataCache&) = delete;
+  MetadataCache& operator=(const MetadataCache&) = delete;
+
+  std::optional<ExeMetadata> Lookup(const std::string& exe,
+                                    const FileStamp& stamp);
+  void Insert(const std::string& exe, const FileStamp& stamp,
+              const ExeMetadata& metadata);
+
+  // Returns the cached metadata for the current version of |exe|, calling
+  // |read| and caching its result on a miss. Files that cannot be stat'ed
+  // are read every time.
+  ExeMetadata Get(const std::string& exe, const Reader& read);
+
+  // Reads the size and modification time of the UTF-8 |path|.
+  static bool Stat(const std::string& path, FileStamp* stamp);
+
+  size_t size() const;
+  Stats stats() const;
+
+ private:
+  // Requires |mutex_|.
+  void Load();
+  // Rewrites the file with only the live records and maps it again.
+  bool Compact();
+  // Indexes the well-formed records of |mapped_| and returns where they end.
+  size_t IndexMapped();
+  void Index(const uint8_t* record);
+  void Append(const std::vector<uint8_t>& record);
+
+  const std::string path_;
+
+  mutable std::mutex mutex_;
+  MappedFile mapped_;
+  std::FILE* log_ = nullptr;
+  // Encoded records inserted since the file was mapped.
+  std::deque<std::vector<uint8_t>> appended_;
+  // Path -> latest encoded record, in |mapped_| or |appended_|.
+  std::unordered_map<std::string_view, const uint8_t*> index_;
+  size_t superseded_ = 0;
+  Stats stats_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_METADATA_CACHE_H_
@@ -0,0 +1,65 @@
+#include "core/path.h"
+
+namespace routine {
+
+std::string NormalizePath(std::string_view path, bool fold) {
+  std::string normalized;
+  normalized.reserve(path.size());
+
+  PathComponents components(path);
+  std::string_view component;
+  while (components.Next(&component)) {
+    if (!normalized.empty()) {
+      normalized.push_back('/');
+    }
+    for (char c : component) {
+      normalized.push_back(fold ? FoldAscii(c) : c);
+    }
+  }
+  return normalized;
+}
+
+uint64_t HashPath(std::string_view path, bool fold) {
+  uint64_t hash = kFnvOffsetBasis;
+  bool first = true;
+
+  PathComponents components(path);
+  std::string_view component;
+  while (components.Next(&component)) {
+    if (!first) {
+      hash = HashBytes("/", false, hash);
+    }
+    hash = HashBytes(component, fold, hash);
+    first = false;
+  }
+  return hash;
+}
+
+bool NormalizedPathEquals(std::string_view normalized, std::string_view path,
+                          bool fold) {
+  size_t pos = 0;
+  bool first = true;
+
+  PathComponents components(path);
+  std::string_view component;
+  while (components.Next(&component)) {
+    if (!first) {
+      if (pos == normalized.size() || normalized[pos] != '/') {
+        return false;
+      }
+      ++pos;
+    }
+    if (normalized.size() - pos < component.size()) {
+      return false;
+    }
+    for (char c : component) {
+      if (normalized[pos++] != (fold ? FoldAscii(c) : c)) {
+        return false;
+      }
+    }
+    first = false;
+  }
+  return pos == normalized.size();
+}
+
+}  // namespace routine
@@ -0,0 +1,86 @@
+#ifndef ROUTINE_CORE_PATH_H_
+#define ROUTINE_CORE_PATH_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace routine {
+
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+// Lower-cases ASCII letters and leaves every other byte untouched, so UTF-8
+// sequences survive folding.
+inline char FoldAscii(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+inline bool IsPathSeparator(char c) {
+  return c == '/' || c == '\\';
+}
+
+// FNV-1a over |bytes|, optionally folding ASCII case, continuing from |hash|.
+inline uint64_t HashBytes(std::string_view bytes, bool fold,
+                          uint64_t hash = kFnvOffsetBasis) {
+  for (char c : bytes) {
+    hash ^= static_cast<uint8_t>(fold ? FoldAscii(c) : c);
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+// Finalizer from splitmix64; spreads a combined key over all 64 bits.
+inline uint64_t MixHash(uint64_t a, uint64_t b) {
+  uint64_t x = a ^ (b + 0x9e3779b97f4a7c15ull + (a << 6) + (a >> 2));
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+// Iterates over the components of a path without allocating. Both '/' and
+// '\\' separate components and empty components are skipped, so
+// "C:\\Games\\" and "C:/Games" yield the same sequence.
+class PathComponents {
+ public:
+  explicit PathComponents(std::string_view path) : path_(path) {}
+
+  // Stores the next component in |component| and returns true, or returns
+  // false once the path is exhausted.
+  bool Next(std::string_view* component) {
+    while (pos_ < path_.size() && IsPathSeparator(path_[pos_])) {
+      ++pos_;
+    }
+    if (pos_ == path_.size()) {
+      return false;
+    }
+    size_t end = pos_;
+    while (end < path_.size() && !IsPathSeparator(path_[end])) {
+      ++end;
+    }
+    *component = path_.substr(pos_, end - pos_);
+    pos_ = end;
+    return true;
+  }
+
+ private:
+  std::string_view path_;
+  size_t pos_ = 0;
+};
+
+// Returns |path| with '/' separators, no empty components and, when |fold| is
+// set, ASCII case folded. Two paths name the same rule target exactly when
+// their normalized forms are equal.
+std::string NormalizePath(std::string_view path, bool fold);
+
+// Hash of NormalizePath(path, fold) computed without materializing it.
+uint64_t HashPath(std::string_view path, bool fold);
+
+// Returns whether NormalizePath(path, fold) == |normalized| without
+// allocating.
+bool NormalizedPathEquals(std::string_view normalized, std::string_view path,
+                          bool fold);
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_PATH_H_
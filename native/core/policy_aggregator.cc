@@ -0,0 +1,201 @@
+#include "core/policy_aggregator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace routine {
+
+namespace {
+
+using ItemList = std::vector<std::string> PolicyItems::*;
+
+constexpr ItemList kLists[] = {&PolicyItems::apps, &PolicyItems::sites,
+                               &PolicyItems::categories};
+
+}  // namespace
+
+void PolicyAggregator::SetRoutine(const std::string& id, RoutinePolicy policy) {
+  Routine routine;
+  routine.allow = policy.allow;
+  for (size_t kind = 0; kind < kKinds; ++kind) {
+    // A routine listing an item twice still counts it once.
+    std::vector<std::string>& names = policy.items.*kLists[kind];
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    routine.slots[kind].reserve(names.size());
+    for (const std::string& name : names) {
+      routine.slots[kind].push_back(Intern(kind, name));
+    }
+  }
+
+  auto it = routines_.find(id);
+  if (it == routines_.end()) {
+    routines_.emplace(id, std::move(routine));
+    return;
+  }
+  Routine& old = it->second;
+  // The same names intern to the same slots in the same order.
+  if (old.allow != routine.allow ||
+      !std::equal(std::begin(old.slots), std::end(old.slots),
+                  std::begin(routine.slots))) {
+    routine.active = old.active;
+    if (old.active) {
+      Apply(old, false);
+      Apply(routine, true);
+    }
+    std::swap(old, routine);
+  }
+  // Whichever of the two lists is not kept.
+  for (size_t kind = 0; kind < kKinds; ++kind) {
+    for (const uint32_t slot : routine.slots[kind]) {
+      Release(kind, slot);
+    }
+  }
+}
+
+void PolicyAggregator::RemoveRoutine(const std::string& id) {
+  auto it = routines_.find(id);
+  if (it == routines_.end()) {
+    return;
+  }
+  if (it->second.active) {
+    Apply(it->second, false);
+  }
+  for (size_t kind = 0; kind < kKinds; ++kind) {
+    for (const uint32_t slot : it->second.slots[kind]) {
+      Release(kind, slot);
+    }
+  }
+  routines_.erase(it);
+}
+
+void PolicyAggregator::SetActive(const std::string& id, bool active) {
+  auto it = routines_.find(id);
+  if (it == routines_.end() || it->second.active == active) {
+    return;
+  }
+  it->second.active = active;
+  Apply(it->second, active);
+}
+
+bool PolicyAggregator::IsActive(const std::string& id) const {
+  auto it = routines_.find(id);
+  return it != routines_.end() && it->second.active;
+}
+
+PolicyItems PolicyAggregator::Effective() const {
+  PolicyItems effective;
+  for (size_t kind = 0; kind < kKinds; ++kind) {
+    std::vector<std::string>& names = effective.*kLists[kind];
+    for (const Item& item : tables_[kind].items) {
+      if (InEffect(item.counts, allow_list())) {
+        names.push_back(item.name);
+      }
+    }
+    std::sort(names.begin(), names.end());
+  }
+  return effective;
+}
+
+PolicyDelta PolicyAggregator::TakeDelta() {
+  PolicyDelta delta;
+  delta.allow_list = allow_list();
+  delta.reset = allow_list() != taken_allow_list_;
+  if (delta.reset) {
+    delta.added = Effective();
+  }
+  for (size_t kind = 0; kind < kKinds; ++kind) {
+    ItemTable& table = tables_[kind];
+    std::vector<std::string>& added = delta.added.*kLists[kind];
+    std::vector<std::string>& removed = delta.removed.*kLists[kind];
+    for (const uint32_t slot : table.touched) {
+      Item& item = table.items[slot];
+      const bool in_effect = InEffect(item.counts, allow_list());
+      if (!delta.reset && in_effect != item.was_in_effect) {
+        (in_effect ? added : removed).push_back(item.name);
+      }
+      item.touched = false;
+      if (item.references == 0) {
+        Free(kind, slot);
+      }
+    }
+    table.touched.clear();
+    if (!delta.reset) {
+      std::sort(added.begin(), added.end());
+      std::sort(removed.begin(), removed.end());
+    }
+  }
+  taken_allow_list_ = allow_list();
+  return delta;
+}
+
+bool PolicyAggregator::InEffect(const Counts& counts, bool allow_list) {
+  return allow_list ? counts.allow > 0 && counts.block == 0 : counts.block > 0;
+}
+
+uint32_t PolicyAggregator::Intern(size_t kind, const std::string& name) {
+  ItemTable& table = tables_[kind];
+  auto [it, inserted] = table.slots.try_emplace(name, 0);
+  if (inserted) {
+    if (table.free.empty()) {
+      it->second = static_cast<uint32_t>(table.items.size());
+      table.items.emplace_back();
+    } else {
+      it->second = table.free.back();
+      table.free.pop_back();
+    }
+    table.items[it->second].name = name;
+  }
+  ++table.items[it->second].references;
+  return it->second;
+}
+
+void PolicyAggregator::Release(size_t kind, uint32_t slot) {
+  Item& item = tables_[kind].items[slot];
+  // A touched item is still needed for the next delta's names; TakeDelta()
+  // frees it.
+  if (--item.references == 0 && !item.touched) {
+    Free(kind, slot);
+  }
+}
+
+void PolicyAggregator::Free(size_t kind, uint32_t slot) {
+  ItemTable& table = tables_[kind];
+  Item& item = table.items[slot];
+  table.slots.erase(item.name);
+  item = Item();
+  table.free.push_back(slot);
+}
+
+void PolicyAggregator::Apply(const Routine& routine, bool on) {
+  for (size_t kind = 0; kind < kKinds; ++kind) {
+    ItemTable& table = tables_[kind];
+    for (const uint32_t slot : routine.slots[kind]) {
+      Item& item = table.items[slot];
+      if (!item.touched) {
+        // The first touch since TakeDelta() sees the counts as they were
+        // then; judge them by the mode as it was then too. If the mode has
+        // changed by the next TakeDelta(), this is not consulted.
+        item.touched = true;
+        item.was_in_effect = InEffect(item.counts, taken_allow_list_);
+        table.touched.push_back(slot);
+      }
+      uint32_t& count = routine.allow ? item.counts.allow : item.counts.block;
+      if (on) {
+        ++count;
+      } else {
+        --count;
+      }
+    }
+  }
+  if (routine.allow) {
+    if (on) {
+      ++active_allow_;
+    } else {
+      --active_allow_;
+    }
+  }
+}
+
+}  // namespace routine
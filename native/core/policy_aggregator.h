@@ -0,0 +1,133 @@
+#ifndef ROUTINE_CORE_POLICY_AGGREGATOR_H_
+#define ROUTINE_CORE_POLICY_AGGREGATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace routine {
+
+// The three kinds of item a routine lists, as the app's Routine model and
+// the updateAppList call name them.
+struct PolicyItems {
+  std::vector<std::string> apps;
+  std::vector<std::string> sites;
+  std::vector<std::string> categories;
+
+  bool empty() const {
+    return apps.empty() && sites.empty() && categories.empty();
+  }
+};
+
+// What one routine blocks or, for an allow routine, lets through.
+struct RoutinePolicy {
+  bool allow = false;
+  PolicyItems items;
+};
+
+// How the effective policy changed between two PolicyAggregator::TakeDelta()
+// calls. Lists are sorted.
+struct PolicyDelta {
+  // Whether the lists now say what may run rather than what is blocked.
+  bool allow_list = false;
+  // The lists changed meaning (the first allow routine came on or the last
+  // went off): |added| holds the whole new lists and |removed| is empty.
+  bool reset = false;
+  PolicyItems added;
+  PolicyItems removed;
+
+  bool empty() const { return !reset && added.empty() && removed.empty(); }
+};
+
+// The effective blocking policy of the routines that are on, kept up to
+// date as they come on and go off. It follows DesktopService.evaluate: if
+// any routine that is on allows, the policy is an allow list of those
+// routines' items less any a blocking routine that is on lists; otherwise
+// it is every item the blocking routines that are on list.
+//
+// Items are interned when a routine is defined, and each carries a count of
+// the allowing and of the blocking routines that are on and list it. Turning
+// a routine on or off costs O(items in the routine) array updates and
+// records only the items whose effect changed, so a schedule boundary
+// becomes a small delta rather than a rebuild. The exception is the first
+// allow routine coming on or the last going off, which changes the meaning
+// of every item and costs O(items).
+//
+// Not thread-safe.
+class PolicyAggregator {
+ public:
+  PolicyAggregator() = default;
+
+  PolicyAggregator(const PolicyAggregator&) = delete;
+  PolicyAggregator& operator=(const PolicyAggregator&) = delete;
+
+  // Defines routine |id| or replaces its lists. A new routine starts off; a
+  // routine that is on applies the change at once.
+  void SetRoutine(const std::string& id, RoutinePolicy policy);
+  void RemoveRoutine(const std::string& id);
+  // Ignored for routines not defined.
+  void SetActive(const std::string& id, bool active);
+
+  bool IsActive(const std::string& id) const;
+  bool allow_list() const { return active_allow_ > 0; }
+  size_t routine_count() const { return routines_.size(); }
+
+  // The effective lists now, sorted. O(items).
+  PolicyItems Effective() const;
+
+  // What changed since the last call, or since construction.
+  PolicyDelta TakeDelta();
+
+ private:
+  static constexpr size_t kKinds = 3;
+
+  struct Counts {
+    uint32_t allow = 0;
+    uint32_t block = 0;
+  };
+  struct Item {
+    std::string name;
+    Counts counts;
+    // Routines defined, on or off, that list the item. The slot is freed
+    // when this drops to zero.
+    uint32_t references = 0;
+    // Counted since the last TakeDelta(), and whether it was in effect
+    // then.
+    bool touched = false;
+    bool was_in_effect = false;
+  };
+  // One kind of item, interned when a routine is defined so that turning
+  // routines on and off works on slot numbers and never hashes a string.
+  struct ItemTable {
+    std::unordered_map<std::string, uint32_t> slots;
+    std::vector<Item> items;
+    std::vector<uint32_t> free;
+    std::vector<uint32_t> touched;
+  };
+  struct Routine {
+    bool allow = false;
+    bool active = false;
+    // Per kind, the items' slots in the order of their names.
+    std::vector<uint32_t> slots[kKinds];
+  };
+
+  static bool InEffect(const Counts& counts, bool allow_list);
+  uint32_t Intern(size_t kind, const std::string& name);
+  void Release(size_t kind, uint32_t slot);
+  void Free(size_t kind, uint32_t slot);
+  // Counts |routine|'s items in (|on|) or out.
+  void Apply(const Routine& routine, bool on);
+
+  std::unordered_map<std::string, Routine> routines_;
+  // In PolicyItems order.
+  ItemTable tables_[kKinds];
+  uint32_t active_allow_ = 0;
+  // allow_list() as of the last TakeDelta().
+  bool taken_allow_list_ = false;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_POLICY_AGGREGATOR_H_
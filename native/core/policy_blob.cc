@@ -0,0 +1,562 @@
+#include "core/policy_blob.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <set>
+#include <utility>
+
+#include "core/domain_matcher.h"
+#include "core/path.h"
+
+namespace routine {
+
+namespace {
+
+constexpr char kMagic[4] = {'R', 'P', 'O', 'L'};
+// Longest host name DNS allows.
+constexpr size_t kMaxHostSize = 253;
+
+enum SectionIndex { kStrings, kApps, kExempt, kNodes, kEdges, kSites, kCount };
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint32_t flags;
+  uint32_t size;
+  uint64_t checksum;
+  uint32_t app_count;
+  uint32_t exempt_count;
+  uint32_t directory_count;
+  uint32_t reserved;
+  // Offset and record count of each section; the string section counts
+  // bytes.
+  uint32_t sections[kCount][2];
+};
+
+struct Slot {
+  uint64_t hash;
+  uint32_t offset;
+  // Zero marks an empty slot; normalized paths are never empty.
+  uint32_t size;
+};
+
+struct Node {
+  uint32_t first_edge;
+  uint32_t edge_count;
+  uint32_t terminal;
+};
+
+struct Edge {
+  uint32_t label_offset;
+  uint32_t label_size;
+  uint32_t child;
+};
+
+struct StringRef {
+  uint32_t offset;
+  uint32_t size;
+};
+
+static_assert(sizeof(Header) == 88 && sizeof(Slot) == 16 &&
+                  sizeof(Node) == 12 && sizeof(Edge) == 12 &&
+                  sizeof(StringRef) == 8,
+              "records are written as they are laid out in memory");
+
+constexpr size_t kRecordSize[kCount] = {1, sizeof(Slot), sizeof(Slot),
+                                        sizeof(Node), sizeof(Edge),
+                                        sizeof(StringRef)};
+
+// Smallest power of two holding |count| entries at no more than half load.
+size_t TableCapacity(size_t count) {
+  if (count == 0) {
+    return 0;
+  }
+  size_t capacity = 8;
+  while (capacity < count * 2) {
+    capacity <<= 1;
+  }
+  return capacity;
+}
+
+// Orders a stored (already folded) label against a path component the way
+// std::string orders the labels at compile time.
+int CompareLabel(std::string_view label, std::string_view component,
+                 bool fold) {
+  const size_t common = std::min(label.size(), component.size());
+  for (size_t i = 0; i < common; ++i) {
+    const uint8_t a = static_cast<uint8_t>(label[i]);
+    const uint8_t b =
+        static_cast<uint8_t>(fold ? FoldAscii(component[i]) : component[i]);
+    if (a != b) {
+      return a < b ? -1 : 1;
+    }
+  }
+  if (label.size() == component.size()) {
+    return 0;
+  }
+  return label.size() < component.size() ? -1 : 1;
+}
+
+// Returns |site| normalized by NormalizeDomain() and reversed, or nothing
+// if it is not a valid domain: "*.Example.com." becomes "moc.elpmaxe".
+std::string ReverseSite(std::string_view site) {
+  std::string ascii;
+  if (!NormalizeDomain(site, &ascii)) {
+    return std::string();
+  }
+  return std::string(ascii.rbegin(), ascii.rend());
+}
+
+class Writer {
+ public:
+  Writer() : bytes_(sizeof(Header), '\0') {}
+
+  uint32_t AddString(std::string_view text) {
+    const uint32_t offset = static_cast<uint32_t>(strings_.size());
+    strings_.append(text);
+    return offset;
+  }
+
+  // Appends |records| as a section, 8-byte aligned.
+  template <typename T>
+  void AddSection(SectionIndex index, const std::vector<T>& records) {
+    Align();
+    header_.sections[index][0] = static_cast<uint32_t>(bytes_.size());
+    header_.sections[index][1] = static_cast<uint32_t>(records.size());
+    if (!records.empty()) {
+      bytes_.append(reinterpret_cast<const char*>(records.data()),
+                    records.size() * sizeof(T));
+    }
+  }
+
+  Header& header() { return header_; }
+
+  std::string Finish() {
+    Align();
+    header_.sections[kStrings][0] = static_cast<uint32_t>(bytes_.size());
+    header_.sections[kStrings][1] = static_cast<uint32_t>(strings_.size());
+    bytes_ += strings_;
+    Align();
+
+    std::memcpy(header_.magic, kMagic, sizeof(kMagic));
+    header_.version = PolicyBlob::kVersion;
+    header_.size = static_cast<uint32_t>(bytes_.size());
+    header_.checksum = HashBytes(
+        std::string_view(bytes_).substr(sizeof(Header)), false);
+    std::memcpy(&bytes_[0], &header_, sizeof(header_));
+    return std::move(bytes_);
+  }
+
+ private:
+  void Align() { bytes_.resize((bytes_.size() + 7) / 8 * 8, '\0'); }
+
+  std::string bytes_;
+  std::string strings_;
+  Header header_{};
+};
+
+std::vector<Slot> BuildTable(Writer* writer,
+                             const std::vector<std::string>& paths,
+                             bool fold, uint32_t* count) {
+  // Ordered, so equal sources compile to equal blobs.
+  std::set<std::string> unique;
+  for (const auto& path : paths) {
+    std::string normalized = NormalizePath(path, fold);
+    if (!normalized.empty()) {
+      unique.insert(std::move(normalized));
+    }
+  }
+
+  std::vector<Slot> slots(TableCapacity(unique.size()), Slot{});
+  const size_t mask = slots.size() - 1;
+  for (const auto& path : unique) {
+    const uint64_t hash = HashBytes(path, false);
+    size_t slot = hash & mask;
+    while (slots[slot].size != 0) {
+      slot = (slot + 1) & mask;
+    }
+    slots[slot].hash = hash;
+    slots[slot].offset = writer->AddString(path);
+    slots[slot].size = static_cast<uint32_t>(path.size());
+  }
+  *count = static_cast<uint32_t>(unique.size());
+  return slots;
+}
+
+}  // namespace
+
+std::string PolicyBlob::Compile(const Source& source) {
+  const bool fold = source.ignore_case;
+  Writer writer;
+  Header& header = writer.header();
+  header.flags = (source.allow_list ? kAllowList : 0) |
+                 (fold ? kIgnoreCase : 0);
+
+  writer.AddSection(kApps,
+                    BuildTable(&writer, source.apps, fold, &header.app_count));
+  writer.AddSection(kExempt, BuildTable(&writer, source.exempt, fold,
+                                        &header.exempt_count));
+
+  // The directory trie, built with ordered maps so each node's edges come
+  // out sorted by label.
+  std::vector<std::map<std::string, uint32_t>> children(1);
+  std::vector<uint32_t> terminal(1, 0);
+  for (const auto& directory : source.directories) {
+    uint32_t node = 0;
+    bool empty = true;
+    PathComponents components(directory);
+    std::string_view component;
+    while (components.Next(&component)) {
+      empty = false;
+      std::string label(component);
+      if (fold) {
+        for (char& c : label) {
+          c = FoldAscii(c);
+        }
+      }
+      auto it = children[node].find(label);
+      if (it == children[node].end()) {
+        const uint32_t child = static_cast<uint32_t>(children.size());
+        children[node].emplace(std::move(label), child);
+        children.emplace_back();
+        terminal.push_back(0);
+        node = child;
+      } else {
+        node = it->second;
+      }
+    }
+    // An empty directory would match every path; ignore it rather than
+    // block everything.
+    if (!empty && !terminal[node]) {
+      terminal[node] = 1;
+      ++header.directory_count;
+    }
+  }
+
+  std::vector<Node> nodes;
+  std::vector<Edge> edges;
+  if (header.directory_count > 0) {
+    nodes.reserve(children.size());
+    for (uint32_t i = 0; i < children.size(); ++i) {
+      nodes.push_back(Node{static_cast<uint32_t>(edges.size()),
+                           static_cast<uint32_t>(children[i].size()),
+                           terminal[i]});
+      for (const auto& [label, child] : children[i]) {
+        edges.push_back(Edge{writer.AddString(label),
+                             static_cast<uint32_t>(label.size()), child});
+      }
+    }
+  }
+  writer.AddSection(kNodes, nodes);
+  writer.AddSection(kEdges, edges);
+
+  std::set<std::string> reversed;
+  for (const auto& site : source.sites) {
+    std::string normalized = ReverseSite(site);
+    if (!normalized.empty()) {
+      reversed.insert(std::move(normalized));
+    }
+  }
+  std::vector<StringRef> sites;
+  sites.reserve(reversed.size());
+  for (const auto& site : reversed) {
+    sites.push_back(StringRef{writer.AddString(site),
+                              static_cast<uint32_t>(site.size())});
+  }
+  writer.AddSection(kSites, sites);
+
+  return writer.Finish();
+}
+
+bool PolicyBlob::Open(std::string_view bytes) {
+  *this = PolicyBlob();
+
+  Header header;
+  if (bytes.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.size != bytes.size() ||
+      header.checksum != HashBytes(bytes.substr(sizeof(header)), false)) {
+    return false;
+  }
+
+  Section sections[kCount];
+  for (int i = 0; i < kCount; ++i) {
+    sections[i].offset = header.sections[i][0];
+    sections[i].count = header.sections[i][1];
+    const uint64_t end = static_cast<uint64_t>(sections[i].offset) +
+                         uint64_t{sections[i].count} * kRecordSize[i];
+    if (sections[i].offset < sizeof(header) || end > bytes.size()) {
+      return false;
+    }
+  }
+
+  PolicyBlob blob;
+  blob.bytes_ = bytes;
+  blob.strings_ = sections[kStrings];
+  auto valid_string = [&](uint32_t offset, uint32_t size) {
+    return uint64_t{offset} + size <= blob.strings_.count;
+  };
+
+  for (const SectionIndex index : {kApps, kExempt}) {
+    const Section& table = sections[index];
+    if ((table.count & (table.count - 1)) != 0) {
+      return false;
+    }
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < table.count; ++i) {
+      const Slot slot = blob.Load<Slot>(table.offset, i);
+      if (slot.size != 0) {
+        ++used;
+        if (!valid_string(slot.offset, slot.size)) {
+          return false;
+        }
+      }
+    }
+    // A full table would make a miss probe forever.
+    if (table.count > 0 && used == table.count) {
+      return false;
+    }
+  }
+
+  const Section& nodes = sections[kNodes];
+  const Section& edges = sections[kEdges];
+  if (header.directory_count > 0 && nodes.count == 0) {
+    return false;
+  }
+  for (uint32_t i = 0; i < nodes.count; ++i) {
+    const Node node = blob.Load<Node>(nodes.offset, i);
+    if (uint64_t{node.first_edge} + node.edge_count > edges.count) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < edges.count; ++i) {
+    const Edge edge = blob.Load<Edge>(edges.offset, i);
+    if (!valid_string(edge.label_offset, edge.label_size) ||
+        edge.child == 0 || edge.child >= nodes.count) {
+      return false;
+    }
+  }
+
+  const Section& sites = sections[kSites];
+  for (uint32_t i = 0; i < sites.count; ++i) {
+    const StringRef site = blob.Load<StringRef>(sites.offset, i);
+    if (!valid_string(site.offset, site.size)) {
+      return false;
+    }
+  }
+
+  blob.flags_ = header.flags;
+  blob.apps_ = sections[kApps];
+  blob.exempt_ = sections[kExempt];
+  blob.nodes_ = nodes;
+  blob.edges_ = edges;
+  blob.sites_ = sites;
+  blob.app_count_ = header.app_count;
+  blob.exempt_count_ = header.exempt_count;
+  blob.directory_count_ = header.directory_count;
+  *this = blob;
+  return true;
+}
+
+template <typename T>
+T PolicyBlob::Load(uint32_t offset, uint32_t index) const {
+  T record;
+  std::memcpy(&record, bytes_.data() + offset + size_t{index} * sizeof(T),
+              sizeof(T));
+  return record;
+}
+
+std::string_view PolicyBlob::String(uint32_t offset, uint32_t size) const {
+  return bytes_.substr(strings_.offset + size_t{offset}, size);
+}
+
+bool PolicyBlob::IsBlocked(std::string_view path, uint64_t path_hash) const {
+  if (IsExempt(path, path_hash)) {
+    return false;
+  }
+  const bool listed = ContainsApp(path, path_hash) || InDirectories(path);
+  return allow_list() ? !listed : listed;
+}
+
+bool PolicyBlob::ContainsApp(std::string_view path, uint64_t path_hash) const {
+  return TableContains(apps_, path, path_hash);
+}
+
+bool PolicyBlob::IsExempt(std::string_view path, uint64_t path_hash) const {
+  return TableContains(exempt_, path, path_hash);
+}
+
+bool PolicyBlob::TableContains(const Section& table, std::string_view path,
+                               uint64_t hash) const {
+  if (table.count == 0) {
+    return false;
+  }
+  const uint32_t mask = table.count - 1;
+  for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+    const Slot slot = Load<Slot>(table.offset, i);
+    if (slot.size == 0) {
+      return false;
+    }
+    if (slot.hash == hash &&
+        NormalizedPathEquals(String(slot.offset, slot.size), path,
+                             ignore_case())) {
+      return true;
+    }
+  }
+}
+
+bool PolicyBlob::InDirectories(std::string_view path) const {
+  if (directory_count_ == 0) {
+    return false;
+  }
+  uint32_t node = 0;
+  PathComponents components(path);
+  std::string_view component;
+  while (components.Next(&component)) {
+    node = FindChild(node, component);
+    if (node == 0) {
+      return false;
+    }
+    if (Load<Node>(nodes_.offset, node).terminal) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t PolicyBlob::FindChild(uint32_t node,
+                               std::string_view component) const {
+  const Node parent = Load<Node>(nodes_.offset, node);
+  uint32_t low = parent.first_edge;
+  uint32_t high = parent.first_edge + parent.edge_count;
+  while (low < high) {
+    const uint32_t mid = low + (high - low) / 2;
+    const Edge edge = Load<Edge>(edges_.offset, mid);
+    const int order = CompareLabel(String(edge.label_offset, edge.label_size),
+                                   component, ignore_case());
+    if (order == 0) {
+      return edge.child;
+    }
+    if (order < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return 0;
+}
+
+bool PolicyBlob::MatchesSite(std::string_view host) const {
+  while (!host.empty() && host.back() == '.') {
+    host.remove_suffix(1);
+  }
+  if (sites_.count == 0 || host.empty() || host.size() > kMaxHostSize) {
+    return false;
+  }
+  for (const char c : host) {
+    if (static_cast<uint8_t>(c) >= 0x80) {
+      // Listed sites are punycode; so must the host be.
+      std::string ascii;
+      return NormalizeDomain(host, &ascii) && MatchesSite(ascii);
+    }
+  }
+  char reversed[kMaxHostSize];
+  for (size_t i = 0; i < host.size(); ++i) {
+    reversed[i] = FoldAscii(host[host.size() - 1 - i]);
+  }
+  // "moc.elpmaxe.www" is listed as "moc", "moc.elpmaxe" or itself.
+  const std::string_view name(reversed, host.size());
+  for (size_t end = 1; end <= name.size(); ++end) {
+    if ((end == name.size() || name[end] == '.') &&
+        ContainsReversedSite(name.substr(0, end))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PolicyBlob::ContainsReversedSite(std::string_view reversed) const {
+  uint32_t low = 0;
+  uint32_t high = sites_.count;
+  while (low < high) {
+    const uint32_t mid = low + (high - low) / 2;
+    const StringRef site = Load<StringRef>(sites_.offset, mid);
+    const int order = String(site.offset, site.size).compare(reversed);
+    if (order == 0) {
+      return true;
+    }
+    if (order < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return false;
+}
+
+std::vector<std::string> PolicyBlob::TableEntries(const Section& table) const {
+  std::vector<std::string> entries;
+  for (uint32_t i = 0; i < table.count; ++i) {
+    const Slot slot = Load<Slot>(table.offset, i);
+    if (slot.size != 0) {
+      entries.emplace_back(String(slot.offset, slot.size));
+    }
+  }
+  return entries;
+}
+
+std::vector<std::string> PolicyBlob::Apps() const {
+  return TableEntries(apps_);
+}
+
+std::vector<std::string> PolicyBlob::Exempt() const {
+  return TableEntries(exempt_);
+}
+
+std::vector<std::string> PolicyBlob::Directories() const {
+  std::vector<std::string> directories;
+  if (directory_count_ == 0) {
+    return directories;
+  }
+  // Edges only point to later nodes, but a damaged blob could still
+  // revisit one; the depth bound keeps the walk finite.
+  std::function<void(uint32_t, const std::string&, uint32_t)> walk =
+      [&](uint32_t index, const std::string& prefix, uint32_t depth) {
+        const Node node = Load<Node>(nodes_.offset, index);
+        if (node.terminal) {
+          directories.push_back(prefix);
+        }
+        if (depth == nodes_.count) {
+          return;
+        }
+        for (uint32_t i = 0; i < node.edge_count; ++i) {
+          const Edge edge = Load<Edge>(edges_.offset, node.first_edge + i);
+          const std::string_view label =
+              String(edge.label_offset, edge.label_size);
+          walk(edge.child,
+               prefix.empty() ? std::string(label)
+                              : prefix + "/" + std::string(label),
+               depth + 1);
+        }
+      };
+  walk(0, "", 0);
+  return directories;
+}
+
+std::vector<std::string> PolicyBlob::Sites() const {
+  std::vector<std::string> sites;
+  sites.reserve(sites_.count);
+  for (uint32_t i = 0; i < sites_.count; ++i) {
+    const StringRef site = Load<StringRef>(sites_.offset, i);
+    const std::string_view reversed = String(site.offset, site.size);
+    sites.emplace_back(reversed.rbegin(), reversed.rend());
+  }
+  return sites;
+}
+
+}  // namespace routine
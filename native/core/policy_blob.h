@@ -0,0 +1,110 @@
+#ifndef ROUTINE_CORE_POLICY_BLOB_H_
+#define ROUTINE_CORE_POLICY_BLOB_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace routine {
+
+// A compiled block policy as one relocatable byte string, queried in place.
+//
+// The blob can be kept in memory, written to disk and memory-mapped, or
+// handed to another process; nothing in it is a pointer. Layout, all
+// integers little-endian and every section 8-byte aligned:
+//
+//   header     magic "RPOL", version, flags, total size, FNV-1a checksum
+//              of everything after the header, and the offset and record
+//              count of each section
+//   strings    the bytes of every path, trie label and site
+//   apps       open-addressed table of normalized paths keyed by HashPath()
+//   exempt     likewise
+//   nodes      directory trie nodes: first edge, edge count, terminal flag
+//   edges      trie edges sorted by label within each node, so a child is
+//              found by binary search
+//   sites      domains in NormalizeDomain() form, reversed ("moc.elpmaxe")
+//              and sorted, so a host matches by looking up each of its
+//              label-aligned suffixes
+//
+// Open() checks the checksum and every offset once; lookups after that do
+// no bounds checks and allocate nothing.
+class PolicyBlob {
+ public:
+  static constexpr uint32_t kVersion = 1;
+
+  // What Compile() turns into a blob.
+  struct Source {
+    bool allow_list = false;
+    // Compare paths ASCII case-insensitively, as Windows file systems do.
+    bool ignore_case = false;
+    std::vector<std::string> apps;
+    std::vector<std::string> directories;
+    std::vector<std::string> exempt;
+    std::vector<std::string> sites;
+  };
+
+  static std::string Compile(const Source& source);
+
+  // Adopts |bytes|, which must outlive this object. Returns false, leaving
+  // the blob empty, if they are not an intact blob of this version.
+  bool Open(std::string_view bytes);
+
+  bool IsBlocked(std::string_view path, uint64_t path_hash) const;
+  bool ContainsApp(std::string_view path, uint64_t path_hash) const;
+  bool IsExempt(std::string_view path, uint64_t path_hash) const;
+  bool InDirectories(std::string_view path) const;
+  // Whether |host| is a listed site or a subdomain of one. ASCII case is
+  // ignored; Unicode hosts are punycode-encoded first.
+  bool MatchesSite(std::string_view host) const;
+
+  bool allow_list() const { return (flags_ & kAllowList) != 0; }
+  bool ignore_case() const { return (flags_ & kIgnoreCase) != 0; }
+  size_t app_count() const { return app_count_; }
+  size_t exempt_count() const { return exempt_count_; }
+  size_t directory_count() const { return directory_count_; }
+  size_t site_count() const { return sites_.count; }
+  std::string_view bytes() const { return bytes_; }
+
+  // For inspection: the listed entries in table or trie order.
+  std::vector<std::string> Apps() const;
+  std::vector<std::string> Exempt() const;
+  std::vector<std::string> Directories() const;
+  std::vector<std::string> Sites() const;
+
+ private:
+  static constexpr uint32_t kAllowList = 1 << 0;
+  static constexpr uint32_t kIgnoreCase = 1 << 1;
+
+  struct Section {
+    uint32_t offset = 0;
+    uint32_t count = 0;
+  };
+
+  template <typename T>
+  T Load(uint32_t offset, uint32_t index) const;
+  std::string_view String(uint32_t offset, uint32_t size) const;
+
+  bool TableContains(const Section& table, std::string_view path,
+                     uint64_t hash) const;
+  std::vector<std::string> TableEntries(const Section& table) const;
+  uint32_t FindChild(uint32_t node, std::string_view component) const;
+  bool ContainsReversedSite(std::string_view reversed) const;
+
+  std::string_view bytes_;
+  uint32_t flags_ = 0;
+  Section strings_;
+  Section apps_;
+  Section exempt_;
+  Section nodes_;
+  Section edges_;
+  Section sites_;
+  uint32_t app_count_ = 0;
+  uint32_t exempt_count_ = 0;
+  uint32_t directory_count_ = 0;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_POLICY_BLOB_H_
@@ -0,0 +1,40 @@
+#include "core/policy_store.h"
+
+#include <utility>
+
+#include "core/path.h"
+
+namespace routine {
+
+PolicyStore::PolicyStore(size_t cache_capacity)
+    : policy_(std::make_unique<const Snapshot>(
+          Snapshot{RuleSet::Builder(RuleSet::Options()).Build(), 0})),
+      cache_(cache_capacity) {}
+
+void PolicyStore::Set(std::unique_ptr<const RuleSet> rules) {
+  const uint64_t generation =
+      generation_.fetch_add(1, std::memory_order_acq_rel) + 1;
+  policy_.Publish(
+      std::make_unique<const Snapshot>(Snapshot{std::move(rules), generation}));
+}
+
+bool PolicyStore::IsBlocked(std::string_view path) const {
+  auto policy = policy_.Read();
+  const RuleSet& rules = *policy->rules;
+  const uint64_t hash = HashPath(path, rules.options().ignore_case);
+
+  bool blocked;
+  if (cache_.Lookup(hash, policy->generation, &blocked)) {
+    return blocked;
+  }
+
+  blocked = rules.IsBlocked(path, hash);
+  cache_.Insert(hash, policy->generation, blocked);
+  return blocked;
+}
+
+bool PolicyStore::allow_list() const {
+  return policy_.Read()->rules->options().allow_list;
+}
+
+}  // namespace routine
@@ -0,0 +1,59 @@
+#ifndef ROUTINE_CORE_POLICY_STORE_H_
+#define ROUTINE_CORE_POLICY_STORE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+#include "core/rcu_cell.h"
+#include "core/rule_set.h"
+#include "core/verdict_cache.h"
+
+namespace routine {
+
+// The active block policy of a runner.
+//
+// Policies are compiled by the caller, off the enforcement path, and handed
+// over whole; IsBlocked() never takes a lock and never sees a partially
+// applied policy. Verdicts are memoised in a bounded cache tagged with the
+// policy generation, so a new policy invalidates it without a clear.
+class PolicyStore {
+ public:
+  // Starts with an empty block list, which blocks nothing.
+  explicit PolicyStore(size_t cache_capacity = VerdictCache::kDefaultCapacity);
+
+  PolicyStore(const PolicyStore&) = delete;
+  PolicyStore& operator=(const PolicyStore&) = delete;
+
+  // Makes |rules| the active policy. The previous policy is freed once the
+  // last reader still using it returns.
+  void Set(std::unique_ptr<const RuleSet> rules);
+
+  bool IsBlocked(std::string_view path) const;
+
+  // Whether the active policy blocks everything it does not list.
+  bool allow_list() const;
+
+  // Incremented by every Set(); zero until the first policy arrives.
+  uint64_t generation() const {
+    return generation_.load(std::memory_order_acquire);
+  }
+
+  VerdictCache::Stats cache_stats() const { return cache_.stats(); }
+
+ private:
+  struct Snapshot {
+    std::unique_ptr<const RuleSet> rules;
+    uint64_t generation = 0;
+  };
+
+  RcuCell<Snapshot> policy_;
+  std::atomic<uint64_t> generation_{0};
+  mutable VerdictCache cache_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_POLICY_STORE_H_
@@ -0,0 +1,99 @@
+#include "core/process_table.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+
+namespace routine {
+
+ProcessTable::Diff ProcessTable::Update(const std::vector<ProcessKey>& current,
+                                        const Describe& describe,
+                                        const CancellationToken* cancel) {
+  Diff diff;
+  const uint64_t update = ++update_;
+
+  for (const ProcessKey& key : current) {
+    auto it = entries_.find(key.pid);
+    if (it != entries_.end() && it->second.start_time == key.start_time) {
+      if (it->second.seen != update) {
+        ++diff.retained;
+      }
+      it->second.seen = update;
+      continue;
+    }
+
+    if (cancel != nullptr && cancel->IsCancelled()) {
+      diff.cancelled = true;
+      return diff;
+    }
+    std::optional<RunningApp> app = describe(key);
+    // Counted before the process it replaces is forgotten, so an app that
+    // just restarted under a reused pid is not reported gone and back.
+    Track(app);
+    if (it == entries_.end()) {
+      it = entries_.emplace(key.pid, Entry()).first;
+    } else {
+      // Same pid, different process.
+      Untrack(it->second.app);
+      ++diff.removed;
+    }
+    Entry& entry = it->second;
+    entry.start_time = key.start_time;
+    entry.seen = update;
+    entry.app = std::move(app);
+    ++diff.added;
+  }
+
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.seen != update) {
+      Untrack(it->second.app);
+      it = entries_.erase(it);
+      ++diff.removed;
+    } else {
+      ++it;
+    }
+  }
+  return diff;
+}
+
+std::vector<RunningApp> ProcessTable::Apps() const {
+  std::vector<std::pair<int64_t, const RunningApp*>> listed;
+  listed.reserve(entries_.size());
+  for (const auto& [pid, entry] : entries_) {
+    if (entry.app) {
+      listed.emplace_back(pid, &*entry.app);
+    }
+  }
+  std::sort(listed.begin(), listed.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  std::vector<RunningApp> apps;
+  std::unordered_set<std::string> paths;
+  for (const auto& [pid, app] : listed) {
+    if (paths.insert(app->path).second) {
+      apps.push_back(*app);
+    }
+  }
+  return apps;
+}
+
+void ProcessTable::Track(const std::optional<RunningApp>& app) {
+  if (app && ++paths_[app->path] == 1 && observer_ != nullptr) {
+    observer_->AppAdded(*app);
+  }
+}
+
+void ProcessTable::Untrack(const std::optional<RunningApp>& app) {
+  if (!app) {
+    return;
+  }
+  auto it = paths_.find(app->path);
+  if (--it->second == 0) {
+    paths_.erase(it);
+    if (observer_ != nullptr) {
+      observer_->AppRemoved(*app);
+    }
+  }
+}
+
+}  // namespace routine
@@ -0,0 +1,97 @@
+#ifndef ROUTINE_CORE_PROCESS_TABLE_H_
+#define ROUTINE_CORE_PROCESS_TABLE_H_
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/cancellation_token.h"
+
+namespace routine {
+
+// Names one process even across pid reuse.
+struct ProcessKey {
+  int64_t pid = 0;
+  // Platform-specific creation time (clock ticks since boot on Linux,
+  // FILETIME on Windows); only compared for equality.
+  uint64_t start_time = 0;
+};
+
+// What the block-apps picker shows for a running process.
+struct RunningApp {
+  // Executable name without directory (or ".exe" on Windows).
+  std::string name;
+  std::string display_name;
+  std::string path;
+};
+
+// Remembers what was learned about each running process between
+// enumerations, so that expensive per-process work (opening the process,
+// reading version resources, parsing desktop entries) is done once per
+// process lifetime instead of on every call.
+//
+// Not thread-safe; owned by whichever thread answers the picker.
+class ProcessTable {
+ public:
+  // Told when an app starts being listed by Apps(), as its first process is
+  // described, and when it stops, as its last process goes away. Lets a
+  // listener mirror Apps() without relisting it after every Update().
+  class Observer {
+   public:
+    virtual ~Observer() = default;
+    virtual void AppAdded(const RunningApp& app) = 0;
+    virtual void AppRemoved(const RunningApp& app) = 0;
+  };
+
+  // Returns the app a process belongs to, or nothing if it should not be
+  // listed. Only called for processes the table has not seen before.
+  using Describe = std::function<std::optional<RunningApp>(const ProcessKey&)>;
+
+  struct Diff {
+    size_t added = 0;
+    size_t removed = 0;
+    size_t retained = 0;
+    // Update() stopped early; the table keeps what it had described.
+    bool cancelled = false;
+  };
+
+  // Reconciles the table with |current|, the processes running now.
+  // Entries whose key is absent (exited, or the pid was reused) are dropped;
+  // new keys are described with |describe|. Once |cancel| is cancelled no
+  // further processes are described and nothing is dropped, so the next
+  // Update() picks up where this one stopped.
+  Diff Update(const std::vector<ProcessKey>& current, const Describe& describe,
+              const CancellationToken* cancel = nullptr);
+
+  // The apps of the processes from the last Update(), one per path, ordered
+  // by pid.
+  std::vector<RunningApp> Apps() const;
+
+  size_t size() const { return entries_.size(); }
+
+  // |observer| may be null; it is only called from within Update().
+  void set_observer(Observer* observer) { observer_ = observer; }
+
+ private:
+  struct Entry {
+    uint64_t start_time = 0;
+    uint64_t seen = 0;
+    std::optional<RunningApp> app;
+  };
+
+  void Track(const std::optional<RunningApp>& app);
+  void Untrack(const std::optional<RunningApp>& app);
+
+  std::unordered_map<int64_t, Entry> entries_;
+  // Processes per listed path.
+  std::unordered_map<std::string, size_t> paths_;
+  uint64_t update_ = 0;
+  Observer* observer_ = nullptr;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_PROCESS_TABLE_H_
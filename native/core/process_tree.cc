@@ -0,0 +1,130 @@
+#include "core/process_tree.h"
+
+#include <utility>
+
+namespace routine {
+
+void ProcessTree::Reset(const std::vector<Seed>& processes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  nodes_.clear();
+  free_.clear();
+  by_pid_.clear();
+  exited_ = 0;
+  nodes_.reserve(processes.size());
+  by_pid_.reserve(processes.size());
+
+  // Parents may come after their children; link once every pid is known.
+  for (const Seed& seed : processes) {
+    if (by_pid_.count(seed.pid) != 0) {
+      continue;
+    }
+    Add(seed.pid, kNone,
+        seed.exe.empty() ? nullptr
+                         : std::make_shared<const std::string>(seed.exe));
+  }
+  for (const Seed& seed : processes) {
+    const uint32_t index = by_pid_[seed.pid];
+    auto parent = by_pid_.find(seed.ppid);
+    if (parent == by_pid_.end() || parent->second == index ||
+        nodes_[index].parent != kNone) {
+      continue;
+    }
+    nodes_[index].parent = parent->second;
+    ++nodes_[parent->second].children;
+  }
+}
+
+void ProcessTree::Fork(int64_t pid, int64_t parent_pid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ExitLocked(pid);
+  uint32_t parent = kNone;
+  std::shared_ptr<const std::string> exe;
+  auto it = by_pid_.find(parent_pid);
+  if (it != by_pid_.end()) {
+    parent = it->second;
+    exe = nodes_[parent].exe;
+  }
+  Add(pid, parent, std::move(exe));
+}
+
+void ProcessTree::Exec(int64_t pid, const std::string& exe) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto shared =
+      exe.empty() ? nullptr : std::make_shared<const std::string>(exe);
+  auto it = by_pid_.find(pid);
+  if (it == by_pid_.end()) {
+    // Forked before we were listening, or its fork event was lost.
+    Add(pid, kNone, std::move(shared));
+    return;
+  }
+  nodes_[it->second].exe = std::move(shared);
+}
+
+void ProcessTree::Exit(int64_t pid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ExitLocked(pid);
+}
+
+size_t ProcessTree::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return nodes_.size() - free_.size();
+}
+
+size_t ProcessTree::exited() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return exited_;
+}
+
+uint32_t ProcessTree::Add(int64_t pid, uint32_t parent,
+                          std::shared_ptr<const std::string> exe) {
+  uint32_t index;
+  if (free_.empty()) {
+    index = static_cast<uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+  } else {
+    index = free_.back();
+    free_.pop_back();
+  }
+  Node& node = nodes_[index];
+  node.pid = pid;
+  node.parent = parent;
+  node.children = 0;
+  node.exited = false;
+  node.exe = std::move(exe);
+  if (parent != kNone) {
+    ++nodes_[parent].children;
+  }
+  by_pid_[pid] = index;
+  return index;
+}
+
+void ProcessTree::Release(uint32_t index) {
+  while (index != kNone) {
+    Node& node = nodes_[index];
+    if (!node.exited || node.children != 0) {
+      return;
+    }
+    const uint32_t parent = node.parent;
+    node = Node();
+    free_.push_back(index);
+    --exited_;
+    if (parent != kNone) {
+      --nodes_[parent].children;
+    }
+    index = parent;
+  }
+}
+
+void ProcessTree::ExitLocked(int64_t pid) {
+  auto it = by_pid_.find(pid);
+  if (it == by_pid_.end()) {
+    return;
+  }
+  const uint32_t index = it->second;
+  by_pid_.erase(it);
+  nodes_[index].exited = true;
+  ++exited_;
+  Release(index);
+}
+
+}  // namespace routine
@@ -0,0 +1,112 @@
+#ifndef ROUTINE_CORE_PROCESS_TREE_H_
+#define ROUTINE_CORE_PROCESS_TREE_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace routine {
+
+// Who started whom, kept current from fork, exec and exit events, so a
+// verdict can be attributed to an ancestor: a renderer, crash reporter or
+// game started by a blocked launcher is the launcher's, whatever its own
+// executable.
+//
+// Nodes live in an arena and link to their parent by index, found from a
+// pid through a hash, so walking a lineage is O(depth). A process that
+// exits stays in the tree, unreachable by pid, for as long as it has
+// descendants: a launcher that exits after starting its game still
+// attributes the game. Its pid can be reused meanwhile without the new
+// process inheriting anything.
+//
+// Thread-safe.
+class ProcessTree {
+ public:
+  // Lineages longer than this are cut, should a torn /proc scan have made
+  // a cycle.
+  static constexpr size_t kMaxDepth = 1024;
+
+  struct Seed {
+    int64_t pid = 0;
+    int64_t ppid = 0;
+    // Empty for kernel threads and processes we may not inspect.
+    std::string exe;
+  };
+
+  ProcessTree() = default;
+
+  ProcessTree(const ProcessTree&) = delete;
+  ProcessTree& operator=(const ProcessTree&) = delete;
+
+  // Replaces the tree with the processes running now, in any order. For
+  // the initial scan and after events were lost.
+  void Reset(const std::vector<Seed>& processes);
+
+  // |pid| was forked by |parent_pid| and runs its executable until it
+  // execs. A pid still in the tree is taken to have exited unseen.
+  void Fork(int64_t pid, int64_t parent_pid);
+  // |exe| is empty if it could not be read.
+  void Exec(int64_t pid, const std::string& exe);
+  void Exit(int64_t pid);
+
+  // Visits the executables of |pid| and its ancestors, nearest first,
+  // until |visit| returns true. Returns that executable, or an empty
+  // string if none was chosen or |pid| is unknown.
+  template <typename Visit>
+  std::string FindInLineage(int64_t pid, Visit visit) const;
+
+  // Processes running, and exited ones kept for their descendants.
+  size_t size() const;
+  size_t exited() const;
+
+ private:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  struct Node {
+    int64_t pid = 0;
+    uint32_t parent = kNone;
+    // Children still in the tree, running or not.
+    uint32_t children = 0;
+    bool exited = false;
+    // Shared with the parent until exec, so a fork does not copy a path.
+    std::shared_ptr<const std::string> exe;
+  };
+
+  uint32_t Add(int64_t pid, uint32_t parent,
+               std::shared_ptr<const std::string> exe);
+  // Removes |index| if it exited and has no children left, then does the
+  // same for its ancestors.
+  void Release(uint32_t index);
+  void ExitLocked(int64_t pid);
+
+  mutable std::mutex mutex_;
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> free_;
+  std::unordered_map<int64_t, uint32_t> by_pid_;
+  size_t exited_ = 0;
+};
+
+template <typename Visit>
+std::string ProcessTree::FindInLineage(int64_t pid, Visit visit) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = by_pid_.find(pid);
+  if (it == by_pid_.end()) {
+    return std::string();
+  }
+  uint32_t index = it->second;
+  for (size_t depth = 0; index != kNone && depth < kMaxDepth; ++depth) {
+    const Node& node = nodes_[index];
+    if (node.exe && visit(*node.exe)) {
+      return *node.exe;
+    }
+    index = node.parent;
+  }
+  return std::string();
+}
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_PROCESS_TREE_H_
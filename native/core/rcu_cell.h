@@ -0,0 +1,129 @@
+#ifndef ROUTINE_CORE_RCU_CELL_H_
+#define ROUTINE_CORE_RCU_CELL_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "core/sharded_counter.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+// Padding the reader shards to a cache line is the point.
+#pragma warning(disable : 4324)
+#endif
+
+namespace routine {
+
+// Holds an immutable value that is replaced wholesale by writers and read
+// without locks.
+//
+// Readers pin the current epoch by bumping a per-thread-shard counter, load
+// the pointer and drop the pin when their ReadGuard goes away. Publish()
+// swaps the pointer, flips the epoch and frees the previous value once every
+// reader pinned to the old epoch has finished, so a reader never observes a
+// half-built or freed value. Writers are serialised with each other; readers
+// never wait.
+template <typename T>
+class RcuCell {
+ public:
+  class ReadGuard {
+   public:
+    ReadGuard(ReadGuard&& other) noexcept
+        : counter_(other.counter_), value_(other.value_) {
+      other.counter_ = nullptr;
+    }
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+    ReadGuard& operator=(ReadGuard&&) = delete;
+
+    ~ReadGuard() {
+      if (counter_ != nullptr) {
+        counter_->fetch_sub(1, std::memory_order_release);
+      }
+    }
+
+    const T* get() const { return value_; }
+    const T* operator->() const { return value_; }
+    const T& operator*() const { return *value_; }
+    explicit operator bool() const { return value_ != nullptr; }
+
+   private:
+    friend class RcuCell;
+
+    ReadGuard(std::atomic<int64_t>* counter, const T* value)
+        : counter_(counter), value_(value) {}
+
+    std::atomic<int64_t>* counter_;
+    const T* value_;
+  };
+
+  RcuCell() = default;
+  explicit RcuCell(std::unique_ptr<const T> initial)
+      : current_(initial.release()) {}
+  ~RcuCell() { delete current_.load(); }
+
+  RcuCell(const RcuCell&) = delete;
+  RcuCell& operator=(const RcuCell&) = delete;
+
+  // Pins the current value for the lifetime of the returned guard.
+  ReadGuard Read() const {
+    Shard& shard = shards_[ThreadShardIndex()];
+    for (;;) {
+      const uint64_t epoch = epoch_.load();
+      std::atomic<int64_t>& counter = shard.readers[epoch & 1];
+      counter.fetch_add(1);
+      // If a writer flipped the epoch between the load and the increment it
+      // may already have stopped waiting on this counter; pin again.
+      if (epoch_.load() == epoch) {
+        return ReadGuard(&counter, current_.load());
+      }
+      counter.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  // Publishes |next| and frees the previous value once no reader can still
+  // be using it. Returns only after the previous value is gone.
+  void Publish(std::unique_ptr<const T> next) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    const T* previous = current_.exchange(next.release());
+    const uint64_t epoch = epoch_.fetch_add(1);
+    WaitForReaders(epoch & 1);
+    delete previous;
+  }
+
+ private:
+  struct alignas(64) Shard {
+    Shard() {
+      readers[0].store(0, std::memory_order_relaxed);
+      readers[1].store(0, std::memory_order_relaxed);
+    }
+    std::atomic<int64_t> readers[2];
+  };
+
+  void WaitForReaders(uint64_t parity) const {
+    for (const Shard& shard : shards_) {
+      while (shard.readers[parity].load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  std::atomic<const T*> current_{nullptr};
+  std::atomic<uint64_t> epoch_{0};
+  // One pair of counters per thread shard so concurrent readers do not
+  // bounce a single cache line between cores.
+  mutable std::array<Shard, kThreadShards> shards_;
+  std::mutex writer_mutex_;
+};
+
+}  // namespace routine
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif  // ROUTINE_CORE_RCU_CELL_H_
@@ -0,0 +1,75 @@
+#include "core/rule_set.h"
+
+#include <utility>
+
+#include "core/path.h"
+
+namespace routine {
+
+RuleSet::Builder::Builder(const Options& options) {
+  source_.allow_list = options.allow_list;
+  source_.ignore_case = options.ignore_case;
+}
+
+RuleSet::Builder& RuleSet::Builder::AddApp(std::string_view path) {
+  source_.apps.emplace_back(path);
+  return *this;
+}
+
+RuleSet::Builder& RuleSet::Builder::AddDirectory(std::string_view path) {
+  source_.directories.emplace_back(path);
+  return *this;
+}
+
+RuleSet::Builder& RuleSet::Builder::AddExempt(std::string_view path) {
+  source_.exempt.emplace_back(path);
+  return *this;
+}
+
+RuleSet::Builder& RuleSet::Builder::AddSite(std::string_view domain) {
+  source_.sites.emplace_back(domain);
+  return *this;
+}
+
+std::unique_ptr<const RuleSet> RuleSet::Builder::Build() const {
+  return FromBlob(PolicyBlob::Compile(source_));
+}
+
+std::unique_ptr<const RuleSet> RuleSet::FromBlob(std::string blob) {
+  std::unique_ptr<RuleSet> rules(new RuleSet(std::move(blob)));
+  if (!rules->blob_.Open(rules->storage_)) {
+    return nullptr;
+  }
+  rules->options_.allow_list = rules->blob_.allow_list();
+  rules->options_.ignore_case = rules->blob_.ignore_case();
+  return rules;
+}
+
+RuleSet::RuleSet(std::string storage) : storage_(std::move(storage)) {}
+
+bool RuleSet::IsBlocked(std::string_view path) const {
+  return IsBlocked(path, HashPath(path, options_.ignore_case));
+}
+
+bool RuleSet::IsBlocked(std::string_view path, uint64_t path_hash) const {
+  return blob_.IsBlocked(path, path_hash);
+}
+
+bool RuleSet::Matches(std::string_view path) const {
+  return blob_.ContainsApp(path, HashPath(path, options_.ignore_case)) ||
+         blob_.InDirectories(path);
+}
+
+bool RuleSet::IsExempt(std::string_view path) const {
+  return blob_.IsExempt(path, HashPath(path, options_.ignore_case));
+}
+
+bool RuleSet::InDirectories(std::string_view path) const {
+  return blob_.InDirectories(path);
+}
+
+bool RuleSet::MatchesSite(std::string_view host) const {
+  return blob_.MatchesSite(host);
+}
+
+}  // namespace routine
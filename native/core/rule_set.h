@@ -0,0 +1,95 @@
+#ifndef ROUTINE_CORE_RULE_SET_H_
+#define ROUTINE_CORE_RULE_SET_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "core/policy_blob.h"
+
+namespace routine {
+
+// An immutable, precompiled set of application block rules.
+//
+// The rules live in a PolicyBlob: executable paths are matched against a
+// hashed table of exact paths and a path-component trie of directory
+// prefixes, so a lookup costs one pass over the path regardless of how many
+// rules exist. Builder compiles the blob once; FromBlob() adopts one
+// compiled elsewhere, e.g. read back from disk, without decoding it. A
+// RuleSet is never mutated, which lets any number of threads query it
+// without locking.
+class RuleSet {
+ public:
+  struct Options {
+    // The listed apps and directories are the only ones allowed; everything
+    // else is blocked.
+    bool allow_list = false;
+    // Compare paths ASCII case-insensitively, as Windows file systems do.
+    bool ignore_case = false;
+  };
+
+  class Builder {
+   public:
+    explicit Builder(const Options& options);
+
+    // Lists a single executable by its full path.
+    Builder& AddApp(std::string_view path);
+    // Lists every executable below |path|, matched by whole components.
+    Builder& AddDirectory(std::string_view path);
+    // Never blocks |path|, whatever the lists say (the shell, ourselves).
+    Builder& AddExempt(std::string_view path);
+    // Lists a domain and its subdomains, for the browser side of the policy.
+    Builder& AddSite(std::string_view domain);
+
+    std::unique_ptr<const RuleSet> Build() const;
+
+   private:
+    PolicyBlob::Source source_;
+  };
+
+  // Adopts the compiled |blob|. Returns null if it is damaged or from
+  // another version.
+  static std::unique_ptr<const RuleSet> FromBlob(std::string blob);
+
+  RuleSet(const RuleSet&) = delete;
+  RuleSet& operator=(const RuleSet&) = delete;
+
+  // Returns whether the executable at |path| should be blocked.
+  bool IsBlocked(std::string_view path) const;
+
+  // As above, reusing |path_hash|, which must equal
+  // HashPath(path, options().ignore_case).
+  bool IsBlocked(std::string_view path, uint64_t path_hash) const;
+
+  // Returns whether |path| is listed exactly or lies below a listed
+  // directory.
+  bool Matches(std::string_view path) const;
+
+  bool IsExempt(std::string_view path) const;
+
+  // Returns whether |path| lies below one of the listed directories.
+  bool InDirectories(std::string_view path) const;
+
+  // Returns whether |host| is a listed site or a subdomain of one.
+  bool MatchesSite(std::string_view host) const;
+
+  const Options& options() const { return options_; }
+  size_t app_count() const { return blob_.app_count(); }
+  size_t directory_count() const { return blob_.directory_count(); }
+  size_t site_count() const { return blob_.site_count(); }
+
+  // The compiled rules, to persist or hand to another process.
+  const PolicyBlob& blob() const { return blob_; }
+
+ private:
+  explicit RuleSet(std::string storage);
+
+  const std::string storage_;
+  PolicyBlob blob_;
+  Options options_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_RULE_SET_H_
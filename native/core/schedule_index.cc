@@ -0,0 +1,255 @@
+#include "core/schedule_index.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <algorithm>
+#include <utility>
+
+namespace routine {
+
+namespace {
+
+constexpr int32_t kMinutesPerDay = 24 * 60;
+constexpr int32_t kMinutesPerWeek = 7 * kMinutesPerDay;
+constexpr int64_t kSecondsPerDay = 24 * 3600;
+constexpr int64_t kSecondsPerWeek = 7 * kSecondsPerDay;
+// 1970-01-01 was a Thursday, day 3 of a week starting on Monday.
+constexpr int64_t kEpochWeekday = 3;
+
+// Seconds since Monday 00:00 of the week holding the local time |local|.
+int64_t SecondOfWeek(int64_t local) {
+  const int64_t shifted = local + kEpochWeekday * kSecondsPerDay;
+  const int64_t second = shifted % kSecondsPerWeek;
+  return second < 0 ? second + kSecondsPerWeek : second;
+}
+
+// |value| must not be zero.
+uint32_t CountTrailingZeros(uint64_t value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return index;
+#else
+  return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+using Span = std::pair<int32_t, int32_t>;
+
+// The minute-of-week intervals |routine| is scheduled in, sorted, merged
+// where they touch and cut at the end of the week.
+std::vector<Span> WeeklySpans(const RoutineSchedule& routine) {
+  const bool all_day = routine.start_minute == -1 && routine.end_minute == -1;
+  if (!all_day &&
+      (routine.start_minute < 0 || routine.start_minute > kMinutesPerDay ||
+       routine.end_minute < 0 || routine.end_minute > kMinutesPerDay)) {
+    return {};
+  }
+
+  std::vector<Span> spans;
+  for (int day = 0; day < 7; ++day) {
+    if ((routine.days & (1 << day)) == 0) {
+      continue;
+    }
+    const int32_t midnight = day * kMinutesPerDay;
+    int32_t start;
+    int32_t end;
+    if (all_day) {
+      start = midnight;
+      end = midnight + kMinutesPerDay;
+    } else if (routine.start_minute < routine.end_minute) {
+      start = midnight + routine.start_minute;
+      end = midnight + routine.end_minute;
+    } else if (routine.start_minute > routine.end_minute) {
+      // Overnight, into the next day.
+      start = midnight + routine.start_minute;
+      end = midnight + kMinutesPerDay + routine.end_minute;
+    } else {
+      continue;
+    }
+    if (start >= end) {
+      // 24:00 to 00:00, which never blocks.
+      continue;
+    }
+    if (end <= kMinutesPerWeek) {
+      spans.emplace_back(start, end);
+    } else {
+      // Sunday night runs into Monday morning.
+      if (start < kMinutesPerWeek) {
+        spans.emplace_back(start, kMinutesPerWeek);
+      }
+      spans.emplace_back(std::max(start - kMinutesPerWeek, 0),
+                         end - kMinutesPerWeek);
+    }
+  }
+
+  std::sort(spans.begin(), spans.end());
+  std::vector<Span> merged;
+  for (const Span& span : spans) {
+    if (!merged.empty() && span.first <= merged.back().second) {
+      merged.back().second = std::max(merged.back().second, span.second);
+    } else {
+      merged.push_back(span);
+    }
+  }
+  return merged;
+}
+
+}  // namespace
+
+ScheduleIndex::ScheduleIndex(const std::vector<RoutineSchedule>& routines) {
+  std::vector<Interval> intervals;
+  off_until_.reserve(routines.size());
+  for (uint32_t i = 0; i < routines.size(); ++i) {
+    const RoutineSchedule& routine = routines[i];
+    const int64_t off_until =
+        std::max(routine.paused_until, routine.snoozed_until);
+    off_until_.push_back(off_until);
+    if (off_until > 0) {
+      off_ends_.push_back(off_until);
+    }
+
+    const std::vector<Span> spans = WeeklySpans(routine);
+    if (spans.empty()) {
+      continue;
+    }
+    if (spans.size() == 1 && spans[0] == Span(0, kMinutesPerWeek)) {
+      always_.push_back(i);
+      continue;
+    }
+    // A span ending at the end of the week continues into one starting at
+    // its beginning; the week boundary between them is no transition.
+    const bool wraps =
+        spans.front().first == 0 && spans.back().second == kMinutesPerWeek;
+    for (const Span& span : spans) {
+      intervals.push_back(Interval{span.first, span.second, i});
+      if (!wraps || span.first != 0) {
+        transitions_.push_back(span.first);
+      }
+      if (!wraps || span.second != kMinutesPerWeek) {
+        transitions_.push_back(span.second % kMinutesPerWeek);
+      }
+    }
+  }
+  std::sort(transitions_.begin(), transitions_.end());
+  transitions_.erase(std::unique(transitions_.begin(), transitions_.end()),
+                     transitions_.end());
+  std::sort(off_ends_.begin(), off_ends_.end());
+
+  bounds_ = {0, kMinutesPerWeek};
+  for (const Interval& interval : intervals) {
+    bounds_.push_back(interval.start);
+    bounds_.push_back(interval.end);
+  }
+  std::sort(bounds_.begin(), bounds_.end());
+  bounds_.erase(std::unique(bounds_.begin(), bounds_.end()), bounds_.end());
+
+  const size_t segments = bounds_.size() - 1;
+  std::vector<std::vector<uint32_t>> lists(4 * segments);
+  for (const Interval& interval : intervals) {
+    Insert(1, 0, segments, interval, &lists);
+  }
+  offsets_.reserve(lists.size() + 1);
+  for (const auto& list : lists) {
+    offsets_.push_back(static_cast<uint32_t>(routines_.size()));
+    routines_.insert(routines_.end(), list.begin(), list.end());
+  }
+  offsets_.push_back(static_cast<uint32_t>(routines_.size()));
+}
+
+void ScheduleIndex::Insert(size_t node, size_t low, size_t high,
+                           const Interval& interval,
+                           std::vector<std::vector<uint32_t>>* lists) const {
+  if (interval.start <= bounds_[low] && bounds_[high] <= interval.end) {
+    (*lists)[node].push_back(interval.routine);
+    return;
+  }
+  const size_t mid = low + (high - low) / 2;
+  if (interval.start < bounds_[mid]) {
+    Insert(2 * node, low, mid, interval, lists);
+  }
+  if (bounds_[mid] < interval.end) {
+    Insert(2 * node + 1, mid, high, interval, lists);
+  }
+}
+
+std::vector<uint32_t> ScheduleIndex::ActiveAt(int64_t utc,
+                                              const TimeZone& zone) const {
+  const int32_t minute =
+      static_cast<int32_t>(SecondOfWeek(zone.ToLocal(utc)) / 60);
+  const size_t segment =
+      std::upper_bound(bounds_.begin(), bounds_.end(), minute) -
+      bounds_.begin() - 1;
+
+  // A routine turns up at most once along the path, but in no order; a
+  // bitmap puts the answer in order in O(active + routines / 64).
+  std::vector<uint64_t> bits((off_until_.size() + 63) / 64);
+  auto mark = [&bits](uint32_t routine) {
+    bits[routine / 64] |= uint64_t{1} << (routine % 64);
+  };
+  for (const uint32_t routine : always_) {
+    mark(routine);
+  }
+  size_t node = 1;
+  size_t low = 0;
+  size_t high = bounds_.size() - 1;
+  for (;;) {
+    for (uint32_t i = offsets_[node]; i < offsets_[node + 1]; ++i) {
+      mark(routines_[i]);
+    }
+    if (high - low == 1) {
+      break;
+    }
+    const size_t mid = low + (high - low) / 2;
+    if (segment < mid) {
+      node = 2 * node;
+      high = mid;
+    } else {
+      node = 2 * node + 1;
+      low = mid;
+    }
+  }
+
+  std::vector<uint32_t> active;
+  for (size_t word = 0; word < bits.size(); ++word) {
+    for (uint64_t set = bits[word]; set != 0; set &= set - 1) {
+      const uint32_t routine =
+          static_cast<uint32_t>(word * 64 + CountTrailingZeros(set));
+      if (off_until_[routine] <= utc) {
+        active.push_back(routine);
+      }
+    }
+  }
+  return active;
+}
+
+int64_t ScheduleIndex::NextTransition(int64_t utc,
+                                      const TimeZone& zone) const {
+  int64_t next = kNever;
+  const auto off_end =
+      std::upper_bound(off_ends_.begin(), off_ends_.end(), utc);
+  if (off_end != off_ends_.end()) {
+    next = *off_end;
+  }
+  if (transitions_.empty()) {
+    return next;
+  }
+
+  const int64_t second = SecondOfWeek(zone.ToLocal(utc));
+  const auto transition =
+      std::upper_bound(transitions_.begin(), transitions_.end(),
+                       static_cast<int32_t>(second / 60));
+  const int64_t target =
+      transition != transitions_.end()
+          ? int64_t{*transition} * 60
+          : (int64_t{transitions_.front()} + kMinutesPerWeek) * 60;
+  // Exact while the offset holds; if it changes first, the wall clock jumps
+  // and the caller asks again from there.
+  const int64_t boundary = utc + (target - second);
+  next = std::min(next, boundary);
+  return std::min(next, zone.NextOffsetChange(utc, next - 1));
+}
+
+}  // namespace routine
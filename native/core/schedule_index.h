@@ -0,0 +1,91 @@
+#ifndef ROUTINE_CORE_SCHEDULE_INDEX_H_
+#define ROUTINE_CORE_SCHEDULE_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "core/time_zone.h"
+
+namespace routine {
+
+// When one routine blocks, as the app's Routine model describes it.
+struct RoutineSchedule {
+  // Bit 0 is Monday, bit 6 Sunday.
+  uint8_t days = 0x7f;
+  // Minutes after local midnight, 0 to 1440. Both -1 means all day. A start
+  // after the end spans midnight and belongs to the day it starts on; equal
+  // times never block.
+  int32_t start_minute = -1;
+  int32_t end_minute = -1;
+  // UTC seconds; the routine is off before either (a break or a snooze).
+  int64_t paused_until = 0;
+  int64_t snoozed_until = 0;
+};
+
+// Every routine's weekly schedule compiled into one interval index, so the
+// app can ask which routines are on at an instant and when that next
+// changes instead of re-walking every routine on a timer per start and end
+// minute.
+//
+// Schedules are in local wall-clock time, so a routine follows the clock
+// across daylight saving changes the way the app's Routine.isActive does:
+// on a spring-forward night a routine starting in the skipped hour is on
+// from the jump, and on a fall-back night times in the repeated hour
+// happen twice.
+//
+// Each routine's days are unrolled into minute-of-week intervals, merged
+// where they touch (Monday and Tuesday all day is one interval, with no
+// transition at Tuesday midnight), and stored in a segment tree over the
+// elementary intervals between all boundaries. ActiveAt() is a stabbing
+// query, O(log n + active) plus n / 64 words to put the answer in order;
+// NextTransition() is a binary search over the sorted boundaries and
+// pause/snooze ends, O(log n), plus a look for a UTC offset change up to
+// that point.
+class ScheduleIndex {
+ public:
+  static constexpr int64_t kNever = std::numeric_limits<int64_t>::max();
+
+  explicit ScheduleIndex(const std::vector<RoutineSchedule>& routines);
+
+  // Indexes into the routines passed in, ascending, of those on at |utc|.
+  std::vector<uint32_t> ActiveAt(int64_t utc, const TimeZone& zone) const;
+
+  // The first instant after |utc| at which ActiveAt() may differ: a routine
+  // starts or ends, a pause or snooze runs out, or the zone's offset
+  // changes while some routine has a schedule. kNever if nothing ever
+  // changes.
+  int64_t NextTransition(int64_t utc, const TimeZone& zone) const;
+
+  size_t routine_count() const { return off_until_.size(); }
+
+ private:
+  struct Interval {
+    int32_t start;
+    int32_t end;
+    uint32_t routine;
+  };
+
+  void Insert(size_t node, size_t low, size_t high, const Interval& interval,
+              std::vector<std::vector<uint32_t>>* lists) const;
+
+  // Elementary interval bounds in minutes of the week, 0 first and 10080
+  // last.
+  std::vector<int32_t> bounds_;
+  // Segment tree over the elementary intervals, node lists flattened: the
+  // routines of node i are routines_[offsets_[i], offsets_[i + 1]).
+  std::vector<uint32_t> offsets_;
+  std::vector<uint32_t> routines_;
+  std::vector<uint32_t> always_;
+  // Minutes of the week at which some routine starts or ends, sorted.
+  std::vector<int32_t> transitions_;
+  // Per routine, the later of its pause and snooze ends.
+  std::vector<int64_t> off_until_;
+  // Those ends, sorted.
+  std::vector<int64_t> off_ends_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_SCHEDULE_INDEX_H_
@@ -0,0 +1,68 @@
+#ifndef ROUTINE_CORE_SHARDED_COUNTER_H_
+#define ROUTINE_CORE_SHARDED_COUNTER_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+// Padding each shard to a cache line is the point.
+#pragma warning(disable : 4324)
+#endif
+
+namespace routine {
+
+constexpr size_t kThreadShards = 16;
+
+// Stable per-thread index in [0, kThreadShards), handed out round robin so
+// that hot per-thread state lands on different cache lines.
+inline size_t ThreadShardIndex() {
+  static std::atomic<size_t> next_index{0};
+  thread_local const size_t index =
+      next_index.fetch_add(1, std::memory_order_relaxed) % kThreadShards;
+  return index;
+}
+
+// A statistics counter that many threads bump without contending on one
+// cache line. Reads sum the shards and are only eventually consistent.
+class ShardedCounter {
+ public:
+  ShardedCounter() {
+    for (auto& shard : shards_) {
+      shard.value.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  ShardedCounter(const ShardedCounter&) = delete;
+  ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+  void Add(uint64_t delta = 1) {
+    shards_[ThreadShardIndex()].value.fetch_add(delta,
+                                                std::memory_order_relaxed);
+  }
+
+  uint64_t Load() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+      total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value;
+  };
+
+  std::array<Shard, kThreadShards> shards_;
+};
+
+}  // namespace routine
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif  // ROUTINE_CORE_SHARDED_COUNTER_H_
@@ -0,0 +1,55 @@
+#include "core/time_zone.h"
+
+#include <ctime>
+
+namespace routine {
+
+namespace {
+
+constexpr int64_t kProbeStep = 3 * 3600;
+
+}  // namespace
+
+int32_t SystemTimeZone::OffsetAt(int64_t utc) const {
+  const std::time_t time = static_cast<std::time_t>(utc);
+  std::tm local;
+#ifdef _WIN32
+  if (localtime_s(&local, &time) != 0) {
+    return 0;
+  }
+  // Reading the local fields back as UTC leaves the offset.
+  return static_cast<int32_t>(_mkgmtime(&local) - time);
+#else
+  if (localtime_r(&time, &local) == nullptr) {
+    return 0;
+  }
+  return static_cast<int32_t>(local.tm_gmtoff);
+#endif
+}
+
+int64_t SystemTimeZone::NextOffsetChange(int64_t utc, int64_t limit) const {
+  const int32_t offset = OffsetAt(utc);
+  int64_t before = utc;
+  while (before < limit) {
+    const int64_t probe = before + kProbeStep < limit ? before + kProbeStep
+                                                      : limit;
+    if (OffsetAt(probe) == offset) {
+      before = probe;
+      continue;
+    }
+    // The change is in (before, probe].
+    int64_t after = probe;
+    while (after - before > 1) {
+      const int64_t mid = before + (after - before) / 2;
+      if (OffsetAt(mid) == offset) {
+        before = mid;
+      } else {
+        after = mid;
+      }
+    }
+    return after;
+  }
+  return limit + 1;
+}
+
+}  // namespace routine
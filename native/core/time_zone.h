@@ -0,0 +1,48 @@
+#ifndef ROUTINE_CORE_TIME_ZONE_H_
+#define ROUTINE_CORE_TIME_ZONE_H_
+
+#include <cstdint>
+
+namespace routine {
+
+// Maps UTC instants to local wall-clock time. Times are seconds since the
+// Unix epoch.
+class TimeZone {
+ public:
+  virtual ~TimeZone() = default;
+
+  // Seconds east of UTC in effect at |utc|.
+  virtual int32_t OffsetAt(int64_t utc) const = 0;
+
+  // The first instant in (utc, limit] at which the offset differs from the
+  // one at |utc|, or |limit| + 1 if there is none.
+  virtual int64_t NextOffsetChange(int64_t utc, int64_t limit) const = 0;
+
+  int64_t ToLocal(int64_t utc) const { return utc + OffsetAt(utc); }
+};
+
+class FixedOffsetTimeZone : public TimeZone {
+ public:
+  explicit FixedOffsetTimeZone(int32_t offset) : offset_(offset) {}
+
+  int32_t OffsetAt(int64_t utc) const override { return offset_; }
+  int64_t NextOffsetChange(int64_t utc, int64_t limit) const override {
+    return limit + 1;
+  }
+
+ private:
+  const int32_t offset_;
+};
+
+// The zone the C library uses for local time, daylight saving included.
+class SystemTimeZone : public TimeZone {
+ public:
+  int32_t OffsetAt(int64_t utc) const override;
+  // Probes every few hours and bisects to the second, so a change is found
+  // as long as changes are hours apart, as they are in every real zone.
+  int64_t NextOffsetChange(int64_t utc, int64_t limit) const override;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_TIME_ZONE_H_
@@ -0,0 +1,415 @@
+#include "core/usage_tracker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+#include "core/mapped_file.h"
+#include "core/path.h"
+
+namespace routine {
+
+namespace {
+
+// File layout, in native byte order (the file never leaves the machine):
+//
+//   header:  "RTUS" u32 version
+//   block:   u32 rows  u32 names  u32 body_size  u32 checksum  body
+//   body:    i32 days[rows]  u32 apps[rows]  u32 ms[rows]
+//            (u16 length, name)[names]
+//
+// Apps are numbered in the order their names appear in the file, and a
+// block may use the names it carries.
+constexpr char kMagic[4] = {'R', 'T', 'U', 'S'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kFileHeaderSize = 8;
+constexpr size_t kBlockHeaderSize = 16;
+constexpr size_t kRowSize = 12;
+
+// Superseded rows tolerated before the file is rewritten on open.
+constexpr size_t kMinSupersededForCompaction = 256;
+
+constexpr int64_t kDayMs = 86400000;
+
+template <typename T>
+T LoadValue(const uint8_t* bytes) {
+  T value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+template <typename T>
+void StoreValue(std::vector<uint8_t>* out, T value) {
+  const size_t offset = out->size();
+  out->resize(offset + sizeof(value));
+  std::memcpy(out->data() + offset, &value, sizeof(value));
+}
+
+uint32_t Checksum(const uint8_t* body, size_t size) {
+  return static_cast<uint32_t>(HashBytes(
+      std::string_view(reinterpret_cast<const char*>(body), size), false));
+}
+
+int64_t FloorDiv(int64_t value, int64_t divisor) {
+  return value / divisor - (value % divisor < 0 ? 1 : 0);
+}
+
+}  // namespace
+
+UsageTracker::UsageTracker(Options options, const TimeZone* zone)
+    : options_(std::move(options)), zone_(zone) {
+  ring_.reserve(options_.ring_capacity);
+  std::lock_guard<std::mutex> lock(mutex_);
+  Load();
+}
+
+UsageTracker::~UsageTracker() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  FlushLocked(last_flush_ms_);
+  if (file_ != nullptr) {
+    std::fclose(file_);
+  }
+}
+
+bool UsageTracker::Focus(const std::string& exe, int64_t now_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Account(now_ms);
+  const uint32_t app = exe.empty() ? kNone : Intern(exe);
+  if (app != focused_) {
+    if (focused_ != kNone && now_ms > focus_start_ms_ &&
+        options_.ring_capacity > 0) {
+      Entry entry;
+      entry.start_ms = focus_start_ms_;
+      entry.duration_ms = static_cast<uint32_t>(
+          std::min<int64_t>(now_ms - focus_start_ms_, UINT32_MAX));
+      entry.app = focused_;
+      if (ring_.size() < options_.ring_capacity) {
+        ring_.push_back(entry);
+      } else {
+        ring_[ring_next_] = entry;
+      }
+      ring_next_ = (ring_next_ + 1) % options_.ring_capacity;
+    }
+    focused_ = app;
+    focus_start_ms_ = now_ms;
+    counted_ms_ = now_ms;
+  }
+  return app != kNone && OverBudget(app, now_ms);
+}
+
+bool UsageTracker::Tick(int64_t now_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Account(now_ms);
+  if (now_ms - last_flush_ms_ >= options_.flush_interval_ms) {
+    FlushLocked(now_ms);
+  }
+  return focused_ != kNone && OverBudget(focused_, now_ms);
+}
+
+bool UsageTracker::Flush(int64_t now_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Account(now_ms);
+  return FlushLocked(now_ms);
+}
+
+void UsageTracker::SetBudgets(
+    const std::vector<std::pair<std::string, int64_t>>& minutes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  budgets_ms_.clear();
+  for (const auto& [exe, budget] : minutes) {
+    if (!exe.empty()) {
+      budgets_ms_[Intern(exe)] = std::max<int64_t>(budget, 0) * 60000;
+    }
+  }
+}
+
+int64_t UsageTracker::Remaining(const std::string& exe,
+                                int64_t now_ms) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto id = ids_.find(exe);
+  if (id == ids_.end()) {
+    return -1;
+  }
+  auto budget = budgets_ms_.find(id->second);
+  if (budget == budgets_ms_.end()) {
+    return -1;
+  }
+  return std::max<int64_t>(budget->second - UsedToday(id->second, now_ms), 0);
+}
+
+std::vector<std::pair<std::string, int64_t>> UsageTracker::RemainingAll(
+    int64_t now_ms) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::pair<std::string, int64_t>> remaining;
+  for (const auto& [app, budget] : budgets_ms_) {
+    remaining.emplace_back(
+        names_[app], std::max<int64_t>(budget - UsedToday(app, now_ms), 0));
+  }
+  std::sort(remaining.begin(), remaining.end());
+  return remaining;
+}
+
+UsageTracker::Totals UsageTracker::Query(int64_t first_day, int64_t last_day,
+                                         int64_t now_ms) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unordered_map<uint64_t, int64_t> selected;
+  for (const auto& [key, ms] : totals_) {
+    const int64_t day = static_cast<int64_t>(key >> 32);
+    if (day >= first_day && day <= last_day) {
+      selected[key] += ms;
+    }
+  }
+  if (focused_ != kNone) {
+    SplitByDay(counted_ms_, now_ms, [&](int64_t day, int64_t ms) {
+      if (day >= first_day && day <= last_day) {
+        selected[Key(day, focused_)] += ms;
+      }
+    });
+  }
+
+  std::vector<std::tuple<int64_t, const std::string*, int64_t>> rows;
+  rows.reserve(selected.size());
+  for (const auto& [key, ms] : selected) {
+    rows.emplace_back(static_cast<int64_t>(key >> 32),
+                      &names_[static_cast<uint32_t>(key)], ms);
+  }
+  std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+    return std::get<0>(a) != std::get<0>(b)
+               ? std::get<0>(a) < std::get<0>(b)
+               : *std::get<1>(a) < *std::get<1>(b);
+  });
+
+  Totals totals;
+  totals.days.reserve(rows.size());
+  totals.apps.reserve(rows.size());
+  totals.ms.reserve(rows.size());
+  for (const auto& [day, app, ms] : rows) {
+    totals.days.push_back(day);
+    totals.apps.push_back(*app);
+    totals.ms.push_back(ms);
+  }
+  return totals;
+}
+
+std::vector<UsageTracker::Interval> UsageTracker::Recent() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<Interval> intervals;
+  intervals.reserve(ring_.size());
+  // Once the ring is full, the oldest entry is the next to be replaced.
+  const size_t first = ring_.size() < options_.ring_capacity ? 0 : ring_next_;
+  for (size_t i = 0; i < ring_.size(); ++i) {
+    const Entry& entry = ring_[(first + i) % ring_.size()];
+    intervals.push_back(
+        Interval{names_[entry.app], entry.start_ms, entry.duration_ms});
+  }
+  return intervals;
+}
+
+int64_t UsageTracker::LocalDay(int64_t utc_ms) const {
+  const int64_t utc = FloorDiv(utc_ms, 1000);
+  return FloorDiv(utc + zone_->OffsetAt(utc), 86400);
+}
+
+int64_t UsageTracker::DayStart(int64_t day) const {
+  // The offset is looked up at an estimate of midnight, which is off only
+  // when the offset changes within hours of it.
+  const int64_t local = day * 86400;
+  const int64_t guess = local - zone_->OffsetAt(local);
+  return (local - zone_->OffsetAt(guess)) * 1000;
+}
+
+uint32_t UsageTracker::Intern(const std::string& exe) {
+  auto [it, inserted] =
+      ids_.try_emplace(exe, static_cast<uint32_t>(names_.size()));
+  if (inserted) {
+    names_.push_back(exe);
+  }
+  return it->second;
+}
+
+void UsageTracker::Account(int64_t now_ms) {
+  if (focused_ == kNone || now_ms <= counted_ms_) {
+    return;
+  }
+  SplitByDay(counted_ms_, now_ms, [&](int64_t day, int64_t ms) {
+    const uint64_t key = Key(day, focused_);
+    uint32_t& total = totals_[key];
+    total = static_cast<uint32_t>(std::min<int64_t>(total + ms, kDayMs));
+    dirty_.insert(key);
+  });
+  counted_ms_ = now_ms;
+}
+
+template <typename Add>
+void UsageTracker::SplitByDay(int64_t from_ms, int64_t to_ms, Add add) const {
+  while (from_ms < to_ms) {
+    const int64_t day = LocalDay(from_ms);
+    int64_t end = DayStart(day + 1);
+    if (end <= from_ms || end > to_ms) {
+      end = to_ms;
+    }
+    add(day, end - from_ms);
+    from_ms = end;
+  }
+}
+
+int64_t UsageTracker::UsedToday(uint32_t app, int64_t now_ms) const {
+  const int64_t today = LocalDay(now_ms);
+  auto total = totals_.find(Key(today, app));
+  int64_t used = total != totals_.end() ? total->second : 0;
+  if (app == focused_ && now_ms > counted_ms_) {
+    used += now_ms - std::max(counted_ms_, DayStart(today));
+  }
+  return used;
+}
+
+bool UsageTracker::OverBudget(uint32_t app, int64_t now_ms) const {
+  auto budget = budgets_ms_.find(app);
+  return budget != budgets_ms_.end() &&
+         UsedToday(app, now_ms) >= budget->second;
+}
+
+void UsageTracker::Load() {
+  if (options_.path.empty()) {
+    return;
+  }
+
+  bool rewrite = true;
+  MappedFile mapped;
+  if (mapped.Open(options_.path) && mapped.size() >= kFileHeaderSize &&
+      std::memcmp(mapped.data(), kMagic, sizeof(kMagic)) == 0 &&
+      LoadValue<uint32_t>(mapped.data() + 4) == kVersion) {
+    size_t offset = kFileHeaderSize;
+    while (mapped.size() - offset >= kBlockHeaderSize) {
+      const uint8_t* block = mapped.data() + offset;
+      const uint32_t rows = LoadValue<uint32_t>(block);
+      const uint32_t names = LoadValue<uint32_t>(block + 4);
+      const uint32_t body_size = LoadValue<uint32_t>(block + 8);
+      const uint8_t* body = block + kBlockHeaderSize;
+      if (body_size > mapped.size() - offset - kBlockHeaderSize ||
+          static_cast<uint64_t>(rows) * kRowSize > body_size ||
+          LoadValue<uint32_t>(block + 12) != Checksum(body, body_size)) {
+        break;
+      }
+
+      // Names first: the rows may use them.
+      const uint8_t* name = body + static_cast<size_t>(rows) * kRowSize;
+      const uint8_t* end = body + body_size;
+      bool valid = true;
+      for (uint32_t i = 0; i < names && valid; ++i) {
+        valid = end - name >= 2 && end - name - 2 >= LoadValue<uint16_t>(name);
+        if (valid) {
+          const uint16_t length = LoadValue<uint16_t>(name);
+          Intern(std::string(reinterpret_cast<const char*>(name + 2), length));
+          name += 2 + length;
+        }
+      }
+      for (uint32_t row = 0; row < rows && valid; ++row) {
+        const int32_t day = LoadValue<int32_t>(body + 4 * row);
+        const uint32_t app = LoadValue<uint32_t>(body + 4 * (rows + row));
+        const uint32_t ms = LoadValue<uint32_t>(body + 4 * (2 * rows + row));
+        valid = app < names_.size();
+        if (valid) {
+          totals_[Key(day, app)] = ms;
+        }
+      }
+      if (!valid) {
+        break;
+      }
+      file_rows_ += rows;
+      offset += kBlockHeaderSize + body_size;
+    }
+    // A torn tail would hide everything appended after it.
+    const size_t superseded = file_rows_ - std::min(file_rows_, totals_.size());
+    rewrite = offset != mapped.size() ||
+              (superseded >= kMinSupersededForCompaction &&
+               superseded > totals_.size());
+  }
+  mapped.Close();
+  flushed_names_ = names_.size();
+
+  // Appending to a file without a valid header would lose every block, so
+  // persistence is off for this session if the rewrite fails.
+  if (!rewrite || Compact()) {
+    file_ = OpenFile(options_.path, "ab");
+  }
+}
+
+bool UsageTracker::Compact() {
+  std::vector<uint64_t> keys;
+  keys.reserve(totals_.size());
+  for (const auto& [key, ms] : totals_) {
+    keys.push_back(key);
+  }
+  const std::string temp = options_.path + ".tmp";
+  std::FILE* file = OpenFile(temp, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  bool ok = std::fwrite(kMagic, 1, sizeof(kMagic), file) == sizeof(kMagic) &&
+            std::fwrite(&kVersion, sizeof(kVersion), 1, file) == 1;
+  if (!names_.empty()) {
+    const std::vector<uint8_t> block = EncodeBlock(keys, 0);
+    ok = ok && std::fwrite(block.data(), 1, block.size(), file) == block.size();
+  }
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok || !ReplaceFile(temp, options_.path)) {
+    return false;
+  }
+  file_rows_ = keys.size();
+  flushed_names_ = names_.size();
+  dirty_.clear();
+  return true;
+}
+
+bool UsageTracker::FlushLocked(int64_t now_ms) {
+  last_flush_ms_ = now_ms;
+  if (file_ == nullptr) {
+    return options_.path.empty();
+  }
+  if (dirty_.empty() && flushed_names_ == names_.size()) {
+    return true;
+  }
+  const std::vector<uint8_t> block =
+      EncodeBlock(std::vector<uint64_t>(dirty_.begin(), dirty_.end()),
+                  flushed_names_);
+  if (std::fwrite(block.data(), 1, block.size(), file_) != block.size() ||
+      std::fflush(file_) != 0) {
+    return false;
+  }
+  file_rows_ += dirty_.size();
+  flushed_names_ = names_.size();
+  dirty_.clear();
+  return true;
+}
+
+std::vector<uint8_t> UsageTracker::EncodeBlock(
+    const std::vector<uint64_t>& keys, size_t first_name) const {
+  std::vector<uint8_t> block(kBlockHeaderSize);
+  for (const uint64_t key : keys) {
+    StoreValue(&block, static_cast<int32_t>(key >> 32));
+  }
+  for (const uint64_t key : keys) {
+    StoreValue(&block, static_cast<uint32_t>(key));
+  }
+  for (const uint64_t key : keys) {
+    StoreValue(&block, totals_.at(key));
+  }
+  for (size_t i = first_name; i < names_.size(); ++i) {
+    const std::string_view name =
+        std::string_view(names_[i]).substr(0, UINT16_MAX);
+    StoreValue(&block, static_cast<uint16_t>(name.size()));
+    block.insert(block.end(), name.begin(), name.end());
+  }
+
+  const uint32_t header[4] = {
+      static_cast<uint32_t>(keys.size()),
+      static_cast<uint32_t>(names_.size() - first_name),
+      static_cast<uint32_t>(block.size() - kBlockHeaderSize),
+      Checksum(block.data() + kBlockHeaderSize,
+               block.size() - kBlockHeaderSize)};
+  std::memcpy(block.data(), header, sizeof(header));
+  return block;
+}
+
+}  // namespace routine
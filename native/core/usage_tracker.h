@@ -0,0 +1,159 @@
+#ifndef ROUTINE_CORE_USAGE_TRACKER_H_
+#define ROUTINE_CORE_USAGE_TRACKER_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "core/time_zone.h"
+
+namespace routine {
+
+// Foreground time per application, kept from focus changes, with daily
+// budgets enforced natively.
+//
+// Each focus interval goes into a fixed ring of the most recent ones and is
+// added to per-day, per-app counters, split at local midnight. The counters
+// are persisted to an append-only file of columnar blocks: a flush appends
+// the totals that changed since the last one as day, app and time columns,
+// with the names of apps first seen since, and loading replays the blocks,
+// later totals replacing earlier ones. A torn trailing block from a crash
+// is dropped, and the file is rewritten as a single block once superseded
+// rows outnumber live ones.
+//
+// A budget caps an app's foreground time per local day. Focus() and Tick()
+// answer whether the focused app has used its budget up, so the runner can
+// minimise it from its own poll timer.
+//
+// Times are milliseconds since the Unix epoch; days are local days since
+// 1970-01-01. Thread-safe.
+class UsageTracker {
+ public:
+  struct Options {
+    // Empty keeps usage in memory only.
+    std::string path;
+    // Focus intervals kept for Recent().
+    size_t ring_capacity = 1024;
+    // How often Tick() appends the changed counters to |path|.
+    int64_t flush_interval_ms = 60000;
+  };
+
+  struct Interval {
+    std::string app;
+    int64_t start_ms = 0;
+    int64_t duration_ms = 0;
+  };
+
+  // Foreground time by day and app, one row each, as columns.
+  struct Totals {
+    std::vector<int64_t> days;
+    std::vector<std::string> apps;
+    std::vector<int64_t> ms;
+  };
+
+  // |zone| must outlive the tracker.
+  UsageTracker(Options options, const TimeZone* zone);
+  // Flushes what was counted so far.
+  ~UsageTracker();
+
+  UsageTracker(const UsageTracker&) = delete;
+  UsageTracker& operator=(const UsageTracker&) = delete;
+
+  // |exe| took focus at |now_ms|; empty when nothing, or nothing readable,
+  // has focus. Ends the running interval unless |exe| already had focus.
+  // Returns whether |exe| has used up its budget for today.
+  bool Focus(const std::string& exe, int64_t now_ms);
+
+  // Counts the focused app's time up to |now_ms| and flushes if the flush
+  // interval has passed. Returns whether the focused app has used up its
+  // budget, for the runner to refocus it. Call from the poll timer.
+  bool Tick(int64_t now_ms);
+
+  // Counts up to |now_ms| and appends the changed counters to the file.
+  // Returns false if the file cannot be written.
+  bool Flush(int64_t now_ms);
+
+  // Replaces the budgets, in minutes per day by executable.
+  void SetBudgets(const std::vector<std::pair<std::string, int64_t>>& minutes);
+
+  // Milliseconds |exe| has left today, or -1 if it has no budget.
+  int64_t Remaining(const std::string& exe, int64_t now_ms) const;
+  // Remaining() for every app with a budget.
+  std::vector<std::pair<std::string, int64_t>> RemainingAll(
+      int64_t now_ms) const;
+
+  // Totals for the days in [first_day, last_day], the running interval
+  // included, ordered by day and then app.
+  Totals Query(int64_t first_day, int64_t last_day, int64_t now_ms) const;
+
+  // The last focus intervals, oldest first.
+  std::vector<Interval> Recent() const;
+
+  // The local day |utc_ms| falls on, and the instant that day starts.
+  int64_t LocalDay(int64_t utc_ms) const;
+  int64_t DayStart(int64_t day) const;
+
+ private:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  // 16 bytes, so the ring stays small however long it runs.
+  struct Entry {
+    int64_t start_ms = 0;
+    uint32_t duration_ms = 0;
+    uint32_t app = 0;
+  };
+
+  static uint64_t Key(int64_t day, uint32_t app) {
+    return (static_cast<uint64_t>(day) << 32) | app;
+  }
+
+  uint32_t Intern(const std::string& exe);
+  // Adds the focused app's time since it was last counted.
+  void Account(int64_t now_ms);
+  // Calls |add(day, ms)| for each local day [from_ms, to_ms) touches.
+  template <typename Add>
+  void SplitByDay(int64_t from_ms, int64_t to_ms, Add add) const;
+  int64_t UsedToday(uint32_t app, int64_t now_ms) const;
+  bool OverBudget(uint32_t app, int64_t now_ms) const;
+
+  void Load();
+  // Rewrites the file as one block of every total.
+  bool Compact();
+  bool FlushLocked(int64_t now_ms);
+  // A block of the totals under |keys| and the names from |first_name| on.
+  std::vector<uint8_t> EncodeBlock(const std::vector<uint64_t>& keys,
+                                   size_t first_name) const;
+
+  const Options options_;
+  const TimeZone* const zone_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, uint32_t> ids_;
+  std::vector<Entry> ring_;
+  size_t ring_next_ = 0;
+  // Milliseconds by Key().
+  std::unordered_map<uint64_t, uint32_t> totals_;
+  std::unordered_map<uint32_t, int64_t> budgets_ms_;
+
+  uint32_t focused_ = kNone;
+  int64_t focus_start_ms_ = 0;
+  // Up to where the focused app's time is in |totals_|.
+  int64_t counted_ms_ = 0;
+
+  std::FILE* file_ = nullptr;
+  // Totals and names changed since the last flush.
+  std::unordered_set<uint64_t> dirty_;
+  size_t flushed_names_ = 0;
+  size_t file_rows_ = 0;
+  int64_t last_flush_ms_ = 0;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_USAGE_TRACKER_H_
@@ -0,0 +1,124 @@
+#include "core/verdict_cache.h"
+
+namespace routine {
+
+namespace {
+
+// Entry layout, low to high: valid, blocked, referenced, 21 bits of policy
+// generation, 40 bits of hash tag. The set index comes from the low bits of
+// the hash, so together the tag and index cover well over 48 hash bits.
+constexpr uint64_t kValid = 1;
+constexpr uint64_t kBlocked = 2;
+constexpr uint64_t kReferenced = 4;
+constexpr int kGenerationShift = 3;
+constexpr uint64_t kGenerationMask = (1ull << 21) - 1;
+constexpr int kTagShift = 24;
+
+uint64_t TagOf(uint64_t hash) {
+  return hash >> kTagShift;
+}
+
+uint64_t MakeEntry(uint64_t hash, uint64_t generation, bool blocked) {
+  return kValid | (blocked ? kBlocked : 0) |
+         ((generation & kGenerationMask) << kGenerationShift) |
+         (TagOf(hash) << kTagShift);
+}
+
+bool IsCurrent(uint64_t entry, uint64_t generation) {
+  return (entry & kValid) &&
+         ((entry >> kGenerationShift) & kGenerationMask) ==
+             (generation & kGenerationMask);
+}
+
+}  // namespace
+
+VerdictCache::VerdictCache(size_t capacity) {
+  size_t sets = 1;
+  while (sets * kWays < capacity) {
+    sets <<= 1;
+  }
+  set_mask_ = sets - 1;
+
+  entries_.reset(new std::atomic<uint64_t>[sets * kWays]);
+  for (size_t i = 0; i < sets * kWays; ++i) {
+    entries_[i].store(0, std::memory_order_relaxed);
+  }
+  hands_.reset(new std::atomic<uint8_t>[sets]);
+  for (size_t i = 0; i < sets; ++i) {
+    hands_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+bool VerdictCache::Lookup(uint64_t hash, uint64_t generation, bool* blocked) {
+  std::atomic<uint64_t>* set = SetFor(hash);
+  const uint64_t tag = TagOf(hash);
+
+  for (size_t way = 0; way < kWays; ++way) {
+    const uint64_t entry = set[way].load(std::memory_order_relaxed);
+    if (IsCurrent(entry, generation) && (entry >> kTagShift) == tag) {
+      // Only write when the bit is clear, so hot entries stay shared.
+      if (!(entry & kReferenced)) {
+        set[way].fetch_or(kReferenced, std::memory_order_relaxed);
+      }
+      *blocked = (entry & kBlocked) != 0;
+      hits_.Add();
+      return true;
+    }
+  }
+
+  misses_.Add();
+  return false;
+}
+
+void VerdictCache::Insert(uint64_t hash, uint64_t generation, bool blocked) {
+  std::atomic<uint64_t>* set = SetFor(hash);
+  const uint64_t tag = TagOf(hash);
+  const uint64_t replacement = MakeEntry(hash, generation, blocked);
+
+  // Prefer a slot that already holds this key, is empty, or belongs to an
+  // older policy generation.
+  for (size_t way = 0; way < kWays; ++way) {
+    const uint64_t entry = set[way].load(std::memory_order_relaxed);
+    if (!IsCurrent(entry, generation) || (entry >> kTagShift) == tag) {
+      set[way].store(replacement, std::memory_order_relaxed);
+      return;
+    }
+  }
+
+  // CLOCK: sweep from the hand, giving referenced entries a second chance,
+  // until an unreferenced one turns up. Two passes always find one unless
+  // other threads keep re-referencing the set.
+  std::atomic<uint8_t>& hand = hands_[hash & set_mask_];
+  const size_t start = hand.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < kWays * 2; ++i) {
+    const size_t way = (start + i) % kWays;
+    uint64_t entry = set[way].load(std::memory_order_relaxed);
+    if (entry & kReferenced) {
+      set[way].compare_exchange_strong(entry, entry & ~kReferenced,
+                                       std::memory_order_relaxed);
+      continue;
+    }
+    if (set[way].compare_exchange_strong(entry, replacement,
+                                         std::memory_order_relaxed)) {
+      hand.store(static_cast<uint8_t>((way + 1) % kWays),
+                 std::memory_order_relaxed);
+      evictions_.Add();
+      return;
+    }
+  }
+
+  set[start % kWays].store(replacement, std::memory_order_relaxed);
+  hand.store(static_cast<uint8_t>((start + 1) % kWays),
+             std::memory_order_relaxed);
+  evictions_.Add();
+}
+
+VerdictCache::Stats VerdictCache::stats() const {
+  Stats stats;
+  stats.hits = hits_.Load();
+  stats.misses = misses_.Load();
+  stats.evictions = evictions_.Load();
+  return stats;
+}
+
+}  // namespace routine
@@ -0,0 +1,64 @@
+#ifndef ROUTINE_CORE_VERDICT_CACHE_H_
+#define ROUTINE_CORE_VERDICT_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "core/sharded_counter.h"
+
+namespace routine {
+
+// Fixed-capacity cache of block verdicts keyed by a 64-bit path hash.
+//
+// The cache is 8-way set associative and evicts with CLOCK inside each set.
+// Every entry is a single atomic word holding the verdict, a reference bit,
+// the policy generation it was computed under and the high 40 bits of the
+// hash, so lookups and inserts are lock-free and an entry from an older
+// generation simply never matches: invalidating the whole cache on a policy
+// change costs nothing.
+class VerdictCache {
+ public:
+  static constexpr size_t kDefaultCapacity = 4096;
+  static constexpr size_t kWays = 8;
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // Live entries of the current generation pushed out to make room.
+    uint64_t evictions = 0;
+  };
+
+  // |capacity| is rounded up to a power-of-two number of sets.
+  explicit VerdictCache(size_t capacity = kDefaultCapacity);
+
+  VerdictCache(const VerdictCache&) = delete;
+  VerdictCache& operator=(const VerdictCache&) = delete;
+
+  // Returns true and stores the cached verdict in |blocked| if |hash| has an
+  // entry computed under |generation|.
+  bool Lookup(uint64_t hash, uint64_t generation, bool* blocked);
+
+  void Insert(uint64_t hash, uint64_t generation, bool blocked);
+
+  Stats stats() const;
+  size_t capacity() const { return (set_mask_ + 1) * kWays; }
+
+ private:
+  std::atomic<uint64_t>* SetFor(uint64_t hash) const {
+    return &entries_[(hash & set_mask_) * kWays];
+  }
+
+  std::unique_ptr<std::atomic<uint64_t>[]> entries_;
+  std::unique_ptr<std::atomic<uint8_t>[]> hands_;
+  size_t set_mask_ = 0;
+
+  ShardedCounter hits_;
+  ShardedCounter misses_;
+  ShardedCounter evictions_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_VERDICT_CACHE_H_
@@ -0,0 +1,95 @@
+#include "core/worker_pool.h"
+
+#include <utility>
+
+namespace routine {
+
+WorkerPool::WorkerPool(size_t threads, Poster post) : post_(std::move(post)) {
+  for (size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back(&WorkerPool::Run, this);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    for (auto& [kind, token] : latest_) {
+      token.Cancel();
+    }
+    queue_.clear();
+  }
+  ready_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkerPool::Submit(const std::string& kind, Work work, Task cancelled) {
+  std::vector<Task> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto latest = latest_.find(kind);
+    if (latest != latest_.end()) {
+      latest->second.Cancel();
+      for (auto it = queue_.begin(); it != queue_.end();) {
+        if (it->kind == kind) {
+          dropped.push_back(std::move(it->cancelled));
+          it = queue_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+
+    Request request{kind, CancellationToken(), std::move(work),
+                    std::move(cancelled)};
+    latest_[kind] = request.token;
+    queue_.push_back(std::move(request));
+  }
+  ready_.notify_one();
+
+  for (auto& task : dropped) {
+    post_(std::move(task));
+  }
+}
+
+void WorkerPool::Run() {
+  for (;;) {
+    Request request;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+      if (stopping_) {
+        return;
+      }
+      request = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    Task reply = request.work(request.token);
+    Finish(std::move(request), std::move(reply));
+  }
+}
+
+void WorkerPool::Finish(Request request, Task reply) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto latest = latest_.find(request.kind);
+    if (latest != latest_.end() && latest->second == request.token) {
+      latest_.erase(latest);
+    }
+    if (stopping_) {
+      return;
+    }
+  }
+
+  Task task = request.token.IsCancelled() ? std::move(request.cancelled)
+                                          : std::move(reply);
+  request.work = nullptr;
+  request.cancelled = nullptr;
+  reply = nullptr;
+  post_(std::move(task));
+}
+
+}  // namespace routine
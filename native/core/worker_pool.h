@@ -0,0 +1,71 @@
+#ifndef ROUTINE_CORE_WORKER_POOL_H_
+#define ROUTINE_CORE_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "core/cancellation_token.h"
+
+namespace routine {
+
+// Runs slow method channel handlers off the platform thread and hands their
+// replies back to it.
+//
+// Every request has a kind (usually the method name). Submitting a request
+// cancels the pending or running request of the same kind: one that has not
+// started is dropped, one that is running sees its token cancelled. Each
+// request ends in exactly one posted task, its reply or its |cancelled|
+// callback, so a caller can always answer the Dart side. A request's
+// closures are released before its task is posted, so whatever they capture
+// is last released on the platform thread.
+class WorkerPool {
+ public:
+  using Task = std::function<void()>;
+  // Schedules a task on the platform thread. Called from any thread.
+  using Poster = std::function<void(Task)>;
+  // Does the work off the platform thread and returns the reply to post.
+  using Work = std::function<Task(const CancellationToken&)>;
+
+  WorkerPool(size_t threads, Poster post);
+  // Cancels everything and waits for running work. Nothing is posted once
+  // destruction has begun.
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  void Submit(const std::string& kind, Work work, Task cancelled);
+
+ private:
+  struct Request {
+    std::string kind;
+    CancellationToken token;
+    Work work;
+    Task cancelled;
+  };
+
+  void Run();
+  void Finish(Request request, Task reply);
+
+  Poster post_;
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<Request> queue_;
+  // The newest request of each kind that has not finished yet.
+  std::unordered_map<std::string, CancellationToken> latest_;
+  bool stopping_ = false;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_CORE_WORKER_POOL_H_
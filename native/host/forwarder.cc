@@ -0,0 +1,197 @@
+#include "host/forwarder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace routine {
+
+namespace {
+
+constexpr size_t kHeaderSize = 4;
+// Room for a length prefix and the first body byte, which decides whether a
+// frame is intercepted.
+constexpr size_t kMinBufferSize = kHeaderSize + 1;
+
+uint32_t ReadLength(const char* data) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+  return static_cast<uint32_t>(bytes[0]) |
+         static_cast<uint32_t>(bytes[1]) << 8 |
+         static_cast<uint32_t>(bytes[2]) << 16 |
+         static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+}  // namespace
+
+Forwarder::Forwarder(Stream from, Stream to, Options options)
+    : from_(from),
+      to_(to),
+      options_(options),
+      buffer_(new char[std::max(options.buffer_size, kMinBufferSize)]) {}
+
+Forwarder::~Forwarder() = default;
+
+bool Forwarder::Run() {
+  const size_t capacity = std::max(options_.buffer_size, kMinBufferSize);
+  for (;;) {
+    if (remaining_ >= capacity && !dropping_ && !intercepting_ &&
+        end_ == 0 && splice_supported_ && !SpliceBody()) {
+      return false;
+    }
+
+    const int64_t read = ReadSome(from_, buffer_.get() + end_, capacity - end_);
+    if (read <= 0) {
+      return read == 0;
+    }
+    ++stats_.reads;
+    end_ += static_cast<size_t>(read);
+    if (!Process()) {
+      return false;
+    }
+  }
+}
+
+bool Forwarder::Process() {
+  char* data = buffer_.get();
+  size_t pos = 0;
+  // Start of the bytes due out that have not been written yet.
+  size_t out = 0;
+  auto flush = [&](size_t until) {
+    if (until > out) {
+      if (!WriteAll(to_, data + out, until - out)) {
+        return false;
+      }
+      ++stats_.writes;
+    }
+    out = until;
+    return true;
+  };
+  auto finish_frame = [&] {
+    if (dropping_) {
+      ++stats_.dropped;
+    } else if (intercepting_) {
+      return FinishIntercepted();
+    } else {
+      ++stats_.messages;
+    }
+    return true;
+  };
+
+  for (;;) {
+    if (remaining_ > 0) {
+      const size_t take =
+          static_cast<size_t>(std::min<uint64_t>(remaining_, end_ - pos));
+      if (dropping_ || intercepting_) {
+        if (!flush(pos)) {
+          return false;
+        }
+        if (intercepting_) {
+          intercepted_.append(data + pos, take);
+        }
+        out = pos + take;
+      } else {
+        stats_.bytes += take;
+      }
+      pos += take;
+      remaining_ -= take;
+      if (remaining_ > 0) {
+        break;
+      }
+      if (!finish_frame()) {
+        return false;
+      }
+      continue;
+    }
+
+    if (end_ - pos < kHeaderSize) {
+      break;
+    }
+    const uint32_t length = ReadLength(data + pos);
+    intercepting_ = false;
+    if (options_.intercept && length > 0) {
+      if (end_ - pos == kHeaderSize) {
+        break;
+      }
+      intercepting_ = data[pos + kHeaderSize] != '{';
+    }
+    const uint32_t limit = intercepting_ ? options_.max_intercept_size
+                                         : options_.max_message_size;
+    remaining_ = length;
+    dropping_ = length > limit;
+    if (dropping_) {
+      std::fprintf(stderr, "Dropping message of %u bytes (limit %u)\n", length,
+                   limit);
+      intercepting_ = false;
+    }
+    if (dropping_ || intercepting_) {
+      if (!flush(pos)) {
+        return false;
+      }
+      out = pos + kHeaderSize;
+    }
+    pos += kHeaderSize;
+    if (remaining_ == 0 && !finish_frame()) {
+      return false;
+    }
+  }
+
+  if (!flush(pos)) {
+    return false;
+  }
+  // Keep the start of a length prefix split across reads.
+  std::memmove(data, data + pos, end_ - pos);
+  end_ -= pos;
+  return true;
+}
+
+bool Forwarder::FinishIntercepted() {
+  ++stats_.intercepted;
+  const std::string body = options_.intercept(intercepted_);
+  intercepted_.clear();
+  intercepting_ = false;
+  if (body.empty()) {
+    return true;
+  }
+  if (body.size() > options_.max_message_size) {
+    std::fprintf(stderr, "Dropping message of %zu bytes (limit %u)\n",
+                 body.size(), options_.max_message_size);
+    ++stats_.dropped;
+    return true;
+  }
+
+  const uint32_t size = static_cast<uint32_t>(body.size());
+  char frame[kHeaderSize];
+  for (size_t i = 0; i < kHeaderSize; ++i) {
+    frame[i] = static_cast<char>(size >> (8 * i));
+  }
+  if (!WriteAll(to_, frame, kHeaderSize) ||
+      !WriteAll(to_, body.data(), body.size())) {
+    return false;
+  }
+  stats_.writes += 2;
+  ++stats_.messages;
+  stats_.bytes += body.size();
+  return true;
+}
+
+bool Forwarder::SpliceBody() {
+  while (remaining_ > 0) {
+    const int64_t moved = SpliceSome(
+        from_, to_, static_cast<size_t>(std::min<uint64_t>(remaining_, 1 << 20)));
+    if (moved < 0) {
+      // Not a pipe on either side; copy the rest instead.
+      splice_supported_ = false;
+      return true;
+    }
+    if (moved == 0) {
+      return true;
+    }
+    remaining_ -= static_cast<uint64_t>(moved);
+    stats_.bytes += static_cast<uint64_t>(moved);
+    stats_.spliced_bytes += static_cast<uint64_t>(moved);
+  }
+  ++stats_.messages;
+  return true;
+}
+
+}  // namespace routine
@@ -0,0 +1,90 @@
+#ifndef ROUTINE_HOST_FORWARDER_H_
+#define ROUTINE_HOST_FORWARDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "host/stream.h"
+
+namespace routine {
+
+// Relays native messaging frames (a 4-byte little-endian length, then that
+// many bytes) from one stream to another, one direction of the host.
+//
+// Frames are found incrementally: a read may end anywhere, including inside
+// a length prefix, and may hold many frames. Bytes are never decoded. All
+// complete frames in a read go out in one write; the body of a frame larger
+// than the buffer is streamed through as it arrives, spliced when the
+// platform allows. Frames over |max_message_size| are dropped whole, so the
+// two sides stay in step.
+//
+// With |intercept| set, frames that are not JSON are collected whole and
+// replaced by what it returns instead of being relayed; the host uses this
+// to turn the app's policy snapshots into deltas.
+class Forwarder {
+ public:
+  struct Options {
+    // Chrome's limit for messages to the browser.
+    uint32_t max_message_size = 1024 * 1024;
+    size_t buffer_size = 64 * 1024;
+
+    // Called with the body of every frame that does not start with '{';
+    // returns the body to send in its place, or nothing to send nothing.
+    std::function<std::string(std::string_view body)> intercept;
+    // Larger frames for |intercept| are dropped.
+    uint32_t max_intercept_size = 64 * 1024 * 1024;
+  };
+
+  struct Stats {
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;
+    uint64_t intercepted = 0;
+    uint64_t spliced_bytes = 0;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+  };
+
+  Forwarder(Stream from, Stream to, Options options);
+  ~Forwarder();
+
+  Forwarder(const Forwarder&) = delete;
+  Forwarder& operator=(const Forwarder&) = delete;
+
+  // Relays until |from| ends (returns true) or either stream fails (false).
+  // A frame cut off by the end of |from| is not completed.
+  bool Run();
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  // Forwards the frames in buffer_[0, end_) and keeps any partial prefix.
+  bool Process();
+  // Moves the rest of a large frame body without buffering it.
+  bool SpliceBody();
+  // Sends what |intercept| makes of intercepted_.
+  bool FinishIntercepted();
+
+  const Stream from_;
+  const Stream to_;
+  const Options options_;
+  std::unique_ptr<char[]> buffer_;
+  size_t end_ = 0;
+
+  // Body bytes of the current frame not seen yet.
+  uint64_t remaining_ = 0;
+  bool dropping_ = false;
+  bool intercepting_ = false;
+  std::string intercepted_;
+  bool splice_supported_ = true;
+
+  Stats stats_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_HOST_FORWARDER_H_
@@ -0,0 +1,68 @@
+// The native messaging host browsers start for the Routine extension. It
+// relays length-prefixed messages between the extension (stdin/stdout) and
+// the Routine app without looking inside them, except for the app's policy
+// snapshots, which it turns into deltas for the extension (PolicySync). The
+// app is reached over an abstract Unix domain socket on Linux and over
+// loopback TCP elsewhere, or when it predates the socket.
+//
+// Browsers pass the extension origin and, on Windows, a parent window
+// handle as arguments; both are ignored.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "host/forwarder.h"
+#include "host/policy_sync.h"
+#include "host/stream.h"
+
+namespace {
+
+// The abstract socket name the app listens on (Linux).
+constexpr char kLocalSocketName[] = "com.solidsoft.routine";
+
+// The range the app binds its TCP server in.
+constexpr int kFirstPort = 54320;
+constexpr int kLastPort = 54330;
+
+}  // namespace
+
+int main() {
+  routine::Stream app = routine::ConnectLocal(kLocalSocketName);
+  if (app.handle < 0) {
+    app = routine::ConnectLoopback(kFirstPort, kLastPort);
+  }
+  if (app.handle < 0) {
+    std::fprintf(stderr, "Couldn't connect to app\n");
+    return 1;
+  }
+
+  // Either side going away ends the host; the browser starts a new one.
+  std::thread to_browser([app] {
+    // The app sends site policies as snapshots; the browser gets deltas.
+    routine::PolicySync policy;
+    routine::Forwarder::Options options;
+    options.intercept = [&policy](std::string_view snapshot) {
+      std::string message;
+      if (!policy.Update(snapshot, &message)) {
+        std::fprintf(stderr, "Ignoring malformed policy snapshot\n");
+      }
+      return message;
+    };
+    routine::Forwarder forwarder(app, routine::StandardOutput(), options);
+    const bool closed = forwarder.Run();
+    std::fprintf(stderr, closed ? "Connection to Routine app closed\n"
+                                : "Error relaying from Routine app\n");
+    std::_Exit(closed ? 0 : 1);
+  });
+  to_browser.detach();
+
+  routine::Forwarder forwarder(routine::StandardInput(), app,
+                               routine::Forwarder::Options());
+  const bool closed = forwarder.Run();
+  std::fprintf(stderr, closed ? "stdin stream closed\n"
+                              : "Error relaying from extension\n");
+  std::_Exit(closed ? 0 : 1);
+}
@@ -0,0 +1,189 @@
+#include "host/policy_sync.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include "core/domain_matcher.h"
+
+namespace routine {
+
+namespace {
+
+constexpr size_t kMagicSize = sizeof(kSnapshotMagic) - 1;
+
+void AppendVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+bool ReadVarint(std::string_view* data, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && !data->empty(); shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(data->front());
+    data->remove_prefix(1);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void AppendJsonString(std::string_view text, std::string* out) {
+  out->push_back('"');
+  for (const char c : text) {
+    switch (c) {
+      case '"':
+        out->append("\\\"");
+        break;
+      case '\\':
+        out->append("\\\\");
+        break;
+      default:
+        if (static_cast<uint8_t>(c) < 0x20) {
+          char escaped[7];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x",
+                        static_cast<unsigned>(c));
+          out->append(escaped);
+        } else {
+          out->push_back(c);
+        }
+    }
+  }
+  out->push_back('"');
+}
+
+void AppendJsonArray(const std::vector<std::string>& items, std::string* out) {
+  out->push_back('[');
+  for (size_t i = 0; i < items.size(); ++i) {
+    if (i > 0) {
+      out->push_back(',');
+    }
+    AppendJsonString(items[i], out);
+  }
+  out->push_back(']');
+}
+
+// Replaces |sites| with their NormalizeDomain() forms, sorted and unique,
+// dropping any that are not domains.
+void CanonicalizeSites(std::vector<std::string>* sites) {
+  std::vector<std::string> canonical;
+  canonical.reserve(sites->size());
+  std::string ascii;
+  for (const auto& site : *sites) {
+    if (NormalizeDomain(site, &ascii)) {
+      canonical.push_back(ascii);
+    }
+  }
+  std::sort(canonical.begin(), canonical.end());
+  canonical.erase(std::unique(canonical.begin(), canonical.end()),
+                  canonical.end());
+  sites->swap(canonical);
+}
+
+}  // namespace
+
+std::string SerializeSnapshot(const SitePolicy& policy, bool resync) {
+  std::string out(kSnapshotMagic, kMagicSize);
+  out.push_back(static_cast<char>((resync ? kSnapshotResync : 0) |
+                                  (policy.allow_list ? kSnapshotAllowList
+                                                     : 0)));
+  AppendVarint(policy.sites.size(), &out);
+  for (const auto& site : policy.sites) {
+    AppendVarint(site.size(), &out);
+    out.append(site);
+  }
+  return out;
+}
+
+bool ParseSnapshot(std::string_view data, SitePolicy* policy, bool* resync) {
+  if (data.size() < kMagicSize + 1 ||
+      data.substr(0, kMagicSize) != std::string_view(kSnapshotMagic)) {
+    return false;
+  }
+  const uint8_t flags = static_cast<uint8_t>(data[kMagicSize]);
+  data.remove_prefix(kMagicSize + 1);
+  *resync = (flags & kSnapshotResync) != 0;
+  policy->allow_list = (flags & kSnapshotAllowList) != 0;
+
+  uint64_t count;
+  // Every site takes at least its length byte.
+  if (!ReadVarint(&data, &count) || count > data.size()) {
+    return false;
+  }
+  policy->sites.clear();
+  policy->sites.reserve(static_cast<size_t>(count));
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t size;
+    if (!ReadVarint(&data, &size) || size > data.size()) {
+      return false;
+    }
+    policy->sites.emplace_back(data.substr(0, static_cast<size_t>(size)));
+    data.remove_prefix(static_cast<size_t>(size));
+  }
+  if (!data.empty()) {
+    return false;
+  }
+
+  auto& sites = policy->sites;
+  std::sort(sites.begin(), sites.end());
+  sites.erase(std::unique(sites.begin(), sites.end()), sites.end());
+  return true;
+}
+
+SiteDelta DiffSites(const std::vector<std::string>& from,
+                    const std::vector<std::string>& to) {
+  SiteDelta delta;
+  std::set_difference(to.begin(), to.end(), from.begin(), from.end(),
+                      std::back_inserter(delta.added));
+  std::set_difference(from.begin(), from.end(), to.begin(), to.end(),
+                      std::back_inserter(delta.removed));
+  return delta;
+}
+
+bool PolicySync::Update(std::string_view snapshot, std::string* message) {
+  SitePolicy policy;
+  bool resync;
+  if (!ParseSnapshot(snapshot, &policy, &resync)) {
+    return false;
+  }
+  CanonicalizeSites(&policy.sites);
+
+  message->clear();
+  const bool full =
+      generation_ == 0 || resync || policy.allow_list != current_.allow_list;
+  if (full) {
+    ++generation_;
+    message->append("{\"action\":\"updateBlockedSites\",\"data\":{");
+    message->append("\"generation\":" + std::to_string(generation_));
+    message->append(policy.allow_list ? ",\"allowList\":true"
+                                      : ",\"allowList\":false");
+    message->append(",\"sites\":");
+    AppendJsonArray(policy.sites, message);
+    message->append("}}");
+  } else {
+    const SiteDelta delta = DiffSites(current_.sites, policy.sites);
+    if (delta.empty()) {
+      return true;
+    }
+    ++generation_;
+    message->append("{\"action\":\"patchBlockedSites\",\"data\":{");
+    message->append("\"base\":" + std::to_string(generation_ - 1));
+    message->append(",\"generation\":" + std::to_string(generation_));
+    message->append(",\"add\":");
+    AppendJsonArray(delta.added, message);
+    message->append(",\"remove\":");
+    AppendJsonArray(delta.removed, message);
+    message->append("}}");
+  }
+  current_ = std::move(policy);
+  return true;
+}
+
+}  // namespace routine
@@ -0,0 +1,79 @@
+#ifndef ROUTINE_HOST_POLICY_SYNC_H_
+#define ROUTINE_HOST_POLICY_SYNC_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace routine {
+
+// The site rules the app pushes to a browser extension.
+struct SitePolicy {
+  bool allow_list = false;
+  // Sorted and unique once parsed.
+  std::vector<std::string> sites;
+};
+
+// The app sends policies to the host as binary snapshots rather than JSON:
+// "RPS1", a flags byte, a varint count, then each site as a varint length
+// and its UTF-8 bytes. Frames from the app that are JSON always start with
+// '{', so the first byte tells the two apart.
+constexpr char kSnapshotMagic[] = "RPS1";
+
+// Set when the extension asked for a full resync.
+constexpr uint8_t kSnapshotResync = 1 << 0;
+constexpr uint8_t kSnapshotAllowList = 1 << 1;
+
+std::string SerializeSnapshot(const SitePolicy& policy, bool resync);
+
+// Parses a snapshot into |policy|, sorting and deduplicating its sites.
+// Returns false, leaving |policy| unspecified, if |data| is malformed.
+bool ParseSnapshot(std::string_view data, SitePolicy* policy, bool* resync);
+
+// The change between two sorted site lists.
+struct SiteDelta {
+  std::vector<std::string> added;
+  std::vector<std::string> removed;
+
+  bool empty() const { return added.empty() && removed.empty(); }
+};
+
+SiteDelta DiffSites(const std::vector<std::string>& from,
+                    const std::vector<std::string>& to);
+
+// Remembers what one browser was last sent and turns the app's snapshots
+// into the smallest message that brings it up to date.
+//
+// Sites go out in NormalizeDomain() form, the punycode browsers use for
+// hosts and declarativeNetRequest requires; entries that are not domains
+// are dropped.
+//
+// Every message carries a generation that counts up from 1. The first
+// snapshot, a change of mode and a resync go out in full:
+//
+//   {"action":"updateBlockedSites",
+//    "data":{"generation":N,"allowList":B,"sites":[...]}}
+//
+// anything else as the sites added and removed since generation N - 1:
+//
+//   {"action":"patchBlockedSites",
+//    "data":{"base":N-1,"generation":N,"add":[...],"remove":[...]}}
+//
+// An extension whose generation is not the base asks the app to resync.
+class PolicySync {
+ public:
+  // Sets |message| to the JSON for |snapshot|, or clears it if nothing
+  // changed. Returns false if |snapshot| is malformed.
+  bool Update(std::string_view snapshot, std::string* message);
+
+  uint64_t generation() const { return generation_; }
+
+ private:
+  SitePolicy current_;
+  uint64_t generation_ = 0;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_HOST_POLICY_SYNC_H_
@@ -0,0 +1,254 @@
+#include "host/shm_ring.h"
+
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <new>
+
+namespace routine {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x474e5252;  // "RRNG"
+// Marks the unused end of the buffer a message did not fit in.
+constexpr uint32_t kPadding = 0xffffffff;
+constexpr size_t kMinCapacity = 4096;
+constexpr size_t kMaxCapacity = size_t{1} << 30;
+// Where the buffer starts, after the header.
+constexpr size_t kDataOffset = 256;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the ring header is shared between processes");
+
+// Not FUTEX_PRIVATE_FLAG: the waiter and waker are different processes.
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected,
+               std::chrono::nanoseconds timeout) {
+  timespec relative;
+  relative.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+  relative.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected,
+          &relative, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX,
+          nullptr, nullptr, 0);
+}
+
+// Sleeps on |seq| until |ready| holds or |timeout| passes, announcing the
+// sleep through |waiting| so the other side knows to wake it.
+template <typename Ready>
+bool Wait(std::atomic<uint32_t>* seq, std::atomic<uint32_t>* waiting,
+          std::chrono::milliseconds timeout, Ready ready) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  for (;;) {
+    const uint32_t expected = seq->load();
+    if (ready()) {
+      return true;
+    }
+    // Either the other side sees the flag, or we see its update: both are
+    // sequentially consistent.
+    waiting->store(1);
+    if (ready()) {
+      waiting->store(0);
+      return true;
+    }
+    const auto remaining = deadline - std::chrono::steady_clock::now();
+    if (remaining <= std::chrono::nanoseconds::zero()) {
+      waiting->store(0);
+      return false;
+    }
+    FutexWait(seq, expected, remaining);
+    waiting->store(0);
+  }
+}
+
+}  // namespace
+
+struct ShmRing::Header {
+  uint32_t magic;
+  uint32_t capacity;
+
+  // Written by the producer. head_seq changes with every write and is the
+  // futex the consumer sleeps on.
+  alignas(64) std::atomic<uint64_t> head;
+  std::atomic<uint32_t> head_seq;
+  std::atomic<uint32_t> reader_waiting;
+
+  // Written by the consumer.
+  alignas(64) std::atomic<uint64_t> tail;
+  std::atomic<uint32_t> tail_seq;
+  std::atomic<uint32_t> writer_waiting;
+};
+
+std::unique_ptr<ShmRing> ShmRing::Create(size_t capacity) {
+  static_assert(sizeof(Header) <= kDataOffset, "header overlaps the data");
+  size_t rounded = kMinCapacity;
+  while (rounded < capacity && rounded < kMaxCapacity) {
+    rounded *= 2;
+  }
+
+  const int fd = memfd_create("routine_ring", MFD_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  const size_t size = kDataOffset + rounded;
+  void* mapping = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+    mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (mapping == MAP_FAILED) {
+    close(fd);
+    return nullptr;
+  }
+
+  // The file starts out zeroed, which is an empty ring.
+  Header* header = new (mapping) Header();
+  header->capacity = static_cast<uint32_t>(rounded);
+  header->magic = kMagic;
+  return std::unique_ptr<ShmRing>(new ShmRing(fd, mapping, rounded));
+}
+
+std::unique_ptr<ShmRing> ShmRing::Map(int fd) {
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < kDataOffset + kMinCapacity ||
+      static_cast<size_t>(info.st_size) > kDataOffset + kMaxCapacity) {
+    close(fd);
+    return nullptr;
+  }
+  const size_t size = static_cast<size_t>(info.st_size);
+  void* mapping =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    close(fd);
+    return nullptr;
+  }
+
+  const Header* header = static_cast<const Header*>(mapping);
+  const size_t capacity = size - kDataOffset;
+  if (header->magic != kMagic || header->capacity != capacity ||
+      (capacity & (capacity - 1)) != 0) {
+    munmap(mapping, size);
+    close(fd);
+    return nullptr;
+  }
+  return std::unique_ptr<ShmRing>(new ShmRing(fd, mapping, capacity));
+}
+
+ShmRing::ShmRing(int fd, void* mapping, size_t capacity)
+    : fd_(fd),
+      mapping_(mapping),
+      capacity_(capacity),
+      header_(static_cast<Header*>(mapping)),
+      data_(static_cast<char*>(mapping) + kDataOffset) {}
+
+ShmRing::~ShmRing() {
+  munmap(mapping_, kDataOffset + capacity_);
+  close(fd_);
+}
+
+uint64_t ShmRing::RecordSize(size_t size) {
+  return (kLengthSize + size + 7) / 8 * 8;
+}
+
+uint64_t ShmRing::WriteSpan(uint64_t head, size_t size) const {
+  const uint64_t record = RecordSize(size);
+  const uint64_t contiguous = capacity_ - (head & (capacity_ - 1));
+  return record <= contiguous ? record : contiguous + record;
+}
+
+bool ShmRing::TryWrite(const char* data, size_t size) {
+  if (size > max_message_size()) {
+    return false;
+  }
+  uint64_t head = header_->head.load(std::memory_order_relaxed);
+  const uint64_t tail = header_->tail.load(std::memory_order_acquire);
+  const uint64_t record = RecordSize(size);
+  const uint64_t span = WriteSpan(head, size);
+  if (head - tail + span > capacity_) {
+    return false;
+  }
+
+  size_t offset = head & (capacity_ - 1);
+  if (span != record) {
+    std::memcpy(data_ + offset, &kPadding, kLengthSize);
+    head += capacity_ - offset;
+    offset = 0;
+  }
+  const uint32_t length = static_cast<uint32_t>(size);
+  std::memcpy(data_ + offset, &length, kLengthSize);
+  std::memcpy(data_ + offset + kLengthSize, data, size);
+
+  header_->head.store(head + record);
+  header_->head_seq.fetch_add(1);
+  if (header_->reader_waiting.load() != 0) {
+    FutexWake(&header_->head_seq);
+  }
+  return true;
+}
+
+bool ShmRing::WaitWritable(size_t size, std::chrono::milliseconds timeout) {
+  if (size > max_message_size()) {
+    return false;
+  }
+  return Wait(&header_->tail_seq, &header_->writer_waiting, timeout, [&] {
+    const uint64_t head = header_->head.load(std::memory_order_relaxed);
+    return head - header_->tail.load() + WriteSpan(head, size) <= capacity_;
+  });
+}
+
+bool ShmRing::TryRead(std::string* message) {
+  if (broken_) {
+    return false;
+  }
+  uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+  const uint64_t head = header_->head.load(std::memory_order_acquire);
+  for (;;) {
+    if (tail == head) {
+      return false;
+    }
+    const size_t offset = tail & (capacity_ - 1);
+    uint32_t length;
+    std::memcpy(&length, data_ + offset, kLengthSize);
+    if (length == kPadding) {
+      if (head - tail < capacity_ - offset) {
+        broken_ = true;
+        return false;
+      }
+      tail += capacity_ - offset;
+      continue;
+    }
+    if (length > max_message_size() || head - tail < RecordSize(length) ||
+        offset + RecordSize(length) > capacity_) {
+      broken_ = true;
+      return false;
+    }
+    message->assign(data_ + offset + kLengthSize, length);
+    tail += RecordSize(length);
+    break;
+  }
+
+  header_->tail.store(tail);
+  header_->tail_seq.fetch_add(1);
+  if (header_->writer_waiting.load() != 0) {
+    FutexWake(&header_->tail_seq);
+  }
+  return true;
+}
+
+bool ShmRing::WaitReadable(std::chrono::milliseconds timeout) {
+  return Wait(&header_->head_seq, &header_->reader_waiting, timeout, [&] {
+    return header_->head.load() !=
+           header_->tail.load(std::memory_order_relaxed);
+  });
+}
+
+}  // namespace routine
@@ -0,0 +1,83 @@
+#ifndef ROUTINE_HOST_SHM_RING_H_
+#define ROUTINE_HOST_SHM_RING_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace routine {
+
+// A single-producer, single-consumer queue of messages in memory shared
+// between two processes (Linux), for pushes too large to want two socket
+// copies, such as a full rule set.
+//
+// The ring lives in a memfd: one side creates it and passes fd() to the
+// other (inherited or over a Unix domain socket), which maps it. Messages
+// are a 4-byte length and the bytes, padded to 8 and never split across
+// the end of the buffer. Read and write positions are atomics in the shared
+// header; a side that has to wait sleeps on a futex the other side wakes
+// only while someone sleeps, so a busy ring costs no system calls.
+//
+// Lengths read from the peer are checked; a ring whose contents do not add
+// up is broken() and reads nothing more.
+class ShmRing {
+ public:
+  // Creates a ring of |capacity| bytes, rounded up to a power of two.
+  // Returns null on failure.
+  static std::unique_ptr<ShmRing> Create(size_t capacity);
+
+  // Maps the ring behind |fd|, taking ownership of it. Returns null if |fd|
+  // does not hold a ring.
+  static std::unique_ptr<ShmRing> Map(int fd);
+
+  ~ShmRing();
+
+  ShmRing(const ShmRing&) = delete;
+  ShmRing& operator=(const ShmRing&) = delete;
+
+  // Producer: appends |size| bytes. Returns false if they do not fit right
+  // now, or ever (over max_message_size()).
+  bool TryWrite(const char* data, size_t size);
+
+  // Producer: blocks until |size| bytes fit or |timeout| passes. Returns
+  // whether they fit.
+  bool WaitWritable(size_t size, std::chrono::milliseconds timeout);
+
+  // Consumer: pops the oldest message into |message|. Returns false if there
+  // is none.
+  bool TryRead(std::string* message);
+
+  // Consumer: blocks until a message is available or |timeout| passes.
+  // Returns whether one is.
+  bool WaitReadable(std::chrono::milliseconds timeout);
+
+  int fd() const { return fd_; }
+  size_t capacity() const { return capacity_; }
+  size_t max_message_size() const { return capacity_ / 2 - kLengthSize; }
+  bool broken() const { return broken_; }
+
+ private:
+  struct Header;
+
+  static constexpr size_t kLengthSize = 4;
+
+  ShmRing(int fd, void* mapping, size_t capacity);
+
+  // Bytes a message of |size| takes in the buffer.
+  static uint64_t RecordSize(size_t size);
+  // Bytes the next write of |size| needs, including padding to wrap.
+  uint64_t WriteSpan(uint64_t head, size_t size) const;
+
+  const int fd_;
+  void* const mapping_;
+  const size_t capacity_;
+  Header* const header_;
+  char* const data_;
+  bool broken_ = false;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_HOST_SHM_RING_H_
@@ -0,0 +1,226 @@
+#include "host/stream.h"
+
+#include <climits>
+#include <cstddef>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#if !defined(_WIN32) && !defined(MSG_NOSIGNAL)
+// macOS: SO_NOSIGPIPE on the socket does the same.
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace routine {
+
+#ifdef _WIN32
+
+Stream StandardInput() {
+  return Stream{reinterpret_cast<intptr_t>(GetStdHandle(STD_INPUT_HANDLE)),
+                false};
+}
+
+Stream StandardOutput() {
+  return Stream{reinterpret_cast<intptr_t>(GetStdHandle(STD_OUTPUT_HANDLE)),
+                false};
+}
+
+int64_t ReadSome(Stream from, char* data, size_t size) {
+  const DWORD chunk = size > MAXDWORD ? MAXDWORD : static_cast<DWORD>(size);
+  if (from.socket) {
+    const int read = recv(static_cast<SOCKET>(from.handle), data,
+                          static_cast<int>(chunk > INT_MAX ? INT_MAX : chunk),
+                          0);
+    return read < 0 ? -1 : read;
+  }
+  DWORD read = 0;
+  if (!ReadFile(reinterpret_cast<HANDLE>(from.handle), data, chunk, &read,
+                nullptr)) {
+    // The browser closing its end of the pipe is the normal way to stop.
+    return GetLastError() == ERROR_BROKEN_PIPE ? 0 : -1;
+  }
+  return read;
+}
+
+bool WriteAll(Stream to, const char* data, size_t size) {
+  while (size > 0) {
+    const DWORD chunk = size > MAXDWORD ? MAXDWORD : static_cast<DWORD>(size);
+    DWORD written = 0;
+    if (to.socket) {
+      const int sent = send(static_cast<SOCKET>(to.handle), data,
+                            static_cast<int>(chunk > INT_MAX ? INT_MAX : chunk),
+                            0);
+      if (sent <= 0) {
+        return false;
+      }
+      written = static_cast<DWORD>(sent);
+    } else if (!WriteFile(reinterpret_cast<HANDLE>(to.handle), data, chunk,
+                          &written, nullptr)) {
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+int64_t SpliceSome(Stream from, Stream to, size_t size) { return -1; }
+
+Stream ConnectLocal(const char* name) { return Stream(); }
+
+Stream ConnectLoopback(int first, int last) {
+  WSADATA wsa;
+  if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+    return Stream();
+  }
+  for (int port = first; port <= last; ++port) {
+    SOCKET fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd == INVALID_SOCKET) {
+      break;
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<u_short>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) == 0) {
+      // Messages are small and latency-bound.
+      BOOL no_delay = TRUE;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY,
+                 reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+      return Stream{static_cast<intptr_t>(fd), true};
+    }
+    closesocket(fd);
+  }
+  return Stream();
+}
+
+void Close(Stream stream) {
+  if (stream.socket) {
+    closesocket(static_cast<SOCKET>(stream.handle));
+  } else {
+    CloseHandle(reinterpret_cast<HANDLE>(stream.handle));
+  }
+}
+
+#else
+
+Stream StandardInput() { return Stream{STDIN_FILENO, false}; }
+
+Stream StandardOutput() { return Stream{STDOUT_FILENO, false}; }
+
+int64_t ReadSome(Stream from, char* data, size_t size) {
+  for (;;) {
+    const ssize_t read = ::read(static_cast<int>(from.handle), data, size);
+    if (read >= 0 || errno != EINTR) {
+      return read;
+    }
+  }
+}
+
+bool WriteAll(Stream to, const char* data, size_t size) {
+  while (size > 0) {
+    // send() rather than write() so a closed peer is an error, not SIGPIPE.
+    const ssize_t written =
+        to.socket ? ::send(static_cast<int>(to.handle), data, size,
+                           MSG_NOSIGNAL)
+                  : ::write(static_cast<int>(to.handle), data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+int64_t SpliceSome(Stream from, Stream to, size_t size) {
+#ifdef __linux__
+  // Only works when one side is a pipe, which is how browsers start hosts.
+  for (;;) {
+    const ssize_t moved =
+        splice(static_cast<int>(from.handle), nullptr,
+               static_cast<int>(to.handle), nullptr, size, SPLICE_F_MOVE);
+    if (moved >= 0 || errno != EINTR) {
+      return moved;
+    }
+  }
+#else
+  return -1;
+#endif
+}
+
+Stream ConnectLocal(const char* name) {
+#ifdef __linux__
+  sockaddr_un address{};
+  const size_t length = std::strlen(name);
+  if (length + 1 > sizeof(address.sun_path)) {
+    return Stream();
+  }
+  address.sun_family = AF_UNIX;
+  // The leading NUL puts the name in the abstract namespace. Its length is
+  // part of the address, so no terminator follows.
+  std::memcpy(address.sun_path + 1, name, length);
+  const socklen_t address_size =
+      static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + length);
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return Stream();
+  }
+  if (connect(fd, reinterpret_cast<const sockaddr*>(&address),
+              address_size) == 0) {
+    return Stream{fd, true};
+  }
+  close(fd);
+#endif
+  return Stream();
+}
+
+Stream ConnectLoopback(int first, int last) {
+  for (int port = first; port <= last; ++port) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+      break;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+    const int no_sigpipe = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) == 0) {
+      // Messages are small and latency-bound.
+      const int no_delay = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+      return Stream{fd, true};
+    }
+    close(fd);
+  }
+  return Stream();
+}
+
+void Close(Stream stream) { close(static_cast<int>(stream.handle)); }
+
+#endif
+
+}  // namespace routine
@@ -0,0 +1,47 @@
+#ifndef ROUTINE_HOST_STREAM_H_
+#define ROUTINE_HOST_STREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace routine {
+
+// One end of a byte stream the native messaging host relays: the browser's
+// stdin/stdout pipes or the socket to the app.
+struct Stream {
+  // A file descriptor, or a HANDLE / SOCKET on Windows.
+  intptr_t handle = -1;
+  bool socket = false;
+};
+
+Stream StandardInput();
+Stream StandardOutput();
+
+// Reads at most |size| bytes, blocking until at least one is available.
+// Returns the count, 0 at end of stream, or -1 on error.
+int64_t ReadSome(Stream from, char* data, size_t size);
+
+// Writes all of |data|. Returns false on error.
+bool WriteAll(Stream to, const char* data, size_t size);
+
+// Moves up to |size| bytes from |from| to |to| without copying them through
+// user space (splice() through a pipe on Linux). Returns the count moved,
+// 0 at end of stream, or -1 if the streams do not support it or on error;
+// the caller then falls back to ReadSome() / WriteAll().
+int64_t SpliceSome(Stream from, Stream to, size_t size);
+
+// Connects to the app's abstract Unix domain socket |name| (Linux only, so
+// there is no socket file to clean up or race on). Returns a stream with a
+// negative handle if nobody listens or the platform has no abstract sockets;
+// the caller then falls back to ConnectLoopback().
+Stream ConnectLocal(const char* name);
+
+// Connects to the first loopback TCP port in [first, last] that accepts.
+// Returns a stream with a negative handle if none does.
+Stream ConnectLoopback(int first, int last);
+
+void Close(Stream stream);
+
+}  // namespace routine
+
+#endif  // ROUTINE_HOST_STREAM_H_
@@ -0,0 +1,311 @@
+#include "linux/cgroup_freezer.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mntent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "core/path.h"
+
+namespace routine {
+
+namespace {
+
+constexpr char kDefaultRoot[] = "routine-blocked";
+// cpu.max period, the kernel's default.
+constexpr int kCpuPeriodUs = 100000;
+
+bool WriteFile(const std::string& path, const std::string& value) {
+  const int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  // cgroup files report errors from write() itself.
+  const bool written =
+      write(fd, value.data(), value.size()) ==
+      static_cast<ssize_t>(value.size());
+  close(fd);
+  return written;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+std::vector<int64_t> ReadPids(const std::string& group) {
+  std::vector<int64_t> pids;
+  std::istringstream procs(ReadFile(group + "/cgroup.procs"));
+  int64_t pid;
+  while (procs >> pid) {
+    pids.push_back(pid);
+  }
+  return pids;
+}
+
+std::string CgroupMount() {
+  FILE* table = setmntent("/proc/self/mounts", "r");
+  if (table == nullptr) {
+    return std::string();
+  }
+  std::string mount;
+  mntent entry;
+  char buffer[4096];
+  while (getmntent_r(table, &entry, buffer, sizeof(buffer)) != nullptr) {
+    if (std::string_view(entry.mnt_type) == "cgroup2") {
+      mount = entry.mnt_dir;
+      break;
+    }
+  }
+  endmntent(table);
+  return mount;
+}
+
+std::string Parent(const std::string& path) {
+  const size_t slash = path.find_last_of('/');
+  return slash == std::string::npos || slash == 0 ? path
+                                                   : path.substr(0, slash);
+}
+
+}  // namespace
+
+CgroupFreezer::CgroupFreezer(ProcFs proc, Options options)
+    : proc_(std::move(proc)),
+      options_(std::move(options)),
+      self_pid_(getpid()) {}
+
+CgroupFreezer::~CgroupFreezer() { ThawAll(); }
+
+bool CgroupFreezer::Open() {
+  mount_ = CgroupMount();
+  if (mount_.empty()) {
+    return false;
+  }
+  root_ = options_.root;
+  if (root_.empty()) {
+    const std::string self = CgroupOf(self_pid_);
+    if (self.empty()) {
+      return false;
+    }
+    root_ = (self == mount_ ? self : Parent(self)) + "/" + kDefaultRoot;
+  }
+  if (mkdir(root_.c_str(), 0755) != 0 && errno != EEXIST) {
+    return false;
+  }
+  // Freezing needs Linux 5.2; throttling needs the cpu controller handed
+  // down to the app groups.
+  if (access((root_ + "/cgroup.freeze").c_str(), W_OK) != 0 ||
+      (options_.cpu_percent > 0 &&
+       !WriteFile(root_ + "/cgroup.subtree_control", "+cpu"))) {
+    return false;
+  }
+
+  // An earlier run that died would have left its apps frozen for good.
+  const std::string parent = Parent(root_);
+  if (DIR* dir = opendir(root_.c_str())) {
+    while (dirent* entry = readdir(dir)) {
+      const std::string name = entry->d_name;
+      if (entry->d_type != DT_DIR || name == "." || name == "..") {
+        continue;
+      }
+      Group group;
+      group.path = root_ + "/" + name;
+      group.origin = parent;
+      Thaw(&group);
+    }
+    closedir(dir);
+  }
+  return true;
+}
+
+bool CgroupFreezer::Freeze(int64_t pid, const std::string& exe) {
+  if (root_.empty() || pid <= 1 || pid == self_pid_) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto [it, created] = groups_.try_emplace(exe);
+  Group& group = it->second;
+  if (created) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "app-%016llx",
+                  static_cast<unsigned long long>(HashBytes(exe, false)));
+    group.path = root_ + "/" + name;
+    const bool made = mkdir(group.path.c_str(), 0755) == 0 || errno == EEXIST;
+    const bool limited =
+        made && (options_.cpu_percent > 0
+                     ? WriteFile(group.path + "/cpu.max",
+                                 std::to_string(options_.cpu_percent *
+                                                kCpuPeriodUs / 100) +
+                                     " " + std::to_string(kCpuPeriodUs))
+                     : WriteFile(group.path + "/cgroup.freeze", "1"));
+    if (!limited) {
+      rmdir(group.path.c_str());
+      groups_.erase(it);
+      return false;
+    }
+  }
+
+  // The group is frozen already: each process stops as it arrives. A
+  // second pass picks up children forked while the first was moving their
+  // parents.
+  bool moved_any = false;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (const int64_t member : ProcessTree(pid, exe)) {
+      if (frozen_pids_.count(member) != 0 || member == self_pid_) {
+        continue;
+      }
+      const std::string origin = CgroupOf(member);
+      if (origin.empty() || !Move(member, group.path)) {
+        continue;
+      }
+      if (group.origin.empty()) {
+        group.origin = origin;
+      }
+      group.origins[member] = origin;
+      frozen_pids_[member] = exe;
+      moved_any = true;
+    }
+  }
+  if (moved_any) {
+    ++stats_.freezes;
+  }
+  if (group.origins.empty()) {
+    rmdir(group.path.c_str());
+    groups_.erase(exe);
+    return false;
+  }
+  return frozen_pids_.count(pid) != 0;
+}
+
+bool CgroupFreezer::IsFrozen(int64_t pid) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frozen_pids_.count(pid) != 0;
+}
+
+void CgroupFreezer::Reconcile(
+    const std::function<bool(const std::string& exe)>& is_blocked) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = groups_.begin(); it != groups_.end();) {
+    if (!is_blocked(it->first)) {
+      Thaw(&it->second);
+      it = groups_.erase(it);
+      continue;
+    }
+    // Killed while frozen; the pid may name another process soon.
+    const std::vector<int64_t> members = ReadPids(it->second.path);
+    for (auto origin = it->second.origins.begin();
+         origin != it->second.origins.end();) {
+      if (std::find(members.begin(), members.end(), origin->first) ==
+          members.end()) {
+        frozen_pids_.erase(origin->first);
+        origin = it->second.origins.erase(origin);
+      } else {
+        ++origin;
+      }
+    }
+    ++it;
+  }
+}
+
+void CgroupFreezer::ThawAll() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& [exe, group] : groups_) {
+    Thaw(&group);
+  }
+  groups_.clear();
+}
+
+CgroupFreezer::Stats CgroupFreezer::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.groups = groups_.size();
+  stats.processes = frozen_pids_.size();
+  return stats;
+}
+
+std::vector<int64_t> CgroupFreezer::ProcessTree(int64_t pid,
+                                                const std::string& exe) const {
+  std::unordered_map<int64_t, std::vector<int64_t>> children;
+  std::unordered_map<int64_t, int64_t> parents;
+  for (const int64_t candidate : proc_.ListPids()) {
+    ProcessInfo info;
+    if (proc_.ReadStat(candidate, &info)) {
+      children[info.ppid].push_back(candidate);
+      parents[candidate] = info.ppid;
+    }
+  }
+
+  // Multi-process apps often focus a window of a helper; start from the
+  // process that launched them all.
+  int64_t top = pid;
+  for (auto parent = parents.find(top);
+       parent != parents.end() && parent->second > 1 &&
+       parent->second != self_pid_ && proc_.ReadExe(parent->second) == exe;
+       parent = parents.find(top)) {
+    top = parent->second;
+  }
+
+  std::vector<int64_t> tree = {top};
+  for (size_t i = 0; i < tree.size(); ++i) {
+    auto it = children.find(tree[i]);
+    if (it != children.end()) {
+      tree.insert(tree.end(), it->second.begin(), it->second.end());
+    }
+  }
+  return tree;
+}
+
+std::string CgroupFreezer::CgroupOf(int64_t pid) const {
+  std::istringstream lines(
+      ReadFile(proc_.root() + "/" + std::to_string(pid) + "/cgroup"));
+  std::string line;
+  while (std::getline(lines, line)) {
+    // The v2 hierarchy is the "0::" line.
+    if (line.rfind("0::", 0) == 0) {
+      const std::string relative = line.substr(3);
+      return relative == "/" ? mount_ : mount_ + relative;
+    }
+  }
+  return std::string();
+}
+
+bool CgroupFreezer::Move(int64_t pid, const std::string& group) {
+  if (WriteFile(group + "/cgroup.procs", std::to_string(pid))) {
+    return true;
+  }
+  // Gone meanwhile is not a failure.
+  if (errno != ESRCH) {
+    ++stats_.move_failures;
+  }
+  return false;
+}
+
+void CgroupFreezer::Thaw(Group* group) {
+  // Both, for groups an earlier run made in the other mode.
+  WriteFile(group->path + "/cgroup.freeze", "0");
+  WriteFile(group->path + "/cpu.max", "max");
+  for (const int64_t pid : ReadPids(group->path)) {
+    auto origin = group->origins.find(pid);
+    Move(pid, origin != group->origins.end() ? origin->second
+                                             : group->origin);
+    frozen_pids_.erase(pid);
+  }
+  for (const auto& [pid, origin] : group->origins) {
+    frozen_pids_.erase(pid);
+  }
+  // Fails if a process could not be moved back; it stays, thawed.
+  rmdir(group->path.c_str());
+  ++stats_.thaws;
+}
+
+}  // namespace routine
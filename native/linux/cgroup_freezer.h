@@ -0,0 +1,112 @@
+#ifndef ROUTINE_LINUX_CGROUP_FREEZER_H_
+#define ROUTINE_LINUX_CGROUP_FREEZER_H_
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "linux/proc_fs.h"
+
+namespace routine {
+
+// Stops blocked applications with the cgroup v2 freezer rather than a
+// signal: the whole process tree of a blocked app, helpers and renderers
+// included, is moved into a child group of |root| and frozen through
+// cgroup.freeze, so it uses no CPU and cannot spawn a new window. Children
+// a frozen or throttled process forks are born in its group. Thawing moves
+// every process back to the group it came from.
+//
+// With a |cpu_percent| the group is throttled through cpu.max instead, a
+// softer block that leaves the app responsive but slow.
+//
+// Moving a process needs write access to the cgroup.procs of the nearest
+// group holding both it and |root|, which a systemd user session delegates
+// for apps started as units. Where a move is refused, Freeze() fails and
+// the caller falls back to SIGSTOP.
+class CgroupFreezer {
+ public:
+  struct Options {
+    // A cgroup v2 directory for the per-app groups, created if missing.
+    // Empty picks "routine-blocked" beside our own group.
+    std::string root;
+    // 0 freezes. Otherwise each blocked app gets this share of one CPU.
+    int cpu_percent = 0;
+  };
+
+  struct Stats {
+    // Frozen or throttled now.
+    uint64_t groups = 0;
+    uint64_t processes = 0;
+    uint64_t freezes = 0;
+    uint64_t thaws = 0;
+    // Processes the kernel would not move in or back out.
+    uint64_t move_failures = 0;
+  };
+
+  CgroupFreezer(ProcFs proc, Options options);
+  // Thaws everything.
+  ~CgroupFreezer();
+
+  CgroupFreezer(const CgroupFreezer&) = delete;
+  CgroupFreezer& operator=(const CgroupFreezer&) = delete;
+
+  // Finds the cgroup v2 hierarchy and prepares |root|, thawing groups an
+  // earlier run left behind. Returns false without cgroup v2, without
+  // cgroup.freeze (Linux 5.2) or, when throttling, without the cpu
+  // controller.
+  bool Open();
+
+  // Moves the process tree |pid| belongs to, up to its topmost ancestor
+  // running |exe|, into the group for |exe| and freezes it. Returns false
+  // if not even |pid| could be moved.
+  bool Freeze(int64_t pid, const std::string& exe);
+
+  // Whether |pid| was moved into a frozen group. A hash lookup, so focusing
+  // a frozen app's window again costs nothing.
+  bool IsFrozen(int64_t pid) const;
+
+  // Thaws the groups of executables |is_blocked| no longer blocks and
+  // forgets processes that have exited. Call after every policy change.
+  void Reconcile(const std::function<bool(const std::string& exe)>& is_blocked);
+
+  void ThawAll();
+
+  const std::string& root() const { return root_; }
+  Stats stats() const;
+
+ private:
+  struct Group {
+    std::string path;
+    // Where each process came from, by pid. Processes born in the group
+    // go back to |origin|, that of the first process moved in.
+    std::unordered_map<int64_t, std::string> origins;
+    std::string origin;
+  };
+
+  // The pids of the tree |pid| belongs to, parents first.
+  std::vector<int64_t> ProcessTree(int64_t pid, const std::string& exe) const;
+  // The cgroup directory |pid| is in, or empty.
+  std::string CgroupOf(int64_t pid) const;
+  bool Move(int64_t pid, const std::string& group);
+  void Thaw(Group* group);
+
+  const ProcFs proc_;
+  const Options options_;
+  const int64_t self_pid_;
+  // Where the cgroup v2 hierarchy is mounted, and the group for app groups.
+  std::string mount_;
+  std::string root_;
+
+  mutable std::mutex mutex_;
+  // By executable.
+  std::unordered_map<std::string, Group> groups_;
+  std::unordered_map<int64_t, std::string> frozen_pids_;
+  Stats stats_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_LINUX_CGROUP_FREEZER_H_
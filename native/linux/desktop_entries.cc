@@ -0,0 +1,217 @@
+#include "linux/desktop_entries.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+namespace routine {
+
+namespace {
+
+std::vector<std::string> SplitColons(const char* value) {
+  std::vector<std::string> parts;
+  std::string_view rest = value;
+  while (!rest.empty()) {
+    const size_t colon = rest.find(':');
+    const std::string_view part = rest.substr(0, colon);
+    if (!part.empty()) {
+      parts.emplace_back(part);
+    }
+    if (colon == std::string_view::npos) {
+      break;
+    }
+    rest.remove_prefix(colon + 1);
+  }
+  return parts;
+}
+
+std::string_view Trim(std::string_view value) {
+  while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+    value.remove_prefix(1);
+  }
+  while (!value.empty() && (value.back() == ' ' || value.back() == '\t' ||
+                            value.back() == '\r')) {
+    value.remove_suffix(1);
+  }
+  return value;
+}
+
+// The program of an Exec= line: its first word, unquoted, skipping an
+// "env VAR=value ..." prefix.
+std::string ExecProgram(std::string_view exec) {
+  for (;;) {
+    exec = Trim(exec);
+    std::string word;
+    if (!exec.empty() && exec.front() == '"') {
+      const size_t end = exec.find('"', 1);
+      word = std::string(exec.substr(1, end - 1));
+      exec.remove_prefix(end == std::string_view::npos ? exec.size()
+                                                       : end + 1);
+    } else {
+      const size_t end = exec.find_first_of(" \t");
+      word = std::string(exec.substr(0, end));
+      exec.remove_prefix(end == std::string_view::npos ? exec.size() : end);
+    }
+
+    const bool env = word == "env" || word == "/usr/bin/env";
+    const bool assignment = word.find('=') != std::string::npos &&
+                            word.find('/') == std::string::npos;
+    if (!env && !assignment) {
+      return word;
+    }
+    if (exec.empty()) {
+      return std::string();
+    }
+  }
+}
+
+// Resolves |program| the way the launcher would: through $PATH unless it
+// is a path, then through symlinks.
+std::string ResolveProgram(const std::string& program) {
+  std::vector<std::string> candidates;
+  if (program.find('/') != std::string::npos) {
+    candidates.push_back(program);
+  } else if (const char* path = getenv("PATH")) {
+    for (const auto& directory : SplitColons(path)) {
+      candidates.push_back(directory + "/" + program);
+    }
+  }
+
+  for (const auto& candidate : candidates) {
+    char resolved[PATH_MAX];
+    if (access(candidate.c_str(), X_OK) == 0 &&
+        realpath(candidate.c_str(), resolved) != nullptr) {
+      return resolved;
+    }
+  }
+  return std::string();
+}
+
+}  // namespace
+
+std::vector<std::string> DesktopEntries::DefaultDirectories() {
+  std::vector<std::string> roots;
+  if (const char* data_home = getenv("XDG_DATA_HOME");
+      data_home != nullptr && *data_home != '\0') {
+    roots.emplace_back(data_home);
+  } else if (const char* home = getenv("HOME")) {
+    roots.push_back(std::string(home) + "/.local/share");
+  }
+
+  const char* data_dirs = getenv("XDG_DATA_DIRS");
+  for (auto& root : SplitColons(data_dirs != nullptr && *data_dirs != '\0'
+                                    ? data_dirs
+                                    : "/usr/local/share:/usr/share")) {
+    roots.push_back(std::move(root));
+  }
+
+  std::vector<std::string> directories;
+  for (const auto& root : roots) {
+    directories.push_back(root + "/applications");
+  }
+  return directories;
+}
+
+DesktopEntries::DesktopEntries(std::vector<std::string> directories)
+    : directories_(std::move(directories)) {}
+
+std::optional<DesktopEntry> DesktopEntries::Find(const std::string& exe) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!scanned_) {
+    Scan();
+    scanned_ = true;
+  }
+  auto it = entries_.find(exe);
+  if (it == entries_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+std::optional<DesktopEntry> DesktopEntries::Parse(std::string_view contents) {
+  DesktopEntry entry;
+  std::string exec;
+  bool in_group = false;
+  bool application = false;
+
+  while (!contents.empty()) {
+    const size_t newline = contents.find('\n');
+    const std::string_view line = Trim(contents.substr(0, newline));
+    contents.remove_prefix(newline == std::string_view::npos ? contents.size()
+                                                             : newline + 1);
+
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    if (line.front() == '[') {
+      if (in_group) {
+        // Only the first group matters; actions come after it.
+        break;
+      }
+      in_group = line == "[Desktop Entry]";
+      continue;
+    }
+    if (!in_group) {
+      continue;
+    }
+
+    const size_t equals = line.find('=');
+    if (equals == std::string_view::npos) {
+      continue;
+    }
+    // Localised keys ("Name[de]") keep their bracket and are skipped.
+    const std::string_view key = Trim(line.substr(0, equals));
+    const std::string_view value = Trim(line.substr(equals + 1));
+    if (key == "Type") {
+      application = value == "Application";
+    } else if (key == "Name") {
+      entry.name = std::string(value);
+    } else if (key == "Icon") {
+      entry.icon = std::string(value);
+    } else if (key == "Exec") {
+      exec = std::string(value);
+    } else if (key == "TryExec") {
+      entry.program = std::string(value);
+    }
+  }
+
+  if (entry.program.empty()) {
+    entry.program = ExecProgram(exec);
+  }
+  if (!application || entry.name.empty() || entry.program.empty()) {
+    return std::nullopt;
+  }
+  return entry;
+}
+
+void DesktopEntries::Scan() {
+  for (const auto& directory : directories_) {
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator it(directory, error), end;
+    for (; !error && it != end; it.increment(error)) {
+      if (it->path().extension() != ".desktop") {
+        continue;
+      }
+      std::ifstream file(it->path());
+      std::stringstream contents;
+      contents << file.rdbuf();
+
+      auto entry = Parse(contents.str());
+      if (!entry) {
+        continue;
+      }
+      std::string exe = ResolveProgram(entry->program);
+      // Earlier directories take precedence, as they do for launchers.
+      if (!exe.empty()) {
+        entries_.emplace(std::move(exe), std::move(*entry));
+      }
+    }
+  }
+}
+
+}  // namespace routine
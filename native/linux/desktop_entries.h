@@ -0,0 +1,55 @@
+#ifndef ROUTINE_LINUX_DESKTOP_ENTRIES_H_
+#define ROUTINE_LINUX_DESKTOP_ENTRIES_H_
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace routine {
+
+// The parts of a freedesktop.org desktop entry the app picker shows.
+struct DesktopEntry {
+  std::string name;
+  std::string icon;
+  // The program Exec= (or TryExec=) launches, as written.
+  std::string program;
+};
+
+// Maps executables to the desktop entries that launch them.
+//
+// The application directories are only scanned the first time an
+// executable is looked up, so a picker whose entries all come from the
+// metadata cache never reads a desktop file. Thread-safe.
+class DesktopEntries {
+ public:
+  // $XDG_DATA_HOME/applications followed by the applications directories
+  // of $XDG_DATA_DIRS, most important first.
+  static std::vector<std::string> DefaultDirectories();
+
+  explicit DesktopEntries(
+      std::vector<std::string> directories = DefaultDirectories());
+
+  // Returns the entry whose program resolves to |exe|.
+  std::optional<DesktopEntry> Find(const std::string& exe);
+
+  // Parses the [Desktop Entry] group of |contents|. Returns nothing for
+  // entries that are not applications or lack a name or program.
+  static std::optional<DesktopEntry> Parse(std::string_view contents);
+
+ private:
+  void Scan();
+
+  const std::vector<std::string> directories_;
+
+  std::mutex mutex_;
+  bool scanned_ = false;
+  // Canonical executable path -> entry.
+  std::unordered_map<std::string, DesktopEntry> entries_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_LINUX_DESKTOP_ENTRIES_H_
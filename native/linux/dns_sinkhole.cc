@@ -0,0 +1,323 @@
+#include "linux/dns_sinkhole.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <memory>
+
+namespace routine {
+
+namespace {
+
+// Room for any UDP payload.
+constexpr size_t kBufferSize = 65536;
+// Packets read from one socket per wakeup before looking at the other, so
+// a flood of queries cannot starve upstream answers.
+constexpr int kMaxReadsPerWakeup = 64;
+// Keep this many upstream ids free so a new one is found quickly.
+constexpr size_t kMaxPending = 60000;
+
+bool ParseAddress(const std::string& address, uint16_t port,
+                  sockaddr_storage* storage, socklen_t* size) {
+  std::memset(storage, 0, sizeof(*storage));
+  auto* v4 = reinterpret_cast<sockaddr_in*>(storage);
+  if (inet_pton(AF_INET, address.c_str(), &v4->sin_addr) == 1) {
+    v4->sin_family = AF_INET;
+    v4->sin_port = htons(port);
+    *size = sizeof(sockaddr_in);
+    return true;
+  }
+  auto* v6 = reinterpret_cast<sockaddr_in6*>(storage);
+  if (inet_pton(AF_INET6, address.c_str(), &v6->sin6_addr) == 1) {
+    v6->sin6_family = AF_INET6;
+    v6->sin6_port = htons(port);
+    *size = sizeof(sockaddr_in6);
+    return true;
+  }
+  return false;
+}
+
+bool EndsWithLabel(std::string_view name, std::string_view suffix) {
+  return name == suffix ||
+         (name.size() > suffix.size() &&
+          name.compare(name.size() - suffix.size(), suffix.size(), suffix) ==
+              0 &&
+          name[name.size() - suffix.size() - 1] == '.');
+}
+
+}  // namespace
+
+DnsSinkhole::DnsSinkhole(Options options)
+    : options_(std::move(options)),
+      policy_(std::make_unique<const Policy>()),
+      cache_(options_.cache),
+      random_(std::random_device()()),
+      buffer_(kBufferSize) {}
+
+DnsSinkhole::~DnsSinkhole() { Stop(); }
+
+bool DnsSinkhole::Start() {
+  if (thread_.joinable()) {
+    return false;
+  }
+  sockaddr_storage listen;
+  socklen_t listen_size;
+  sockaddr_storage upstream;
+  socklen_t upstream_size;
+  if (!ParseAddress(options_.listen_address, options_.listen_port, &listen,
+                    &listen_size) ||
+      !ParseAddress(options_.upstream_address, options_.upstream_port,
+                    &upstream, &upstream_size)) {
+    return false;
+  }
+
+  listen_fd_ =
+      socket(listen.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  // Connected, so the kernel drops datagrams from anyone else.
+  upstream_fd_ =
+      socket(upstream.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (listen_fd_ < 0 || upstream_fd_ < 0 || epoll_fd_ < 0 || wake_fd_ < 0 ||
+      bind(listen_fd_, reinterpret_cast<sockaddr*>(&listen), listen_size) !=
+          0 ||
+      connect(upstream_fd_, reinterpret_cast<sockaddr*>(&upstream),
+              upstream_size) != 0) {
+    CloseAll();
+    return false;
+  }
+
+  sockaddr_storage bound;
+  socklen_t bound_size = sizeof(bound);
+  getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&bound), &bound_size);
+  port_ = ntohs(bound.ss_family == AF_INET
+                    ? reinterpret_cast<sockaddr_in*>(&bound)->sin_port
+                    : reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port);
+
+  for (const int fd : {listen_fd_, upstream_fd_, wake_fd_}) {
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+      CloseAll();
+      return false;
+    }
+  }
+
+  stopping_ = false;
+  thread_ = std::thread(&DnsSinkhole::Run, this);
+  return true;
+}
+
+void DnsSinkhole::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  stopping_ = true;
+  const uint64_t one = 1;
+  [[maybe_unused]] ssize_t written = write(wake_fd_, &one, sizeof(one));
+  thread_.join();
+  CloseAll();
+  pending_.clear();
+  deadlines_.clear();
+}
+
+void DnsSinkhole::SetSites(bool allow_list,
+                           const std::vector<std::string>& sites) {
+  auto policy = std::make_unique<Policy>();
+  policy->allow_list = allow_list;
+  for (const std::string& site : sites) {
+    policy->sites.Add(site);
+  }
+  policy_.Publish(std::move(policy));
+}
+
+DnsSinkhole::Stats DnsSinkhole::stats() const {
+  Stats stats;
+  stats.queries = queries_.load(std::memory_order_relaxed);
+  stats.blocked = blocked_.load(std::memory_order_relaxed);
+  stats.cached = cached_.load(std::memory_order_relaxed);
+  stats.forwarded = forwarded_.load(std::memory_order_relaxed);
+  stats.answered = answered_.load(std::memory_order_relaxed);
+  stats.timeouts = timeouts_.load(std::memory_order_relaxed);
+  stats.dropped = dropped_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void DnsSinkhole::Run() {
+  epoll_event events[3];
+  int timeout = -1;
+  while (!stopping_) {
+    const int ready = epoll_wait(epoll_fd_, events, 3, timeout);
+    if (ready < 0 && errno != EINTR) {
+      break;
+    }
+    for (int i = 0; i < ready; ++i) {
+      if (events[i].data.fd == listen_fd_) {
+        ReadQueries();
+      } else if (events[i].data.fd == upstream_fd_) {
+        ReadUpstream();
+      }
+    }
+    timeout = ExpirePending(Clock::now());
+  }
+}
+
+void DnsSinkhole::ReadQueries() {
+  for (int i = 0; i < kMaxReadsPerWakeup; ++i) {
+    sockaddr_storage from;
+    socklen_t from_size = sizeof(from);
+    const ssize_t size =
+        recvfrom(listen_fd_, buffer_.data(), buffer_.size(), 0,
+                 reinterpret_cast<sockaddr*>(&from), &from_size);
+    if (size < 0) {
+      return;
+    }
+    HandleQuery(std::string_view(buffer_.data(), static_cast<size_t>(size)),
+                from, from_size);
+  }
+}
+
+void DnsSinkhole::ReadUpstream() {
+  for (int i = 0; i < kMaxReadsPerWakeup; ++i) {
+    const ssize_t size = recv(upstream_fd_, buffer_.data(), buffer_.size(), 0);
+    if (size < 0) {
+      return;
+    }
+    HandleUpstream(std::string_view(buffer_.data(), static_cast<size_t>(size)));
+  }
+}
+
+void DnsSinkhole::HandleQuery(std::string_view query,
+                              const sockaddr_storage& from,
+                              socklen_t from_size) {
+  DnsQuestion question;
+  size_t question_end = 0;
+  if (!ParseDnsQuery(query, &question, &question_end)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  queries_.fetch_add(1, std::memory_order_relaxed);
+
+  if (IsBlocked(question.name)) {
+    blocked_.fetch_add(1, std::memory_order_relaxed);
+    Reply(BuildDnsBlockedResponse(
+              query, question_end, question,
+              options_.block_answer == BlockAnswer::kSinkhole,
+              options_.blocked_ttl),
+          from, from_size);
+    return;
+  }
+
+  const Clock::time_point now = Clock::now();
+  std::string response;
+  if (cache_.Lookup(question, DnsId(query), now, &response)) {
+    cached_.fetch_add(1, std::memory_order_relaxed);
+    Reply(response, from, from_size);
+    return;
+  }
+
+  if (pending_.size() >= kMaxPending) {
+    Reply(BuildDnsErrorResponse(query, question_end, kDnsServFail), from,
+          from_size);
+    return;
+  }
+  uint16_t id;
+  do {
+    id = static_cast<uint16_t>(random_());
+  } while (pending_.count(id) != 0);
+
+  std::string upstream(query);
+  SetDnsId(id, upstream.data());
+  if (send(upstream_fd_, upstream.data(), upstream.size(), 0) < 0) {
+    Reply(BuildDnsErrorResponse(query, question_end, kDnsServFail), from,
+          from_size);
+    return;
+  }
+  forwarded_.fetch_add(1, std::memory_order_relaxed);
+
+  Pending& pending = pending_[id];
+  pending.client = from;
+  pending.client_size = from_size;
+  pending.query.assign(query);
+  pending.question_end = question_end;
+  pending.question = std::move(question);
+  pending.deadline = now + options_.upstream_timeout;
+  deadlines_.emplace_back(pending.deadline, id);
+}
+
+void DnsSinkhole::HandleUpstream(std::string_view response) {
+  auto it = pending_.find(DnsId(response));
+  DnsResponseInfo info;
+  if (it == pending_.end() ||
+      !ScanDnsResponse(response, it->second.question, &info)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  const Pending& pending = it->second;
+  cache_.Insert(pending.question, response, info, Clock::now());
+
+  std::string relayed(response);
+  SetDnsId(DnsId(pending.query), relayed.data());
+  Reply(relayed, pending.client, pending.client_size);
+  answered_.fetch_add(1, std::memory_order_relaxed);
+  pending_.erase(it);
+}
+
+int DnsSinkhole::ExpirePending(Clock::time_point now) {
+  while (!deadlines_.empty()) {
+    const auto [deadline, id] = deadlines_.front();
+    auto it = pending_.find(id);
+    if (it == pending_.end() || it->second.deadline != deadline) {
+      // Answered, and perhaps the id reused since.
+      deadlines_.pop_front();
+      continue;
+    }
+    if (deadline > now) {
+      const auto wait =
+          std::chrono::ceil<std::chrono::milliseconds>(deadline - now);
+      return static_cast<int>(wait.count());
+    }
+    timeouts_.fetch_add(1, std::memory_order_relaxed);
+    Reply(BuildDnsErrorResponse(it->second.query, it->second.question_end,
+                                kDnsServFail),
+          it->second.client, it->second.client_size);
+    pending_.erase(it);
+    deadlines_.pop_front();
+  }
+  return -1;
+}
+
+bool DnsSinkhole::IsBlocked(const std::string& name) const {
+  if (name.empty()) {
+    return false;
+  }
+  auto policy = policy_.Read();
+  if (!policy->allow_list) {
+    return policy->sites.Matches(name);
+  }
+  return !EndsWithLabel(name, "arpa") && !EndsWithLabel(name, "localhost") &&
+         !policy->sites.Matches(name);
+}
+
+void DnsSinkhole::Reply(std::string_view message, const sockaddr_storage& to,
+                        socklen_t to_size) {
+  sendto(listen_fd_, message.data(), message.size(), 0,
+         reinterpret_cast<const sockaddr*>(&to), to_size);
+}
+
+void DnsSinkhole::CloseAll() {
+  for (int* fd : {&listen_fd_, &upstream_fd_, &epoll_fd_, &wake_fd_}) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+}
+
+}  // namespace routine
@@ -0,0 +1,159 @@
+#ifndef ROUTINE_LINUX_DNS_SINKHOLE_H_
+#define ROUTINE_LINUX_DNS_SINKHOLE_H_
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "core/dns_cache.h"
+#include "core/dns_message.h"
+#include "core/domain_matcher.h"
+#include "core/rcu_cell.h"
+
+namespace routine {
+
+// A stub DNS resolver on a loopback UDP port that refuses blocked sites for
+// every program on the machine, not just browsers with the extension.
+// Blocked names are answered on the spot with NXDOMAIN or an unspecified
+// address; the rest are relayed to an upstream resolver, and its answers
+// cached for their TTL.
+//
+// One thread runs an epoll loop over the listening socket, a socket
+// connected to the upstream resolver and an eventfd for shutdown. Queries
+// in flight are keyed by a random upstream id; an answer must also repeat
+// the question to be relayed. A query the upstream leaves unanswered for
+// |upstream_timeout| gets SERVFAIL, so the client moves on to its next
+// nameserver. Only UDP is served.
+class DnsSinkhole {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class BlockAnswer {
+    kNxDomain,
+    // A 0.0.0.0 or AAAA ::, which fails fast in clients that retry other
+    // nameservers on NXDOMAIN.
+    kSinkhole,
+  };
+
+  struct Options {
+    // Numeric IPv4 or IPv6 addresses.
+    std::string listen_address = "127.0.0.1";
+    // 0 picks a free port; see port().
+    uint16_t listen_port = 53;
+    std::string upstream_address;
+    uint16_t upstream_port = 53;
+
+    BlockAnswer block_answer = BlockAnswer::kNxDomain;
+    // Short, so a site is reachable soon after it is unblocked.
+    uint32_t blocked_ttl = 10;
+    DnsCache::Options cache;
+    std::chrono::milliseconds upstream_timeout{2000};
+  };
+
+  struct Stats {
+    uint64_t queries = 0;
+    uint64_t blocked = 0;
+    // Answered from the cache.
+    uint64_t cached = 0;
+    uint64_t forwarded = 0;
+    // Upstream answers relayed to the client that asked.
+    uint64_t answered = 0;
+    uint64_t timeouts = 0;
+    // Malformed queries and upstream packets that answer nothing pending.
+    uint64_t dropped = 0;
+  };
+
+  explicit DnsSinkhole(Options options);
+  ~DnsSinkhole();
+
+  DnsSinkhole(const DnsSinkhole&) = delete;
+  DnsSinkhole& operator=(const DnsSinkhole&) = delete;
+
+  // Binds the listening socket and starts the resolver thread. Returns
+  // false if an address is invalid or the port cannot be bound (port 53
+  // needs CAP_NET_BIND_SERVICE).
+  bool Start();
+  void Stop();
+
+  // The bound listening port once started.
+  uint16_t port() const { return port_; }
+
+  // Blocks |sites| and their subdomains or, with |allow_list|, everything
+  // else. Allow lists leave reverse lookups and localhost alone. Safe from
+  // any thread; applies to the next query.
+  void SetSites(bool allow_list, const std::vector<std::string>& sites);
+
+  Stats stats() const;
+  DnsCache::Stats cache_stats() const { return cache_.stats(); }
+
+ private:
+  struct Policy {
+    bool allow_list = false;
+    DomainMatcher sites;
+  };
+  struct Pending {
+    sockaddr_storage client;
+    socklen_t client_size = 0;
+    // The client's query with its own id, for a SERVFAIL on timeout.
+    std::string query;
+    size_t question_end = 0;
+    DnsQuestion question;
+    Clock::time_point deadline;
+  };
+
+  void Run();
+  void ReadQueries();
+  void ReadUpstream();
+  void HandleQuery(std::string_view query, const sockaddr_storage& from,
+                   socklen_t from_size);
+  void HandleUpstream(std::string_view response);
+  // Answers SERVFAIL to queries past their deadline and returns the epoll
+  // timeout until the next one, or -1.
+  int ExpirePending(Clock::time_point now);
+  bool IsBlocked(const std::string& name) const;
+  void Reply(std::string_view message, const sockaddr_storage& to,
+             socklen_t to_size);
+  void CloseAll();
+
+  const Options options_;
+  RcuCell<Policy> policy_;
+
+  int listen_fd_ = -1;
+  int upstream_fd_ = -1;
+  int epoll_fd_ = -1;
+  int wake_fd_ = -1;
+  uint16_t port_ = 0;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+
+  // Resolver thread only.
+  DnsCache cache_;
+  std::unordered_map<uint16_t, Pending> pending_;
+  // Upstream ids by deadline; the timeout is fixed, so arrival order is
+  // deadline order. Ids answered meanwhile are skipped.
+  std::deque<std::pair<Clock::time_point, uint16_t>> deadlines_;
+  std::mt19937 random_;
+  std::vector<char> buffer_;
+
+  std::atomic<uint64_t> queries_{0};
+  std::atomic<uint64_t> blocked_{0};
+  std::atomic<uint64_t> cached_{0};
+  std::atomic<uint64_t> forwarded_{0};
+  std::atomic<uint64_t> answered_{0};
+  std::atomic<uint64_t> timeouts_{0};
+  std::atomic<uint64_t> dropped_{0};
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_LINUX_DNS_SINKHOLE_H_
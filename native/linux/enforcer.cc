@@ -0,0 +1,176 @@
+#include "linux/enforcer.h"
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <utility>
+
+namespace routine {
+
+Enforcer::Enforcer(const PolicyStore* policy, ProcFs proc, Mode mode,
+                   MinimizeFunction minimize,
+                   EnforcementStats* enforcement_stats,
+                   CgroupFreezer* freezer)
+    : policy_(policy),
+      self_pid_(getpid()),
+      proc_(std::move(proc)),
+      mode_(mode),
+      minimize_(std::move(minimize)),
+      enforcement_stats_(enforcement_stats),
+      freezer_(freezer) {}
+
+Enforcer::~Enforcer() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& [pid, process] : suspended_) {
+    Resume(pid, process);
+  }
+  suspended_.clear();
+}
+
+bool Enforcer::Enforce(const ForegroundWindow& window) {
+  if (window.pid <= 0) {
+    return false;
+  }
+  if (IsFrozen(window.pid)) {
+    return true;
+  }
+
+  const std::string exe = proc_.ReadExe(window.pid);
+  if (exe.empty()) {
+    // Kernel threads and other users' processes are skipped silently in
+    // EnforceProcess(); a focused window should always be readable.
+    if (enforcement_stats_ != nullptr) {
+      enforcement_stats_->image_path_failures.Add();
+    }
+    return false;
+  }
+  const std::string blocked_exe = Attribute(window.pid, exe);
+  if (blocked_exe.empty()) {
+    return false;
+  }
+
+  if (mode_ == Mode::kMinimize) {
+    if (minimize_) {
+      minimize_(window.window);
+    }
+    return true;
+  }
+
+  Stop(window.pid, blocked_exe);
+  return true;
+}
+
+bool Enforcer::EnforceProcess(int64_t pid) {
+  // Shells, helpers and the session itself are never listed, so allow
+  // lists are left to focus enforcement.
+  if (policy_->allow_list()) {
+    return false;
+  }
+  if (pid <= 0 || pid == self_pid_) {
+    return false;
+  }
+  if (IsFrozen(pid)) {
+    return true;
+  }
+
+  const std::string exe = proc_.ReadExe(pid);
+  if (exe.empty()) {
+    return false;
+  }
+  const std::string blocked_exe = Attribute(pid, exe);
+  if (blocked_exe.empty()) {
+    return false;
+  }
+  Stop(pid, blocked_exe);
+  return true;
+}
+
+void Enforcer::EnforceRunning() {
+  for (const int64_t pid : proc_.ListPids()) {
+    EnforceProcess(pid);
+  }
+}
+
+void Enforcer::Reconcile() {
+  if (freezer_ != nullptr) {
+    freezer_->Reconcile(
+        [this](const std::string& exe) { return IsBlocked(exe); });
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = suspended_.begin(); it != suspended_.end();) {
+    ProcessInfo info;
+    const bool alive = proc_.ReadStat(it->first, &info) &&
+                       info.start_time == it->second.start_time;
+    if (!alive) {
+      it = suspended_.erase(it);
+    } else if (!IsBlocked(it->second.exe)) {
+      Resume(it->first, it->second);
+      it = suspended_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+size_t Enforcer::suspended_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return suspended_.size();
+}
+
+bool Enforcer::IsBlocked(const std::string& exe) {
+  if (enforcement_stats_ == nullptr) {
+    return policy_->IsBlocked(exe);
+  }
+  ScopedLatency latency(&enforcement_stats_->is_blocked,
+                        &enforcement_stats_->trace, "isBlocked");
+  return policy_->IsBlocked(exe);
+}
+
+std::string Enforcer::Attribute(int64_t pid, const std::string& exe) {
+  if (IsBlocked(exe)) {
+    return exe;
+  }
+  // Under an allow list nearly every ancestor is unlisted, so lineage
+  // would block the whole desktop.
+  if (tree_ == nullptr || policy_->allow_list()) {
+    return std::string();
+  }
+  // Started by a blocked app. Resuming is keyed on that app, so the
+  // process runs again once it is unblocked.
+  return tree_->FindInLineage(
+      pid, [this](const std::string& ancestor) { return IsBlocked(ancestor); });
+}
+
+bool Enforcer::IsFrozen(int64_t pid) const {
+  return mode_ == Mode::kFreeze && freezer_ != nullptr &&
+         freezer_->IsFrozen(pid);
+}
+
+void Enforcer::Stop(int64_t pid, const std::string& exe) {
+  if (mode_ == Mode::kFreeze && freezer_ != nullptr &&
+      freezer_->Freeze(pid, exe)) {
+    return;
+  }
+  Suspend(pid, exe);
+}
+
+void Enforcer::Suspend(int64_t pid, const std::string& exe) {
+  ProcessInfo info;
+  if (!proc_.ReadStat(pid, &info)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (kill(static_cast<pid_t>(pid), SIGSTOP) == 0) {
+    suspended_[pid] = Suspended{info.start_time, exe};
+  }
+}
+
+void Enforcer::Resume(int64_t pid, const Suspended& process) {
+  // Never signal a process that merely inherited the pid.
+  ProcessInfo info;
+  if (proc_.ReadStat(pid, &info) && info.start_time == process.start_time) {
+    kill(static_cast<pid_t>(pid), SIGCONT);
+  }
+}
+
+}  // namespace routine
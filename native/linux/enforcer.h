@@ -0,0 +1,103 @@
+#ifndef ROUTINE_LINUX_ENFORCER_H_
+#define ROUTINE_LINUX_ENFORCER_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "core/enforcement_stats.h"
+#include "core/foreground_tracker.h"
+#include "core/policy_store.h"
+#include "core/process_tree.h"
+#include "linux/cgroup_freezer.h"
+#include "linux/proc_fs.h"
+
+namespace routine {
+
+// Applies the block policy to focused windows and newly executed processes
+// on Linux.
+class Enforcer {
+ public:
+  enum class Mode {
+    // Minimise the focused window, as the Windows runner does.
+    kMinimize,
+    // SIGSTOP the owning process until the policy stops blocking it.
+    kSuspend,
+    // Freeze (or throttle) the app's whole process tree in a cgroup until
+    // the policy stops blocking it, falling back to kSuspend where the
+    // cgroup cannot take the process.
+    kFreeze,
+  };
+
+  using MinimizeFunction = std::function<bool(uint64_t window)>;
+
+  // |enforcement_stats|, when given, must outlive the enforcer and receives
+  // the time of each policy lookup and a count of focused windows whose
+  // executable could not be read. |freezer|, required by kFreeze, must be
+  // open and outlive the enforcer.
+  Enforcer(const PolicyStore* policy, ProcFs proc, Mode mode,
+           MinimizeFunction minimize,
+           EnforcementStats* enforcement_stats = nullptr,
+           CgroupFreezer* freezer = nullptr);
+  // Resumes everything this enforcer suspended.
+  ~Enforcer();
+
+  Enforcer(const Enforcer&) = delete;
+  Enforcer& operator=(const Enforcer&) = delete;
+
+  // Handles a focus change. Returns whether the window's process is blocked.
+  bool Enforce(const ForegroundWindow& window);
+
+  // Handles a process that just called exec(). There is no window yet, so a
+  // blocked process is suspended, or frozen in kFreeze. Allow lists are
+  // only enforced on focus. Returns whether it is blocked.
+  bool EnforceProcess(int64_t pid);
+
+  // Checks every running process, for when exec notifications were lost.
+  void EnforceRunning();
+
+  // Resumes suspended processes the current policy no longer blocks. Call
+  // after every policy change.
+  void Reconcile();
+
+  size_t suspended_count() const;
+
+  // With a tree, a block list stops whatever a blocked app starts too,
+  // even after the app exits. Allow lists ignore the tree. |tree| may be
+  // null and must outlive the enforcer. Set before enforcing.
+  void set_process_tree(const ProcessTree* tree) { tree_ = tree; }
+
+ private:
+  struct Suspended {
+    uint64_t start_time = 0;
+    std::string exe;
+  };
+
+  bool IsBlocked(const std::string& exe);
+  // The executable |pid|, running |exe|, is blocked as: its own or an
+  // ancestor's. Empty if it is not blocked.
+  std::string Attribute(int64_t pid, const std::string& exe);
+  // Whether |pid| is frozen already, which needs no /proc access.
+  bool IsFrozen(int64_t pid) const;
+  void Stop(int64_t pid, const std::string& exe);
+  void Suspend(int64_t pid, const std::string& exe);
+  void Resume(int64_t pid, const Suspended& process);
+
+  const PolicyStore* policy_;
+  const int64_t self_pid_;
+  ProcFs proc_;
+  Mode mode_;
+  MinimizeFunction minimize_;
+  EnforcementStats* const enforcement_stats_;
+  CgroupFreezer* const freezer_;
+  const ProcessTree* tree_ = nullptr;
+
+  mutable std::mutex mutex_;
+  std::map<int64_t, Suspended> suspended_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_LINUX_ENFORCER_H_
@@ -0,0 +1,181 @@
+#include "linux/exec_blocker.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <utility>
+
+namespace routine {
+
+namespace {
+
+uint64_t MonotonicNs() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000u +
+         static_cast<uint64_t>(now.tv_nsec);
+}
+
+}  // namespace
+
+ExecBlocker::ExecBlocker(Enforcer* enforcer, ProcessTree* tree, ProcFs proc)
+    : enforcer_(enforcer), tree_(tree), proc_(std::move(proc)) {
+  batch_.reserve(ProcConnector::kMaxBatch);
+}
+
+ExecBlocker::~ExecBlocker() { Stop(); }
+
+bool ExecBlocker::Start() {
+  const uint32_t types =
+      tree_ != nullptr
+          ? ProcConnector::kFork | ProcConnector::kExec | ProcConnector::kExit
+          : ProcConnector::kExec;
+  if (thread_.joinable() || !connector_.Open(types)) {
+    return false;
+  }
+  if (pipe2(wake_fds_, O_CLOEXEC | O_NONBLOCK) != 0) {
+    connector_.Close();
+    return false;
+  }
+
+  // After subscribing, so nothing forked meanwhile is missed; events for
+  // processes the scan already saw are applied harmlessly on top.
+  if (tree_ != nullptr) {
+    ScanProcesses();
+  }
+  stopping_ = false;
+  thread_ = std::thread(&ExecBlocker::Run, this);
+  return true;
+}
+
+void ExecBlocker::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  stopping_ = true;
+  const char byte = 0;
+  [[maybe_unused]] ssize_t written = write(wake_fds_[1], &byte, 1);
+  thread_.join();
+
+  connector_.Close();
+  close(wake_fds_[0]);
+  close(wake_fds_[1]);
+  wake_fds_[0] = wake_fds_[1] = -1;
+}
+
+void ExecBlocker::HandleBatch(const std::vector<ProcEvent>& events,
+                              bool overrun) {
+  batches_.fetch_add(1, std::memory_order_relaxed);
+  if (overrun) {
+    // Some execs were never reported; the only safe recovery is to look at
+    // everything that is running now.
+    overruns_.fetch_add(1, std::memory_order_relaxed);
+    if (tree_ != nullptr) {
+      ScanProcesses();
+    }
+    enforcer_->EnforceRunning();
+  }
+
+  uint64_t execs = 0;
+  uint64_t blocked = 0;
+  uint64_t total_latency = 0;
+  uint64_t max_latency = 0;
+  for (const ProcEvent& event : events) {
+    if (tree_ != nullptr) {
+      switch (event.type) {
+        case ProcEvent::Type::kFork:
+          tree_->Fork(event.pid, event.parent_pid);
+          continue;
+        case ProcEvent::Type::kExec:
+          tree_->Exec(event.pid, proc_.ReadExe(event.pid));
+          break;
+        case ProcEvent::Type::kExit:
+          tree_->Exit(event.pid);
+          continue;
+      }
+    }
+    if (event.type != ProcEvent::Type::kExec) {
+      continue;
+    }
+    ++execs;
+    if (enforcer_->EnforceProcess(event.pid)) {
+      ++blocked;
+    }
+    const uint64_t now = MonotonicNs();
+    const uint64_t latency =
+        now > event.timestamp_ns ? now - event.timestamp_ns : 0;
+    total_latency += latency;
+    if (latency > max_latency) {
+      max_latency = latency;
+    }
+  }
+
+  execs_.fetch_add(execs, std::memory_order_relaxed);
+  blocked_.fetch_add(blocked, std::memory_order_relaxed);
+  total_latency_ns_.fetch_add(total_latency, std::memory_order_relaxed);
+  uint64_t previous = max_latency_ns_.load(std::memory_order_relaxed);
+  while (previous < max_latency &&
+         !max_latency_ns_.compare_exchange_weak(previous, max_latency,
+                                                std::memory_order_relaxed)) {
+  }
+}
+
+ExecBlocker::Stats ExecBlocker::stats() const {
+  Stats stats;
+  stats.batches = batches_.load(std::memory_order_relaxed);
+  stats.execs = execs_.load(std::memory_order_relaxed);
+  stats.blocked = blocked_.load(std::memory_order_relaxed);
+  stats.overruns = overruns_.load(std::memory_order_relaxed);
+  stats.total_latency_ns = total_latency_ns_.load(std::memory_order_relaxed);
+  stats.max_latency_ns = max_latency_ns_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void ExecBlocker::ScanProcesses() {
+  std::vector<ProcessTree::Seed> processes;
+  for (const int64_t pid : proc_.ListPids()) {
+    ProcessInfo info;
+    if (proc_.ReadStat(pid, &info)) {
+      processes.push_back({pid, info.ppid, proc_.ReadExe(pid)});
+    }
+  }
+  tree_->Reset(processes);
+}
+
+void ExecBlocker::Run() {
+  pollfd fds[2];
+  fds[0].fd = connector_.fd();
+  fds[0].events = POLLIN;
+  fds[1].fd = wake_fds_[0];
+  fds[1].events = POLLIN;
+
+  while (!stopping_) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (fds[1].revents & POLLIN) {
+      continue;
+    }
+
+    // Drain everything queued so far; each recvmmsg() returns up to
+    // kMaxBatch events, and under load several calls' worth arrive per
+    // wakeup.
+    for (;;) {
+      batch_.clear();
+      bool overrun = false;
+      const size_t read = connector_.ReadBatch(&batch_, &overrun);
+      if (read == 0 && !overrun) {
+        break;
+      }
+      HandleBatch(batch_, overrun);
+    }
+  }
+}
+
+}  // namespace routine
@@ -0,0 +1,87 @@
+#ifndef ROUTINE_LINUX_EXEC_BLOCKER_H_
+#define ROUTINE_LINUX_EXEC_BLOCKER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "core/process_tree.h"
+#include "linux/enforcer.h"
+#include "linux/proc_connector.h"
+#include "linux/proc_fs.h"
+
+namespace routine {
+
+// Blocks applications as they start rather than once they take focus: every
+// exec() reported by the proc connector is checked against the policy and a
+// blocked process is suspended before it can map a window.
+//
+// Events are drained in batches so a fork storm costs one wakeup and one
+// recvmmsg() per batch rather than per process.
+//
+// Given a ProcessTree, it also keeps the tree current from fork and exit
+// events, after seeding it from /proc, and applies each batch to the tree
+// before enforcing its execs, so a process is judged with its ancestry.
+class ExecBlocker {
+ public:
+  struct Stats {
+    uint64_t batches = 0;
+    uint64_t execs = 0;
+    uint64_t blocked = 0;
+    // Times the kernel dropped events and we fell back to a full scan.
+    uint64_t overruns = 0;
+    // From the kernel emitting an exec event to its verdict.
+    uint64_t total_latency_ns = 0;
+    uint64_t max_latency_ns = 0;
+  };
+
+  // |tree|, if given, must outlive the blocker and should be the one the
+  // enforcer attributes with.
+  explicit ExecBlocker(Enforcer* enforcer, ProcessTree* tree = nullptr,
+                       ProcFs proc = ProcFs());
+  ~ExecBlocker();
+
+  ExecBlocker(const ExecBlocker&) = delete;
+  ExecBlocker& operator=(const ExecBlocker&) = delete;
+
+  // Subscribes to exec events, and fork and exit events for the tree,
+  // seeds the tree and starts the event thread. Returns false
+  // without CAP_NET_ADMIN, in which case focus enforcement still applies.
+  bool Start();
+  void Stop();
+
+  // Handles one batch of events on the calling thread. |overrun| means
+  // events were lost before this batch.
+  void HandleBatch(const std::vector<ProcEvent>& events, bool overrun);
+
+  Stats stats() const;
+
+ private:
+  void Run();
+  // Rebuilds the tree from what is running now.
+  void ScanProcesses();
+
+  Enforcer* enforcer_;
+  ProcessTree* const tree_;
+  const ProcFs proc_;
+  ProcConnector connector_;
+
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+  int wake_fds_[2] = {-1, -1};
+
+  // Only touched by the event thread (or a caller of HandleBatch()).
+  std::vector<ProcEvent> batch_;
+
+  std::atomic<uint64_t> batches_{0};
+  std::atomic<uint64_t> execs_{0};
+  std::atomic<uint64_t> blocked_{0};
+  std::atomic<uint64_t> overruns_{0};
+  std::atomic<uint64_t> total_latency_ns_{0};
+  std::atomic<uint64_t> max_latency_ns_{0};
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_LINUX_EXEC_BLOCKER_H_
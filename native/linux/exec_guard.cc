@@ -0,0 +1,328 @@
+#include "linux/exec_guard.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <mntent.h>
+#include <poll.h>
+#include <sys/fanotify.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#include "core/path.h"
+
+namespace routine {
+
+namespace {
+
+uint64_t MonotonicNs() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000u +
+         static_cast<uint64_t>(now.tv_nsec);
+}
+
+// Mount points of everything mounted, as the kernel lists them.
+std::vector<std::string> MountedFilesystems() {
+  std::vector<std::string> mounts;
+  FILE* table = setmntent("/proc/self/mounts", "r");
+  if (table == nullptr) {
+    return {"/"};
+  }
+  mntent entry;
+  char buffer[4096];
+  while (getmntent_r(table, &entry, buffer, sizeof(buffer)) != nullptr) {
+    mounts.emplace_back(entry.mnt_dir);
+  }
+  endmntent(table);
+  return mounts;
+}
+
+bool Mark(int fanotify_fd, const std::string& path) {
+  // FAN_MARK_FILESYSTEM (5.1) also covers bind mounts of the filesystem
+  // made later; older kernels mark the mount.
+  for (const unsigned int kind : {FAN_MARK_FILESYSTEM, FAN_MARK_MOUNT}) {
+    if (fanotify_mark(fanotify_fd, FAN_MARK_ADD | kind, FAN_OPEN_EXEC_PERM,
+                      AT_FDCWD, path.c_str()) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+ExecGuard::ExecGuard(const PolicyStore* policy, Options options)
+    : policy_(policy),
+      options_(std::move(options)),
+      self_pid_(getpid()),
+      cache_(options_.cache_capacity) {}
+
+ExecGuard::~ExecGuard() { Stop(); }
+
+bool ExecGuard::Start() {
+  if (thread_.joinable()) {
+    return false;
+  }
+  fanotify_fd_ = fanotify_init(FAN_CLASS_CONTENT | FAN_CLOEXEC | FAN_NONBLOCK,
+                               O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+  if (fanotify_fd_ < 0) {
+    return false;
+  }
+  // Marked even under an allow list, to find out whether the kernel has
+  // FAN_OPEN_EXEC_PERM; Reconcile() drops the marks again.
+  if (!MarkAll() || pipe2(wake_fds_, O_CLOEXEC | O_NONBLOCK) != 0) {
+    close(fanotify_fd_);
+    fanotify_fd_ = -1;
+    marked_ = false;
+    return false;
+  }
+
+  stopping_ = false;
+  thread_ = std::thread(&ExecGuard::Run, this);
+  watchdog_ = std::thread(&ExecGuard::Watch, this);
+  Reconcile();
+  return true;
+}
+
+void ExecGuard::Reconcile() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  const bool guard = !policy_->allow_list();
+  if (guard && !marked_) {
+    MarkAll();
+  } else if (!guard && marked_) {
+    // Removes both kinds Mark() may have added.
+    for (const unsigned int kind : {FAN_MARK_FILESYSTEM, FAN_MARK_MOUNT}) {
+      fanotify_mark(fanotify_fd_, FAN_MARK_FLUSH | kind, 0, AT_FDCWD,
+                    nullptr);
+    }
+    marked_ = false;
+  }
+}
+
+bool ExecGuard::MarkAll() {
+  bool marked = false;
+  for (const std::string& mount :
+       options_.mounts.empty() ? MountedFilesystems() : options_.mounts) {
+    // Pseudo filesystems refuse the mark; nothing executes from them.
+    marked |= Mark(fanotify_fd_, mount);
+  }
+  marked_ = marked;
+  return marked;
+}
+
+void ExecGuard::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  watchdog_wake_.notify_one();
+  const char byte = 0;
+  [[maybe_unused]] ssize_t written = write(wake_fds_[1], &byte, 1);
+  thread_.join();
+  watchdog_.join();
+
+  // The kernel allows whatever is still waiting once the group is closed.
+  close(fanotify_fd_);
+  fanotify_fd_ = -1;
+  close(wake_fds_[0]);
+  close(wake_fds_[1]);
+  wake_fds_[0] = wake_fds_[1] = -1;
+}
+
+bool ExecGuard::IsDenied(int fd, pid_t pid) {
+  // Allow lists are enforced only on focus; unlisted execs include the
+  // shell and every system helper. Answered before any syscall, for the
+  // events queued before Reconcile() removed the marks.
+  if (pid == self_pid_ || policy_->allow_list()) {
+    return false;
+  }
+  struct stat file;
+  if (fstat(fd, &file) != 0) {
+    return false;
+  }
+  // The change time moves when the file is rewritten in place, which keeps
+  // its inode. Hard links share a verdict: the one of the path first seen.
+  const uint64_t key = MixHash(
+      MixHash(static_cast<uint64_t>(file.st_dev),
+              static_cast<uint64_t>(file.st_ino)),
+      static_cast<uint64_t>(file.st_ctim.tv_sec) * 1000000000u +
+          static_cast<uint64_t>(file.st_ctim.tv_nsec));
+  // Read first, so a verdict computed across a policy change is filed
+  // under the old generation and never served.
+  const uint64_t generation = policy_->generation();
+  bool denied;
+  if (cache_.Lookup(key, generation, &denied)) {
+    cached_.fetch_add(1, std::memory_order_relaxed);
+    return denied;
+  }
+
+  denied = false;
+  char link[32];
+  std::snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+  char path[PATH_MAX];
+  const ssize_t size = readlink(link, path, sizeof(path));
+  if (size > 0 && static_cast<size_t>(size) < sizeof(path)) {
+    denied = policy_->IsBlocked(
+        std::string_view(path, static_cast<size_t>(size)));
+  }
+  cache_.Insert(key, generation, denied);
+  return denied;
+}
+
+ExecGuard::Stats ExecGuard::stats() const {
+  Stats stats;
+  stats.execs = execs_.load(std::memory_order_relaxed);
+  stats.denied = denied_.load(std::memory_order_relaxed);
+  stats.cached = cached_.load(std::memory_order_relaxed);
+  stats.timeouts = timeouts_.load(std::memory_order_relaxed);
+  stats.total_latency_ns = total_latency_ns_.load(std::memory_order_relaxed);
+  stats.max_latency_ns = max_latency_ns_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void ExecGuard::Run() {
+  pollfd fds[2];
+  fds[0].fd = fanotify_fd_;
+  fds[0].events = POLLIN;
+  fds[1].fd = wake_fds_[0];
+  fds[1].events = POLLIN;
+
+  while (!stopping_) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (fds[1].revents & POLLIN) {
+      continue;
+    }
+    while (HandleEvents()) {
+    }
+  }
+}
+
+bool ExecGuard::HandleEvents() {
+  alignas(fanotify_event_metadata) char buffer[4096];
+  const ssize_t size = read(fanotify_fd_, buffer, sizeof(buffer));
+  if (size <= 0) {
+    return false;
+  }
+  const uint64_t start = MonotonicNs();
+
+  incoming_.clear();
+  ssize_t left = size;
+  for (auto* event = reinterpret_cast<fanotify_event_metadata*>(buffer);
+       FAN_EVENT_OK(event, left); event = FAN_EVENT_NEXT(event, left)) {
+    if (event->fd < 0) {
+      continue;
+    }
+    if (event->vers != FANOTIFY_METADATA_VERSION ||
+        !(event->mask & FAN_OPEN_EXEC_PERM)) {
+      // Answer what we cannot read rather than leave the exec waiting.
+      Respond(event->fd, true);
+      close(event->fd);
+      continue;
+    }
+    incoming_.push_back(Event{event->fd, static_cast<pid_t>(event->pid)});
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batch_.swap(incoming_);
+    batch_start_ns_.store(start, std::memory_order_relaxed);
+  }
+
+  uint64_t denied = 0;
+  uint64_t total_latency = 0;
+  uint64_t max_latency = 0;
+  for (Event& event : batch_) {
+    const bool deny = IsDenied(event.fd, event.pid);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (event.answered) {
+      continue;
+    }
+    Respond(event.fd, !deny);
+    event.answered = true;
+    denied += deny ? 1 : 0;
+    const uint64_t latency = MonotonicNs() - start;
+    total_latency += latency;
+    if (latency > max_latency) {
+      max_latency = latency;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const Event& event : batch_) {
+      close(event.fd);
+    }
+    execs_.fetch_add(batch_.size(), std::memory_order_relaxed);
+    batch_.clear();
+    batch_start_ns_.store(0, std::memory_order_relaxed);
+  }
+
+  denied_.fetch_add(denied, std::memory_order_relaxed);
+  total_latency_ns_.fetch_add(total_latency, std::memory_order_relaxed);
+  uint64_t previous = max_latency_ns_.load(std::memory_order_relaxed);
+  while (previous < max_latency &&
+         !max_latency_ns_.compare_exchange_weak(previous, max_latency,
+                                                std::memory_order_relaxed)) {
+  }
+  return true;
+}
+
+void ExecGuard::Respond(int fd, bool allow) {
+  fanotify_response response;
+  response.fd = fd;
+  response.response = allow ? FAN_ALLOW : FAN_DENY;
+  [[maybe_unused]] ssize_t written =
+      write(fanotify_fd_, &response, sizeof(response));
+}
+
+void ExecGuard::Watch() {
+  const uint64_t timeout_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(options_.timeout)
+          .count();
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    watchdog_wake_.wait_for(lock, options_.timeout / 2);
+    const uint64_t start = batch_start_ns_.load(std::memory_order_relaxed);
+    if (start != 0 && MonotonicNs() - start > timeout_ns) {
+      FailOpen();
+    }
+  }
+}
+
+void ExecGuard::FailOpen() {
+  for (Event& event : batch_) {
+    if (!event.answered) {
+      Respond(event.fd, true);
+      event.answered = true;
+      timeouts_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  // Whatever queued up behind the late batch is allowed too.
+  alignas(fanotify_event_metadata) char buffer[4096];
+  ssize_t size;
+  while ((size = read(fanotify_fd_, buffer, sizeof(buffer))) > 0) {
+    for (auto* event = reinterpret_cast<fanotify_event_metadata*>(buffer);
+         FAN_EVENT_OK(event, size); event = FAN_EVENT_NEXT(event, size)) {
+      if (event->fd >= 0) {
+        Respond(event->fd, true);
+        close(event->fd);
+        execs_.fetch_add(1, std::memory_order_relaxed);
+        timeouts_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+}  // namespace routine
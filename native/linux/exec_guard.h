@@ -0,0 +1,131 @@
+#ifndef ROUTINE_LINUX_EXEC_GUARD_H_
+#define ROUTINE_LINUX_EXEC_GUARD_H_
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/policy_store.h"
+#include "core/verdict_cache.h"
+
+namespace routine {
+
+// Denies blocked executables before they run, where ExecBlocker can only
+// suspend them once they have: fanotify holds every exec() on the marked
+// filesystems with a FAN_OPEN_EXEC_PERM event until we answer, and a
+// denied exec() fails with EPERM.
+//
+// Every exec on the machine waits for the verdict, so the event thread
+// answers from a verdict cache keyed by the file's device and inode, and
+// only resolves and matches the path on a miss. A watchdog answers for the
+// event thread if it takes longer than |timeout|: a stalled guard allows
+// execs rather than hanging the system. Allow lists are left to focus
+// enforcement, since denying everything unlisted would take the shell and
+// every helper with it; the filesystems stay unmarked while one is active.
+class ExecGuard {
+ public:
+  struct Options {
+    // Filesystems to guard, by any path on them. Empty guards every mounted
+    // filesystem.
+    std::vector<std::string> mounts;
+    std::chrono::milliseconds timeout{250};
+    size_t cache_capacity = VerdictCache::kDefaultCapacity;
+  };
+
+  struct Stats {
+    uint64_t execs = 0;
+    uint64_t denied = 0;
+    // Verdicts answered from the inode cache.
+    uint64_t cached = 0;
+    // Execs the watchdog allowed because the verdict was late.
+    uint64_t timeouts = 0;
+    // From reading an event to answering it.
+    uint64_t total_latency_ns = 0;
+    uint64_t max_latency_ns = 0;
+  };
+
+  ExecGuard(const PolicyStore* policy, Options options);
+  ~ExecGuard();
+
+  ExecGuard(const ExecGuard&) = delete;
+  ExecGuard& operator=(const ExecGuard&) = delete;
+
+  // Marks the filesystems and starts the event and watchdog threads.
+  // Returns false without CAP_SYS_ADMIN or on kernels before 5.0, which
+  // lack FAN_OPEN_EXEC_PERM; ExecBlocker still applies then.
+  bool Start();
+  // Stops answering. Execs waiting for a verdict are allowed.
+  void Stop();
+
+  // Guards the filesystems only while the policy blocks: under an allow
+  // list, which the guard never applies, the marks are removed so execs do
+  // not wait on it. Call after every policy change, from the thread that
+  // started the guard.
+  void Reconcile();
+
+  // Whether the exec of the file open at |fd| by |pid| is denied. Called by
+  // the event thread for each event; public for tests.
+  bool IsDenied(int fd, pid_t pid);
+
+  Stats stats() const;
+
+ private:
+  struct Event {
+    int fd = -1;
+    pid_t pid = 0;
+    bool answered = false;
+  };
+
+  // Marks every guarded filesystem. Returns whether any took the mark.
+  bool MarkAll();
+  void Run();
+  void Watch();
+  // Reads and answers one buffer of events. Returns false once the queue
+  // is empty.
+  bool HandleEvents();
+  void Respond(int fd, bool allow);
+  // Called with mutex_ held: allows everything the event thread has not
+  // answered, and everything queued behind it.
+  void FailOpen();
+
+  const PolicyStore* policy_;
+  const Options options_;
+  const pid_t self_pid_;
+  VerdictCache cache_;
+
+  int fanotify_fd_ = -1;
+  // Whether the filesystems are marked. Starting thread only.
+  bool marked_ = false;
+  int wake_fds_[2] = {-1, -1};
+  std::thread thread_;
+  std::thread watchdog_;
+  std::atomic<bool> stopping_{false};
+
+  // The events being decided and when their buffer was read, or zero.
+  // Responses go out under mutex_, so the event thread and the watchdog
+  // never answer the same fd twice or an fd reused by a later event.
+  std::mutex mutex_;
+  std::condition_variable watchdog_wake_;
+  std::vector<Event> batch_;
+  std::atomic<uint64_t> batch_start_ns_{0};
+  // Event thread only; swapped with batch_ so neither reallocates.
+  std::vector<Event> incoming_;
+
+  std::atomic<uint64_t> execs_{0};
+  std::atomic<uint64_t> denied_{0};
+  std::atomic<uint64_t> cached_{0};
+  std::atomic<uint64_t> timeouts_{0};
+  std::atomic<uint64_t> total_latency_ns_{0};
+  std::atomic<uint64_t> max_latency_ns_{0};
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_LINUX_EXEC_GUARD_H_
@@ -0,0 +1,235 @@
+#include "linux/proc_connector.h"
+
+#include <arpa/inet.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/filter.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+namespace routine {
+
+namespace {
+
+// Large enough for any proc connector datagram.
+constexpr size_t kDatagramSize = 512;
+
+// The kernel queues events here while we are busy; a fork storm overruns
+// the default buffer within milliseconds.
+constexpr int kReceiveBufferBytes = 8 << 20;
+
+// Offset of proc_event::what within a datagram.
+constexpr uint32_t kWhatOffset = NLMSG_HDRLEN + sizeof(cn_msg);
+
+uint32_t KernelEventType(uint32_t type) {
+  switch (type) {
+    case ProcConnector::kFork:
+      return proc_event::PROC_EVENT_FORK;
+    case ProcConnector::kExec:
+      return proc_event::PROC_EVENT_EXEC;
+    default:
+      return proc_event::PROC_EVENT_EXIT;
+  }
+}
+
+// Classic BPF accepting only datagrams whose proc_event::what is one of
+// |types|. Absolute loads are big-endian, hence htonl().
+bool AttachFilter(int fd, uint32_t types) {
+  std::vector<uint32_t> accepted;
+  for (const uint32_t type :
+       {ProcConnector::kFork, ProcConnector::kExec, ProcConnector::kExit}) {
+    if (types & type) {
+      accepted.push_back(htonl(KernelEventType(type)));
+    }
+  }
+
+  const uint8_t count = static_cast<uint8_t>(accepted.size());
+  std::vector<sock_filter> program;
+  program.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, kWhatOffset));
+  for (uint8_t i = 0; i < count; ++i) {
+    // Jump over the remaining comparisons and the reject.
+    program.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, accepted[i],
+                               static_cast<uint8_t>(count - i), 0));
+  }
+  program.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+  program.push_back(BPF_STMT(BPF_RET | BPF_K, 0xffffffff));
+
+  sock_fprog fprog;
+  fprog.len = static_cast<unsigned short>(program.size());
+  fprog.filter = program.data();
+  return setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) ==
+         0;
+}
+
+}  // namespace
+
+ProcConnector::~ProcConnector() { Close(); }
+
+bool ProcConnector::Open(uint32_t types) {
+  Close();
+
+  fd_ = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+               NETLINK_CONNECTOR);
+  if (fd_ < 0) {
+    return false;
+  }
+
+  // Needs CAP_NET_ADMIN as well, which subscribing requires anyway.
+  if (setsockopt(fd_, SOL_SOCKET, SO_RCVBUFFORCE, &kReceiveBufferBytes,
+                 sizeof(kReceiveBufferBytes)) != 0) {
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &kReceiveBufferBytes,
+               sizeof(kReceiveBufferBytes));
+  }
+
+  sockaddr_nl address;
+  std::memset(&address, 0, sizeof(address));
+  address.nl_family = AF_NETLINK;
+  address.nl_groups = CN_IDX_PROC;
+  // nl_pid of zero lets the kernel pick a unique port, so several
+  // connectors can coexist in one process.
+  if (bind(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      !AttachFilter(fd_, types) || !Subscribe(true)) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+
+  types_ = types;
+  buffers_.assign(kMaxBatch * kDatagramSize, 0);
+  return true;
+}
+
+void ProcConnector::Close() {
+  if (fd_ < 0) {
+    return;
+  }
+  Subscribe(false);
+  close(fd_);
+  fd_ = -1;
+}
+
+size_t ProcConnector::ReadBatch(std::vector<ProcEvent>* events,
+                                bool* overrun) {
+  if (fd_ < 0) {
+    return 0;
+  }
+
+  iovec iov[kMaxBatch];
+  mmsghdr messages[kMaxBatch];
+  std::memset(messages, 0, sizeof(messages));
+  for (size_t i = 0; i < kMaxBatch; ++i) {
+    iov[i].iov_base = buffers_.data() + i * kDatagramSize;
+    iov[i].iov_len = kDatagramSize;
+    messages[i].msg_hdr.msg_iov = &iov[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  const int received =
+      recvmmsg(fd_, messages, kMaxBatch, MSG_DONTWAIT, nullptr);
+  if (received < 0) {
+    if (errno == ENOBUFS) {
+      *overrun = true;
+    }
+    return 0;
+  }
+
+  for (int i = 0; i < received; ++i) {
+    Parse(iov[i].iov_base, messages[i].msg_len, types_, events);
+  }
+  return static_cast<size_t>(received);
+}
+
+void ProcConnector::Parse(const void* data, size_t size, uint32_t types,
+                          std::vector<ProcEvent>* events) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  size_t offset = 0;
+  while (size - offset >= NLMSG_HDRLEN) {
+    nlmsghdr header;
+    std::memcpy(&header, bytes + offset, sizeof(header));
+    if (header.nlmsg_len < NLMSG_HDRLEN || header.nlmsg_len > size - offset) {
+      return;
+    }
+
+    const size_t payload = header.nlmsg_len - NLMSG_HDRLEN;
+    if (header.nlmsg_type == NLMSG_DONE &&
+        payload >= sizeof(cn_msg) + offsetof(proc_event, event_data)) {
+      // The payload sits at an arbitrary offset in the datagram; copy it out
+      // rather than cast.
+      cn_msg message;
+      proc_event event;
+      std::memset(&event, 0, sizeof(event));
+      const uint8_t* body = bytes + offset + NLMSG_HDRLEN;
+      std::memcpy(&message, body, sizeof(message));
+      std::memcpy(&event, body + sizeof(message),
+                  std::min(payload - sizeof(message), sizeof(event)));
+
+      if (message.id.idx == CN_IDX_PROC && message.id.val == CN_VAL_PROC) {
+        ProcEvent out;
+        out.timestamp_ns = event.timestamp_ns;
+        bool wanted = false;
+        switch (event.what) {
+          case proc_event::PROC_EVENT_FORK:
+            wanted = (types & kFork) && event.event_data.fork.child_pid ==
+                                            event.event_data.fork.child_tgid;
+            out.type = ProcEvent::Type::kFork;
+            out.pid = event.event_data.fork.child_tgid;
+            out.parent_pid = event.event_data.fork.parent_tgid;
+            break;
+          case proc_event::PROC_EVENT_EXEC:
+            wanted = types & kExec;
+            out.type = ProcEvent::Type::kExec;
+            out.pid = event.event_data.exec.process_tgid;
+            break;
+          case proc_event::PROC_EVENT_EXIT:
+            wanted = (types & kExit) && event.event_data.exit.process_pid ==
+                                            event.event_data.exit.process_tgid;
+            out.type = ProcEvent::Type::kExit;
+            out.pid = event.event_data.exit.process_tgid;
+            break;
+          default:
+            break;
+        }
+        if (wanted) {
+          events->push_back(out);
+        }
+      }
+    }
+
+    offset += NLMSG_ALIGN(header.nlmsg_len);
+    if (offset >= size) {
+      return;
+    }
+  }
+}
+
+bool ProcConnector::Subscribe(bool listen) {
+  // nlmsghdr, cn_msg and the operation, back to back. cn_msg ends in a
+  // flexible array, so the request is assembled byte by byte.
+  uint8_t request[NLMSG_HDRLEN + sizeof(cn_msg) + sizeof(uint32_t)];
+  std::memset(request, 0, sizeof(request));
+
+  nlmsghdr header;
+  std::memset(&header, 0, sizeof(header));
+  header.nlmsg_len = sizeof(request);
+  header.nlmsg_type = NLMSG_DONE;
+  cn_msg message;
+  std::memset(&message, 0, sizeof(message));
+  message.id.idx = CN_IDX_PROC;
+  message.id.val = CN_VAL_PROC;
+  message.len = sizeof(uint32_t);
+  const uint32_t op = listen ? PROC_CN_MCAST_LISTEN : PROC_CN_MCAST_IGNORE;
+
+  std::memcpy(request, &header, sizeof(header));
+  std::memcpy(request + NLMSG_HDRLEN, &message, sizeof(message));
+  std::memcpy(request + NLMSG_HDRLEN + sizeof(message), &op, sizeof(op));
+  return send(fd_, request, sizeof(request), 0) ==
+         static_cast<ssize_t>(sizeof(request));
+}
+
+}  // namespace routine
@@ -0,0 +1,78 @@
+#ifndef ROUTINE_LINUX_PROC_CONNECTOR_H_
+#define ROUTINE_LINUX_PROC_CONNECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace routine {
+
+// A process lifecycle event from the kernel's proc connector. Only whole
+// processes are reported; thread creation and exit are filtered out.
+struct ProcEvent {
+  enum class Type : uint8_t {
+    kFork,
+    kExec,
+    kExit,
+  };
+
+  Type type = Type::kExec;
+  int64_t pid = 0;
+  // The forking process for kFork; zero otherwise.
+  int64_t parent_pid = 0;
+  // CLOCK_MONOTONIC time at which the kernel emitted the event.
+  uint64_t timestamp_ns = 0;
+};
+
+// A netlink socket subscribed to the proc connector (CN_IDX_PROC), which
+// multicasts every fork, exec and exit on the system. Subscribing requires
+// CAP_NET_ADMIN.
+class ProcConnector {
+ public:
+  // Event types to subscribe to. Everything else is dropped by a socket
+  // filter before it is queued, so an exec-only subscriber does not pay for
+  // the fork and exit traffic of a build or a shell loop.
+  static constexpr uint32_t kFork = 1u << 0;
+  static constexpr uint32_t kExec = 1u << 1;
+  static constexpr uint32_t kExit = 1u << 2;
+
+  // Datagrams drained per ReadBatch() call.
+  static constexpr size_t kMaxBatch = 256;
+
+  ProcConnector() = default;
+  ~ProcConnector();
+
+  ProcConnector(const ProcConnector&) = delete;
+  ProcConnector& operator=(const ProcConnector&) = delete;
+
+  // Opens the socket and subscribes to |types|. Returns false when the
+  // connector is unavailable or we lack the privilege.
+  bool Open(uint32_t types);
+  void Close();
+
+  // Non-blocking; poll() it for POLLIN.
+  int fd() const { return fd_; }
+
+  // Appends up to kMaxBatch queued events to |events| with a single
+  // recvmmsg() and returns how many datagrams were read. Sets |*overrun|
+  // when the kernel dropped events because the socket buffer filled, in
+  // which case callers must assume they missed some. Returns zero when
+  // nothing is queued.
+  size_t ReadBatch(std::vector<ProcEvent>* events, bool* overrun);
+
+  // Decodes the netlink messages in |data|, appending the events selected
+  // by |types| to |events|.
+  static void Parse(const void* data, size_t size, uint32_t types,
+                    std::vector<ProcEvent>* events);
+
+ private:
+  bool Subscribe(bool listen);
+
+  int fd_ = -1;
+  uint32_t types_ = 0;
+  std::vector<uint8_t> buffers_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_LINUX_PROC_CONNECTOR_H_
@@ -0,0 +1,143 @@
+#include "linux/proc_fs.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+namespace routine {
+
+namespace {
+
+constexpr std::string_view kDeletedSuffix = " (deleted)";
+
+bool ParsePid(const char* name, int64_t* pid) {
+  if (*name == '\0') {
+    return false;
+  }
+  int64_t value = 0;
+  for (const char* c = name; *c != '\0'; ++c) {
+    if (*c < '0' || *c > '9') {
+      return false;
+    }
+    value = value * 10 + (*c - '0');
+  }
+  *pid = value;
+  return true;
+}
+
+}  // namespace
+
+std::vector<int64_t> ProcFs::ListPids() const {
+  std::vector<int64_t> pids;
+  DIR* dir = opendir(root_.c_str());
+  if (dir == nullptr) {
+    return pids;
+  }
+  while (dirent* entry = readdir(dir)) {
+    int64_t pid;
+    if (ParsePid(entry->d_name, &pid)) {
+      pids.push_back(pid);
+    }
+  }
+  closedir(dir);
+  return pids;
+}
+
+std::optional<ProcessInfo> ProcFs::Read(int64_t pid) const {
+  ProcessInfo info;
+  if (!ReadStat(pid, &info)) {
+    return std::nullopt;
+  }
+
+  struct stat status;
+  if (stat(PidPath(pid, "").c_str(), &status) == 0) {
+    info.uid = status.st_uid;
+  }
+  info.exe = ReadExe(pid);
+  return info;
+}
+
+bool ProcFs::ReadStat(int64_t pid, ProcessInfo* info) const {
+  const int fd = open(PidPath(pid, "stat").c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  char buffer[1024];
+  const ssize_t size = read(fd, buffer, sizeof(buffer) - 1);
+  close(fd);
+  if (size <= 0) {
+    return false;
+  }
+  buffer[size] = '\0';
+
+  // "pid (comm) state ppid ...". comm may itself contain spaces and
+  // parentheses, so it ends at the last ')'.
+  char* open_paren = std::strchr(buffer, '(');
+  char* close_paren = std::strrchr(buffer, ')');
+  if (open_paren == nullptr || close_paren == nullptr ||
+      close_paren < open_paren) {
+    return false;
+  }
+
+  info->pid = pid;
+  info->name.assign(open_paren + 1, close_paren);
+
+  // Fields after comm, counted from 3 (state) as in proc(5).
+  char* cursor = close_paren + 1;
+  for (int field = 3; field <= 22; ++field) {
+    while (*cursor == ' ') {
+      ++cursor;
+    }
+    if (*cursor == '\0') {
+      return false;
+    }
+    char* end = cursor;
+    while (*end != ' ' && *end != '\0') {
+      ++end;
+    }
+    if (field == 4) {
+      info->ppid = std::strtoll(cursor, nullptr, 10);
+    } else if (field == 22) {
+      info->start_time = std::strtoull(cursor, nullptr, 10);
+    }
+    cursor = end;
+  }
+  return true;
+}
+
+std::string ProcFs::ReadExe(int64_t pid) const {
+  char target[PATH_MAX];
+  const ssize_t size =
+      readlink(PidPath(pid, "exe").c_str(), target, sizeof(target));
+  if (size <= 0 || size == static_cast<ssize_t>(sizeof(target))) {
+    return std::string();
+  }
+
+  std::string exe(target, size);
+  // The binary was replaced on disk (e.g. upgraded) while running.
+  if (exe.size() > kDeletedSuffix.size() &&
+      exe.compare(exe.size() - kDeletedSuffix.size(), kDeletedSuffix.size(),
+                  kDeletedSuffix) == 0) {
+    exe.resize(exe.size() - kDeletedSuffix.size());
+  }
+  return exe;
+}
+
+std::string ProcFs::PidPath(int64_t pid, const char* entry) const {
+  std::string path = root_;
+  path += '/';
+  path += std::to_string(pid);
+  if (*entry != '\0') {
+    path += '/';
+    path += entry;
+  }
+  return path;
+}
+
+}  // namespace routine
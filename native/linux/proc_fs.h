@@ -0,0 +1,54 @@
+#ifndef ROUTINE_LINUX_PROC_FS_H_
+#define ROUTINE_LINUX_PROC_FS_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace routine {
+
+struct ProcessInfo {
+  int64_t pid = 0;
+  int64_t ppid = 0;
+  // Clock ticks after boot at which the process started. Together with the
+  // pid it names one process even across pid reuse.
+  uint64_t start_time = 0;
+  uint32_t uid = 0;
+  // The kernel's short command name.
+  std::string name;
+  // Target of /proc/<pid>/exe; empty for kernel threads and for processes
+  // we are not allowed to inspect.
+  std::string exe;
+};
+
+// Reads process information from procfs. |root| is "/proc" outside of tests.
+class ProcFs {
+ public:
+  explicit ProcFs(std::string root = "/proc") : root_(std::move(root)) {}
+
+  std::vector<int64_t> ListPids() const;
+
+  // Reads everything in ProcessInfo. Returns nothing once the process is
+  // gone.
+  std::optional<ProcessInfo> Read(int64_t pid) const;
+
+  // Reads only what /proc/<pid>/stat holds (pid, ppid, start time, name),
+  // which is the cheapest way to tell whether a pid still names the same
+  // process.
+  bool ReadStat(int64_t pid, ProcessInfo* info) const;
+
+  std::string ReadExe(int64_t pid) const;
+
+  const std::string& root() const { return root_; }
+
+ private:
+  std::string PidPath(int64_t pid, const char* entry) const;
+
+  std::string root_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_LINUX_PROC_FS_H_
@@ -0,0 +1,169 @@
+#include "linux/x11_foreground_source.h"
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "linux/x11_util.h"
+
+namespace routine {
+
+namespace {
+
+std::optional<unsigned long> ReadCardinal(Display* display, Window window,
+                                          Atom property, Atom type) {
+  const auto values = ReadCardinals(display, window, property, type, 1);
+  if (values.empty()) {
+    return std::nullopt;
+  }
+  return values.front();
+}
+
+}  // namespace
+
+X11ForegroundSource::X11ForegroundSource(std::string display_name)
+    : display_name_(std::move(display_name)) {}
+
+X11ForegroundSource::~X11ForegroundSource() {
+  Stop();
+  if (display_ != nullptr) {
+    XCloseDisplay(display_);
+  }
+}
+
+bool X11ForegroundSource::Start(Callback callback) {
+  std::lock_guard<std::mutex> lock(display_mutex_);
+  if (thread_.joinable() || !Connect()) {
+    return false;
+  }
+  if (pipe2(wake_fds_, O_CLOEXEC | O_NONBLOCK) != 0) {
+    return false;
+  }
+
+  XSelectInput(display_, root_, PropertyChangeMask);
+  XFlush(display_);
+
+  callback_ = std::move(callback);
+  stopping_ = false;
+  thread_ = std::thread(&X11ForegroundSource::Run, this);
+  return true;
+}
+
+void X11ForegroundSource::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  stopping_ = true;
+  Wake();
+  thread_.join();
+
+  close(wake_fds_[0]);
+  close(wake_fds_[1]);
+  wake_fds_[0] = wake_fds_[1] = -1;
+}
+
+std::optional<ForegroundWindow> X11ForegroundSource::Current() {
+  std::optional<ForegroundWindow> window;
+  {
+    std::lock_guard<std::mutex> lock(display_mutex_);
+    if (!Connect()) {
+      return std::nullopt;
+    }
+    window = QueryActiveWindow();
+  }
+  // The round trip may have pulled pending events off the socket into
+  // Xlib's queue, where poll() cannot see them; have the loop drain them.
+  Wake();
+  return window;
+}
+
+bool X11ForegroundSource::Connect() {
+  if (display_ != nullptr) {
+    return true;
+  }
+
+  display_ = XOpenDisplay(display_name_.empty() ? nullptr
+                                                : display_name_.c_str());
+  if (display_ == nullptr) {
+    return false;
+  }
+  root_ = DefaultRootWindow(display_);
+  active_window_atom_ = XInternAtom(display_, "_NET_ACTIVE_WINDOW", False);
+  pid_atom_ = XInternAtom(display_, "_NET_WM_PID", False);
+  return true;
+}
+
+std::optional<ForegroundWindow> X11ForegroundSource::QueryActiveWindow() {
+  ScopedIgnoreXErrors ignore_errors;
+
+  const auto active =
+      ReadCardinal(display_, root_, active_window_atom_, XA_WINDOW);
+  if (!active) {
+    // The window manager does not support EWMH.
+    return std::nullopt;
+  }
+
+  ForegroundWindow window;
+  window.window = *active;
+  if (window.window != 0) {
+    if (auto pid = ReadCardinal(display_, *active, pid_atom_, XA_CARDINAL)) {
+      window.pid = static_cast<int64_t>(*pid);
+    }
+  }
+  return window;
+}
+
+void X11ForegroundSource::Run() {
+  pollfd fds[2];
+  fds[0].fd = ConnectionNumber(display_);
+  fds[0].events = POLLIN;
+  fds[1].fd = wake_fds_[0];
+  fds[1].events = POLLIN;
+
+  while (!stopping_) {
+    std::optional<ForegroundWindow> changed;
+    {
+      std::lock_guard<std::mutex> lock(display_mutex_);
+      ScopedIgnoreXErrors ignore_errors;
+      bool active_changed = false;
+      while (XPending(display_) > 0) {
+        XEvent event;
+        XNextEvent(display_, &event);
+        if (event.type == PropertyNotify &&
+            event.xproperty.atom == active_window_atom_) {
+          active_changed = true;
+        }
+      }
+      if (active_changed) {
+        changed = QueryActiveWindow();
+      }
+    }
+    if (changed) {
+      callback_(*changed);
+    }
+
+    if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+      break;
+    }
+    if (fds[1].revents & POLLIN) {
+      char buffer[64];
+      while (read(wake_fds_[0], buffer, sizeof(buffer)) > 0) {
+      }
+    }
+  }
+}
+
+void X11ForegroundSource::Wake() {
+  if (wake_fds_[1] >= 0) {
+    const char byte = 0;
+    // A full pipe already guarantees a wakeup.
+    [[maybe_unused]] ssize_t written = write(wake_fds_[1], &byte, 1);
+  }
+}
+
+}  // namespace routine
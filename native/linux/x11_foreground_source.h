@@ -0,0 +1,55 @@
+#ifndef ROUTINE_LINUX_X11_FOREGROUND_SOURCE_H_
+#define ROUTINE_LINUX_X11_FOREGROUND_SOURCE_H_
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "core/foreground_tracker.h"
+
+// Avoid leaking Xlib's macros (None, Bool, Status, ...) into includers.
+struct _XDisplay;
+
+namespace routine {
+
+// Reports focus changes on X11 through EWMH: the window manager keeps
+// _NET_ACTIVE_WINDOW on the root window current, and PropertyNotify on that
+// atom tells us when it moves. Owns a private display connection serviced by
+// a background thread, so callbacks arrive on that thread.
+class X11ForegroundSource : public ForegroundSource {
+ public:
+  // Connects to |display_name|, or to $DISPLAY when empty.
+  explicit X11ForegroundSource(std::string display_name = std::string());
+  ~X11ForegroundSource() override;
+
+  bool Start(Callback callback) override;
+  void Stop() override;
+  std::optional<ForegroundWindow> Current() override;
+
+ private:
+  // Both require |display_mutex_|.
+  bool Connect();
+  std::optional<ForegroundWindow> QueryActiveWindow();
+
+  void Run();
+  void Wake();
+
+  std::string display_name_;
+
+  std::mutex display_mutex_;
+  _XDisplay* display_ = nullptr;
+  unsigned long root_ = 0;
+  unsigned long active_window_atom_ = 0;
+  unsigned long pid_atom_ = 0;
+
+  Callback callback_;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+  int wake_fds_[2] = {-1, -1};
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_LINUX_X11_FOREGROUND_SOURCE_H_
@@ -0,0 +1,87 @@
+#include "linux/x11_session.h"
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+
+#include <utility>
+
+#include "linux/x11_util.h"
+
+namespace routine {
+
+namespace {
+
+// Enough for any desktop; the property is read in one round trip.
+constexpr long kMaxClients = 4096;
+
+}  // namespace
+
+X11Session::X11Session(std::string display_name)
+    : display_name_(std::move(display_name)) {}
+
+X11Session::~X11Session() {
+  if (display_ != nullptr) {
+    XCloseDisplay(display_);
+  }
+}
+
+std::optional<std::unordered_set<int64_t>> X11Session::ClientPids() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!Connect()) {
+    return std::nullopt;
+  }
+  ScopedIgnoreXErrors ignore_errors;
+
+  Atom type = 0;
+  int format = 0;
+  unsigned long count = 0;
+  unsigned long remaining = 0;
+  unsigned char* data = nullptr;
+  if (XGetWindowProperty(display_, DefaultRootWindow(display_),
+                         client_list_atom_, 0, kMaxClients, False, XA_WINDOW,
+                         &type, &format, &count, &remaining,
+                         &data) != Success ||
+      data == nullptr) {
+    return std::nullopt;
+  }
+
+  std::unordered_set<int64_t> pids;
+  const auto* windows = reinterpret_cast<Window*>(data);
+  for (unsigned long i = 0; i < count; ++i) {
+    const auto pid = ReadCardinals(display_, windows[i], pid_atom_,
+                                   XA_CARDINAL, 1);
+    if (!pid.empty()) {
+      pids.insert(static_cast<int64_t>(pid.front()));
+    }
+  }
+  XFree(data);
+  return pids;
+}
+
+bool X11Session::Iconify(uint64_t window) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!Connect()) {
+    return false;
+  }
+  ScopedIgnoreXErrors ignore_errors;
+  const Status sent =
+      XIconifyWindow(display_, window, DefaultScreen(display_));
+  XFlush(display_);
+  return sent != 0;
+}
+
+bool X11Session::Connect() {
+  if (display_ != nullptr) {
+    return true;
+  }
+  display_ = XOpenDisplay(display_name_.empty() ? nullptr
+                                                : display_name_.c_str());
+  if (display_ == nullptr) {
+    return false;
+  }
+  client_list_atom_ = XInternAtom(display_, "_NET_CLIENT_LIST", False);
+  pid_atom_ = XInternAtom(display_, "_NET_WM_PID", False);
+  return true;
+}
+
+}  // namespace routine
@@ -0,0 +1,45 @@
+#ifndef ROUTINE_LINUX_X11_SESSION_H_
+#define ROUTINE_LINUX_X11_SESSION_H_
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+
+struct _XDisplay;
+
+namespace routine {
+
+// A private, thread-safe X11 connection for the one-shot requests the
+// enforcer and the app picker make.
+class X11Session {
+ public:
+  // Connects lazily to |display_name|, or to $DISPLAY when empty.
+  explicit X11Session(std::string display_name = std::string());
+  ~X11Session();
+
+  X11Session(const X11Session&) = delete;
+  X11Session& operator=(const X11Session&) = delete;
+
+  // Pids owning a managed top-level window (_NET_CLIENT_LIST). Returns
+  // nothing when there is no display or no EWMH window manager.
+  std::optional<std::unordered_set<int64_t>> ClientPids();
+
+  // Asks the window manager to minimise |window|.
+  bool Iconify(uint64_t window);
+
+ private:
+  // Requires |mutex_|.
+  bool Connect();
+
+  std::string display_name_;
+  std::mutex mutex_;
+  _XDisplay* display_ = nullptr;
+  unsigned long client_list_atom_ = 0;
+  unsigned long pid_atom_ = 0;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_LINUX_X11_SESSION_H_
@@ -0,0 +1,58 @@
+#include "linux/x11_util.h"
+
+#include <X11/Xlib.h>
+
+#include <mutex>
+
+namespace routine {
+
+namespace {
+
+thread_local bool t_ignore_x_errors = false;
+XErrorHandler g_previous_error_handler = nullptr;
+std::once_flag g_error_handler_once;
+
+int HandleXError(Display* display, XErrorEvent* event) {
+  if (t_ignore_x_errors || g_previous_error_handler == nullptr) {
+    return 0;
+  }
+  return g_previous_error_handler(display, event);
+}
+
+}  // namespace
+
+ScopedIgnoreXErrors::ScopedIgnoreXErrors() : previous_(t_ignore_x_errors) {
+  std::call_once(g_error_handler_once, [] {
+    g_previous_error_handler = XSetErrorHandler(HandleXError);
+  });
+  t_ignore_x_errors = true;
+}
+
+ScopedIgnoreXErrors::~ScopedIgnoreXErrors() {
+  t_ignore_x_errors = previous_;
+}
+
+std::vector<unsigned long> ReadCardinals(Display* display, unsigned long window,
+                                         unsigned long property,
+                                         unsigned long type, long max_items) {
+  Atom actual_type = 0;
+  int actual_format = 0;
+  unsigned long count = 0;
+  unsigned long remaining = 0;
+  unsigned char* data = nullptr;
+
+  const int status = XGetWindowProperty(
+      display, window, property, 0, max_items, False, type, &actual_type,
+      &actual_format, &count, &remaining, &data);
+  std::vector<unsigned long> values;
+  if (status == Success && data != nullptr && actual_format == 32) {
+    const auto* items = reinterpret_cast<unsigned long*>(data);
+    values.assign(items, items + count);
+  }
+  if (data != nullptr) {
+    XFree(data);
+  }
+  return values;
+}
+
+}  // namespace routine
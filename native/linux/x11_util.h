@@ -0,0 +1,37 @@
+#ifndef ROUTINE_LINUX_X11_UTIL_H_
+#define ROUTINE_LINUX_X11_UTIL_H_
+
+#include <vector>
+
+struct _XDisplay;
+
+namespace routine {
+
+// Xlib reports protocol errors through one process-wide handler whose default
+// exits the process. Windows routinely vanish between an event and our
+// property reads, so while one of these is alive errors raised on the
+// current thread are ignored; everything else still goes to the handler
+// that was installed before ours (GDK's, in the runner).
+class ScopedIgnoreXErrors {
+ public:
+  ScopedIgnoreXErrors();
+  ~ScopedIgnoreXErrors();
+
+  ScopedIgnoreXErrors(const ScopedIgnoreXErrors&) = delete;
+  ScopedIgnoreXErrors& operator=(const ScopedIgnoreXErrors&) = delete;
+
+ private:
+  bool previous_;
+};
+
+// Reads up to |max_items| items of a 32-bit format |property| of |window|.
+// Xlib hands those back as longs whatever the platform word size. Returns
+// nothing if the property is missing or has another type or format.
+std::vector<unsigned long> ReadCardinals(_XDisplay* display,
+                                         unsigned long window,
+                                         unsigned long property,
+                                         unsigned long type, long max_items);
+
+}  // namespace routine
+
+#endif  // ROUTINE_LINUX_X11_UTIL_H_
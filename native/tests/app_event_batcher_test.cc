@@ -0,0 +1,107 @@
+#include "core/app_event_batcher.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace routine {
+namespace {
+
+RunningApp App(const std::string& name) {
+  return RunningApp{name, name, "/opt/" + name};
+}
+
+std::vector<std::string> Names(const AppEventBatcher::Batch& batch) {
+  std::vector<std::string> names;
+  for (const auto& app : batch.apps) {
+    names.push_back(app.name);
+  }
+  return names;
+}
+
+class AppEventBatcherTest : public ::testing::Test {
+ protected:
+  AppEventBatcher batcher_{2, [this](AppEventBatcher::Batch batch) {
+                             batches_.push_back(std::move(batch));
+                           }};
+  std::vector<AppEventBatcher::Batch> batches_;
+};
+
+TEST_F(AppEventBatcherTest, SendsFullBatchesAsTheyFill) {
+  batcher_.AppAdded(App("a"));
+  EXPECT_TRUE(batches_.empty());
+  batcher_.AppAdded(App("b"));
+  batcher_.AppAdded(App("c"));
+  ASSERT_EQ(batches_.size(), 1u);
+  EXPECT_EQ(Names(batches_[0]), (std::vector<std::string>{"a", "b"}));
+
+  batcher_.Flush();
+  ASSERT_EQ(batches_.size(), 2u);
+  EXPECT_EQ(Names(batches_[1]), std::vector<std::string>{"c"});
+
+  // Nothing pending, nothing sent.
+  batcher_.Flush();
+  EXPECT_EQ(batches_.size(), 2u);
+}
+
+TEST_F(AppEventBatcherTest, KeepsOrderAcrossKindsOfChange) {
+  batcher_.AppAdded(App("a"));
+  batcher_.AppRemoved(App("a"));
+  batcher_.AppAdded(App("a"));
+  batcher_.Flush();
+
+  ASSERT_EQ(batches_.size(), 3u);
+  EXPECT_EQ(batches_[0].change, AppEventBatcher::Change::kAdded);
+  EXPECT_EQ(batches_[1].change, AppEventBatcher::Change::kRemoved);
+  EXPECT_EQ(batches_[2].change, AppEventBatcher::Change::kAdded);
+}
+
+TEST_F(AppEventBatcherTest, MirrorsProcessTableApps) {
+  ProcessTable table;
+  table.set_observer(&batcher_);
+  auto describe = [](const ProcessKey& key) -> std::optional<RunningApp> {
+    if (key.pid == 1) {
+      return std::nullopt;
+    }
+    return App(key.pid < 10 ? "low" : "high");
+  };
+
+  // 2 and 3 share an app; 1 is not one.
+  table.Update({{1, 1}, {2, 1}, {3, 1}, {10, 1}}, describe);
+  batcher_.Flush();
+  ASSERT_EQ(batches_.size(), 1u);
+  EXPECT_EQ(Names(batches_[0]), (std::vector<std::string>{"low", "high"}));
+
+  // The app stays listed while one of its processes runs.
+  batches_.clear();
+  table.Update({{1, 1}, {3, 1}, {10, 1}}, describe);
+  batcher_.Flush();
+  EXPECT_TRUE(batches_.empty());
+
+  table.Update({{1, 1}, {10, 1}}, describe);
+  batcher_.Flush();
+  ASSERT_EQ(batches_.size(), 1u);
+  EXPECT_EQ(batches_[0].change, AppEventBatcher::Change::kRemoved);
+  EXPECT_EQ(Names(batches_[0]), std::vector<std::string>{"low"});
+}
+
+TEST_F(AppEventBatcherTest, ReusedPidOfTheSameAppIsNoChange) {
+  ProcessTable table;
+  table.set_observer(&batcher_);
+  auto describe = [](const ProcessKey&) -> std::optional<RunningApp> {
+    return App("a");
+  };
+
+  table.Update({{2, 1}}, describe);
+  batcher_.Flush();
+  batches_.clear();
+
+  table.Update({{2, 2}}, describe);
+  batcher_.Flush();
+  EXPECT_TRUE(batches_.empty());
+  EXPECT_EQ(table.Apps().size(), 1u);
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,211 @@
+#include "linux/cgroup_freezer.h"
+
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "linux/enforcer.h"
+
+namespace routine {
+namespace {
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+// Runs the freezer in a scratch group at the top of the cgroup v2
+// hierarchy, on spinning children of the test.
+class CgroupFreezerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    options_.root = "/sys/fs/cgroup/unified/routine_test_" +
+                    std::to_string(getpid());
+    if (!std::filesystem::exists("/sys/fs/cgroup/unified/cgroup.procs")) {
+      options_.root = "/sys/fs/cgroup/routine_test_" + std::to_string(getpid());
+    }
+    exe_ = ProcFs().ReadExe(getpid());
+  }
+
+  void TearDown() override {
+    if (grandchild_ > 0) {
+      kill(grandchild_, SIGKILL);
+    }
+    if (child_ > 0) {
+      kill(child_, SIGKILL);
+      waitpid(child_, nullptr, 0);
+    }
+    rmdir(options_.root.c_str());
+  }
+
+  // A child that spins, and a grandchild of it that spins too. Returns the
+  // child; the grandchild's pid is in |grandchild|.
+  pid_t SpawnTree(pid_t* grandchild) {
+    int fds[2];
+    EXPECT_EQ(pipe(fds), 0);
+    const pid_t child = fork();
+    if (child == 0) {
+      const pid_t spinner = fork();
+      if (spinner == 0) {
+        for (;;) {
+        }
+      }
+      [[maybe_unused]] ssize_t written =
+          write(fds[1], &spinner, sizeof(spinner));
+      for (;;) {
+      }
+    }
+    EXPECT_EQ(read(fds[0], grandchild, sizeof(*grandchild)),
+              static_cast<ssize_t>(sizeof(*grandchild)));
+    close(fds[0]);
+    close(fds[1]);
+    child_ = child;
+    grandchild_ = *grandchild;
+    return child;
+  }
+
+  // The one app group under the root.
+  std::string Group() {
+    for (const auto& entry :
+         std::filesystem::directory_iterator(options_.root)) {
+      if (entry.is_directory()) {
+        return entry.path().string();
+      }
+    }
+    return std::string();
+  }
+
+  std::string CgroupOf(pid_t pid) {
+    return ReadFile("/proc/" + std::to_string(pid) + "/cgroup");
+  }
+
+  // utime + stime of |pid|, in clock ticks.
+  uint64_t CpuTicks(pid_t pid) {
+    const std::string stat = ReadFile("/proc/" + std::to_string(pid) + "/stat");
+    std::istringstream fields(stat.substr(stat.rfind(')') + 2));
+    std::string field;
+    uint64_t utime = 0;
+    uint64_t stime = 0;
+    // Fields 3 to 13, then utime and stime.
+    for (int i = 3; i <= 13; ++i) {
+      fields >> field;
+    }
+    fields >> utime >> stime;
+    return utime + stime;
+  }
+
+  bool WaitFrozen(const std::string& group, bool frozen) {
+    const std::string want = frozen ? "frozen 1" : "frozen 0";
+    for (int attempt = 0; attempt < 200; ++attempt) {
+      if (ReadFile(group + "/cgroup.events").find(want) != std::string::npos) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+  }
+
+  CgroupFreezer::Options options_;
+  std::string exe_;
+  pid_t child_ = 0;
+  pid_t grandchild_ = 0;
+};
+
+TEST_F(CgroupFreezerTest, FreezesAndThawsTheWholeTree) {
+  CgroupFreezer freezer(ProcFs(), options_);
+  if (!freezer.Open()) {
+    GTEST_SKIP() << "cgroup v2 freezer unavailable";
+  }
+  pid_t grandchild = 0;
+  const pid_t child = SpawnTree(&grandchild);
+  const std::string before = CgroupOf(child);
+
+  ASSERT_TRUE(freezer.Freeze(child, exe_));
+  EXPECT_TRUE(freezer.IsFrozen(child));
+  EXPECT_TRUE(freezer.IsFrozen(grandchild));
+  EXPECT_NE(CgroupOf(grandchild).find("routine_test_"), std::string::npos);
+
+  CgroupFreezer::Stats stats = freezer.stats();
+  EXPECT_EQ(stats.groups, 1u);
+  EXPECT_EQ(stats.processes, 2u);
+  ASSERT_TRUE(WaitFrozen(Group(), true));
+  const uint64_t ticks = CpuTicks(grandchild);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(CpuTicks(grandchild), ticks);
+
+  // Still blocked: stays frozen.
+  freezer.Reconcile([](const std::string&) { return true; });
+  EXPECT_TRUE(freezer.IsFrozen(child));
+
+  freezer.Reconcile([](const std::string&) { return false; });
+  EXPECT_FALSE(freezer.IsFrozen(child));
+  EXPECT_EQ(CgroupOf(child), before);
+  EXPECT_EQ(CgroupOf(grandchild), before);
+  stats = freezer.stats();
+  EXPECT_EQ(stats.groups, 0u);
+  EXPECT_EQ(stats.thaws, 1u);
+  EXPECT_EQ(stats.move_failures, 0u);
+}
+
+TEST_F(CgroupFreezerTest, ThawsWhatAnEarlierRunLeftFrozen) {
+  pid_t grandchild = 0;
+  SpawnTree(&grandchild);
+  const std::string before = CgroupOf(grandchild);
+  {
+    CgroupFreezer freezer(ProcFs(), options_);
+    if (!freezer.Open()) {
+      GTEST_SKIP() << "cgroup v2 freezer unavailable";
+    }
+    // Stands in for a crash: the group outlives its freezer.
+    const std::string group = options_.root + "/app-leftover";
+    ASSERT_EQ(mkdir(group.c_str(), 0755), 0);
+    std::ofstream(group + "/cgroup.freeze") << "1";
+    std::ofstream(group + "/cgroup.procs") << grandchild;
+  }
+  EXPECT_NE(CgroupOf(grandchild).find("routine_test_"), std::string::npos);
+
+  CgroupFreezer freezer(ProcFs(), options_);
+  ASSERT_TRUE(freezer.Open());
+  EXPECT_EQ(CgroupOf(grandchild), before);
+  EXPECT_EQ(Group(), "");
+}
+
+TEST_F(CgroupFreezerTest, EnforcerFreezesInsteadOfSuspending) {
+  CgroupFreezer freezer(ProcFs(), options_);
+  if (!freezer.Open()) {
+    GTEST_SKIP() << "cgroup v2 freezer unavailable";
+  }
+  PolicyStore policy;
+  RuleSet::Builder builder{RuleSet::Options()};
+  builder.AddApp(exe_);
+  policy.Set(builder.Build());
+  Enforcer enforcer(&policy, ProcFs(), Enforcer::Mode::kFreeze, nullptr,
+                    nullptr, &freezer);
+
+  pid_t grandchild = 0;
+  const pid_t child = SpawnTree(&grandchild);
+  EXPECT_TRUE(enforcer.EnforceProcess(child));
+  EXPECT_TRUE(freezer.IsFrozen(grandchild));
+  EXPECT_EQ(enforcer.suspended_count(), 0u);
+  // Focusing it again is answered without looking at the process.
+  EXPECT_TRUE(enforcer.Enforce(ForegroundWindow{1, child}));
+  EXPECT_EQ(freezer.stats().freezes, 1u);
+
+  policy.Set(RuleSet::Builder(RuleSet::Options()).Build());
+  enforcer.Reconcile();
+  EXPECT_FALSE(freezer.IsFrozen(child));
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,84 @@
+#include "linux/desktop_entries.h"
+
+#include <gtest/gtest.h>
+#include <limits.h>
+#include <stdlib.h>
+
+#include <filesystem>
+#include <fstream>
+
+namespace routine {
+namespace {
+
+TEST(DesktopEntriesTest, ParsesApplicationEntries) {
+  const auto entry = DesktopEntries::Parse(
+      "# comment\n"
+      "[Desktop Entry]\n"
+      "Type=Application\n"
+      "Name=Firefox Web Browser\n"
+      "Name[de]=Firefox-Webbrowser\n"
+      "Icon=firefox\n"
+      "Exec=firefox %u\n"
+      "\n"
+      "[Desktop Action new-window]\n"
+      "Name=New Window\n"
+      "Exec=firefox --new-window %u\n");
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(entry->name, "Firefox Web Browser");
+  EXPECT_EQ(entry->icon, "firefox");
+  EXPECT_EQ(entry->program, "firefox");
+}
+
+TEST(DesktopEntriesTest, FindsTheLaunchedProgram) {
+  EXPECT_EQ(DesktopEntries::Parse("[Desktop Entry]\nType=Application\n"
+                                  "Name=A\nExec=\"/opt/My App/app\" --x\n")
+                ->program,
+            "/opt/My App/app");
+  EXPECT_EQ(DesktopEntries::Parse("[Desktop Entry]\nType=Application\n"
+                                  "Name=A\nExec=env GDK_BACKEND=x11 app %F\n")
+                ->program,
+            "app");
+  EXPECT_EQ(DesktopEntries::Parse("[Desktop Entry]\nType=Application\n"
+                                  "Name=A\nTryExec=/usr/bin/a\nExec=wrap a\n")
+                ->program,
+            "/usr/bin/a");
+}
+
+TEST(DesktopEntriesTest, RejectsNonApplications) {
+  EXPECT_FALSE(DesktopEntries::Parse(
+      "[Desktop Entry]\nType=Link\nName=Docs\nURL=https://example.com\n"));
+  EXPECT_FALSE(
+      DesktopEntries::Parse("[Desktop Entry]\nType=Application\nExec=a\n"));
+  EXPECT_FALSE(DesktopEntries::Parse(
+      "[Other Group]\nType=Application\nName=A\nExec=a\n"));
+}
+
+TEST(DesktopEntriesTest, MapsResolvedExecutablesToEntries) {
+  const std::filesystem::path dir =
+      std::filesystem::temp_directory_path() / "routine_desktop_entries";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir / "high");
+  std::filesystem::create_directories(dir / "low" / "vendor");
+
+  char sh[PATH_MAX];
+  ASSERT_NE(realpath("/bin/sh", sh), nullptr);
+
+  std::ofstream(dir / "high" / "shell.desktop")
+      << "[Desktop Entry]\nType=Application\nName=Shell\nIcon=term\n"
+         "Exec=/bin/sh -c true\n";
+  std::ofstream(dir / "low" / "vendor" / "other.desktop")
+      << "[Desktop Entry]\nType=Application\nName=Other Shell\n"
+         "Exec=/bin/sh\n";
+
+  DesktopEntries entries({(dir / "high").string(), (dir / "low").string()});
+  const auto entry = entries.Find(sh);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(entry->name, "Shell");
+  EXPECT_EQ(entry->icon, "term");
+  EXPECT_FALSE(entries.Find("/nonexistent/app"));
+
+  std::filesystem::remove_all(dir);
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,73 @@
+#include "core/desktop_session.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+
+namespace routine {
+namespace {
+
+RuleSet::Options AllowList() {
+  RuleSet::Options options;
+  options.allow_list = true;
+  return options;
+}
+
+TEST(DesktopSessionTest, AllowListsSpareTheLinuxSession) {
+  const std::filesystem::path root =
+      std::filesystem::temp_directory_path() /
+      ("routine_session_" + std::to_string(getpid()));
+  std::filesystem::create_directories(root /
+                                      "usr/lib/x86_64-linux-gnu/libexec");
+  std::filesystem::create_directories(root / "usr/lib/firefox");
+  const std::string prefix = root.string();
+
+  RuleSet::Builder builder(AllowList());
+  builder.AddApp(prefix + "/usr/bin/code");
+  AddLinuxSession(true, &builder, prefix);
+  auto rules = builder.Build();
+
+  EXPECT_FALSE(rules->IsBlocked(prefix + "/usr/bin/code"));
+  EXPECT_FALSE(rules->IsBlocked(prefix + "/usr/bin/gnome-shell"));
+  EXPECT_FALSE(rules->IsBlocked(prefix + "/usr/lib/xorg/Xorg"));
+  EXPECT_FALSE(rules->IsBlocked(prefix + "/usr/libexec/gsd-power"));
+  EXPECT_FALSE(rules->IsBlocked(
+      prefix + "/usr/lib/x86_64-linux-gnu/libexec/kscreenlocker_greet"));
+  // "*" only matches what is on disk, and only at its own level.
+  EXPECT_TRUE(rules->IsBlocked(prefix + "/usr/lib/firefox/firefox"));
+  EXPECT_TRUE(rules->IsBlocked(prefix + "/usr/bin/steam"));
+
+  std::filesystem::remove_all(root);
+}
+
+TEST(DesktopSessionTest, BlockListsOnlyExemptTheSession) {
+  RuleSet::Builder builder{RuleSet::Options()};
+  builder.AddApp("/usr/bin/plasmashell");
+  builder.AddDirectory("/usr");
+  AddLinuxSession(false, &builder);
+  auto rules = builder.Build();
+
+  EXPECT_FALSE(rules->IsBlocked("/usr/bin/plasmashell"));
+  EXPECT_FALSE(rules->IsBlocked("/usr/bin/Xwayland"));
+  // The helper directories are not listed, which would block them.
+  EXPECT_TRUE(rules->IsBlocked("/usr/bin/steam"));
+  EXPECT_TRUE(rules->IsBlocked("/usr/libexec/gsd-power"));
+}
+
+TEST(DesktopSessionTest, WindowsKeepsExplorerAndSystemApps) {
+  RuleSet::Options options = AllowList();
+  options.ignore_case = true;
+  RuleSet::Builder builder(options);
+  AddWindowsSession(true, &builder);
+  auto rules = builder.Build();
+
+  EXPECT_FALSE(rules->IsBlocked("C:\\Windows\\Explorer.exe"));
+  EXPECT_FALSE(rules->IsBlocked(
+      "C:\\Windows\\SystemApps\\ShellExperienceHost\\StartMenu.exe"));
+  EXPECT_TRUE(rules->IsBlocked("C:\\Windows\\notepad.exe"));
+}
+
+}  // namespace
+}  // namespace routine
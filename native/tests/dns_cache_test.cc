@@ -0,0 +1,110 @@
+#include "core/dns_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+#include "tests/dns_packets.h"
+
+namespace routine {
+namespace {
+
+using std::chrono::seconds;
+
+class DnsCacheTest : public ::testing::Test {
+ protected:
+  DnsQuestion Question(const std::string& name, uint16_t type = kDnsTypeA) {
+    DnsQuestion question;
+    size_t end = 0;
+    EXPECT_TRUE(ParseDnsQuery(MakeDnsQuery(1, name, type), &question, &end));
+    return question;
+  }
+
+  void Insert(DnsCache* cache, const std::string& name,
+              const std::string& response) {
+    const DnsQuestion question = Question(name);
+    DnsResponseInfo info;
+    ASSERT_TRUE(ScanDnsResponse(response, question, &info));
+    cache->Insert(question, response, info, now_);
+  }
+
+  DnsCache::Clock::time_point now_ = DnsCache::Clock::now();
+};
+
+TEST_F(DnsCacheTest, ServesAgedCopiesUntilExpiry) {
+  DnsCache cache{DnsCache::Options()};
+  const std::string answer = MakeDnsAnswer(MakeDnsQuery(1, "example.com"), 300);
+  Insert(&cache, "example.com", answer);
+
+  std::string response;
+  ASSERT_TRUE(
+      cache.Lookup(Question("EXAMPLE.com"), 0x4242, now_ + seconds(100),
+                   &response));
+  EXPECT_EQ(DnsId(response), 0x4242);
+  DnsResponseInfo info;
+  ASSERT_TRUE(ScanDnsResponse(response, Question("example.com"), &info));
+  EXPECT_EQ(info.ttl, 200u);
+  // Only the id and the TTLs differ from what the upstream sent.
+  EXPECT_EQ(response.size(), answer.size());
+  EXPECT_EQ(response.substr(2, info.ttl_offsets[0] - 2),
+            answer.substr(2, info.ttl_offsets[0] - 2));
+
+  EXPECT_FALSE(cache.Lookup(Question("example.com", kDnsTypeAaaa), 1,
+                            now_ + seconds(100), &response));
+  EXPECT_FALSE(cache.Lookup(Question("example.com"), 1, now_ + seconds(300),
+                            &response));
+  EXPECT_EQ(cache.size(), 0u);
+
+  const DnsCache::Stats stats = cache.stats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 2u);
+}
+
+TEST_F(DnsCacheTest, KeepsNegativeAnswersForTheirSoaMinimum) {
+  DnsCache cache{DnsCache::Options()};
+  Insert(&cache, "missing.example",
+         MakeDnsNegativeAnswer(MakeDnsQuery(1, "missing.example"),
+                               kDnsNxDomain, 3600, 60));
+  std::string response;
+  EXPECT_TRUE(cache.Lookup(Question("missing.example"), 1,
+                           now_ + seconds(59), &response));
+  EXPECT_FALSE(cache.Lookup(Question("missing.example"), 1,
+                            now_ + seconds(60), &response));
+  EXPECT_EQ(cache.stats().negative_hits, 1u);
+}
+
+TEST_F(DnsCacheTest, SkipsWhatMustNotBeCached) {
+  DnsCache cache{DnsCache::Options()};
+  const std::string query = MakeDnsQuery(1, "example.com");
+  Insert(&cache, "example.com", MakeDnsAnswer(query, 0));
+  Insert(&cache, "example.com",
+         MakeDnsResponseHeader(query, kDnsServFail, 0, 0));
+  std::string truncated = MakeDnsAnswer(query, 300);
+  truncated[2] |= 0x02;
+  Insert(&cache, "example.com", truncated);
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST_F(DnsCacheTest, CapsTtlsAndEvictsLeastRecentlyUsed) {
+  DnsCache::Options options;
+  options.capacity = 2;
+  options.max_ttl = 60;
+  DnsCache cache(options);
+  for (const char* name : {"a.com", "b.com"}) {
+    Insert(&cache, name, MakeDnsAnswer(MakeDnsQuery(1, name), 86400));
+  }
+  std::string response;
+  ASSERT_TRUE(cache.Lookup(Question("a.com"), 1, now_, &response));
+  Insert(&cache, "c.com", MakeDnsAnswer(MakeDnsQuery(1, "c.com"), 86400));
+
+  EXPECT_EQ(cache.size(), 2u);
+  EXPECT_EQ(cache.stats().evictions, 1u);
+  EXPECT_FALSE(cache.Lookup(Question("b.com"), 1, now_, &response));
+  EXPECT_TRUE(cache.Lookup(Question("a.com"), 1, now_, &response));
+  EXPECT_FALSE(
+      cache.Lookup(Question("c.com"), 1, now_ + seconds(60), &response));
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,201 @@
+#include "core/dns_message.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "tests/dns_packets.h"
+
+namespace routine {
+namespace {
+
+uint32_t TtlAt(const std::string& message, size_t offset) {
+  uint32_t ttl = 0;
+  for (size_t i = offset; i < offset + 4; ++i) {
+    ttl = ttl << 8 | static_cast<uint8_t>(message[i]);
+  }
+  return ttl;
+}
+
+TEST(DnsMessageTest, ParsesQueries) {
+  DnsQuestion question;
+  size_t end = 0;
+  const std::string query = MakeDnsQuery(0x1234, "WWW.Example.com");
+  ASSERT_TRUE(ParseDnsQuery(query, &question, &end));
+  EXPECT_EQ(question.name, "www.example.com");
+  EXPECT_EQ(question.type, kDnsTypeA);
+  EXPECT_EQ(question.klass, kDnsClassIn);
+  EXPECT_FALSE(question.edns);
+  EXPECT_EQ(end, query.size());
+  EXPECT_EQ(DnsId(query), 0x1234);
+
+  const std::string edns =
+      MakeDnsQuery(1, "example.com", kDnsTypeAaaa, true, true);
+  ASSERT_TRUE(ParseDnsQuery(edns, &question, &end));
+  EXPECT_TRUE(question.edns);
+  EXPECT_TRUE(question.dnssec_ok);
+  EXPECT_LT(end, edns.size());
+
+  ASSERT_TRUE(ParseDnsQuery(MakeDnsQuery(1, ""), &question, &end));
+  EXPECT_EQ(question.name, "");
+}
+
+TEST(DnsMessageTest, RejectsWhatIsNotAQuery) {
+  DnsQuestion question;
+  size_t end = 0;
+  const std::string query = MakeDnsQuery(1, "example.com");
+  EXPECT_FALSE(ParseDnsQuery(query.substr(0, 11), &question, &end));
+  EXPECT_FALSE(ParseDnsQuery(query.substr(0, query.size() - 1), &question,
+                             &end));
+  EXPECT_FALSE(
+      ParseDnsQuery(MakeDnsAnswer(query, 60), &question, &end));
+
+  std::string compressed = query.substr(0, kDnsHeaderSize);
+  compressed += "\xc0\x0c";
+  compressed += std::string("\0\1\0\1", 4);
+  EXPECT_FALSE(ParseDnsQuery(compressed, &question, &end));
+
+  std::string inverse = query;
+  inverse[2] = 0x08;  // IQUERY
+  EXPECT_FALSE(ParseDnsQuery(inverse, &question, &end));
+}
+
+TEST(DnsMessageTest, CacheKeysTellApartWhatChangesTheAnswer) {
+  DnsQuestion a;
+  DnsQuestion b;
+  size_t end = 0;
+  ASSERT_TRUE(ParseDnsQuery(MakeDnsQuery(1, "Example.com"), &a, &end));
+  ASSERT_TRUE(ParseDnsQuery(MakeDnsQuery(2, "example.COM"), &b, &end));
+  EXPECT_EQ(a.CacheKey(), b.CacheKey());
+  ASSERT_TRUE(
+      ParseDnsQuery(MakeDnsQuery(2, "example.com", kDnsTypeAaaa), &b, &end));
+  EXPECT_NE(a.CacheKey(), b.CacheKey());
+  ASSERT_TRUE(ParseDnsQuery(
+      MakeDnsQuery(2, "example.com", kDnsTypeA, true, true), &b, &end));
+  EXPECT_NE(a.CacheKey(), b.CacheKey());
+}
+
+TEST(DnsMessageTest, BuildsBlockedResponses) {
+  DnsQuestion question;
+  size_t end = 0;
+  const std::string query = MakeDnsQuery(0xbeef, "ads.example.com");
+  ASSERT_TRUE(ParseDnsQuery(query, &question, &end));
+
+  DnsResponseInfo info;
+  const std::string nxdomain =
+      BuildDnsBlockedResponse(query, end, question, false, 10);
+  ASSERT_TRUE(ScanDnsResponse(nxdomain, question, &info));
+  EXPECT_EQ(DnsId(nxdomain), 0xbeef);
+  EXPECT_EQ(info.rcode, kDnsNxDomain);
+  EXPECT_TRUE(info.negative);
+  // No SOA, so clients do not cache the refusal.
+  EXPECT_EQ(info.ttl, 0u);
+
+  const std::string sinkhole =
+      BuildDnsBlockedResponse(query, end, question, true, 10);
+  ASSERT_TRUE(ScanDnsResponse(sinkhole, question, &info));
+  EXPECT_EQ(info.rcode, kDnsNoError);
+  EXPECT_FALSE(info.negative);
+  EXPECT_EQ(info.ttl, 10u);
+  EXPECT_EQ(sinkhole.size(), end + 16);
+  EXPECT_EQ(sinkhole.substr(sinkhole.size() - 4), std::string(4, '\0'));
+
+  const std::string mx_query =
+      MakeDnsQuery(1, "ads.example.com", 15 /* MX */);
+  ASSERT_TRUE(ParseDnsQuery(mx_query, &question, &end));
+  const std::string no_data =
+      BuildDnsBlockedResponse(mx_query, end, question, true, 10);
+  ASSERT_TRUE(ScanDnsResponse(no_data, question, &info));
+  EXPECT_TRUE(info.negative);
+  EXPECT_EQ(no_data.size(), end);
+
+  const std::string servfail =
+      BuildDnsErrorResponse(mx_query, end, kDnsServFail);
+  ASSERT_TRUE(ScanDnsResponse(servfail, question, &info));
+  EXPECT_EQ(info.rcode, kDnsServFail);
+  EXPECT_EQ(info.ttl, 0u);
+}
+
+TEST(DnsMessageTest, ScansAnswersForTheirTtl) {
+  DnsQuestion question;
+  size_t end = 0;
+  const std::string query = MakeDnsQuery(7, "example.com");
+  ASSERT_TRUE(ParseDnsQuery(query, &question, &end));
+
+  DnsResponseInfo info;
+  const std::string answer = MakeDnsAnswer(query, 300);
+  ASSERT_TRUE(ScanDnsResponse(answer, question, &info));
+  EXPECT_EQ(info.rcode, kDnsNoError);
+  EXPECT_FALSE(info.negative);
+  EXPECT_FALSE(info.truncated);
+  EXPECT_EQ(info.ttl, 300u);
+  ASSERT_EQ(info.ttl_offsets.size(), 1u);
+  EXPECT_EQ(TtlAt(answer, info.ttl_offsets[0]), 300u);
+
+  // RFC 2308: the smaller of the SOA's TTL and its MINIMUM.
+  ASSERT_TRUE(ScanDnsResponse(
+      MakeDnsNegativeAnswer(query, kDnsNxDomain, 3600, 900), question,
+      &info));
+  EXPECT_TRUE(info.negative);
+  EXPECT_EQ(info.ttl, 900u);
+  ASSERT_TRUE(ScanDnsResponse(
+      MakeDnsNegativeAnswer(query, kDnsNoError, 120, 900), question, &info));
+  EXPECT_TRUE(info.negative);
+  EXPECT_EQ(info.ttl, 120u);
+
+  std::string truncated = answer;
+  truncated[2] |= 0x02;
+  ASSERT_TRUE(ScanDnsResponse(truncated, question, &info));
+  EXPECT_TRUE(info.truncated);
+  EXPECT_EQ(info.ttl, 0u);
+}
+
+TEST(DnsMessageTest, RejectsResponsesToOtherQuestions) {
+  DnsQuestion question;
+  size_t end = 0;
+  ASSERT_TRUE(
+      ParseDnsQuery(MakeDnsQuery(7, "example.com"), &question, &end));
+  DnsResponseInfo info;
+
+  const std::string other = MakeDnsAnswer(MakeDnsQuery(7, "example.org"), 60);
+  EXPECT_FALSE(ScanDnsResponse(other, question, &info));
+  const std::string aaaa =
+      MakeDnsAnswer(MakeDnsQuery(7, "example.com", kDnsTypeAaaa), 60);
+  EXPECT_FALSE(ScanDnsResponse(aaaa, question, &info));
+  const std::string answer = MakeDnsAnswer(MakeDnsQuery(7, "example.com"), 60);
+  EXPECT_FALSE(
+      ScanDnsResponse(answer.substr(0, answer.size() - 2), question, &info));
+  EXPECT_FALSE(
+      ScanDnsResponse(MakeDnsQuery(7, "example.com"), question, &info));
+
+  // A question name that points at itself.
+  std::string loop = answer.substr(0, kDnsHeaderSize);
+  loop[7] = 0;
+  loop += "\xc0\x0c";
+  loop += std::string("\0\1\0\1", 4);
+  EXPECT_FALSE(ScanDnsResponse(loop, question, &info));
+}
+
+TEST(DnsMessageTest, RejectsInflatedRecordCounts) {
+  DnsQuestion question;
+  size_t end = 0;
+  const std::string query = MakeDnsQuery(7, "example.com");
+  ASSERT_TRUE(ParseDnsQuery(query, &question, &end));
+  DnsResponseInfo info;
+
+  // ANCOUNT 0xffff and ARCOUNT 1 once added up to zero records in 16
+  // bits, so nothing was checked and the answer was cached for good.
+  std::string inflated = MakeDnsAnswer(query, 300);
+  inflated[6] = inflated[7] = '\xff';
+  inflated[10] = 0;
+  inflated[11] = 1;
+  EXPECT_FALSE(ScanDnsResponse(inflated, question, &info));
+
+  // One record more than there is.
+  std::string extra = MakeDnsAnswer(query, 300);
+  extra[7] = 2;
+  EXPECT_FALSE(ScanDnsResponse(extra, question, &info));
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,118 @@
+#ifndef ROUTINE_TESTS_DNS_PACKETS_H_
+#define ROUTINE_TESTS_DNS_PACKETS_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "core/dns_message.h"
+
+namespace routine {
+
+// Builders for the DNS packets the tests exchange with the code under test
+// and the fake upstream resolver.
+
+inline void AppendDns16(uint16_t value, std::string* out) {
+  out->push_back(static_cast<char>(value >> 8));
+  out->push_back(static_cast<char>(value));
+}
+
+inline void AppendDns32(uint32_t value, std::string* out) {
+  AppendDns16(static_cast<uint16_t>(value >> 16), out);
+  AppendDns16(static_cast<uint16_t>(value), out);
+}
+
+inline void AppendDnsName(std::string_view name, std::string* out) {
+  while (!name.empty()) {
+    const size_t dot = name.find('.');
+    const std::string_view label = name.substr(0, dot);
+    out->push_back(static_cast<char>(label.size()));
+    out->append(label);
+    name = dot == std::string_view::npos ? std::string_view()
+                                         : name.substr(dot + 1);
+  }
+  out->push_back('\0');
+}
+
+// A recursive query for |name|, with an EDNS OPT record if |edns|.
+inline std::string MakeDnsQuery(uint16_t id, std::string_view name,
+                                uint16_t type = kDnsTypeA, bool edns = false,
+                                bool dnssec_ok = false) {
+  std::string query;
+  AppendDns16(id, &query);
+  AppendDns16(0x0100, &query);  // RD
+  AppendDns16(1, &query);
+  AppendDns16(0, &query);
+  AppendDns16(0, &query);
+  AppendDns16(edns ? 1 : 0, &query);
+  AppendDnsName(name, &query);
+  AppendDns16(type, &query);
+  AppendDns16(kDnsClassIn, &query);
+  if (edns) {
+    query.push_back('\0');
+    AppendDns16(kDnsTypeOpt, &query);
+    AppendDns16(1232, &query);
+    AppendDns32(dnssec_ok ? 0x8000 : 0, &query);
+    AppendDns16(0, &query);
+  }
+  return query;
+}
+
+// The question of |query|, which must come from MakeDnsQuery(), as the
+// header and question of a response with |rcode| and the given counts.
+inline std::string MakeDnsResponseHeader(std::string_view query, uint8_t rcode,
+                                         uint16_t answers,
+                                         uint16_t authority) {
+  size_t end = kDnsHeaderSize;
+  while (query[end] != '\0') {
+    end += 1 + static_cast<uint8_t>(query[end]);
+  }
+  end += 5;
+  std::string response(query.substr(0, end));
+  response[2] = static_cast<char>(0x81);  // QR, RD
+  response[3] = static_cast<char>(0x80 | rcode);  // RA
+  response[6] = static_cast<char>(answers >> 8);
+  response[7] = static_cast<char>(answers);
+  response[8] = static_cast<char>(authority >> 8);
+  response[9] = static_cast<char>(authority);
+  response[10] = response[11] = '\0';
+  return response;
+}
+
+// Answers |query| with one A record for |address| (network order bytes
+// in a uint32_t read big-endian) valid for |ttl| seconds.
+inline std::string MakeDnsAnswer(std::string_view query, uint32_t ttl,
+                                 uint32_t address = 0x5db8d822) {
+  std::string response = MakeDnsResponseHeader(query, kDnsNoError, 1, 0);
+  AppendDns16(0xc000 | kDnsHeaderSize, &response);
+  AppendDns16(kDnsTypeA, &response);
+  AppendDns16(kDnsClassIn, &response);
+  AppendDns32(ttl, &response);
+  AppendDns16(4, &response);
+  AppendDns32(address, &response);
+  return response;
+}
+
+// Answers |query| with |rcode| and an SOA in the authority section whose
+// record TTL and MINIMUM are given.
+inline std::string MakeDnsNegativeAnswer(std::string_view query, uint8_t rcode,
+                                         uint32_t soa_ttl, uint32_t minimum) {
+  std::string response = MakeDnsResponseHeader(query, rcode, 0, 1);
+  AppendDns16(0xc000 | kDnsHeaderSize, &response);
+  AppendDns16(kDnsTypeSoa, &response);
+  AppendDns16(kDnsClassIn, &response);
+  AppendDns32(soa_ttl, &response);
+  std::string rdata;
+  AppendDnsName("ns.example", &rdata);
+  AppendDnsName("admin.example", &rdata);
+  for (uint32_t value : {1u, 7200u, 3600u, 1209600u, minimum}) {
+    AppendDns32(value, &rdata);
+  }
+  AppendDns16(static_cast<uint16_t>(rdata.size()), &response);
+  response += rdata;
+  return response;
+}
+
+}  // namespace routine
+
+#endif  // ROUTINE_TESTS_DNS_PACKETS_H_
@@ -0,0 +1,216 @@
+#include "linux/dns_sinkhole.h"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "tests/dns_packets.h"
+
+namespace routine {
+namespace {
+
+int BindLoopback(uint16_t* port) {
+  const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  EXPECT_EQ(bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)),
+            0);
+  socklen_t size = sizeof(address);
+  getsockname(fd, reinterpret_cast<sockaddr*>(&address), &size);
+  *port = ntohs(address.sin_port);
+  // Short, so a missing answer fails the test instead of hanging it.
+  timeval timeout = {0, 500 * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  return fd;
+}
+
+// A resolver on a loopback port: names starting with "nx" do not exist,
+// names starting with "slow" are never answered and everything else
+// resolves to one A record.
+class FakeUpstream {
+ public:
+  FakeUpstream() : fd_(BindLoopback(&port_)), thread_([this] { Serve(); }) {}
+
+  ~FakeUpstream() {
+    stopping_ = true;
+    thread_.join();
+    close(fd_);
+  }
+
+  uint16_t port() const { return port_; }
+  int queries() const { return queries_.load(); }
+
+ private:
+  void Serve() {
+    char buffer[512];
+    while (!stopping_) {
+      sockaddr_storage from;
+      socklen_t from_size = sizeof(from);
+      const ssize_t size =
+          recvfrom(fd_, buffer, sizeof(buffer), 0,
+                   reinterpret_cast<sockaddr*>(&from), &from_size);
+      if (size < 0) {
+        continue;
+      }
+      const std::string query(buffer, static_cast<size_t>(size));
+      DnsQuestion question;
+      size_t end = 0;
+      if (!ParseDnsQuery(query, &question, &end)) {
+        continue;
+      }
+      queries_.fetch_add(1);
+      if (question.name.rfind("slow", 0) == 0) {
+        continue;
+      }
+      const std::string response =
+          question.name.rfind("nx", 0) == 0
+              ? MakeDnsNegativeAnswer(query, kDnsNxDomain, 3600, 60)
+              : MakeDnsAnswer(query, 300);
+      sendto(fd_, response.data(), response.size(), 0,
+             reinterpret_cast<sockaddr*>(&from), from_size);
+    }
+  }
+
+  uint16_t port_ = 0;
+  const int fd_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<int> queries_{0};
+  std::thread thread_;
+};
+
+class DnsSinkholeTest : public ::testing::Test {
+ protected:
+  void SetUp() override { client_ = BindLoopback(&client_port_); }
+
+  void TearDown() override {
+    sinkhole_.reset();
+    close(client_);
+  }
+
+  void Start(DnsSinkhole::Options options = DnsSinkhole::Options()) {
+    options.listen_port = 0;
+    options.upstream_address = "127.0.0.1";
+    options.upstream_port = upstream_.port();
+    sinkhole_ = std::make_unique<DnsSinkhole>(options);
+    ASSERT_TRUE(sinkhole_->Start());
+  }
+
+  // Sends |query| to the sinkhole and returns its answer, or "" if none
+  // came.
+  std::string Ask(const std::string& query) {
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    to.sin_port = htons(sinkhole_->port());
+    sendto(client_, query.data(), query.size(), 0,
+           reinterpret_cast<sockaddr*>(&to), sizeof(to));
+    char buffer[512];
+    const ssize_t size = recv(client_, buffer, sizeof(buffer), 0);
+    return size < 0 ? std::string()
+                    : std::string(buffer, static_cast<size_t>(size));
+  }
+
+  // The scanned answer to a query for |name|.
+  DnsResponseInfo Resolve(uint16_t id, const std::string& name,
+                          uint16_t type = kDnsTypeA) {
+    const std::string query = MakeDnsQuery(id, name, type);
+    const std::string response = Ask(query);
+    DnsQuestion question;
+    size_t end = 0;
+    EXPECT_TRUE(ParseDnsQuery(query, &question, &end));
+    DnsResponseInfo info;
+    EXPECT_TRUE(ScanDnsResponse(response, question, &info)) << name;
+    EXPECT_EQ(DnsId(response), id);
+    return info;
+  }
+
+  FakeUpstream upstream_;
+  std::unique_ptr<DnsSinkhole> sinkhole_;
+  int client_ = -1;
+  uint16_t client_port_ = 0;
+};
+
+TEST_F(DnsSinkholeTest, RelaysAndCachesUpstreamAnswers) {
+  Start();
+  EXPECT_EQ(Resolve(0x1111, "example.com").ttl, 300u);
+  EXPECT_EQ(Resolve(0x2222, "Example.COM").rcode, kDnsNoError);
+  EXPECT_EQ(upstream_.queries(), 1);
+
+  const DnsResponseInfo missing = Resolve(3, "nx.example.com");
+  EXPECT_EQ(missing.rcode, kDnsNxDomain);
+  EXPECT_EQ(Resolve(4, "nx.example.com").rcode, kDnsNxDomain);
+  EXPECT_EQ(upstream_.queries(), 2);
+
+  const DnsSinkhole::Stats stats = sinkhole_->stats();
+  EXPECT_EQ(stats.queries, 4u);
+  EXPECT_EQ(stats.forwarded, 2u);
+  EXPECT_EQ(stats.answered, 2u);
+  EXPECT_EQ(stats.cached, 2u);
+  EXPECT_EQ(sinkhole_->cache_stats().negative_hits, 1u);
+}
+
+TEST_F(DnsSinkholeTest, AnswersBlockedSitesItself) {
+  Start();
+  sinkhole_->SetSites(false, {"blocked.com"});
+  const DnsResponseInfo blocked = Resolve(1, "www.blocked.com");
+  EXPECT_EQ(blocked.rcode, kDnsNxDomain);
+  EXPECT_EQ(Resolve(2, "notblocked.com").rcode, kDnsNoError);
+  EXPECT_EQ(upstream_.queries(), 1);
+  EXPECT_EQ(sinkhole_->stats().blocked, 1u);
+
+  // Unblocking applies to the next query.
+  sinkhole_->SetSites(false, {});
+  EXPECT_EQ(Resolve(3, "www.blocked.com").rcode, kDnsNoError);
+}
+
+TEST_F(DnsSinkholeTest, SinkholesToTheUnspecifiedAddress) {
+  DnsSinkhole::Options options;
+  options.block_answer = DnsSinkhole::BlockAnswer::kSinkhole;
+  Start(options);
+  sinkhole_->SetSites(false, {"blocked.com"});
+
+  const std::string response = Ask(MakeDnsQuery(1, "blocked.com"));
+  ASSERT_GE(response.size(), 4u);
+  EXPECT_EQ(response.substr(response.size() - 4), std::string(4, '\0'));
+  EXPECT_EQ(Resolve(2, "blocked.com", kDnsTypeAaaa).rcode, kDnsNoError);
+  EXPECT_EQ(upstream_.queries(), 0);
+}
+
+TEST_F(DnsSinkholeTest, AllowListsBlockEverythingElse) {
+  Start();
+  sinkhole_->SetSites(true, {"allowed.com"});
+  EXPECT_EQ(Resolve(1, "docs.allowed.com").rcode, kDnsNoError);
+  EXPECT_EQ(Resolve(2, "other.com").rcode, kDnsNxDomain);
+  EXPECT_EQ(Resolve(3, "1.0.0.127.in-addr.arpa").rcode, kDnsNoError);
+  EXPECT_EQ(upstream_.queries(), 2);
+}
+
+TEST_F(DnsSinkholeTest, FailsQueriesTheUpstreamIgnores) {
+  DnsSinkhole::Options options;
+  options.upstream_timeout = std::chrono::milliseconds(50);
+  Start(options);
+  EXPECT_EQ(Resolve(9, "slow.example.com").rcode, kDnsServFail);
+  EXPECT_EQ(sinkhole_->stats().timeouts, 1u);
+  // Failures are not cached.
+  EXPECT_EQ(Resolve(10, "slow.example.com").rcode, kDnsServFail);
+  EXPECT_EQ(upstream_.queries(), 2);
+}
+
+TEST_F(DnsSinkholeTest, DropsMalformedQueries) {
+  Start();
+  EXPECT_EQ(Ask("garbage"), "");
+  EXPECT_EQ(sinkhole_->stats().dropped, 1u);
+  EXPECT_EQ(Resolve(1, "example.com").rcode, kDnsNoError);
+}
+
+}  // namespace
+}  // namespace routine
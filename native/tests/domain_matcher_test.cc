@@ -0,0 +1,107 @@
+#include "core/domain_matcher.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace routine {
+namespace {
+
+std::string Normalize(std::string_view domain) {
+  std::string ascii;
+  return NormalizeDomain(domain, &ascii) ? ascii : "<invalid>";
+}
+
+TEST(NormalizeDomainTest, LowersAndStripsWildcards) {
+  EXPECT_EQ(Normalize("Example.COM"), "example.com");
+  EXPECT_EQ(Normalize("*.example.com"), "example.com");
+  EXPECT_EQ(Normalize(".example.com."), "example.com");
+  EXPECT_EQ(Normalize("my_host-1.example"), "my_host-1.example");
+}
+
+TEST(NormalizeDomainTest, EncodesPunycode) {
+  EXPECT_EQ(Normalize("b\xc3\xbc" "cher.de"), "xn--bcher-kva.de");
+  EXPECT_EQ(Normalize("M\xc3\x9c" "NCHEN.de"), "xn--mnchen-3ya.de");
+  // RFC 3492 7.1 (B), Chinese (simplified).
+  EXPECT_EQ(Normalize("\xe4\xbb\x96\xe4\xbb\xac\xe4\xb8\xba\xe4\xbb\x80"
+                      "\xe4\xb9\x88\xe4\xb8\x8d\xe8\xaf\xb4\xe4\xb8\xad"
+                      "\xe6\x96\x87"),
+            "xn--ihqwcrb4cv8a8dqg056pqjye");
+  // Cyrillic capitals are lowered: "ПРИМЕР.рф".
+  EXPECT_EQ(Normalize("\xd0\x9f\xd0\xa0\xd0\x98\xd0\x9c\xd0\x95\xd0\xa0."
+                      "\xd1\x80\xd1\x84"),
+            "xn--e1afmkfd.xn--p1ai");
+  // The ideographic full stop separates labels.
+  EXPECT_EQ(Normalize("example\xe3\x80\x82" "com"), "example.com");
+}
+
+TEST(NormalizeDomainTest, RejectsNonHosts) {
+  EXPECT_EQ(Normalize(""), "<invalid>");
+  EXPECT_EQ(Normalize("*."), "<invalid>");
+  EXPECT_EQ(Normalize("a..b"), "<invalid>");
+  EXPECT_EQ(Normalize("example.com/path"), "<invalid>");
+  EXPECT_EQ(Normalize("exa mple.com"), "<invalid>");
+  EXPECT_EQ(Normalize("\xc3\x28.com"), "<invalid>");
+  EXPECT_EQ(Normalize("\xc0\xae.com"), "<invalid>");
+  EXPECT_EQ(Normalize(std::string(64, 'a') + ".com"), "<invalid>");
+  EXPECT_EQ(Normalize(std::string(63, 'a') + ".com"),
+            std::string(63, 'a') + ".com");
+}
+
+TEST(DomainMatcherTest, MatchesOnLabelBoundaries) {
+  DomainMatcher matcher;
+  ASSERT_TRUE(matcher.Add("example.com"));
+  ASSERT_TRUE(matcher.Add("news.ycombinator.com"));
+
+  EXPECT_TRUE(matcher.Matches("example.com"));
+  EXPECT_TRUE(matcher.Matches("www.example.com"));
+  EXPECT_TRUE(matcher.Matches("a.b.EXAMPLE.com."));
+  EXPECT_TRUE(matcher.Matches("news.ycombinator.com"));
+  // endsWith() matched all of these.
+  EXPECT_FALSE(matcher.Matches("notexample.com"));
+  EXPECT_FALSE(matcher.Matches("ycombinator.com"));
+  EXPECT_FALSE(matcher.Matches("hackernews.ycombinator.com"));
+  EXPECT_FALSE(matcher.Matches("example.com.evil.net"));
+  EXPECT_FALSE(matcher.Matches("com"));
+  EXPECT_FALSE(matcher.Matches(""));
+  EXPECT_FALSE(matcher.Matches("a..example.com.x"));
+}
+
+TEST(DomainMatcherTest, MatchesUnicodeAndPunycodeAlike) {
+  DomainMatcher matcher;
+  ASSERT_TRUE(matcher.Add("B\xc3\xbc" "cher.de"));
+  EXPECT_TRUE(matcher.Matches("xn--bcher-kva.de"));
+  EXPECT_TRUE(matcher.Matches("shop.b\xc3\xbc" "cher.de"));
+  EXPECT_FALSE(matcher.Matches("bucher.de"));
+}
+
+TEST(DomainMatcherTest, CountsDomainsNotCoveredByParents) {
+  DomainMatcher matcher;
+  EXPECT_FALSE(matcher.Add("not a domain"));
+  EXPECT_TRUE(matcher.Add("a.example.com"));
+  EXPECT_TRUE(matcher.Add("example.com"));
+  EXPECT_TRUE(matcher.Add("b.example.com"));
+  EXPECT_TRUE(matcher.Add("*.Example.com"));
+  EXPECT_EQ(matcher.size(), 2u);
+  EXPECT_TRUE(matcher.Matches("b.example.com"));
+
+  matcher.Clear();
+  EXPECT_EQ(matcher.size(), 0u);
+  EXPECT_FALSE(matcher.Matches("example.com"));
+}
+
+TEST(DomainMatcherTest, GrowsPastManyDomains) {
+  DomainMatcher matcher;
+  for (int i = 0; i < 5000; ++i) {
+    ASSERT_TRUE(matcher.Add("site" + std::to_string(i) + ".example"));
+  }
+  EXPECT_EQ(matcher.size(), 5000u);
+  for (int i = 0; i < 5000; ++i) {
+    EXPECT_TRUE(matcher.Matches("www.site" + std::to_string(i) + ".example"));
+  }
+  EXPECT_FALSE(matcher.Matches("site5000.example"));
+  EXPECT_FALSE(matcher.Matches("example"));
+}
+
+}  // namespace
+}  // namespace routine
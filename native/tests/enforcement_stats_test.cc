@@ -0,0 +1,193 @@
+#include "core/enforcement_stats.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace routine {
+namespace {
+
+using std::chrono::microseconds;
+using std::chrono::nanoseconds;
+using std::chrono::seconds;
+
+TEST(LatencyHistogramTest, BucketsByPowerOfTwo) {
+  EXPECT_EQ(LatencyHistogram::BucketFor(0), 0u);
+  EXPECT_EQ(LatencyHistogram::BucketFor(1), 1u);
+  EXPECT_EQ(LatencyHistogram::BucketFor(2), 2u);
+  EXPECT_EQ(LatencyHistogram::BucketFor(3), 2u);
+  EXPECT_EQ(LatencyHistogram::BucketFor(1024), 11u);
+  EXPECT_EQ(LatencyHistogram::BucketFor(~uint64_t{0}),
+            LatencyHistogram::kBuckets - 1);
+}
+
+TEST(LatencyHistogramTest, QuantilesAreBucketBounds) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.Load().QuantileNanos(0.5), 0u);
+
+  for (int i = 0; i < 90; ++i) {
+    histogram.Record(nanoseconds(100));
+  }
+  for (int i = 0; i < 10; ++i) {
+    histogram.Record(microseconds(50));
+  }
+  histogram.Record(nanoseconds(-5));
+
+  const LatencyHistogram::Snapshot snapshot = histogram.Load();
+  EXPECT_EQ(snapshot.count, 101u);
+  EXPECT_EQ(snapshot.sum_ns, 90u * 100 + 10u * 50000);
+  EXPECT_EQ(snapshot.max_ns, 50000u);
+  EXPECT_EQ(snapshot.buckets[0], 1u);
+  // 100 ns falls in [64, 128).
+  EXPECT_EQ(snapshot.QuantileNanos(0.5), 127u);
+  EXPECT_EQ(snapshot.QuantileNanos(0.9), 127u);
+  // Capped at the largest latency seen rather than the bucket's 65535.
+  EXPECT_EQ(snapshot.QuantileNanos(0.99), 50000u);
+  EXPECT_EQ(snapshot.QuantileNanos(1.0), 50000u);
+}
+
+TEST(LatencyHistogramTest, RecordsFromManyThreads) {
+  LatencyHistogram histogram;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&histogram, t] {
+      for (int i = 0; i < 1000; ++i) {
+        histogram.Record(nanoseconds(t * 1000 + i));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const LatencyHistogram::Snapshot snapshot = histogram.Load();
+  EXPECT_EQ(snapshot.count, 4000u);
+  EXPECT_EQ(snapshot.max_ns, 3999u);
+}
+
+TEST(RateMeterTest, CountsTheLastMinute) {
+  RateMeter meter;
+  const RateMeter::Clock::time_point start = RateMeter::Clock::now();
+  for (int i = 0; i < 120; ++i) {
+    meter.Mark(start + seconds(i));
+  }
+  EXPECT_EQ(meter.total(), 120u);
+  EXPECT_EQ(meter.LastMinute(start + seconds(119)), 60u);
+  EXPECT_EQ(meter.LastMinute(start + seconds(150)), 29u);
+  EXPECT_EQ(meter.LastMinute(start + seconds(300)), 0u);
+  EXPECT_EQ(meter.total(), 120u);
+}
+
+TEST(TraceRecorderTest, RecordsOnlyWhileEnabled) {
+  TraceRecorder trace(4);
+  const TraceRecorder::Clock::time_point now = TraceRecorder::Clock::now();
+  trace.Complete("ignored", now, now + microseconds(5));
+  EXPECT_EQ(trace.size(), 0u);
+
+  trace.set_enabled(true);
+  trace.Complete("enforce", now, now + microseconds(5));
+  EXPECT_EQ(trace.size(), 1u);
+  const std::string json = trace.ToJson();
+  EXPECT_EQ(json.find("ignored"), std::string::npos);
+  EXPECT_NE(json.find("\"name\":\"enforce\""), std::string::npos);
+  EXPECT_NE(json.find("\"ph\":\"X\""), std::string::npos);
+  EXPECT_NE(json.find("\"dur\":5.000"), std::string::npos);
+}
+
+TEST(TraceRecorderTest, KeepsTheNewestSpans) {
+  TraceRecorder trace(3);
+  trace.set_enabled(true);
+  const char* names[] = {"a", "b", "c", "d", "e"};
+  const TraceRecorder::Clock::time_point now = TraceRecorder::Clock::now();
+  for (const char* name : names) {
+    trace.Complete(name, now, now);
+  }
+  EXPECT_EQ(trace.size(), 3u);
+
+  const std::string json = trace.ToJson();
+  EXPECT_EQ(json.find("\"name\":\"b\""), std::string::npos);
+  const size_t c = json.find("\"name\":\"c\"");
+  const size_t d = json.find("\"name\":\"d\"");
+  const size_t e = json.find("\"name\":\"e\"");
+  ASSERT_NE(c, std::string::npos);
+  ASSERT_NE(e, std::string::npos);
+  EXPECT_LT(c, d);
+  EXPECT_LT(d, e);
+}
+
+TEST(TraceRecorderTest, WritesToFile) {
+  TraceRecorder trace;
+  trace.set_enabled(true);
+  const TraceRecorder::Clock::time_point now = TraceRecorder::Clock::now();
+  trace.Complete("poll", now, now);
+
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "routine_trace_test.json";
+  ASSERT_TRUE(trace.WriteTo(path.string()));
+  std::ifstream in(path, std::ios::binary);
+  const std::string contents((std::istreambuf_iterator<char>(in)),
+                             std::istreambuf_iterator<char>());
+  EXPECT_EQ(contents, trace.ToJson());
+  in.close();
+  std::filesystem::remove(path);
+
+  EXPECT_FALSE(trace.WriteTo((path / "missing" / "trace.json").string()));
+}
+
+TEST(ScopedLatencyTest, RecordsIntoHistogramAndTrace) {
+  LatencyHistogram histogram;
+  TraceRecorder trace;
+  { ScopedLatency latency(&histogram, &trace, "off"); }
+  trace.set_enabled(true);
+  { ScopedLatency latency(&histogram, &trace, "on"); }
+  { ScopedLatency latency(nullptr, nullptr, "neither"); }
+
+  EXPECT_EQ(histogram.Load().count, 2u);
+  EXPECT_EQ(trace.size(), 1u);
+  EXPECT_NE(trace.ToJson().find("\"name\":\"on\""), std::string::npos);
+}
+
+TEST(EnforcementStatsJsonTest, ReportsEveryFigure) {
+  EnforcementStats stats;
+  stats.focus_to_enforcement.Record(microseconds(3));
+  stats.is_blocked.Record(nanoseconds(200));
+  stats.open_process_failures.Add(2);
+  stats.image_path_failures.Add();
+  stats.timer_wakeups.Mark(stats.start);
+  stats.timer_wakeups.Mark(stats.start + seconds(90));
+
+  EnforcementExtras extras;
+  extras.cache.hits = 3;
+  extras.cache.misses = 1;
+  std::string json =
+      EnforcementStatsJson(stats, extras, stats.start + seconds(100));
+  EXPECT_EQ(json.front(), '{');
+  EXPECT_EQ(json.back(), '}');
+  EXPECT_NE(json.find("\"uptimeSeconds\":100.000"), std::string::npos);
+  EXPECT_NE(json.find("\"focusToEnforcement\":{\"count\":1,\"meanNs\":3000"),
+            std::string::npos);
+  EXPECT_NE(json.find("\"buckets\":[[4095,1]]"), std::string::npos);
+  EXPECT_NE(json.find("\"isBlocked\":{\"count\":1"), std::string::npos);
+  EXPECT_NE(json.find("\"pollTick\":{\"count\":0"), std::string::npos);
+  EXPECT_NE(json.find("\"hitRate\":0.7500"), std::string::npos);
+  EXPECT_NE(json.find("\"openProcessFailures\":2"), std::string::npos);
+  EXPECT_NE(json.find("\"imagePathFailures\":1"), std::string::npos);
+  EXPECT_NE(json.find("\"timerWakeups\":2"), std::string::npos);
+  EXPECT_NE(json.find("\"timerWakeupsLastMinute\":1"), std::string::npos);
+  EXPECT_NE(json.find("\"tracing\":false"), std::string::npos);
+  EXPECT_EQ(json.find("logBytesWritten"), std::string::npos);
+
+  extras.log_bytes_written = 512;
+  extras.log_messages_dropped = 0;
+  json = EnforcementStatsJson(stats, extras, stats.start + seconds(100));
+  EXPECT_NE(json.find("\"logBytesWritten\":512"), std::string::npos);
+  EXPECT_NE(json.find("\"logMessagesDropped\":0"), std::string::npos);
+}
+
+}  // namespace
+}  // namespace routine
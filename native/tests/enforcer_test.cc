@@ -0,0 +1,194 @@
+#include "linux/enforcer.h"
+
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace routine {
+namespace {
+
+char ProcessState(pid_t pid) {
+  for (int attempt = 0; attempt < 200; ++attempt) {
+    int status = 0;
+    // WUNTRACED|WCONTINUED lets us observe stops of our own child.
+    const pid_t changed =
+        waitpid(pid, &status, WNOHANG | WUNTRACED | WCONTINUED);
+    if (changed == pid && WIFSTOPPED(status)) {
+      return 'T';
+    }
+    if (changed == pid && WIFCONTINUED(status)) {
+      return 'R';
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return '?';
+}
+
+std::unique_ptr<const RuleSet> BlockExe(const std::string& exe) {
+  RuleSet::Builder builder{RuleSet::Options()};
+  if (!exe.empty()) {
+    builder.AddApp(exe);
+  }
+  return builder.Build();
+}
+
+class EnforcerTest : public ::testing::Test {
+ protected:
+  void SetUp() override { exe_ = ProcFs().ReadExe(getpid()); }
+
+  std::string exe_;
+  PolicyStore policy_;
+};
+
+TEST_F(EnforcerTest, MinimizesBlockedWindows) {
+  std::vector<uint64_t> minimized;
+  Enforcer enforcer(&policy_, ProcFs(), Enforcer::Mode::kMinimize,
+                    [&](uint64_t window) {
+                      minimized.push_back(window);
+                      return true;
+                    });
+
+  EXPECT_FALSE(enforcer.Enforce(ForegroundWindow{7, getpid()}));
+  policy_.Set(BlockExe(exe_));
+  EXPECT_TRUE(enforcer.Enforce(ForegroundWindow{7, getpid()}));
+  EXPECT_FALSE(enforcer.Enforce(ForegroundWindow{8, 0}));
+
+  EXPECT_EQ(minimized, std::vector<uint64_t>{7});
+}
+
+TEST_F(EnforcerTest, RecordsLookupsAndUnreadableWindows) {
+  EnforcementStats stats;
+  Enforcer enforcer(&policy_, ProcFs(), Enforcer::Mode::kMinimize, nullptr,
+                    &stats);
+
+  enforcer.Enforce(ForegroundWindow{7, getpid()});
+  enforcer.EnforceProcess(getppid());
+  EXPECT_EQ(stats.is_blocked.Load().count, 2u);
+
+  // No such process: nothing to look up, and counted as unreadable.
+  enforcer.Enforce(ForegroundWindow{8, 0x3fffffff});
+  EXPECT_EQ(stats.is_blocked.Load().count, 2u);
+  EXPECT_EQ(stats.image_path_failures.Load(), 1u);
+}
+
+TEST_F(EnforcerTest, SuspendsUntilPolicyChanges) {
+  const pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    for (;;) {
+      pause();
+    }
+  }
+
+  {
+    Enforcer enforcer(&policy_, ProcFs(), Enforcer::Mode::kSuspend, nullptr);
+    policy_.Set(BlockExe(exe_));
+
+    EXPECT_TRUE(enforcer.Enforce(ForegroundWindow{1, child}));
+    EXPECT_EQ(ProcessState(child), 'T');
+    EXPECT_EQ(enforcer.suspended_count(), 1u);
+
+    // Still blocked: nothing to resume.
+    enforcer.Reconcile();
+    EXPECT_EQ(enforcer.suspended_count(), 1u);
+
+    policy_.Set(BlockExe(""));
+    enforcer.Reconcile();
+    EXPECT_EQ(ProcessState(child), 'R');
+    EXPECT_EQ(enforcer.suspended_count(), 0u);
+  }
+
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+}
+
+TEST_F(EnforcerTest, SuspendsBlockedProcessesButNotItself) {
+  const pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    for (;;) {
+      pause();
+    }
+  }
+
+  {
+    Enforcer enforcer(&policy_, ProcFs(), Enforcer::Mode::kMinimize, nullptr);
+    EXPECT_FALSE(enforcer.EnforceProcess(child));
+
+    policy_.Set(BlockExe(exe_));
+    EXPECT_FALSE(enforcer.EnforceProcess(getpid()));
+    EXPECT_TRUE(enforcer.EnforceProcess(child));
+    EXPECT_EQ(ProcessState(child), 'T');
+    EXPECT_EQ(enforcer.suspended_count(), 1u);
+  }
+  EXPECT_EQ(ProcessState(child), 'R');
+
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+}
+
+TEST_F(EnforcerTest, BlocksOnBehalfOfAncestors) {
+  const pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    for (;;) {
+      pause();
+    }
+  }
+
+  // The child was started by a launcher that has since exited.
+  constexpr int64_t kLauncher = 0x3ffffff0;
+  const std::string launcher = "/opt/launcher/bin/launcher";
+  ProcessTree tree;
+  tree.Reset({{kLauncher, 1, launcher}});
+  tree.Fork(child, kLauncher);
+  tree.Exec(child, exe_);
+  tree.Exit(kLauncher);
+
+  {
+    Enforcer enforcer(&policy_, ProcFs(), Enforcer::Mode::kSuspend, nullptr);
+    policy_.Set(BlockExe(launcher));
+    EXPECT_FALSE(enforcer.EnforceProcess(child));
+
+    enforcer.set_process_tree(&tree);
+    EXPECT_TRUE(enforcer.EnforceProcess(child));
+    EXPECT_EQ(ProcessState(child), 'T');
+
+    // Resumed once the launcher is no longer blocked.
+    policy_.Set(BlockExe(""));
+    enforcer.Reconcile();
+    EXPECT_EQ(ProcessState(child), 'R');
+  }
+
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+}
+
+TEST_F(EnforcerTest, ResumesEverythingOnDestruction) {
+  const pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    for (;;) {
+      pause();
+    }
+  }
+
+  policy_.Set(BlockExe(exe_));
+  {
+    Enforcer enforcer(&policy_, ProcFs(), Enforcer::Mode::kSuspend, nullptr);
+    enforcer.Enforce(ForegroundWindow{1, child});
+    EXPECT_EQ(ProcessState(child), 'T');
+  }
+  EXPECT_EQ(ProcessState(child), 'R');
+
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,176 @@
+#include "linux/exec_blocker.h"
+
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+namespace routine {
+namespace {
+
+bool WaitForStop(pid_t pid) {
+  for (int attempt = 0; attempt < 400; ++attempt) {
+    int status = 0;
+    if (waitpid(pid, &status, WNOHANG | WUNTRACED) == pid &&
+        WIFSTOPPED(status)) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return false;
+}
+
+// Blocks a private copy of sleep(1), so enforcement cannot touch anything
+// else running on the machine.
+class ExecBlockerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() /
+           ("routine_exec_blocker_" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir_);
+    exe_ = std::filesystem::canonical(dir_) / "blocked_sleep";
+    std::filesystem::copy_file(
+        "/bin/sleep", exe_,
+        std::filesystem::copy_options::overwrite_existing);
+
+    RuleSet::Builder builder{RuleSet::Options()};
+    builder.AddApp(exe_.string());
+    policy_.Set(builder.Build());
+  }
+
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  pid_t SpawnBlocked() {
+    const pid_t child = fork();
+    if (child == 0) {
+      execl(exe_.c_str(), "sleep", "30", static_cast<char*>(nullptr));
+      _exit(127);
+    }
+    return child;
+  }
+
+  std::filesystem::path dir_;
+  std::filesystem::path exe_;
+  PolicyStore policy_;
+};
+
+TEST_F(ExecBlockerTest, SuspendsBlockedExecs) {
+  Enforcer enforcer(&policy_, ProcFs(), Enforcer::Mode::kMinimize, nullptr);
+  ExecBlocker blocker(&enforcer);
+  if (!blocker.Start()) {
+    GTEST_SKIP() << "proc connector needs CAP_NET_ADMIN";
+  }
+
+  const pid_t child = SpawnBlocked();
+  ASSERT_GT(child, 0);
+  EXPECT_TRUE(WaitForStop(child));
+  blocker.Stop();
+
+  const ExecBlocker::Stats stats = blocker.stats();
+  EXPECT_GE(stats.execs, 1u);
+  EXPECT_GE(stats.blocked, 1u);
+  EXPECT_GE(stats.batches, 1u);
+
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+}
+
+TEST_F(ExecBlockerTest, RescansAfterOverrun) {
+  const pid_t child = SpawnBlocked();
+  ASSERT_GT(child, 0);
+  // Not started: the exec goes unseen, as if its event had been dropped.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  Enforcer enforcer(&policy_, ProcFs(), Enforcer::Mode::kMinimize, nullptr);
+  ExecBlocker blocker(&enforcer);
+
+  blocker.HandleBatch({}, /*overrun=*/true);
+  EXPECT_TRUE(WaitForStop(child));
+  EXPECT_EQ(blocker.stats().overruns, 1u);
+
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+}
+
+TEST_F(ExecBlockerTest, LeavesAllowListsToFocus) {
+  const pid_t child = SpawnBlocked();
+  ASSERT_GT(child, 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  // A /proc with only |child| in it, so a rescan cannot reach anything
+  // else on the machine.
+  const std::filesystem::path proc = dir_ / "proc";
+  std::filesystem::create_directories(proc);
+  std::filesystem::create_directory_symlink(
+      "/proc/" + std::to_string(child), proc / std::to_string(child));
+
+  RuleSet::Options options;
+  options.allow_list = true;
+  RuleSet::Builder builder(options);
+  builder.AddApp("/usr/bin/editor");
+  policy_.Set(builder.Build());
+
+  Enforcer enforcer(&policy_, ProcFs(proc.string()),
+                    Enforcer::Mode::kSuspend, nullptr);
+  ExecBlocker blocker(&enforcer);
+  ProcEvent exec;
+  exec.pid = child;
+  blocker.HandleBatch({exec}, /*overrun=*/false);
+  blocker.HandleBatch({}, /*overrun=*/true);
+  enforcer.EnforceRunning();
+
+  EXPECT_EQ(blocker.stats().blocked, 0u);
+  EXPECT_EQ(enforcer.suspended_count(), 0u);
+  int status = 0;
+  EXPECT_EQ(waitpid(child, &status, WNOHANG | WUNTRACED), 0);
+
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+}
+
+TEST_F(ExecBlockerTest, BlocksWhatBlockedAppsStart) {
+  const pid_t launcher = SpawnBlocked();
+  ASSERT_GT(launcher, 0);
+  const pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    for (;;) {
+      pause();
+    }
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  ProcessTree tree;
+  Enforcer enforcer(&policy_, ProcFs(), Enforcer::Mode::kMinimize, nullptr);
+  enforcer.set_process_tree(&tree);
+  ExecBlocker blocker(&enforcer, &tree);
+
+  // As the kernel would report the launcher starting |child|.
+  ProcEvent exec_launcher;
+  exec_launcher.pid = launcher;
+  ProcEvent fork_child;
+  fork_child.type = ProcEvent::Type::kFork;
+  fork_child.pid = child;
+  fork_child.parent_pid = launcher;
+  ProcEvent exec_child;
+  exec_child.pid = child;
+  blocker.HandleBatch({exec_launcher, fork_child, exec_child},
+                      /*overrun=*/false);
+
+  EXPECT_TRUE(WaitForStop(launcher));
+  EXPECT_TRUE(WaitForStop(child));
+  EXPECT_EQ(blocker.stats().blocked, 2u);
+  EXPECT_EQ(tree.size(), 2u);
+
+  for (const pid_t pid : {launcher, child}) {
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+  }
+}
+
+}  // namespace
+}  // namespace routine
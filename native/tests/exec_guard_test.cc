@@ -0,0 +1,141 @@
+#include "linux/exec_guard.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+
+namespace routine {
+namespace {
+
+// Blocks a private copy of true(1), so the guard cannot deny anything else
+// executed on the machine meanwhile.
+class ExecGuardTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() /
+           ("routine_exec_guard_" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir_);
+    dir_ = std::filesystem::canonical(dir_);
+    blocked_ = dir_ / "blocked_true";
+    allowed_ = dir_ / "allowed_true";
+    for (const auto& copy : {blocked_, allowed_}) {
+      std::filesystem::copy_file(
+          "/bin/true", copy,
+          std::filesystem::copy_options::overwrite_existing);
+    }
+    Block(false);
+  }
+
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  void Block(bool allow_list) {
+    RuleSet::Options options;
+    options.allow_list = allow_list;
+    RuleSet::Builder builder{options};
+    builder.AddApp(blocked_.string());
+    policy_.Set(builder.Build());
+  }
+
+  bool IsDenied(ExecGuard* guard, const std::filesystem::path& path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    EXPECT_GE(fd, 0);
+    const bool denied = guard->IsDenied(fd, getpid() + 1);
+    close(fd);
+    return denied;
+  }
+
+  // Runs |path| and returns its exit status: 0 if it ran, 126 if exec()
+  // was refused with EPERM.
+  int Run(const std::filesystem::path& path) {
+    const pid_t child = fork();
+    if (child == 0) {
+      execl(path.c_str(), "true", static_cast<char*>(nullptr));
+      _exit(errno == EPERM ? 126 : 127);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+  }
+
+  std::filesystem::path dir_;
+  std::filesystem::path blocked_;
+  std::filesystem::path allowed_;
+  PolicyStore policy_;
+};
+
+TEST_F(ExecGuardTest, DecidesByInodeAndCachesVerdicts) {
+  ExecGuard guard(&policy_, ExecGuard::Options());
+  EXPECT_TRUE(IsDenied(&guard, blocked_));
+  EXPECT_TRUE(IsDenied(&guard, blocked_));
+  EXPECT_FALSE(IsDenied(&guard, allowed_));
+  EXPECT_EQ(guard.stats().cached, 1u);
+
+  // Our own execs are never denied.
+  const int fd = open(blocked_.c_str(), O_RDONLY | O_CLOEXEC);
+  EXPECT_FALSE(guard.IsDenied(fd, getpid()));
+  close(fd);
+
+  // A new policy invalidates the cached verdicts.
+  policy_.Set(RuleSet::Builder(RuleSet::Options()).Build());
+  EXPECT_FALSE(IsDenied(&guard, blocked_));
+}
+
+TEST_F(ExecGuardTest, LeavesAllowListsToFocusEnforcement) {
+  Block(true);
+  ExecGuard guard(&policy_, ExecGuard::Options());
+  EXPECT_FALSE(IsDenied(&guard, allowed_));
+}
+
+TEST_F(ExecGuardTest, DeniesBlockedExecs) {
+  ExecGuard::Options options;
+  options.mounts = {dir_.string()};
+  ExecGuard guard(&policy_, options);
+  if (!guard.Start()) {
+    GTEST_SKIP() << "fanotify exec permission events need CAP_SYS_ADMIN";
+  }
+  EXPECT_EQ(Run(blocked_), 126);
+  EXPECT_EQ(Run(allowed_), 0);
+  EXPECT_EQ(Run(blocked_), 126);
+  guard.Stop();
+
+  const ExecGuard::Stats stats = guard.stats();
+  EXPECT_GE(stats.execs, 3u);
+  EXPECT_EQ(stats.denied, 2u);
+  EXPECT_GE(stats.cached, 1u);
+  EXPECT_EQ(stats.timeouts, 0u);
+  // Stopped, nothing is denied any more.
+  EXPECT_EQ(Run(blocked_), 0);
+}
+
+TEST_F(ExecGuardTest, UnmarksFilesystemsUnderAllowLists) {
+  Block(true);
+  ExecGuard::Options options;
+  options.mounts = {dir_.string()};
+  ExecGuard guard(&policy_, options);
+  if (!guard.Start()) {
+    GTEST_SKIP() << "fanotify exec permission events need CAP_SYS_ADMIN";
+  }
+  // Nothing to decide, so execs do not wait for the guard.
+  EXPECT_EQ(Run(allowed_), 0);
+  EXPECT_EQ(Run(blocked_), 0);
+  EXPECT_EQ(guard.stats().execs, 0u);
+
+  Block(false);
+  guard.Reconcile();
+  EXPECT_EQ(Run(blocked_), 126);
+  EXPECT_GE(guard.stats().execs, 1u);
+
+  Block(true);
+  guard.Reconcile();
+  const uint64_t execs = guard.stats().execs;
+  EXPECT_EQ(Run(blocked_), 0);
+  EXPECT_EQ(guard.stats().execs, execs);
+}
+
+}  // namespace
+}  // namespace routine
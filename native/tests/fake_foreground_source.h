@@ -0,0 +1,45 @@
+#ifndef ROUTINE_TESTS_FAKE_FOREGROUND_SOURCE_H_
+#define ROUTINE_TESTS_FAKE_FOREGROUND_SOURCE_H_
+
+#include <optional>
+#include <utility>
+
+#include "core/foreground_tracker.h"
+
+namespace routine {
+
+// A ForegroundSource driven by the test: Focus() moves focus and, unless
+// events are muted, notifies the tracker the way a platform hook would.
+class FakeForegroundSource : public ForegroundSource {
+ public:
+  explicit FakeForegroundSource(bool event_driven = true)
+      : event_driven_(event_driven) {}
+
+  bool Start(Callback callback) override {
+    callback_ = std::move(callback);
+    return event_driven_;
+  }
+  void Stop() override { callback_ = nullptr; }
+  std::optional<ForegroundWindow> Current() override {
+    ++queries;
+    return current_;
+  }
+
+  void Focus(uint64_t window, int64_t pid, bool notify = true) {
+    current_ = ForegroundWindow{window, pid};
+    if (notify && event_driven_ && callback_) {
+      callback_(current_);
+    }
+  }
+
+  int queries = 0;
+
+ private:
+  bool event_driven_;
+  Callback callback_;
+  ForegroundWindow current_;
+};
+
+}  // namespace routine
+
+#endif  // ROUTINE_TESTS_FAKE_FOREGROUND_SOURCE_H_
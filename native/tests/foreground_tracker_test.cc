@@ -0,0 +1,136 @@
+#include "core/foreground_tracker.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "core/enforcement_stats.h"
+#include "tests/fake_foreground_source.h"
+
+namespace routine {
+namespace {
+
+using std::chrono::seconds;
+
+class ForegroundTrackerTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<ForegroundTracker> MakeTracker(
+      bool event_driven, EnforcementStats* enforcement_stats = nullptr) {
+    auto source = std::make_unique<FakeForegroundSource>(event_driven);
+    source_ = source.get();
+    return std::make_unique<ForegroundTracker>(
+        std::move(source),
+        [this](const ForegroundWindow& window) { handled_.push_back(window); },
+        seconds(2), enforcement_stats);
+  }
+
+  FakeForegroundSource* source_ = nullptr;
+  std::vector<ForegroundWindow> handled_;
+};
+
+TEST_F(ForegroundTrackerTest, HandlesOnlyActualChanges) {
+  auto tracker = MakeTracker(true);
+  source_->Focus(1, 100, false);
+  EXPECT_TRUE(tracker->Start());
+  ASSERT_EQ(handled_.size(), 1u);
+
+  source_->Focus(1, 100);
+  source_->Focus(2, 200);
+  source_->Focus(2, 200);
+  source_->Focus(1, 100);
+
+  ASSERT_EQ(handled_.size(), 3u);
+  EXPECT_EQ(handled_[1].window, 2u);
+  EXPECT_EQ(handled_[2].pid, 100);
+  EXPECT_EQ(tracker->stats().events, 4u);
+}
+
+TEST_F(ForegroundTrackerTest, IgnoresEmptyFocus) {
+  auto tracker = MakeTracker(true);
+  tracker->Start();
+  source_->Focus(0, 0);
+  EXPECT_TRUE(handled_.empty());
+}
+
+TEST_F(ForegroundTrackerTest, ReportsLosingFocus) {
+  auto tracker = MakeTracker(true);
+  int unfocused = 0;
+  tracker->set_unfocus_handler([&] { ++unfocused; });
+  source_->Focus(1, 100, false);
+  tracker->Start();
+  source_->Focus(0, 0);
+  source_->Focus(0, 0);
+  EXPECT_EQ(unfocused, 1);
+
+  source_->Focus(1, 100);
+  EXPECT_EQ(handled_.size(), 2u);
+  EXPECT_EQ(unfocused, 1);
+}
+
+TEST_F(ForegroundTrackerTest, PollIsDebouncedWhileEventsFlow) {
+  auto tracker = MakeTracker(true);
+  tracker->Start();
+  source_->Focus(1, 100);
+  const int queries = source_->queries;
+
+  tracker->Poll(ForegroundTracker::Clock::now());
+  EXPECT_EQ(source_->queries, queries);
+  EXPECT_EQ(tracker->stats().skipped_polls, 1u);
+
+  // A missed event is still picked up once the source has gone quiet.
+  source_->Focus(3, 300, false);
+  tracker->Poll(ForegroundTracker::Clock::now() + seconds(3));
+  ASSERT_EQ(handled_.size(), 2u);
+  EXPECT_EQ(handled_.back().window, 3u);
+}
+
+TEST_F(ForegroundTrackerTest, FallsBackToPollingWithoutEvents) {
+  auto tracker = MakeTracker(false);
+  EXPECT_FALSE(tracker->Start());
+
+  source_->Focus(1, 100);
+  tracker->Poll(ForegroundTracker::Clock::now());
+  tracker->Poll(ForegroundTracker::Clock::now());
+  source_->Focus(2, 200);
+  tracker->Poll(ForegroundTracker::Clock::now());
+
+  ASSERT_EQ(handled_.size(), 2u);
+  EXPECT_EQ(tracker->stats().polls, 3u);
+}
+
+TEST_F(ForegroundTrackerTest, RefreshRedeliversCurrentWindow) {
+  auto tracker = MakeTracker(true);
+  source_->Focus(1, 100, false);
+  tracker->Start();
+  tracker->Refresh();
+
+  ASSERT_EQ(handled_.size(), 2u);
+  EXPECT_EQ(handled_[0], handled_[1]);
+}
+
+TEST_F(ForegroundTrackerTest, TimesEnforcement) {
+  EnforcementStats stats;
+  stats.trace.set_enabled(true);
+  auto tracker = MakeTracker(false, &stats);
+  tracker->Start();
+
+  source_->Focus(1, 100);
+  tracker->Poll(ForegroundTracker::Clock::now());
+  EXPECT_EQ(stats.poll_tick.Load().count, 1u);
+  // Only focus events count towards focus-to-enforcement.
+  EXPECT_EQ(stats.focus_to_enforcement.Load().count, 0u);
+
+  tracker = MakeTracker(true, &stats);
+  tracker->Start();
+  source_->Focus(2, 200);
+  source_->Focus(2, 200);
+  source_->Focus(3, 300);
+  EXPECT_EQ(stats.focus_to_enforcement.Load().count, 2u);
+  EXPECT_NE(stats.trace.ToJson().find("\"name\":\"enforce\""),
+            std::string::npos);
+}
+
+}  // namespace
+}  // namespace routine
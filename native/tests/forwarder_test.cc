@@ -0,0 +1,165 @@
+#include "host/forwarder.h"
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace routine {
+namespace {
+
+std::string Frame(const std::string& body) {
+  const uint32_t size = static_cast<uint32_t>(body.size());
+  std::string frame;
+  for (int i = 0; i < 4; ++i) {
+    frame.push_back(static_cast<char>(size >> (8 * i)));
+  }
+  return frame + body;
+}
+
+std::string ReadToEnd(int fd) {
+  std::string data;
+  char buffer[4096];
+  ssize_t read;
+  while ((read = ::read(fd, buffer, sizeof(buffer))) > 0) {
+    data.append(buffer, static_cast<size_t>(read));
+  }
+  return data;
+}
+
+// Feeds |chunks| through a Forwarder, each with its own write(), and returns
+// what came out the other end.
+class ForwarderTest : public ::testing::Test {
+ protected:
+  std::string Relay(const std::vector<std::string>& chunks,
+                    bool pipes = false) {
+    int in[2];
+    int out[2];
+    if (pipes) {
+      EXPECT_EQ(pipe(in), 0);
+      EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, out), 0);
+    } else {
+      EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, in), 0);
+      EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, out), 0);
+    }
+    // With pipes the input is the read end [0]; socket pairs use [0] too.
+    const Stream from{in[0], !pipes};
+    const Stream to{out[1], true};
+
+    std::thread writer([&] {
+      for (const auto& chunk : chunks) {
+        EXPECT_TRUE(WriteAll(Stream{in[1], !pipes}, chunk.data(),
+                             chunk.size()));
+      }
+      close(in[1]);
+    });
+    std::string output;
+    std::thread reader([&] { output = ReadToEnd(out[0]); });
+
+    Forwarder forwarder(from, to, options_);
+    EXPECT_TRUE(forwarder.Run());
+    stats_ = forwarder.stats();
+    close(out[1]);
+    writer.join();
+    reader.join();
+    close(in[0]);
+    close(out[0]);
+    return output;
+  }
+
+  Forwarder::Options options_;
+  Forwarder::Stats stats_;
+};
+
+TEST_F(ForwarderTest, ReassemblesFramesSplitAnywhere) {
+  const std::string stream = Frame("{\"action\":\"a\"}") + Frame("") +
+                             Frame("{\"action\":\"b\"}");
+  std::vector<std::string> bytes;
+  for (char byte : stream) {
+    bytes.emplace_back(1, byte);
+  }
+  EXPECT_EQ(Relay(bytes), stream);
+  EXPECT_EQ(stats_.messages, 3u);
+}
+
+TEST_F(ForwarderTest, ForwardsManyFramesPerRead) {
+  std::string stream;
+  for (int i = 0; i < 100; ++i) {
+    stream += Frame("message " + std::to_string(i));
+  }
+  EXPECT_EQ(Relay({stream}), stream);
+  EXPECT_EQ(stats_.messages, 100u);
+  EXPECT_LT(stats_.writes, 100u);
+}
+
+TEST_F(ForwarderTest, DropsOversizedFramesWhole) {
+  options_.max_message_size = 8;
+  const std::string stream = Frame("small") + Frame("far too large") +
+                             Frame("tiny");
+  EXPECT_EQ(Relay({stream.substr(0, 11), stream.substr(11)}),
+            Frame("small") + Frame("tiny"));
+  EXPECT_EQ(stats_.messages, 2u);
+  EXPECT_EQ(stats_.dropped, 1u);
+}
+
+TEST_F(ForwarderTest, StreamsFramesLargerThanTheBuffer) {
+  options_.buffer_size = 64;
+  const std::string body(100000, 'x');
+  const std::string stream = Frame(body) + Frame("after");
+  EXPECT_EQ(Relay({stream}), stream);
+  EXPECT_EQ(stats_.messages, 2u);
+  EXPECT_EQ(stats_.bytes, body.size() + 5);
+}
+
+TEST_F(ForwarderTest, SplicesLargeBodiesOutOfPipes) {
+  options_.buffer_size = 64;
+  const std::string body(300000, 'y');
+  const std::string stream = Frame(body) + Frame("after");
+  EXPECT_EQ(Relay({stream}, /*pipes=*/true), stream);
+  EXPECT_EQ(stats_.messages, 2u);
+#ifdef __linux__
+  EXPECT_GT(stats_.spliced_bytes, 0u);
+#endif
+}
+
+TEST_F(ForwarderTest, InterceptsFramesThatAreNotJson) {
+  options_.buffer_size = 64;
+  std::vector<std::string> seen;
+  options_.intercept = [&](std::string_view body) {
+    seen.emplace_back(body);
+    return body.size() > 1 ? "{\"size\":" + std::to_string(body.size()) + "}"
+                           : std::string();
+  };
+  const std::string large(1000, 'z');
+  const std::string stream = Frame("{\"a\":1}") + Frame(large) + Frame("x") +
+                             Frame("") + Frame("{\"b\":2}");
+  std::vector<std::string> bytes;
+  for (size_t i = 0; i < stream.size(); i += 3) {
+    bytes.push_back(stream.substr(i, 3));
+  }
+
+  EXPECT_EQ(Relay(bytes), Frame("{\"a\":1}") + Frame("{\"size\":1000}") +
+                              Frame("") + Frame("{\"b\":2}"));
+  EXPECT_EQ(seen, (std::vector<std::string>{large, "x"}));
+  EXPECT_EQ(stats_.intercepted, 2u);
+  EXPECT_EQ(stats_.messages, 4u);
+}
+
+TEST_F(ForwarderTest, DropsOversizedInterceptedFrames) {
+  options_.max_intercept_size = 4;
+  int calls = 0;
+  options_.intercept = [&](std::string_view body) {
+    ++calls;
+    return std::string(body);
+  };
+  const std::string stream = Frame("too long") + Frame("ok");
+  EXPECT_EQ(Relay({stream}), Frame("ok"));
+  EXPECT_EQ(calls, 1);
+  EXPECT_EQ(stats_.dropped, 1u);
+}
+
+}  // namespace
+}  // namespace routine
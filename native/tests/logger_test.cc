@@ -0,0 +1,197 @@
+#include "core/logger.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace routine {
+namespace {
+
+std::string ReadFile(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+class LoggerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() /
+           ("routine_logger_" +
+            std::string(::testing::UnitTest::GetInstance()
+                            ->current_test_info()
+                            ->name()));
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+    options_.path = (dir_ / "routine.rlog").string();
+  }
+
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  std::vector<LogRecord> Decode(const std::string& path) {
+    std::vector<LogRecord> records;
+    EXPECT_TRUE(DecodeLog(ReadFile(path), &records)) << path;
+    return records;
+  }
+
+  std::filesystem::path dir_;
+  Logger::Options options_;
+};
+
+TEST_F(LoggerTest, WritesRecordsInOrder) {
+  Logger logger(options_);
+  EXPECT_FALSE(logger.Log(Logger::Level::kDebug, "filtered"));
+  EXPECT_TRUE(logger.Log(Logger::Level::kInfo, "first"));
+  EXPECT_TRUE(logger.Log(Logger::Level::kError, "second"));
+  logger.Flush();
+
+  const std::vector<LogRecord> records = Decode(options_.path);
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(records[0].message, "first");
+  EXPECT_EQ(records[0].level, LogLevel::kInfo);
+  EXPECT_EQ(records[1].message, "second");
+  EXPECT_EQ(records[1].level, LogLevel::kError);
+  EXPECT_LE(records[0].time_us, records[1].time_us);
+  EXPECT_EQ(records[0].thread, records[1].thread);
+  EXPECT_EQ(logger.stats().written, 2u);
+  EXPECT_EQ(logger.stats().bytes_written,
+            std::filesystem::file_size(options_.path));
+}
+
+TEST_F(LoggerTest, TruncatesLongMessages) {
+  Logger logger(options_);
+  logger.Log(Logger::Level::kInfo, std::string(1000, 'x'));
+  logger.Flush();
+
+  const std::vector<LogRecord> records = Decode(options_.path);
+  ASSERT_EQ(records.size(), 1u);
+  EXPECT_EQ(records[0].message.size(), Logger::kMaxMessageSize);
+}
+
+TEST_F(LoggerTest, AppendsToAnIntactLogAndReplacesAForeignOne) {
+  {
+    Logger logger(options_);
+    logger.Log(Logger::Level::kInfo, "one");
+  }
+  {
+    Logger logger(options_);
+    logger.Log(Logger::Level::kInfo, "two");
+  }
+  EXPECT_EQ(Decode(options_.path).size(), 2u);
+
+  // A text log from before the binary format.
+  std::ofstream(options_.path) << "plain text\n";
+  {
+    Logger logger(options_);
+    logger.Log(Logger::Level::kInfo, "three");
+  }
+  const std::vector<LogRecord> records = Decode(options_.path);
+  ASSERT_EQ(records.size(), 1u);
+  EXPECT_EQ(records[0].message, "three");
+}
+
+TEST_F(LoggerTest, RotatesIntoCompressedFiles) {
+  const std::string prefix = "Focused application: /usr/bin/app";
+  options_.max_file_size = 4096;
+  options_.max_rotated_files = 2;
+  {
+    Logger logger(options_);
+    for (int i = 0; i < 1000; ++i) {
+      logger.Log(Logger::Level::kInfo, prefix + std::to_string(i));
+      if (i % 100 == 0) {
+        // Leaves room in the queue.
+        logger.Flush();
+      }
+    }
+    EXPECT_GT(logger.stats().rotations, 2u);
+    EXPECT_EQ(logger.stats().dropped, 0u);
+  }
+
+  EXPECT_FALSE(std::filesystem::exists(options_.path + ".3.lz"));
+  std::vector<LogRecord> records;
+  for (const std::string& path :
+       {options_.path + ".2.lz", options_.path + ".1.lz", options_.path}) {
+    const std::vector<LogRecord> part = Decode(path);
+    records.insert(records.end(), part.begin(), part.end());
+  }
+  ASSERT_FALSE(records.empty());
+  EXPECT_EQ(records.back().message, prefix + "999");
+  // The kept files are contiguous.
+  const size_t first = std::stoul(records.front().message.substr(prefix.size()));
+  for (size_t i = 0; i < records.size(); ++i) {
+    EXPECT_EQ(records[i].message, prefix + std::to_string(first + i));
+  }
+  EXPECT_LE(std::filesystem::file_size(options_.path + ".1.lz"), 4096u / 2);
+}
+
+TEST_F(LoggerTest, DropsInsteadOfBlockingWhenFull) {
+  options_.capacity = 4;
+  options_.flush_interval = std::chrono::hours(1);
+  Logger logger(options_);
+  int accepted = 0;
+  for (int i = 0; i < 10; ++i) {
+    accepted += logger.Log(Logger::Level::kInfo, "message") ? 1 : 0;
+  }
+  EXPECT_EQ(accepted, 4);
+  EXPECT_EQ(logger.stats().dropped, 6u);
+
+  logger.Flush();
+  EXPECT_TRUE(logger.Log(Logger::Level::kInfo, "after"));
+}
+
+TEST_F(LoggerTest, KeepsEveryMessageFromConcurrentThreads) {
+  options_.capacity = 1 << 16;
+  constexpr int kThreads = 4;
+  constexpr int kMessages = 5000;
+  {
+    Logger logger(options_);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < kMessages; ++i) {
+          logger.Log(Logger::Level::kInfo,
+                     std::to_string(t) + ":" + std::to_string(i));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(logger.stats().dropped, 0u);
+  }
+
+  std::set<std::string> messages;
+  std::set<uint32_t> threads;
+  for (const auto& record : Decode(options_.path)) {
+    messages.insert(record.message);
+    threads.insert(record.thread);
+  }
+  EXPECT_EQ(messages.size(), size_t{kThreads} * kMessages);
+  EXPECT_EQ(threads.size(), size_t{kThreads});
+}
+
+TEST_F(LoggerTest, DecodesTheGoodPrefixOfATornLog) {
+  {
+    Logger logger(options_);
+    logger.Log(Logger::Level::kInfo, "kept");
+    logger.Log(Logger::Level::kInfo, "torn");
+  }
+  const std::string log = ReadFile(options_.path);
+
+  std::vector<LogRecord> records;
+  size_t valid_size = 0;
+  EXPECT_FALSE(
+      DecodeLog(log.substr(0, log.size() - 2), &records, &valid_size));
+  ASSERT_EQ(records.size(), 1u);
+  EXPECT_EQ(records[0].message, "kept");
+  EXPECT_LT(valid_size, log.size());
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,58 @@
+#include "core/lz.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+
+namespace routine {
+namespace {
+
+std::string RoundTrip(const std::string& input) {
+  std::string output;
+  EXPECT_TRUE(LzDecompress(LzCompress(input), &output));
+  return output;
+}
+
+TEST(LzTest, RoundTripsEdgeCases) {
+  EXPECT_EQ(RoundTrip(""), "");
+  EXPECT_EQ(RoundTrip("a"), "a");
+  EXPECT_EQ(RoundTrip("abcd"), "abcd");
+  // One long run: a match overlapping its own output.
+  EXPECT_EQ(RoundTrip(std::string(100000, 'x')), std::string(100000, 'x'));
+}
+
+TEST(LzTest, CompressesRepetitiveText) {
+  std::string log;
+  for (int i = 0; i < 2000; ++i) {
+    log += "Focused application: C:\\Program Files\\App" +
+           std::to_string(i % 7) + "\\app.exe\n";
+  }
+  const std::string compressed = LzCompress(log);
+  EXPECT_LT(compressed.size(), log.size() / 10);
+  EXPECT_EQ(RoundTrip(log), log);
+}
+
+TEST(LzTest, RoundTripsRandomData) {
+  std::mt19937 random(7);
+  std::string data(70000, '\0');
+  for (auto& byte : data) {
+    // A small alphabet leaves some short matches to find.
+    byte = static_cast<char>('a' + random() % 5);
+  }
+  EXPECT_EQ(RoundTrip(data), data);
+}
+
+TEST(LzTest, RejectsMalformedInput) {
+  const std::string compressed = LzCompress(std::string(1000, 'x') + "tail");
+  std::string output;
+  // Truncated inside the first match.
+  EXPECT_FALSE(LzDecompress(compressed.substr(0, 3), &output));
+
+  // An offset reaching before the start of the output.
+  output.clear();
+  EXPECT_FALSE(LzDecompress(std::string("\x10x\x05\x00", 4), &output));
+}
+
+}  // namespace
+}  // namespace routine
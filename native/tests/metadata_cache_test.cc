@@ -0,0 +1,162 @@
+#include "core/metadata_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace routine {
+namespace {
+
+class MetadataCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() /
+           ("routine_metadata_" +
+            std::string(::testing::UnitTest::GetInstance()
+                            ->current_test_info()
+                            ->name()));
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+    path_ = (dir_ / "exe_metadata.bin").string();
+  }
+
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  std::filesystem::path dir_;
+  std::string path_;
+};
+
+ExeMetadata Metadata(const std::string& name) {
+  ExeMetadata metadata;
+  metadata.display_name = name;
+  metadata.product_name = name + " Suite";
+  metadata.icon = name + ".png";
+  metadata.version = "1.0";
+  return metadata;
+}
+
+TEST_F(MetadataCacheTest, PersistsAcrossInstances) {
+  {
+    MetadataCache cache(path_);
+    cache.Insert("/usr/bin/firefox", FileStamp{100, 5}, Metadata("Firefox"));
+    cache.Insert("/usr/bin/gimp", FileStamp{200, 6}, Metadata("GIMP"));
+  }
+
+  MetadataCache cache(path_);
+  EXPECT_EQ(cache.size(), 2u);
+  const auto firefox = cache.Lookup("/usr/bin/firefox", FileStamp{100, 5});
+  ASSERT_TRUE(firefox);
+  EXPECT_EQ(firefox->display_name, "Firefox");
+  EXPECT_EQ(firefox->product_name, "Firefox Suite");
+  EXPECT_EQ(firefox->icon, "Firefox.png");
+  EXPECT_EQ(firefox->version, "1.0");
+}
+
+TEST_F(MetadataCacheTest, MissesOnChangedBinary) {
+  MetadataCache cache(path_);
+  cache.Insert("/usr/bin/firefox", FileStamp{100, 5}, Metadata("Firefox"));
+
+  EXPECT_FALSE(cache.Lookup("/usr/bin/firefox", FileStamp{100, 6}));
+  EXPECT_FALSE(cache.Lookup("/usr/bin/firefox", FileStamp{101, 5}));
+  EXPECT_FALSE(cache.Lookup("/usr/bin/chrome", FileStamp{100, 5}));
+
+  // The newest version wins, also after reopening.
+  cache.Insert("/usr/bin/firefox", FileStamp{120, 7}, Metadata("Firefox 2"));
+  EXPECT_EQ(cache.Lookup("/usr/bin/firefox", FileStamp{120, 7})->display_name,
+            "Firefox 2");
+  MetadataCache reopened(path_);
+  EXPECT_EQ(
+      reopened.Lookup("/usr/bin/firefox", FileStamp{120, 7})->display_name,
+      "Firefox 2");
+  EXPECT_EQ(reopened.size(), 1u);
+}
+
+TEST_F(MetadataCacheTest, DiscardsTornTail) {
+  {
+    MetadataCache cache(path_);
+    cache.Insert("/a", FileStamp{1, 1}, Metadata("A"));
+    cache.Insert("/b", FileStamp{2, 2}, Metadata("B"));
+  }
+  // Chop the last record in half, as a crash mid-append would.
+  const auto size = std::filesystem::file_size(path_);
+  std::filesystem::resize_file(path_, size - 10);
+
+  {
+    MetadataCache cache(path_);
+    EXPECT_TRUE(cache.Lookup("/a", FileStamp{1, 1}));
+    EXPECT_FALSE(cache.Lookup("/b", FileStamp{2, 2}));
+    cache.Insert("/c", FileStamp{3, 3}, Metadata("C"));
+  }
+
+  MetadataCache cache(path_);
+  EXPECT_TRUE(cache.Lookup("/a", FileStamp{1, 1}));
+  EXPECT_TRUE(cache.Lookup("/c", FileStamp{3, 3}));
+}
+
+TEST_F(MetadataCacheTest, RecoversFromGarbage) {
+  std::ofstream(path_) << "definitely not a cache";
+
+  {
+    MetadataCache cache(path_);
+    EXPECT_EQ(cache.size(), 0u);
+    cache.Insert("/a", FileStamp{1, 1}, Metadata("A"));
+  }
+  EXPECT_TRUE(MetadataCache(path_).Lookup("/a", FileStamp{1, 1}));
+}
+
+TEST_F(MetadataCacheTest, CompactsSupersededRecords) {
+  {
+    MetadataCache cache(path_);
+    for (int64_t i = 0; i < 200; ++i) {
+      cache.Insert("/a", FileStamp{1, i}, Metadata("A"));
+    }
+  }
+  const auto before = std::filesystem::file_size(path_);
+  {
+    MetadataCache cache(path_);
+    EXPECT_TRUE(cache.Lookup("/a", FileStamp{1, 199}));
+  }
+  EXPECT_LT(std::filesystem::file_size(path_), before / 10);
+  EXPECT_TRUE(MetadataCache(path_).Lookup("/a", FileStamp{1, 199}));
+}
+
+TEST_F(MetadataCacheTest, ReadsEachBinaryVersionOnce) {
+  const std::string exe = (dir_ / "app").string();
+  std::ofstream(exe) << "v1";
+
+  int reads = 0;
+  const MetadataCache::Reader read = [&](const std::string&) {
+    ++reads;
+    return Metadata("App");
+  };
+
+  {
+    MetadataCache cache(path_);
+    EXPECT_EQ(cache.Get(exe, read).display_name, "App");
+    EXPECT_EQ(cache.Get(exe, read).display_name, "App");
+    EXPECT_EQ(reads, 1);
+  }
+  {
+    // Cold start: nothing is parsed again.
+    MetadataCache cache(path_);
+    cache.Get(exe, read);
+    EXPECT_EQ(reads, 1);
+    EXPECT_EQ(cache.stats().hits, 1u);
+  }
+
+  std::ofstream(exe) << "version two";
+  MetadataCache cache(path_);
+  cache.Get(exe, read);
+  EXPECT_EQ(reads, 2);
+}
+
+TEST_F(MetadataCacheTest, WorksInMemory) {
+  MetadataCache cache("");
+  cache.Insert("/a", FileStamp{1, 1}, Metadata("A"));
+  EXPECT_TRUE(cache.Lookup("/a", FileStamp{1, 1}));
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,305 @@
+#include "core/policy_aggregator.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace routine {
+namespace {
+
+using Items = std::vector<std::string>;
+
+RoutinePolicy Block(Items apps, Items sites = {}, Items categories = {}) {
+  RoutinePolicy policy;
+  policy.items.apps = std::move(apps);
+  policy.items.sites = std::move(sites);
+  policy.items.categories = std::move(categories);
+  return policy;
+}
+
+RoutinePolicy Allow(Items apps, Items sites = {}, Items categories = {}) {
+  RoutinePolicy policy = Block(std::move(apps), std::move(sites),
+                               std::move(categories));
+  policy.allow = true;
+  return policy;
+}
+
+// DesktopService.evaluate, rebuilt from scratch.
+PolicyItems Evaluate(const std::map<std::string, RoutinePolicy>& routines,
+                     const std::set<std::string>& active, bool* allow_list) {
+  *allow_list = false;
+  for (const auto& [id, policy] : routines) {
+    *allow_list |= active.count(id) > 0 && policy.allow;
+  }
+  std::set<std::string> lists[3];
+  std::set<std::string> excluded[3];
+  for (const auto& [id, policy] : routines) {
+    if (active.count(id) == 0) {
+      continue;
+    }
+    const Items* items[] = {&policy.items.apps, &policy.items.sites,
+                            &policy.items.categories};
+    for (int kind = 0; kind < 3; ++kind) {
+      if (!*allow_list || policy.allow) {
+        lists[kind].insert(items[kind]->begin(), items[kind]->end());
+      } else {
+        excluded[kind].insert(items[kind]->begin(), items[kind]->end());
+      }
+    }
+  }
+  Items result[3];
+  for (int kind = 0; kind < 3; ++kind) {
+    std::set_difference(lists[kind].begin(), lists[kind].end(),
+                        excluded[kind].begin(), excluded[kind].end(),
+                        std::back_inserter(result[kind]));
+  }
+  return PolicyItems{result[0], result[1], result[2]};
+}
+
+// Folds |delta| into |items| the way the app does.
+void Patch(const PolicyDelta& delta, PolicyItems* items) {
+  if (delta.reset) {
+    *items = delta.added;
+    return;
+  }
+  Items* lists[] = {&items->apps, &items->sites, &items->categories};
+  const Items* added[] = {&delta.added.apps, &delta.added.sites,
+                          &delta.added.categories};
+  const Items* removed[] = {&delta.removed.apps, &delta.removed.sites,
+                            &delta.removed.categories};
+  for (int kind = 0; kind < 3; ++kind) {
+    std::set<std::string> list(lists[kind]->begin(), lists[kind]->end());
+    for (const std::string& item : *removed[kind]) {
+      ASSERT_EQ(list.erase(item), 1u) << item;
+    }
+    for (const std::string& item : *added[kind]) {
+      ASSERT_TRUE(list.insert(item).second) << item;
+    }
+    lists[kind]->assign(list.begin(), list.end());
+  }
+}
+
+TEST(PolicyAggregatorTest, StartsEmpty) {
+  PolicyAggregator aggregator;
+  EXPECT_FALSE(aggregator.allow_list());
+  EXPECT_TRUE(aggregator.Effective().empty());
+  EXPECT_TRUE(aggregator.TakeDelta().empty());
+}
+
+TEST(PolicyAggregatorTest, DefinedRoutinesStartOff) {
+  PolicyAggregator aggregator;
+  aggregator.SetRoutine("work", Block({"/usr/bin/steam"}));
+  EXPECT_FALSE(aggregator.IsActive("work"));
+  EXPECT_TRUE(aggregator.TakeDelta().empty());
+}
+
+TEST(PolicyAggregatorTest, BlockRoutinesAddOnlyNewItems) {
+  PolicyAggregator aggregator;
+  aggregator.SetRoutine("work", Block({"/usr/bin/steam"}, {"reddit.com"}));
+  aggregator.SetRoutine("night", Block({"/usr/bin/steam", "/usr/bin/discord"},
+                                       {}, {"/opt/games"}));
+
+  aggregator.SetActive("work", true);
+  PolicyDelta delta = aggregator.TakeDelta();
+  EXPECT_FALSE(delta.reset);
+  EXPECT_FALSE(delta.allow_list);
+  EXPECT_EQ(delta.added.apps, Items({"/usr/bin/steam"}));
+  EXPECT_EQ(delta.added.sites, Items({"reddit.com"}));
+  EXPECT_TRUE(delta.removed.empty());
+
+  aggregator.SetActive("night", true);
+  delta = aggregator.TakeDelta();
+  EXPECT_EQ(delta.added.apps, Items({"/usr/bin/discord"}));
+  EXPECT_TRUE(delta.added.sites.empty());
+  EXPECT_EQ(delta.added.categories, Items({"/opt/games"}));
+  EXPECT_TRUE(delta.removed.empty());
+
+  // Steam stays blocked while night still lists it.
+  aggregator.SetActive("work", false);
+  delta = aggregator.TakeDelta();
+  EXPECT_TRUE(delta.added.empty());
+  EXPECT_TRUE(delta.removed.apps.empty());
+  EXPECT_EQ(delta.removed.sites, Items({"reddit.com"}));
+}
+
+TEST(PolicyAggregatorTest, ChangesUndoneBeforeTakingCancelOut) {
+  PolicyAggregator aggregator;
+  aggregator.SetRoutine("work", Block({"/usr/bin/steam"}));
+  aggregator.SetActive("work", true);
+  aggregator.SetActive("work", false);
+  EXPECT_TRUE(aggregator.TakeDelta().empty());
+}
+
+TEST(PolicyAggregatorTest, FirstAllowRoutineResetsTheLists) {
+  PolicyAggregator aggregator;
+  aggregator.SetRoutine("games", Block({"/usr/bin/steam"}));
+  aggregator.SetRoutine("focus", Allow({"/usr/bin/code", "/usr/bin/steam"},
+                                       {"docs.rs"}));
+  aggregator.SetActive("games", true);
+  aggregator.TakeDelta();
+
+  aggregator.SetActive("focus", true);
+  PolicyDelta delta = aggregator.TakeDelta();
+  EXPECT_TRUE(delta.reset);
+  EXPECT_TRUE(delta.allow_list);
+  // Steam is allowed by focus but blocked by games.
+  EXPECT_EQ(delta.added.apps, Items({"/usr/bin/code"}));
+  EXPECT_EQ(delta.added.sites, Items({"docs.rs"}));
+  EXPECT_TRUE(delta.removed.empty());
+
+  // Within the allow list, a block routine going off lets its items in.
+  aggregator.SetActive("games", false);
+  delta = aggregator.TakeDelta();
+  EXPECT_FALSE(delta.reset);
+  EXPECT_EQ(delta.added.apps, Items({"/usr/bin/steam"}));
+
+  aggregator.SetActive("focus", false);
+  delta = aggregator.TakeDelta();
+  EXPECT_TRUE(delta.reset);
+  EXPECT_FALSE(delta.allow_list);
+  EXPECT_TRUE(delta.added.empty());
+}
+
+TEST(PolicyAggregatorTest, AnEmptyAllowRoutineAllowsNothing) {
+  PolicyAggregator aggregator;
+  aggregator.SetRoutine("lockdown", Allow({}));
+  aggregator.SetActive("lockdown", true);
+  const PolicyDelta delta = aggregator.TakeDelta();
+  EXPECT_TRUE(delta.reset);
+  EXPECT_TRUE(delta.allow_list);
+  EXPECT_TRUE(delta.added.empty());
+}
+
+TEST(PolicyAggregatorTest, ModeFlippingBackWithinABatchIsNoReset) {
+  PolicyAggregator aggregator;
+  aggregator.SetRoutine("focus", Allow({"/usr/bin/code"}));
+  aggregator.SetRoutine("games", Block({"/usr/bin/code"}));
+  aggregator.SetActive("focus", true);
+  aggregator.SetActive("games", true);
+  aggregator.SetActive("focus", false);
+  const PolicyDelta delta = aggregator.TakeDelta();
+  EXPECT_FALSE(delta.reset);
+  EXPECT_EQ(delta.added.apps, Items({"/usr/bin/code"}));
+}
+
+TEST(PolicyAggregatorTest, EditingAnActiveRoutineAppliesTheDifference) {
+  PolicyAggregator aggregator;
+  aggregator.SetRoutine("work", Block({"/usr/bin/steam", "/usr/bin/discord"}));
+  aggregator.SetActive("work", true);
+  aggregator.TakeDelta();
+
+  aggregator.SetRoutine("work", Block({"/usr/bin/discord", "/usr/bin/slack"}));
+  PolicyDelta delta = aggregator.TakeDelta();
+  EXPECT_EQ(delta.added.apps, Items({"/usr/bin/slack"}));
+  EXPECT_EQ(delta.removed.apps, Items({"/usr/bin/steam"}));
+  EXPECT_TRUE(aggregator.IsActive("work"));
+
+  aggregator.RemoveRoutine("work");
+  delta = aggregator.TakeDelta();
+  EXPECT_EQ(delta.removed.apps, Items({"/usr/bin/discord", "/usr/bin/slack"}));
+  EXPECT_EQ(aggregator.routine_count(), 0u);
+}
+
+TEST(PolicyAggregatorTest, DuplicateItemsCountOnce) {
+  PolicyAggregator aggregator;
+  aggregator.SetRoutine("work", Block({"/usr/bin/steam", "/usr/bin/steam"}));
+  aggregator.SetRoutine("night", Block({"/usr/bin/steam"}));
+  aggregator.SetActive("work", true);
+  aggregator.SetActive("night", true);
+  aggregator.TakeDelta();
+
+  aggregator.SetActive("night", false);
+  EXPECT_TRUE(aggregator.TakeDelta().empty());
+  aggregator.SetActive("work", false);
+  EXPECT_EQ(aggregator.TakeDelta().removed.apps, Items({"/usr/bin/steam"}));
+}
+
+TEST(PolicyAggregatorTest, UnknownRoutinesAreIgnored) {
+  PolicyAggregator aggregator;
+  aggregator.SetActive("missing", true);
+  aggregator.RemoveRoutine("missing");
+  EXPECT_FALSE(aggregator.IsActive("missing"));
+  EXPECT_TRUE(aggregator.TakeDelta().empty());
+}
+
+// Random routines switched on and off, edited and recreated at random,
+// checked after every batch against a from-scratch evaluation.
+TEST(PolicyAggregatorTest, DeltasMatchFullEvaluation) {
+  std::mt19937 random(18);
+  std::map<std::string, RoutinePolicy> routines;
+  PolicyAggregator aggregator;
+  for (int i = 0; i < 12; ++i) {
+    RoutinePolicy policy;
+    policy.allow = random() % 4 == 0;
+    Items* lists[] = {&policy.items.apps, &policy.items.sites,
+                      &policy.items.categories};
+    for (Items* list : lists) {
+      for (int j = random() % 6; j > 0; --j) {
+        list->push_back("item" + std::to_string(random() % 10));
+      }
+    }
+    const std::string id = "routine" + std::to_string(i);
+    routines[id] = policy;
+    aggregator.SetRoutine(id, policy);
+  }
+
+  std::set<std::string> active;
+  PolicyItems mirror;
+  for (int batch = 0; batch < 2000; ++batch) {
+    for (int step = random() % 4; step >= 0; --step) {
+      const std::string id = "routine" + std::to_string(random() % 12);
+      if (random() % 16 == 0) {
+        // Deleted and created again, off, with fresh items.
+        aggregator.RemoveRoutine(id);
+        active.erase(id);
+        RoutinePolicy policy = routines[id];
+        policy.items.categories.push_back("new" +
+                                          std::to_string(random() % 10));
+        routines[id] = policy;
+        aggregator.SetRoutine(id, policy);
+        continue;
+      }
+      if (random() % 8 == 0) {
+        RoutinePolicy policy = routines[id];
+        policy.items.apps.push_back("item" + std::to_string(random() % 10));
+        if (!policy.items.sites.empty()) {
+          policy.items.sites.pop_back();
+        }
+        routines[id] = policy;
+        aggregator.SetRoutine(id, policy);
+        continue;
+      }
+      const bool on = active.count(id) == 0;
+      if (on) {
+        active.insert(id);
+      } else {
+        active.erase(id);
+      }
+      aggregator.SetActive(id, on);
+    }
+
+    bool allow_list;
+    const PolicyItems expected = Evaluate(routines, active, &allow_list);
+    const PolicyDelta delta = aggregator.TakeDelta();
+    ASSERT_EQ(delta.allow_list, allow_list) << "batch " << batch;
+    Patch(delta, &mirror);
+    ASSERT_EQ(mirror.apps, expected.apps) << "batch " << batch;
+    ASSERT_EQ(mirror.sites, expected.sites) << "batch " << batch;
+    ASSERT_EQ(mirror.categories, expected.categories) << "batch " << batch;
+
+    const PolicyItems effective = aggregator.Effective();
+    ASSERT_EQ(effective.apps, expected.apps) << "batch " << batch;
+    ASSERT_EQ(effective.sites, expected.sites) << "batch " << batch;
+    ASSERT_EQ(effective.categories, expected.categories) << "batch " << batch;
+  }
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,150 @@
+#include "core/policy_blob.h"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "core/mapped_file.h"
+#include "core/path.h"
+#include "core/rule_set.h"
+
+namespace routine {
+namespace {
+
+PolicyBlob::Source SampleSource() {
+  PolicyBlob::Source source;
+  source.apps = {"/usr/bin/steam", "/opt/discord/Discord"};
+  source.directories = {"/opt/games", "/home/me/.local/share/Steam"};
+  source.exempt = {"/opt/games/launcher"};
+  source.sites = {"example.com", "*.Reddit.com.", "news.ycombinator.com"};
+  return source;
+}
+
+bool Blocked(const PolicyBlob& blob, const std::string& path) {
+  return blob.IsBlocked(path, HashPath(path, blob.ignore_case()));
+}
+
+TEST(PolicyBlobTest, AnswersQueriesInPlace) {
+  const std::string bytes = PolicyBlob::Compile(SampleSource());
+  PolicyBlob blob;
+  ASSERT_TRUE(blob.Open(bytes));
+
+  EXPECT_EQ(blob.bytes().data(), bytes.data());
+  EXPECT_FALSE(blob.allow_list());
+  EXPECT_EQ(blob.app_count(), 2u);
+  EXPECT_EQ(blob.directory_count(), 2u);
+  EXPECT_EQ(blob.exempt_count(), 1u);
+  EXPECT_EQ(blob.site_count(), 3u);
+
+  EXPECT_TRUE(Blocked(blob, "/usr/bin/steam"));
+  EXPECT_TRUE(Blocked(blob, "/usr//bin/steam"));
+  EXPECT_TRUE(Blocked(blob, "/opt/games/x/y"));
+  EXPECT_FALSE(Blocked(blob, "/opt/games/launcher"));
+  EXPECT_FALSE(Blocked(blob, "/opt/gamesx/y"));
+  EXPECT_FALSE(Blocked(blob, "/usr/bin/steam2"));
+}
+
+TEST(PolicyBlobTest, SitesMatchOnLabelBoundaries) {
+  const std::string bytes = PolicyBlob::Compile(SampleSource());
+  PolicyBlob blob;
+  ASSERT_TRUE(blob.Open(bytes));
+
+  EXPECT_TRUE(blob.MatchesSite("example.com"));
+  EXPECT_TRUE(blob.MatchesSite("www.Example.COM"));
+  EXPECT_TRUE(blob.MatchesSite("old.reddit.com"));
+  EXPECT_TRUE(blob.MatchesSite("example.com."));
+  EXPECT_FALSE(blob.MatchesSite("notexample.com"));
+  EXPECT_FALSE(blob.MatchesSite("example.com.evil.net"));
+  EXPECT_FALSE(blob.MatchesSite("ycombinator.com"));
+  EXPECT_FALSE(blob.MatchesSite("com"));
+  EXPECT_FALSE(blob.MatchesSite(""));
+  EXPECT_EQ(blob.Sites(),
+            (std::vector<std::string>{"example.com", "news.ycombinator.com",
+                                      "reddit.com"}));
+}
+
+TEST(PolicyBlobTest, CompilesDeterministically) {
+  PolicyBlob::Source reordered = SampleSource();
+  std::swap(reordered.apps[0], reordered.apps[1]);
+  std::swap(reordered.sites[0], reordered.sites[2]);
+  EXPECT_EQ(PolicyBlob::Compile(SampleSource()),
+            PolicyBlob::Compile(reordered));
+}
+
+TEST(PolicyBlobTest, EmptySourceIsValid) {
+  const std::string bytes = PolicyBlob::Compile(PolicyBlob::Source());
+  PolicyBlob blob;
+  ASSERT_TRUE(blob.Open(bytes));
+  EXPECT_FALSE(Blocked(blob, "/usr/bin/steam"));
+  EXPECT_FALSE(blob.MatchesSite("example.com"));
+}
+
+TEST(PolicyBlobTest, RejectsDamagedBlobs) {
+  const std::string bytes = PolicyBlob::Compile(SampleSource());
+  PolicyBlob blob;
+
+  EXPECT_FALSE(blob.Open(std::string_view(bytes).substr(0, 10)));
+  EXPECT_FALSE(blob.Open(std::string_view(bytes).substr(0, bytes.size() - 1)));
+  EXPECT_FALSE(blob.Open(bytes + std::string(8, '\0')));
+
+  std::string wrong_version = bytes;
+  wrong_version[4] = static_cast<char>(PolicyBlob::kVersion + 1);
+  EXPECT_FALSE(blob.Open(wrong_version));
+
+  // Flipping any byte after the header breaks the checksum.
+  for (size_t i = 88; i < bytes.size(); i += 7) {
+    std::string damaged = bytes;
+    damaged[i] ^= 0x20;
+    EXPECT_FALSE(blob.Open(damaged)) << "byte " << i;
+  }
+  EXPECT_EQ(blob.app_count(), 0u);
+  EXPECT_FALSE(Blocked(blob, "/usr/bin/steam"));
+}
+
+TEST(PolicyBlobTest, RuleSetRoundTripsThroughAMappedFile) {
+  auto rules = RuleSet::Builder(RuleSet::Options{true, true})
+                   .AddApp("C:\\Windows\\explorer.exe")
+                   .AddDirectory("C:\\Program Files\\Office")
+                   .AddSite("docs.example.com")
+                   .Build();
+  ASSERT_NE(rules, nullptr);
+
+  char path[] = "/tmp/routine_policy_blob_XXXXXX";
+  const int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  const std::string_view bytes = rules->blob().bytes();
+  ASSERT_EQ(write(fd, bytes.data(), bytes.size()),
+            static_cast<ssize_t>(bytes.size()));
+  close(fd);
+
+  MappedFile file;
+  ASSERT_TRUE(file.Open(path));
+  std::remove(path);
+  PolicyBlob mapped;
+  ASSERT_TRUE(mapped.Open(std::string_view(
+      reinterpret_cast<const char*>(file.data()), file.size())));
+  EXPECT_TRUE(mapped.allow_list());
+  EXPECT_TRUE(mapped.ignore_case());
+  EXPECT_FALSE(Blocked(mapped, "c:/windows/EXPLORER.EXE"));
+  EXPECT_FALSE(Blocked(mapped, "C:\\Program Files\\office\\word.exe"));
+  EXPECT_TRUE(Blocked(mapped, "C:\\Games\\game.exe"));
+  EXPECT_TRUE(mapped.MatchesSite("docs.example.com"));
+
+  auto reloaded = RuleSet::FromBlob(
+      std::string(reinterpret_cast<const char*>(file.data()), file.size()));
+  ASSERT_NE(reloaded, nullptr);
+  EXPECT_TRUE(reloaded->options().allow_list);
+  EXPECT_TRUE(reloaded->options().ignore_case);
+  EXPECT_FALSE(reloaded->IsBlocked("C:/Windows/explorer.exe"));
+  EXPECT_TRUE(reloaded->IsBlocked("C:/Windows/notepad.exe"));
+  EXPECT_EQ(reloaded->site_count(), 1u);
+
+  EXPECT_EQ(RuleSet::FromBlob("not a blob"), nullptr);
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,161 @@
+#include "core/policy_store.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/rcu_cell.h"
+
+namespace routine {
+namespace {
+
+std::unique_ptr<const RuleSet> MakeRules(int generation, int app_count) {
+  RuleSet::Builder builder{RuleSet::Options()};
+  builder.AddApp("/always/blocked");
+  for (int i = 0; i < app_count; ++i) {
+    builder.AddApp("/gen" + std::to_string(generation) + "/app" +
+                   std::to_string(i));
+  }
+  return builder.Build();
+}
+
+struct Tracked {
+  explicit Tracked(std::atomic<int>* live) : live(live) { ++*live; }
+  ~Tracked() {
+    --*live;
+    magic = 0;
+  }
+
+  std::atomic<int>* live;
+  uint32_t magic = 0x600dcafe;
+};
+
+TEST(RcuCellTest, FreesReplacedValues) {
+  std::atomic<int> live{0};
+  {
+    RcuCell<Tracked> cell(std::make_unique<const Tracked>(&live));
+    for (int i = 0; i < 10; ++i) {
+      cell.Publish(std::make_unique<const Tracked>(&live));
+      EXPECT_EQ(live.load(), 1);
+    }
+  }
+  EXPECT_EQ(live.load(), 0);
+}
+
+TEST(RcuCellTest, ReadersNeverSeeFreedValues) {
+  std::atomic<int> live{0};
+  RcuCell<Tracked> cell(std::make_unique<const Tracked>(&live));
+  std::atomic<bool> stop{false};
+  std::atomic<int> bad{0};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      while (!stop.load(std::memory_order_relaxed)) {
+        auto value = cell.Read();
+        if (value->magic != 0x600dcafe) {
+          ++bad;
+        }
+      }
+    });
+  }
+
+  for (int i = 0; i < 2000; ++i) {
+    cell.Publish(std::make_unique<const Tracked>(&live));
+  }
+  stop = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(bad.load(), 0);
+  EXPECT_EQ(live.load(), 1);
+}
+
+TEST(PolicyStoreTest, StartsEmpty) {
+  PolicyStore store;
+  EXPECT_EQ(store.generation(), 0u);
+  EXPECT_FALSE(store.IsBlocked("/usr/bin/steam"));
+
+  store.Set(MakeRules(0, 1));
+  EXPECT_EQ(store.generation(), 1u);
+  EXPECT_TRUE(store.IsBlocked("/gen0/app0"));
+}
+
+// Hammers IsBlocked() from several threads while Set() publishes new
+// policies in a loop, and reports reader latency percentiles.
+TEST(PolicyStoreTest, StressConcurrentSetAndIsBlocked) {
+  PolicyStore store;
+  store.Set(MakeRules(0, 1000));
+
+  // hardware_concurrency() is 0 when unknown.
+  const unsigned reader_count =
+      std::max(3u, std::thread::hardware_concurrency()) - 1;
+  std::atomic<bool> stop{false};
+  std::atomic<int> wrong{0};
+  std::vector<std::vector<uint32_t>> latencies(reader_count);
+
+  std::vector<std::thread> readers;
+  for (unsigned r = 0; r < reader_count; ++r) {
+    readers.emplace_back([&, r] {
+      auto& samples = latencies[r];
+      samples.reserve(1 << 20);
+      uint64_t i = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        const std::string path =
+            (i++ % 2) ? "/always/blocked" : "/usr/bin/not-listed";
+        const auto start = std::chrono::steady_clock::now();
+        const bool blocked = store.IsBlocked(path);
+        const auto end = std::chrono::steady_clock::now();
+        if (blocked != (path == "/always/blocked")) {
+          ++wrong;
+        }
+        if (samples.size() < samples.capacity()) {
+          samples.push_back(static_cast<uint32_t>(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                  .count()));
+        }
+      }
+    });
+  }
+
+  int sets = 0;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+  while (std::chrono::steady_clock::now() < deadline) {
+    store.Set(MakeRules(++sets, 1000));
+  }
+  stop = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  std::vector<uint32_t> all;
+  for (const auto& samples : latencies) {
+    all.insert(all.end(), samples.begin(), samples.end());
+  }
+  ASSERT_FALSE(all.empty());
+  std::sort(all.begin(), all.end());
+  const auto percentile = [&](double p) {
+    return all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))];
+  };
+
+  std::cout << "[ stress   ] readers=" << reader_count << " sets=" << sets
+            << " lookups=" << all.size() << " p50=" << percentile(0.50)
+            << "ns p99=" << percentile(0.99)
+            << "ns max=" << all.back() << "ns" << std::endl;
+  RecordProperty("p99_ns", static_cast<int>(percentile(0.99)));
+
+  EXPECT_EQ(wrong.load(), 0);
+  EXPECT_EQ(store.generation(), static_cast<uint64_t>(sets) + 1);
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,120 @@
+#include "host/policy_sync.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace routine {
+namespace {
+
+using Sites = std::vector<std::string>;
+
+std::string Snapshot(const Sites& sites, bool allow_list = false,
+                     bool resync = false) {
+  SitePolicy policy;
+  policy.allow_list = allow_list;
+  policy.sites = sites;
+  return SerializeSnapshot(policy, resync);
+}
+
+TEST(PolicySyncTest, SnapshotsRoundTripSortedAndUnique) {
+  SitePolicy policy;
+  policy.allow_list = true;
+  policy.sites = {"youtube.com", "example.org", "youtube.com", "b\xc3\xbc.de"};
+
+  SitePolicy parsed;
+  bool resync = false;
+  ASSERT_TRUE(ParseSnapshot(SerializeSnapshot(policy, true), &parsed,
+                            &resync));
+  EXPECT_TRUE(resync);
+  EXPECT_TRUE(parsed.allow_list);
+  EXPECT_EQ(parsed.sites, (Sites{"b\xc3\xbc.de", "example.org",
+                                 "youtube.com"}));
+}
+
+TEST(PolicySyncTest, RejectsMalformedSnapshots) {
+  const std::string good = Snapshot({"a.com", "b.com"});
+  SitePolicy policy;
+  bool resync;
+  EXPECT_TRUE(ParseSnapshot(good, &policy, &resync));
+  EXPECT_FALSE(ParseSnapshot("{\"action\":\"x\"}", &policy, &resync));
+  EXPECT_FALSE(ParseSnapshot(good.substr(0, good.size() - 1), &policy,
+                             &resync));
+  EXPECT_FALSE(ParseSnapshot(good + "x", &policy, &resync));
+  // A count far larger than the data.
+  EXPECT_FALSE(ParseSnapshot(std::string("RPS1\0\xff\xff\xff\x7f", 9),
+                             &policy, &resync));
+}
+
+TEST(PolicySyncTest, DiffsSortedLists) {
+  const SiteDelta delta = DiffSites({"a.com", "b.com", "c.com"},
+                                    {"b.com", "c.com", "d.com", "e.com"});
+  EXPECT_EQ(delta.added, (Sites{"d.com", "e.com"}));
+  EXPECT_EQ(delta.removed, (Sites{"a.com"}));
+  EXPECT_TRUE(DiffSites({"a.com"}, {"a.com"}).empty());
+}
+
+TEST(PolicySyncTest, SendsFullThenDeltas) {
+  PolicySync sync;
+  std::string message;
+
+  ASSERT_TRUE(sync.Update(Snapshot({"b.com", "a.com"}), &message));
+  EXPECT_EQ(message,
+            "{\"action\":\"updateBlockedSites\",\"data\":{\"generation\":1,"
+            "\"allowList\":false,\"sites\":[\"a.com\",\"b.com\"]}}");
+
+  ASSERT_TRUE(sync.Update(Snapshot({"b.com", "c.com"}), &message));
+  EXPECT_EQ(message,
+            "{\"action\":\"patchBlockedSites\",\"data\":{\"base\":1,"
+            "\"generation\":2,\"add\":[\"c.com\"],\"remove\":[\"a.com\"]}}");
+  EXPECT_EQ(sync.generation(), 2u);
+}
+
+TEST(PolicySyncTest, SendsNothingWhenUnchanged) {
+  PolicySync sync;
+  std::string message;
+  ASSERT_TRUE(sync.Update(Snapshot({"a.com"}), &message));
+  ASSERT_TRUE(sync.Update(Snapshot({"a.com", "a.com"}), &message));
+  EXPECT_TRUE(message.empty());
+  EXPECT_EQ(sync.generation(), 1u);
+}
+
+TEST(PolicySyncTest, ResendsInFullOnResyncOrModeChange) {
+  PolicySync sync;
+  std::string message;
+  ASSERT_TRUE(sync.Update(Snapshot({"a.com"}), &message));
+
+  ASSERT_TRUE(sync.Update(Snapshot({"a.com"}, false, /*resync=*/true),
+                          &message));
+  EXPECT_EQ(message.find("{\"action\":\"updateBlockedSites\""), 0u);
+  EXPECT_NE(message.find("\"generation\":2"), std::string::npos);
+
+  ASSERT_TRUE(sync.Update(Snapshot({"a.com"}, /*allow_list=*/true),
+                          &message));
+  EXPECT_NE(message.find("\"generation\":3,\"allowList\":true"),
+            std::string::npos);
+}
+
+TEST(PolicySyncTest, SendsSitesAsBrowsersSeeHosts) {
+  PolicySync sync;
+  std::string message;
+  // Entries that are not host names are dropped.
+  ASSERT_TRUE(sync.Update(Snapshot({"*.Example.COM.", "B\xc3\xbc" "cher.de",
+                                    "a\"b\\c\n", "example.com"}),
+                          &message));
+  EXPECT_EQ(message,
+            "{\"action\":\"updateBlockedSites\",\"data\":{\"generation\":1,"
+            "\"allowList\":false,\"sites\":[\"example.com\","
+            "\"xn--bcher-kva.de\"]}}");
+}
+
+TEST(PolicySyncTest, IgnoresMalformedSnapshots) {
+  PolicySync sync;
+  std::string message = "unchanged";
+  EXPECT_FALSE(sync.Update("RPS", &message));
+  EXPECT_EQ(sync.generation(), 0u);
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,145 @@
+#include "linux/proc_connector.h"
+
+#include <gtest/gtest.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+
+namespace routine {
+namespace {
+
+// Builds one datagram the way the kernel lays it out.
+std::vector<uint8_t> Datagram(const proc_event& event) {
+  std::vector<uint8_t> bytes(NLMSG_HDRLEN + sizeof(cn_msg) + sizeof(event));
+  nlmsghdr header;
+  std::memset(&header, 0, sizeof(header));
+  header.nlmsg_len = static_cast<uint32_t>(bytes.size());
+  header.nlmsg_type = NLMSG_DONE;
+  cn_msg message;
+  std::memset(&message, 0, sizeof(message));
+  message.id.idx = CN_IDX_PROC;
+  message.id.val = CN_VAL_PROC;
+  message.len = sizeof(event);
+
+  std::memcpy(bytes.data(), &header, sizeof(header));
+  std::memcpy(bytes.data() + NLMSG_HDRLEN, &message, sizeof(message));
+  std::memcpy(bytes.data() + NLMSG_HDRLEN + sizeof(message), &event,
+              sizeof(event));
+  return bytes;
+}
+
+proc_event MakeEvent(uint32_t what) {
+  proc_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.what = static_cast<decltype(event.what)>(what);
+  event.timestamp_ns = 42;
+  return event;
+}
+
+TEST(ProcConnectorTest, ParsesProcessEvents) {
+  proc_event fork_event = MakeEvent(proc_event::PROC_EVENT_FORK);
+  fork_event.event_data.fork.parent_tgid = 10;
+  fork_event.event_data.fork.child_pid = 11;
+  fork_event.event_data.fork.child_tgid = 11;
+  proc_event exec_event = MakeEvent(proc_event::PROC_EVENT_EXEC);
+  exec_event.event_data.exec.process_tgid = 11;
+  proc_event exit_event = MakeEvent(proc_event::PROC_EVENT_EXIT);
+  exit_event.event_data.exit.process_pid = 11;
+  exit_event.event_data.exit.process_tgid = 11;
+
+  std::vector<ProcEvent> events;
+  const uint32_t all =
+      ProcConnector::kFork | ProcConnector::kExec | ProcConnector::kExit;
+  for (const proc_event& event : {fork_event, exec_event, exit_event}) {
+    const auto bytes = Datagram(event);
+    ProcConnector::Parse(bytes.data(), bytes.size(), all, &events);
+  }
+
+  ASSERT_EQ(events.size(), 3u);
+  EXPECT_EQ(events[0].type, ProcEvent::Type::kFork);
+  EXPECT_EQ(events[0].pid, 11);
+  EXPECT_EQ(events[0].parent_pid, 10);
+  EXPECT_EQ(events[1].type, ProcEvent::Type::kExec);
+  EXPECT_EQ(events[1].pid, 11);
+  EXPECT_EQ(events[1].timestamp_ns, 42u);
+  EXPECT_EQ(events[2].type, ProcEvent::Type::kExit);
+  EXPECT_EQ(events[2].pid, 11);
+}
+
+TEST(ProcConnectorTest, SkipsThreadsAndUnwantedTypes) {
+  proc_event thread_event = MakeEvent(proc_event::PROC_EVENT_FORK);
+  thread_event.event_data.fork.child_pid = 12;
+  thread_event.event_data.fork.child_tgid = 11;
+  proc_event thread_exit_event = MakeEvent(proc_event::PROC_EVENT_EXIT);
+  thread_exit_event.event_data.exit.process_pid = 12;
+  thread_exit_event.event_data.exit.process_tgid = 11;
+  proc_event exec_event = MakeEvent(proc_event::PROC_EVENT_EXEC);
+  exec_event.event_data.exec.process_tgid = 11;
+  proc_event comm_event = MakeEvent(proc_event::PROC_EVENT_COMM);
+
+  std::vector<ProcEvent> events;
+  const uint32_t all =
+      ProcConnector::kFork | ProcConnector::kExec | ProcConnector::kExit;
+  for (const proc_event& event :
+       {thread_event, thread_exit_event, comm_event}) {
+    const auto bytes = Datagram(event);
+    ProcConnector::Parse(bytes.data(), bytes.size(), all, &events);
+  }
+  EXPECT_TRUE(events.empty());
+
+  const auto bytes = Datagram(exec_event);
+  ProcConnector::Parse(bytes.data(), bytes.size(), ProcConnector::kFork,
+                       &events);
+  EXPECT_TRUE(events.empty());
+}
+
+TEST(ProcConnectorTest, RejectsTruncatedMessages) {
+  auto bytes = Datagram(MakeEvent(proc_event::PROC_EVENT_EXEC));
+  std::vector<ProcEvent> events;
+  ProcConnector::Parse(bytes.data(), bytes.size() / 2, ProcConnector::kExec,
+                       &events);
+  ProcConnector::Parse(bytes.data(), NLMSG_HDRLEN - 1, ProcConnector::kExec,
+                       &events);
+  EXPECT_TRUE(events.empty());
+}
+
+TEST(ProcConnectorTest, ReportsExecOfChild) {
+  ProcConnector connector;
+  if (!connector.Open(ProcConnector::kExec)) {
+    GTEST_SKIP() << "proc connector needs CAP_NET_ADMIN";
+  }
+
+  const pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    execl("/bin/true", "true", static_cast<char*>(nullptr));
+    _exit(127);
+  }
+
+  bool seen = false;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!seen && std::chrono::steady_clock::now() < deadline) {
+    pollfd fd{connector.fd(), POLLIN, 0};
+    poll(&fd, 1, 100);
+    std::vector<ProcEvent> events;
+    bool overrun = false;
+    connector.ReadBatch(&events, &overrun);
+    for (const ProcEvent& event : events) {
+      // The filter lets nothing else through.
+      EXPECT_EQ(event.type, ProcEvent::Type::kExec);
+      seen |= event.pid == child;
+    }
+  }
+  waitpid(child, nullptr, 0);
+  EXPECT_TRUE(seen);
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,61 @@
+#include "linux/proc_fs.h"
+
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace routine {
+namespace {
+
+TEST(ProcFsTest, ReadsOwnProcess) {
+  ProcFs proc;
+  const auto pids = proc.ListPids();
+  EXPECT_NE(std::find(pids.begin(), pids.end(), getpid()), pids.end());
+
+  const auto self = proc.Read(getpid());
+  ASSERT_TRUE(self.has_value());
+  EXPECT_EQ(self->pid, getpid());
+  EXPECT_EQ(self->ppid, getppid());
+  EXPECT_EQ(self->uid, getuid());
+  EXPECT_GT(self->start_time, 0u);
+  EXPECT_EQ(self->name, "routine_tests");
+
+  char exe[4096];
+  const ssize_t size = readlink("/proc/self/exe", exe, sizeof(exe));
+  ASSERT_GT(size, 0);
+  EXPECT_EQ(self->exe, std::string(exe, size));
+}
+
+TEST(ProcFsTest, ParsesAwkwardCommandNames) {
+  char root_template[] = "/tmp/routine_procfs_XXXXXX";
+  ASSERT_NE(mkdtemp(root_template), nullptr);
+  const std::string root = root_template;
+  ASSERT_EQ(mkdir((root + "/42").c_str(), 0755), 0);
+  ASSERT_EQ(mkdir((root + "/self").c_str(), 0755), 0);
+  {
+    std::ofstream stat(root + "/42/stat");
+    stat << "42 (a) b (c) S 7 42 42 0 -1 4194560 100 0 0 0 1 2 0 0 20 0 1 0 "
+            "987654 1000 10 0\n";
+  }
+
+  ProcFs proc(root);
+  EXPECT_EQ(proc.ListPids(), std::vector<int64_t>{42});
+
+  ProcessInfo info;
+  ASSERT_TRUE(proc.ReadStat(42, &info));
+  EXPECT_EQ(info.name, "a) b (c");
+  EXPECT_EQ(info.ppid, 7);
+  EXPECT_EQ(info.start_time, 987654u);
+  EXPECT_EQ(proc.ReadExe(42), "");
+  EXPECT_FALSE(proc.Read(43).has_value());
+
+  std::filesystem::remove_all(root);
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,98 @@
+#include "core/process_table.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace routine {
+namespace {
+
+class ProcessTableTest : public ::testing::Test {
+ protected:
+  ProcessTable::Diff Update(const std::vector<ProcessKey>& current) {
+    return table_.Update(current, [this](const ProcessKey& key) {
+      described_.push_back(key.pid);
+      std::optional<RunningApp> app;
+      // Odd pids are background processes.
+      if (key.pid % 2 == 0) {
+        app = RunningApp{"app" + std::to_string(key.pid % 10), "App",
+                         "/opt/app" + std::to_string(key.pid % 10)};
+      }
+      return app;
+    });
+  }
+
+  ProcessTable table_;
+  std::vector<int64_t> described_;
+};
+
+TEST_F(ProcessTableTest, DescribesOnlyNewcomers) {
+  ProcessTable::Diff diff = Update({{2, 100}, {3, 100}, {4, 100}});
+  EXPECT_EQ(diff.added, 3u);
+  EXPECT_EQ(diff.removed, 0u);
+  EXPECT_EQ(described_, (std::vector<int64_t>{2, 3, 4}));
+
+  described_.clear();
+  diff = Update({{2, 100}, {3, 100}, {4, 100}, {6, 100}});
+  EXPECT_EQ(diff.added, 1u);
+  EXPECT_EQ(diff.retained, 3u);
+  EXPECT_EQ(described_, std::vector<int64_t>{6});
+}
+
+TEST_F(ProcessTableTest, DropsExitedAndReusedPids) {
+  Update({{2, 100}, {4, 100}});
+
+  described_.clear();
+  // 2 exited; 4 exited and its pid went to a new process.
+  const ProcessTable::Diff diff = Update({{4, 200}});
+  EXPECT_EQ(diff.added, 1u);
+  EXPECT_EQ(diff.removed, 2u);
+  EXPECT_EQ(diff.retained, 0u);
+  EXPECT_EQ(described_, std::vector<int64_t>{4});
+  EXPECT_EQ(table_.size(), 1u);
+}
+
+TEST_F(ProcessTableTest, ListsAppsOncePerPath) {
+  // 2 and 12 share a path; 3 is not an app.
+  Update({{12, 1}, {3, 1}, {2, 1}, {4, 1}});
+
+  const std::vector<RunningApp> apps = table_.Apps();
+  ASSERT_EQ(apps.size(), 2u);
+  EXPECT_EQ(apps[0].path, "/opt/app2");
+  EXPECT_EQ(apps[1].path, "/opt/app4");
+}
+
+TEST_F(ProcessTableTest, ResumesAfterCancellation) {
+  Update({{2, 1}});
+
+  CancellationToken cancel;
+  described_.clear();
+  const ProcessTable::Diff diff =
+      table_.Update({{2, 1}, {4, 1}, {6, 1}},
+                    [&](const ProcessKey& key) -> std::optional<RunningApp> {
+                      described_.push_back(key.pid);
+                      cancel.Cancel();
+                      return RunningApp{"app", "App", "/opt/app"};
+                    },
+                    &cancel);
+  EXPECT_TRUE(diff.cancelled);
+  EXPECT_EQ(diff.added, 1u);
+  EXPECT_EQ(described_, std::vector<int64_t>{4});
+
+  // Nothing was dropped and only the remaining newcomer is described.
+  described_.clear();
+  Update({{2, 1}, {4, 1}, {6, 1}});
+  EXPECT_EQ(described_, std::vector<int64_t>{6});
+  EXPECT_EQ(table_.size(), 3u);
+}
+
+TEST_F(ProcessTableTest, IgnoresDuplicateKeys) {
+  const ProcessTable::Diff diff = Update({{2, 1}, {2, 1}});
+  EXPECT_EQ(diff.added, 1u);
+  EXPECT_EQ(diff.retained, 0u);
+  EXPECT_EQ(described_.size(), 1u);
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,134 @@
+#include "core/process_tree.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace routine {
+namespace {
+
+// Every executable in |pid|'s lineage, nearest first.
+std::vector<std::string> Lineage(const ProcessTree& tree, int64_t pid) {
+  std::vector<std::string> lineage;
+  tree.FindInLineage(pid, [&](const std::string& exe) {
+    lineage.push_back(exe);
+    return false;
+  });
+  return lineage;
+}
+
+TEST(ProcessTreeTest, ForksInheritUntilTheyExec) {
+  ProcessTree tree;
+  tree.Exec(10, "/usr/bin/launcher");
+  tree.Fork(11, 10);
+  EXPECT_EQ(Lineage(tree, 11),
+            (std::vector<std::string>{"/usr/bin/launcher",
+                                      "/usr/bin/launcher"}));
+
+  tree.Exec(11, "/opt/game/game");
+  tree.Fork(12, 11);
+  tree.Exec(12, "/opt/game/crash_reporter");
+  EXPECT_EQ(Lineage(tree, 12),
+            (std::vector<std::string>{"/opt/game/crash_reporter",
+                                      "/opt/game/game", "/usr/bin/launcher"}));
+  const auto is_game = [](const std::string& exe) {
+    return exe == "/opt/game/game";
+  };
+  EXPECT_EQ(tree.FindInLineage(12, is_game), "/opt/game/game");
+  EXPECT_EQ(tree.FindInLineage(12, [](const std::string&) { return false; }),
+            "");
+  EXPECT_EQ(tree.FindInLineage(99, [](const std::string&) { return true; }),
+            "");
+  EXPECT_EQ(tree.size(), 3u);
+}
+
+TEST(ProcessTreeTest, KeepsExitedAncestorsWhileTheyHaveDescendants) {
+  ProcessTree tree;
+  tree.Exec(10, "/usr/bin/launcher");
+  tree.Fork(11, 10);
+  tree.Exec(11, "/opt/game/game");
+
+  // The launcher exits once the game is up; the game is still its own.
+  tree.Exit(10);
+  EXPECT_EQ(Lineage(tree, 10), std::vector<std::string>());
+  EXPECT_EQ(Lineage(tree, 11),
+            (std::vector<std::string>{"/opt/game/game", "/usr/bin/launcher"}));
+  EXPECT_EQ(tree.size(), 2u);
+  EXPECT_EQ(tree.exited(), 1u);
+
+  // The last descendant going takes the launcher with it.
+  tree.Exit(11);
+  EXPECT_EQ(tree.size(), 0u);
+  EXPECT_EQ(tree.exited(), 0u);
+}
+
+TEST(ProcessTreeTest, ReusedPidsInheritNothing) {
+  ProcessTree tree;
+  tree.Exec(10, "/usr/bin/launcher");
+  tree.Fork(11, 10);
+  tree.Exec(11, "/opt/game/game");
+  tree.Exit(10);
+
+  // Pid 10 now names an unrelated process.
+  tree.Exec(10, "/usr/bin/editor");
+  EXPECT_EQ(Lineage(tree, 10), std::vector<std::string>{"/usr/bin/editor"});
+  EXPECT_EQ(Lineage(tree, 11),
+            (std::vector<std::string>{"/opt/game/game", "/usr/bin/launcher"}));
+
+  // A fork onto a pid still in the tree means its exit went unseen.
+  tree.Fork(11, 10);
+  EXPECT_EQ(Lineage(tree, 11),
+            (std::vector<std::string>{"/usr/bin/editor", "/usr/bin/editor"}));
+  EXPECT_EQ(tree.size(), 2u);
+  EXPECT_EQ(tree.exited(), 0u);
+}
+
+TEST(ProcessTreeTest, ResetsFromAScanInAnyOrder) {
+  ProcessTree tree;
+  tree.Exec(50, "/usr/bin/stale");
+  tree.Reset({{12, 11, "/opt/game/game"},
+              {11, 1, "/usr/bin/launcher"},
+              {1, 0, "/sbin/init"},
+              {2, 0, ""},
+              {13, 12, ""}});
+
+  EXPECT_EQ(tree.size(), 5u);
+  EXPECT_EQ(Lineage(tree, 50), std::vector<std::string>());
+  // Processes we could not read are skipped, not the end of the lineage.
+  EXPECT_EQ(Lineage(tree, 13),
+            (std::vector<std::string>{"/opt/game/game", "/usr/bin/launcher",
+                                      "/sbin/init"}));
+  EXPECT_EQ(Lineage(tree, 2), std::vector<std::string>());
+}
+
+TEST(ProcessTreeTest, CutsCyclesFromATornScan) {
+  ProcessTree tree;
+  // Both pids were reused mid-scan and now claim each other as parent.
+  tree.Reset({{20, 21, "/usr/bin/a"}, {21, 20, "/usr/bin/b"}});
+  size_t visited = 0;
+  EXPECT_EQ(tree.FindInLineage(20,
+                               [&](const std::string&) {
+                                 ++visited;
+                                 return false;
+                               }),
+            "");
+  EXPECT_EQ(visited, ProcessTree::kMaxDepth);
+}
+
+TEST(ProcessTreeTest, ForgetsShortLivedProcesses) {
+  ProcessTree tree;
+  tree.Exec(1, "/sbin/init");
+  for (int64_t pid = 2; pid < 1000; ++pid) {
+    tree.Fork(pid, 1);
+    tree.Exec(pid, "/bin/true");
+    tree.Exit(pid);
+  }
+  EXPECT_EQ(tree.size(), 1u);
+  tree.Fork(2, 1);
+  EXPECT_EQ(Lineage(tree, 2),
+            (std::vector<std::string>{"/sbin/init", "/sbin/init"}));
+}
+
+}  // namespace
+}  // namespace routine
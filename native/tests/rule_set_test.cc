@@ -0,0 +1,137 @@
+#include "core/rule_set.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace routine {
+namespace {
+
+RuleSet::Options BlockList(bool ignore_case = false) {
+  RuleSet::Options options;
+  options.ignore_case = ignore_case;
+  return options;
+}
+
+TEST(RuleSetTest, MatchesExactApps) {
+  auto rules = RuleSet::Builder(BlockList())
+                   .AddApp("/usr/bin/steam")
+                   .AddApp("/opt/discord/Discord")
+                   .Build();
+
+  EXPECT_TRUE(rules->IsBlocked("/usr/bin/steam"));
+  EXPECT_TRUE(rules->IsBlocked("/opt/discord/Discord"));
+  EXPECT_FALSE(rules->IsBlocked("/usr/bin/steam2"));
+  EXPECT_FALSE(rules->IsBlocked("/usr/bin"));
+  EXPECT_EQ(rules->app_count(), 2u);
+}
+
+TEST(RuleSetTest, NormalizesSeparators) {
+  auto rules = RuleSet::Builder(BlockList())
+                   .AddApp("C:\\Games\\game.exe")
+                   .AddDirectory("C:\\Tools\\")
+                   .Build();
+
+  EXPECT_TRUE(rules->IsBlocked("C:/Games/game.exe"));
+  EXPECT_TRUE(rules->IsBlocked("C:\\\\Games\\game.exe"));
+  EXPECT_TRUE(rules->IsBlocked("C:/Tools/x/y.exe"));
+}
+
+TEST(RuleSetTest, DirectoriesMatchWholeComponents) {
+  auto rules = RuleSet::Builder(BlockList())
+                   .AddDirectory("C:\\Program Files\\Steam")
+                   .Build();
+
+  EXPECT_TRUE(rules->IsBlocked("C:\\Program Files\\Steam\\steam.exe"));
+  EXPECT_TRUE(rules->IsBlocked("C:\\Program Files\\Steam\\bin\\x.exe"));
+  // The old substring scan matched both of these.
+  EXPECT_FALSE(rules->IsBlocked("C:\\Program Files\\SteamVR\\vr.exe"));
+  EXPECT_FALSE(rules->IsBlocked("D:\\Backup\\C:\\Program Files\\Steam\\a.exe"));
+  EXPECT_EQ(rules->directory_count(), 1u);
+}
+
+TEST(RuleSetTest, NestedDirectoriesCountOnce) {
+  auto rules = RuleSet::Builder(BlockList())
+                   .AddDirectory("/opt/games")
+                   .AddDirectory("/opt/games/")
+                   .AddDirectory("/opt/games/steam")
+                   .AddDirectory("")
+                   .Build();
+
+  EXPECT_EQ(rules->directory_count(), 2u);
+  EXPECT_TRUE(rules->IsBlocked("/opt/games/steam/steam"));
+  EXPECT_TRUE(rules->IsBlocked("/opt/games/other"));
+  EXPECT_FALSE(rules->IsBlocked("/opt/other"));
+}
+
+TEST(RuleSetTest, IgnoreCaseFoldsAscii) {
+  auto rules = RuleSet::Builder(BlockList(true))
+                   .AddApp("C:\\Games\\Game.exe")
+                   .AddDirectory("C:\\Program Files\\Epic Games")
+                   .Build();
+
+  EXPECT_TRUE(rules->IsBlocked("c:\\games\\GAME.EXE"));
+  EXPECT_TRUE(rules->IsBlocked("C:\\PROGRAM FILES\\epic games\\a.exe"));
+
+  auto strict = RuleSet::Builder(BlockList(false))
+                    .AddApp("C:\\Games\\Game.exe")
+                    .Build();
+  EXPECT_FALSE(strict->IsBlocked("c:\\games\\game.exe"));
+}
+
+TEST(RuleSetTest, AllowListInvertsVerdict) {
+  RuleSet::Options options;
+  options.allow_list = true;
+  auto rules = RuleSet::Builder(options)
+                   .AddApp("/usr/bin/code")
+                   .AddDirectory("/usr/lib/firefox")
+                   .Build();
+
+  EXPECT_FALSE(rules->IsBlocked("/usr/bin/code"));
+  EXPECT_FALSE(rules->IsBlocked("/usr/lib/firefox/firefox"));
+  EXPECT_TRUE(rules->IsBlocked("/usr/bin/steam"));
+}
+
+TEST(RuleSetTest, ExemptPathsAreNeverBlocked) {
+  RuleSet::Options options;
+  options.allow_list = true;
+  options.ignore_case = true;
+  auto rules = RuleSet::Builder(options)
+                   .AddExempt("C:\\Windows\\explorer.exe")
+                   .Build();
+
+  EXPECT_FALSE(rules->IsBlocked("C:\\Windows\\Explorer.exe"));
+  EXPECT_TRUE(rules->IsExempt("c:/windows/explorer.exe"));
+  EXPECT_TRUE(rules->IsBlocked("C:\\Windows\\notepad.exe"));
+}
+
+TEST(RuleSetTest, EmptyRulesBlockNothing) {
+  auto rules = RuleSet::Builder(BlockList()).Build();
+
+  EXPECT_FALSE(rules->IsBlocked("/usr/bin/steam"));
+  EXPECT_FALSE(rules->IsBlocked(""));
+  EXPECT_FALSE(rules->Matches("/"));
+}
+
+TEST(RuleSetTest, ScalesToLargeLists) {
+  RuleSet::Builder builder(BlockList(true));
+  for (int i = 0; i < 5000; ++i) {
+    builder.AddApp("C:\\Apps\\app" + std::to_string(i) + ".exe");
+    builder.AddDirectory("D:\\Category" + std::to_string(i % 50) + "\\Sub" +
+                         std::to_string(i));
+  }
+  auto rules = builder.Build();
+
+  EXPECT_EQ(rules->app_count(), 5000u);
+  EXPECT_EQ(rules->directory_count(), 5000u);
+  for (int i = 0; i < 5000; i += 97) {
+    EXPECT_TRUE(rules->IsBlocked("c:\\apps\\APP" + std::to_string(i) + ".exe"));
+    EXPECT_TRUE(rules->IsBlocked("D:\\Category" + std::to_string(i % 50) +
+                                 "\\Sub" + std::to_string(i) + "\\x.exe"));
+  }
+  EXPECT_FALSE(rules->IsBlocked("C:\\Apps\\app5000.exe"));
+  EXPECT_FALSE(rules->IsBlocked("D:\\Category1\\Sub2\\x.exe"));
+}
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,292 @@
+#include "core/schedule_index.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace routine {
+namespace {
+
+// Days from 1970-01-01 to the given civil date (proleptic Gregorian).
+int64_t DaysFromCivil(int64_t year, int64_t month, int64_t day) {
+  year -= month <= 2;
+  const int64_t era = (year >= 0 ? year : year - 399) / 400;
+  const int64_t year_of_era = year - era * 400;
+  const int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 +
+                              day - 1;
+  const int64_t day_of_era =
+      year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  return era * 146097 + day_of_era - 719468;
+}
+
+int64_t Utc(int year, int month, int day, int hour, int minute) {
+  return DaysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60;
+}
+
+// New York in 2024: EST, EDT from 2024-03-10 07:00 UTC (02:00 local jumps
+// to 03:00) to 2024-11-03 06:00 UTC (02:00 local falls back to 01:00).
+class NewYork2024 : public TimeZone {
+ public:
+  static constexpr int64_t kSpring = 1710054000;
+  static constexpr int64_t kFall = 1730613600;
+
+  int32_t OffsetAt(int64_t utc) const override {
+    return utc >= kSpring && utc < kFall ? -4 * 3600 : -5 * 3600;
+  }
+  int64_t NextOffsetChange(int64_t utc, int64_t limit) const override {
+    for (const int64_t change : {kSpring, kFall}) {
+      if (change > utc && change <= limit) {
+        return change;
+      }
+    }
+    return limit + 1;
+  }
+};
+
+// Routine.isActive from the app, evaluated on local wall-clock time.
+bool ReferenceActive(const RoutineSchedule& routine, int64_t utc,
+                     const TimeZone& zone) {
+  if (routine.paused_until > utc || routine.snoozed_until > utc) {
+    return false;
+  }
+  const int64_t local = zone.ToLocal(utc);
+  const int64_t days = local >= 0 ? local / 86400 : (local - 86399) / 86400;
+  const int day = static_cast<int>(((days + 3) % 7 + 7) % 7);
+  const int minutes = static_cast<int>((local - days * 86400) / 60);
+  auto on = [&](int d) { return (routine.days & (1 << d)) != 0; };
+
+  if (routine.start_minute == -1 && routine.end_minute == -1) {
+    return on(day);
+  }
+  if (routine.end_minute < routine.start_minute) {
+    if (minutes >= routine.start_minute) {
+      return on(day);
+    }
+    if (minutes < routine.end_minute) {
+      return on((day + 6) % 7);
+    }
+    return false;
+  }
+  return on(day) && minutes >= routine.start_minute &&
+         minutes < routine.end_minute;
+}
+
+std::vector<uint32_t> Reference(const std::vector<RoutineSchedule>& routines,
+                                int64_t utc, const TimeZone& zone) {
+  std::vector<uint32_t> active;
+  for (uint32_t i = 0; i < routines.size(); ++i) {
+    if (ReferenceActive(routines[i], utc, zone)) {
+      active.push_back(i);
+    }
+  }
+  return active;
+}
+
+RoutineSchedule Schedule(uint8_t days, int start, int end) {
+  RoutineSchedule routine;
+  routine.days = days;
+  routine.start_minute = start;
+  routine.end_minute = end;
+  return routine;
+}
+
+constexpr uint8_t kMonday = 1 << 0;
+constexpr uint8_t kTuesday = 1 << 1;
+constexpr uint8_t kSunday = 1 << 6;
+
+TEST(ScheduleIndexTest, WorkdaySchedule) {
+  const FixedOffsetTimeZone utc_zone(0);
+  // 2024-01-01 was a Monday.
+  const ScheduleIndex index({Schedule(kMonday | kTuesday, 9 * 60, 17 * 60)});
+
+  EXPECT_TRUE(index.ActiveAt(Utc(2024, 1, 1, 8, 59), utc_zone).empty());
+  EXPECT_EQ(index.ActiveAt(Utc(2024, 1, 1, 9, 0), utc_zone),
+            std::vector<uint32_t>{0});
+  EXPECT_TRUE(index.ActiveAt(Utc(2024, 1, 1, 17, 0), utc_zone).empty());
+  EXPECT_TRUE(index.ActiveAt(Utc(2024, 1, 3, 12, 0), utc_zone).empty());
+
+  EXPECT_EQ(index.NextTransition(Utc(2024, 1, 1, 8, 0) + 30, utc_zone),
+            Utc(2024, 1, 1, 9, 0));
+  EXPECT_EQ(index.NextTransition(Utc(2024, 1, 1, 9, 0), utc_zone),
+            Utc(2024, 1, 1, 17, 0));
+  // Tuesday evening waits until next Monday.
+  EXPECT_EQ(index.NextTransition(Utc(2024, 1, 2, 17, 0), utc_zone),
+            Utc(2024, 1, 8, 9, 0));
+}
+
+TEST(ScheduleIndexTest, OvernightRunsIntoTheNextDayAndWeek) {
+  const FixedOffsetTimeZone utc_zone(0);
+  // Sunday 22:00 to Monday 06:00 (2024-01-07 was a Sunday).
+  const ScheduleIndex index({Schedule(kSunday, 22 * 60, 6 * 60)});
+
+  EXPECT_TRUE(index.ActiveAt(Utc(2024, 1, 7, 21, 59), utc_zone).empty());
+  EXPECT_EQ(index.ActiveAt(Utc(2024, 1, 7, 23, 0), utc_zone).size(), 1u);
+  EXPECT_EQ(index.ActiveAt(Utc(2024, 1, 8, 5, 59), utc_zone).size(), 1u);
+  EXPECT_TRUE(index.ActiveAt(Utc(2024, 1, 8, 6, 0), utc_zone).empty());
+  // Nothing happens at midnight or at the week boundary.
+  EXPECT_EQ(index.NextTransition(Utc(2024, 1, 7, 22, 0), utc_zone),
+            Utc(2024, 1, 8, 6, 0));
+}
+
+TEST(ScheduleIndexTest, AdjacentDaysMergeAcrossMidnight) {
+  const FixedOffsetTimeZone utc_zone(0);
+  const ScheduleIndex index({Schedule(kMonday | kTuesday, -1, -1),
+                             Schedule(kSunday | kMonday, -1, -1),
+                             Schedule(0x7f, -1, -1)});
+
+  EXPECT_EQ(index.ActiveAt(Utc(2024, 1, 2, 0, 0), utc_zone),
+            (std::vector<uint32_t>{0, 2}));
+  // Monday's midnight ends routine 1; Tuesday's starts nothing new, and
+  // routine 2 never changes.
+  EXPECT_EQ(index.NextTransition(Utc(2024, 1, 1, 12, 0), utc_zone),
+            Utc(2024, 1, 2, 0, 0));
+  EXPECT_EQ(index.NextTransition(Utc(2024, 1, 2, 0, 0), utc_zone),
+            Utc(2024, 1, 3, 0, 0));
+  EXPECT_EQ(index.NextTransition(Utc(2024, 1, 3, 0, 0), utc_zone),
+            Utc(2024, 1, 7, 0, 0));
+
+  const ScheduleIndex always({Schedule(0x7f, -1, -1)});
+  EXPECT_EQ(always.NextTransition(Utc(2024, 1, 3, 0, 0), utc_zone),
+            ScheduleIndex::kNever);
+}
+
+TEST(ScheduleIndexTest, PausesAndSnoozesEnd) {
+  const FixedOffsetTimeZone utc_zone(0);
+  RoutineSchedule paused = Schedule(0x7f, -1, -1);
+  paused.paused_until = Utc(2024, 1, 1, 10, 15);
+  RoutineSchedule snoozed = Schedule(0x7f, 9 * 60, 17 * 60);
+  snoozed.snoozed_until = Utc(2024, 1, 1, 12, 0);
+  const ScheduleIndex index({paused, snoozed});
+
+  const int64_t now = Utc(2024, 1, 1, 10, 0);
+  EXPECT_TRUE(index.ActiveAt(now, utc_zone).empty());
+  EXPECT_EQ(index.NextTransition(now, utc_zone), Utc(2024, 1, 1, 10, 15));
+  EXPECT_EQ(index.ActiveAt(Utc(2024, 1, 1, 10, 15), utc_zone),
+            std::vector<uint32_t>{0});
+  EXPECT_EQ(index.NextTransition(Utc(2024, 1, 1, 10, 15), utc_zone),
+            Utc(2024, 1, 1, 12, 0));
+  EXPECT_EQ(index.ActiveAt(Utc(2024, 1, 1, 12, 0), utc_zone),
+            (std::vector<uint32_t>{0, 1}));
+}
+
+TEST(ScheduleIndexTest, FollowsTheWallClockAcrossDaylightSaving) {
+  const NewYork2024 zone;
+  // 02:30-04:00 daily, and 01:00-01:30 daily.
+  const ScheduleIndex index(
+      {Schedule(0x7f, 150, 240), Schedule(0x7f, 60, 90)});
+
+  // Spring forward: 02:30 never happens, so routine 0 starts at the jump.
+  const int64_t before_spring = NewYork2024::kSpring - 60;
+  EXPECT_TRUE(index.ActiveAt(before_spring, zone).empty());
+  EXPECT_EQ(index.NextTransition(before_spring, zone), NewYork2024::kSpring);
+  EXPECT_EQ(index.ActiveAt(NewYork2024::kSpring, zone),
+            std::vector<uint32_t>{0});
+  // 04:00 EDT.
+  EXPECT_EQ(index.NextTransition(NewYork2024::kSpring, zone),
+            Utc(2024, 3, 10, 8, 0));
+
+  // Fall back: 01:00-01:30 happens twice.
+  EXPECT_EQ(index.ActiveAt(Utc(2024, 11, 3, 5, 0), zone),
+            std::vector<uint32_t>{1});
+  EXPECT_EQ(index.NextTransition(Utc(2024, 11, 3, 5, 0), zone),
+            Utc(2024, 11, 3, 5, 30));
+  EXPECT_EQ(index.NextTransition(Utc(2024, 11, 3, 5, 30), zone),
+            NewYork2024::kFall);
+  EXPECT_EQ(index.ActiveAt(NewYork2024::kFall, zone),
+            std::vector<uint32_t>{1});
+  EXPECT_EQ(index.NextTransition(NewYork2024::kFall, zone),
+            NewYork2024::kFall + 30 * 60);
+}
+
+// Walks minute by minute through weeks around both DST changes with random
+// routines and checks every answer against the app's own rule.
+TEST(ScheduleIndexTest, MatchesTheAppMinuteByMinute) {
+  const NewYork2024 zone;
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int> days(0, 0x7f);
+  std::uniform_int_distribution<int> minute(0, 1440);
+  std::uniform_int_distribution<int> kind(0, 9);
+
+  for (const int64_t around : {NewYork2024::kSpring, NewYork2024::kFall}) {
+    const int64_t begin = around - 4 * 86400;
+    const int64_t end = around + 4 * 86400;
+    // Pauses end on the minute here so the walk below sees every change.
+    std::uniform_int_distribution<int64_t> instant(begin / 60, end / 60);
+
+    std::vector<RoutineSchedule> routines;
+    for (int i = 0; i < 40; ++i) {
+      RoutineSchedule routine;
+      routine.days = static_cast<uint8_t>(days(random));
+      switch (kind(random)) {
+        case 0:
+          break;  // All day.
+        case 1:
+          routine.start_minute = 0;
+          routine.end_minute = 1440;
+          break;
+        default:
+          routine.start_minute = minute(random) / 15 * 15;
+          routine.end_minute = minute(random) / 15 * 15;
+      }
+      if (kind(random) == 0) {
+        routine.paused_until = instant(random) * 60;
+      } else if (kind(random) == 0) {
+        routine.snoozed_until = instant(random) * 60;
+      }
+      routines.push_back(routine);
+    }
+    const ScheduleIndex index(routines);
+
+    std::vector<uint32_t> previous = Reference(routines, begin, zone);
+    int64_t next = index.NextTransition(begin, zone);
+    for (int64_t t = begin + 60; t <= end; t += 60) {
+      const std::vector<uint32_t> expected = Reference(routines, t, zone);
+      ASSERT_EQ(index.ActiveAt(t, zone), expected) << "at " << t;
+      if (expected != previous) {
+        // Every change was announced, to the minute.
+        ASSERT_EQ(next, t) << "missed a change at " << t;
+      }
+      if (t >= next) {
+        ASSERT_EQ(next, t) << "transition off the minute grid";
+        next = index.NextTransition(t, zone);
+        ASSERT_GT(next, t);
+      }
+      previous = expected;
+    }
+  }
+}
+
+#ifndef _WIN32
+TEST(ScheduleIndexTest, SystemTimeZoneFindsOffsetChanges) {
+  const char* saved = std::getenv("TZ");
+  const std::string previous = saved != nullptr ? saved : "";
+  setenv("TZ", "America/New_York", 1);
+  tzset();
+
+  const SystemTimeZone zone;
+  const int64_t now = Utc(2024, 6, 1, 0, 0);
+  const int64_t change = zone.NextOffsetChange(now, now + 400 * 86400);
+  const int32_t offset = zone.OffsetAt(now);
+
+  if (saved != nullptr) {
+    setenv("TZ", previous.c_str(), 1);
+  } else {
+    unsetenv("TZ");
+  }
+  tzset();
+
+  if (offset == 0) {
+    GTEST_SKIP() << "no time zone data";
+  }
+  EXPECT_EQ(offset, -4 * 3600);
+  EXPECT_EQ(change, NewYork2024::kFall);
+}
+#endif
+
+}  // namespace
+}  // namespace routine
@@ -0,0 +1,143 @@
+#include "host/shm_ring.h"
+
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace routine {
+namespace {
+
+using std::chrono::milliseconds;
+
+std::string Message(int index) {
+  // Sizes vary so records wrap at different offsets.
+  return std::string(static_cast<size_t>(index * 37 % 1500),
+                     static_cast<char>('a' + index % 26)) +
+         std::to_string(index);
+}
+
+TEST(ShmRingTest, RoundsCapacityUpToAPowerOfTwo) {
+  auto ring = ShmRing::Create(5000);
+  ASSERT_NE(ring, nullptr);
+  EXPECT_EQ(ring->capacity(), 8192u);
+  EXPECT_EQ(ring->max_message_size(), 4092u);
+}
+
+TEST(ShmRingTest, DeliversMessagesInOrderAcrossTheWrap) {
+  auto ring = ShmRing::Create(4096);
+  ASSERT_NE(ring, nullptr);
+
+  int written = 0;
+  int read = 0;
+  std::string message;
+  while (read < 1000) {
+    while (written < 1000 && ring->TryWrite(Message(written).data(),
+                                            Message(written).size())) {
+      ++written;
+    }
+    ASSERT_TRUE(ring->TryRead(&message));
+    EXPECT_EQ(message, Message(read));
+    ++read;
+  }
+  EXPECT_FALSE(ring->TryRead(&message));
+  EXPECT_FALSE(ring->broken());
+}
+
+TEST(ShmRingTest, RefusesMessagesThatDoNotFit) {
+  auto ring = ShmRing::Create(4096);
+  ASSERT_NE(ring, nullptr);
+
+  const std::string too_big(ring->max_message_size() + 1, 'x');
+  EXPECT_FALSE(ring->TryWrite(too_big.data(), too_big.size()));
+  EXPECT_FALSE(ring->WaitWritable(too_big.size(), milliseconds(0)));
+
+  const std::string half(ring->max_message_size(), 'x');
+  EXPECT_TRUE(ring->TryWrite(half.data(), half.size()));
+  EXPECT_TRUE(ring->TryWrite(half.data(), half.size()));
+  EXPECT_FALSE(ring->TryWrite("y", 1));
+  EXPECT_FALSE(ring->WaitWritable(1, milliseconds(10)));
+
+  std::string message;
+  ASSERT_TRUE(ring->TryRead(&message));
+  EXPECT_EQ(message, half);
+  EXPECT_TRUE(ring->TryWrite("y", 1));
+}
+
+TEST(ShmRingTest, WaitReadableTimesOutWhenEmpty) {
+  auto ring = ShmRing::Create(4096);
+  ASSERT_NE(ring, nullptr);
+  EXPECT_FALSE(ring->WaitReadable(milliseconds(10)));
+  ASSERT_TRUE(ring->TryWrite("x", 1));
+  EXPECT_TRUE(ring->WaitReadable(milliseconds(0)));
+}
+
+TEST(ShmRingTest, StreamsBetweenProcesses) {
+  // Small enough that both sides have to sleep on the other.
+  auto ring = ShmRing::Create(4096);
+  ASSERT_NE(ring, nullptr);
+  constexpr int kMessages = 5000;
+
+  const pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    auto producer = ShmRing::Map(dup(ring->fd()));
+    if (producer == nullptr) {
+      _exit(2);
+    }
+    for (int i = 0; i < kMessages; ++i) {
+      const std::string message = Message(i);
+      while (!producer->TryWrite(message.data(), message.size())) {
+        producer->WaitWritable(message.size(), milliseconds(1000));
+      }
+    }
+    _exit(0);
+  }
+
+  std::string message;
+  for (int i = 0; i < kMessages; ++i) {
+    while (!ring->TryRead(&message)) {
+      ASSERT_TRUE(ring->WaitReadable(milliseconds(5000)));
+    }
+    ASSERT_EQ(message, Message(i));
+  }
+
+  int status = 0;
+  ASSERT_EQ(waitpid(child, &status, 0), child);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST(ShmRingTest, RejectsFilesThatAreNotRings) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  EXPECT_EQ(ShmRing::Map(fds[0]), nullptr);
+  close(fds[1]);
+
+  const int fd = memfd_create("not_a_ring", MFD_CLOEXEC);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(ftruncate(fd, 256 + 4096), 0);
+  EXPECT_EQ(ShmRing::Map(fd), nullptr);
+}
+
+TEST(ShmRingTest, StopsReadingCorruptLengths) {
+  auto producer = ShmRing::Create(4096);
+  ASSERT_NE(producer, nullptr);
+  auto consumer = ShmRing::Map(dup(producer->fd()));
+  ASSERT_NE(consumer, nullptr);
+
+  ASSERT_TRUE(producer->TryWrite("hello", 5));
+  // Claim the record runs past what was written.
+  const uint32_t length = 4000;
+  ASSERT_EQ(pwrite(producer->fd(), &length, sizeof(length), 256),
+            static_cast<ssize_t>(sizeof(length)));
+
+  std::string message;
+  EXPECT_FALSE(consumer->TryRead(&message));
+  EXPECT_TRUE(consumer->broken());
+}
+
+}  // namespace
+}  // namespace routine
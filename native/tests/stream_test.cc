@@ -0,0 +1,57 @@
+#include "host/stream.h"
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace routine {
+namespace {
+
+// Listens on the abstract socket |name|; returns the descriptor.
+int ListenAbstract(const std::string& name) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path + 1, name.data(), name.size());
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  EXPECT_GE(fd, 0);
+  EXPECT_EQ(bind(fd, reinterpret_cast<const sockaddr*>(&address),
+                 static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 +
+                                        name.size())),
+            0);
+  EXPECT_EQ(listen(fd, 4), 0);
+  return fd;
+}
+
+TEST(StreamTest, ConnectsToAbstractSocket) {
+  const std::string name = "routine_stream_test." + std::to_string(getpid());
+  const int listener = ListenAbstract(name);
+
+  const Stream app = ConnectLocal(name.c_str());
+  ASSERT_GE(app.handle, 0);
+  EXPECT_TRUE(app.socket);
+
+  const int accepted = accept(listener, nullptr, nullptr);
+  ASSERT_GE(accepted, 0);
+  ASSERT_TRUE(WriteAll(app, "ping", 4));
+  char buffer[4];
+  EXPECT_EQ(ReadSome(Stream{accepted, true}, buffer, sizeof(buffer)), 4);
+  EXPECT_EQ(std::string(buffer, 4), "ping");
+
+  Close(app);
+  close(accepted);
+  close(listener);
+}
+
+TEST(StreamTest, ConnectLocalFailsWithoutListener) {
+  const std::string name = "routine_stream_test.none." +
+                           std::to_string(getpid());
+  EXPECT_LT(ConnectLocal(name.c_str()).handle, 0);
+}
+
+}  // namespace
+}  // namespace routine
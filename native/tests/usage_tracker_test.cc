@@ -0,0 +1,239 @@
+#include "core/usage_tracker.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace routine {
+namespace {
+
+constexpr int64_t kMinute = 60000;
+constexpr int64_t kHour = 60 * kMinute;
+// 2024-01-01 00:00 UTC, a Monday.
+constexpr int64_t kMonday = 1704067200000;
+
+class UsageTrackerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() /
+           ("routine_usage_" +
+            std::string(::testing::UnitTest::GetInstance()
+                            ->current_test_info()
+                            ->name()));
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+    options_.path = (dir_ / "usage.bin").string();
+  }
+
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  std::filesystem::path dir_;
+  UsageTracker::Options options_;
+  // UTC+2, so local midnight is 22:00 UTC.
+  FixedOffsetTimeZone zone_{2 * 3600};
+};
+
+TEST_F(UsageTrackerTest, CountsFocusIntervalsPerApp) {
+  options_.path.clear();
+  UsageTracker tracker(options_, &zone_);
+  const int64_t day = tracker.LocalDay(kMonday);
+  tracker.Focus("/usr/bin/editor", kMonday);
+  tracker.Focus("/usr/bin/browser", kMonday + 10 * kMinute);
+  // Refocusing the same app keeps its interval going.
+  tracker.Focus("/usr/bin/browser", kMonday + 15 * kMinute);
+  tracker.Focus("/usr/bin/editor", kMonday + 30 * kMinute);
+  tracker.Focus("", kMonday + 35 * kMinute);
+
+  const std::vector<UsageTracker::Interval> recent = tracker.Recent();
+  ASSERT_EQ(recent.size(), 3u);
+  EXPECT_EQ(recent[0].app, "/usr/bin/editor");
+  EXPECT_EQ(recent[0].duration_ms, 10 * kMinute);
+  EXPECT_EQ(recent[1].app, "/usr/bin/browser");
+  EXPECT_EQ(recent[1].start_ms, kMonday + 10 * kMinute);
+  EXPECT_EQ(recent[1].duration_ms, 20 * kMinute);
+  EXPECT_EQ(recent[2].duration_ms, 5 * kMinute);
+
+  const UsageTracker::Totals totals = tracker.Query(day, day, kMonday + kHour);
+  EXPECT_EQ(totals.days, (std::vector<int64_t>{day, day}));
+  EXPECT_EQ(totals.apps,
+            (std::vector<std::string>{"/usr/bin/browser", "/usr/bin/editor"}));
+  EXPECT_EQ(totals.ms, (std::vector<int64_t>{20 * kMinute, 15 * kMinute}));
+}
+
+TEST_F(UsageTrackerTest, SplitsIntervalsAtLocalMidnight) {
+  options_.path.clear();
+  UsageTracker tracker(options_, &zone_);
+  // 21:30 to 22:45 UTC crosses local midnight at 22:00 UTC.
+  const int64_t start = kMonday + 21 * kHour + 30 * kMinute;
+  const int64_t day = tracker.LocalDay(start);
+  EXPECT_EQ(tracker.DayStart(day + 1), kMonday + 22 * kHour);
+  tracker.Focus("/usr/bin/editor", start);
+
+  // The running interval counts before it ends.
+  const UsageTracker::Totals totals =
+      tracker.Query(day, day + 1, start + 75 * kMinute);
+  EXPECT_EQ(totals.days, (std::vector<int64_t>{day, day + 1}));
+  EXPECT_EQ(totals.ms, (std::vector<int64_t>{30 * kMinute, 45 * kMinute}));
+  EXPECT_EQ(tracker.Query(day + 1, day + 1, start + 75 * kMinute).ms,
+            std::vector<int64_t>{45 * kMinute});
+}
+
+TEST_F(UsageTrackerTest, RingKeepsTheLatestIntervals) {
+  options_.path.clear();
+  options_.ring_capacity = 3;
+  UsageTracker tracker(options_, &zone_);
+  for (int i = 0; i < 6; ++i) {
+    tracker.Focus("/usr/bin/app" + std::to_string(i), kMonday + i * kMinute);
+  }
+  tracker.Focus("", kMonday + 6 * kMinute);
+
+  const std::vector<UsageTracker::Interval> recent = tracker.Recent();
+  ASSERT_EQ(recent.size(), 3u);
+  EXPECT_EQ(recent[0].app, "/usr/bin/app3");
+  EXPECT_EQ(recent[1].app, "/usr/bin/app4");
+  EXPECT_EQ(recent[2].app, "/usr/bin/app5");
+}
+
+TEST_F(UsageTrackerTest, EnforcesDailyBudgets) {
+  options_.path.clear();
+  UsageTracker tracker(options_, &zone_);
+  tracker.SetBudgets({{"/usr/bin/game", 30}});
+  EXPECT_EQ(tracker.Remaining("/usr/bin/game", kMonday), 30 * kMinute);
+  EXPECT_EQ(tracker.Remaining("/usr/bin/editor", kMonday), -1);
+
+  EXPECT_FALSE(tracker.Focus("/usr/bin/game", kMonday));
+  EXPECT_FALSE(tracker.Tick(kMonday + 20 * kMinute));
+  EXPECT_FALSE(tracker.Focus("/usr/bin/editor", kMonday + 20 * kMinute));
+  EXPECT_FALSE(tracker.Tick(kMonday + 2 * kHour));
+  EXPECT_EQ(tracker.Remaining("/usr/bin/game", kMonday + 2 * kHour),
+            10 * kMinute);
+
+  EXPECT_FALSE(tracker.Focus("/usr/bin/game", kMonday + 3 * kHour));
+  EXPECT_FALSE(tracker.Tick(kMonday + 3 * kHour + 9 * kMinute));
+  EXPECT_TRUE(tracker.Tick(kMonday + 3 * kHour + 10 * kMinute));
+  // Focusing it again is refused straight away.
+  tracker.Focus("/usr/bin/editor", kMonday + 3 * kHour + 11 * kMinute);
+  EXPECT_TRUE(tracker.Focus("/usr/bin/game", kMonday + 4 * kHour));
+  EXPECT_EQ(tracker.RemainingAll(kMonday + 4 * kHour),
+            (std::vector<std::pair<std::string, int64_t>>{
+                {"/usr/bin/game", 0}}));
+
+  // A new local day starts a new budget.
+  tracker.Focus("", kMonday + 4 * kHour);
+  EXPECT_FALSE(tracker.Focus("/usr/bin/game", kMonday + 23 * kHour));
+  EXPECT_EQ(tracker.Remaining("/usr/bin/game", kMonday + 23 * kHour),
+            30 * kMinute);
+
+  tracker.SetBudgets({});
+  EXPECT_EQ(tracker.Remaining("/usr/bin/game", kMonday), -1);
+}
+
+TEST_F(UsageTrackerTest, StopsCountingWhenNothingHasFocus) {
+  options_.path.clear();
+  UsageTracker tracker(options_, &zone_);
+  tracker.SetBudgets({{"/usr/bin/game", 30}});
+  const int64_t day = tracker.LocalDay(kMonday);
+  EXPECT_FALSE(tracker.Focus("/usr/bin/game", kMonday));
+  // The screen locks: the game keeps its window, but not the focus.
+  EXPECT_FALSE(tracker.Focus("", kMonday + 10 * kMinute));
+  EXPECT_FALSE(tracker.Tick(kMonday + 2 * kHour));
+
+  EXPECT_EQ(tracker.Query(day, day, kMonday + 2 * kHour).ms,
+            std::vector<int64_t>{10 * kMinute});
+  EXPECT_EQ(tracker.Remaining("/usr/bin/game", kMonday + 2 * kHour),
+            20 * kMinute);
+}
+
+TEST_F(UsageTrackerTest, PersistsAcrossInstances) {
+  int64_t day;
+  {
+    UsageTracker tracker(options_, &zone_);
+    day = tracker.LocalDay(kMonday);
+    tracker.Focus("/usr/bin/editor", kMonday);
+    tracker.Focus("/usr/bin/browser", kMonday + 10 * kMinute);
+    EXPECT_TRUE(tracker.Flush(kMonday + 20 * kMinute));
+    // Counted up to the last tick, and flushed when it goes.
+    tracker.Tick(kMonday + 25 * kMinute);
+  }
+
+  UsageTracker tracker(options_, &zone_);
+  const UsageTracker::Totals totals = tracker.Query(day, day, kMonday);
+  EXPECT_EQ(totals.apps,
+            (std::vector<std::string>{"/usr/bin/browser", "/usr/bin/editor"}));
+  EXPECT_EQ(totals.ms, (std::vector<int64_t>{15 * kMinute, 10 * kMinute}));
+  // Budgets are the runner's to set again; the time used is not lost.
+  tracker.SetBudgets({{"/usr/bin/browser", 20}});
+  EXPECT_EQ(tracker.Remaining("/usr/bin/browser", kMonday + kHour),
+            5 * kMinute);
+}
+
+TEST_F(UsageTrackerTest, AppendsOnlyWhatChanged) {
+  UsageTracker tracker(options_, &zone_);
+  for (int i = 0; i < 20; ++i) {
+    tracker.Focus("/usr/bin/app" + std::to_string(i), kMonday + i * kMinute);
+  }
+  tracker.Focus("", kMonday + 20 * kMinute);
+  tracker.Flush(kMonday + 20 * kMinute);
+  const auto first = std::filesystem::file_size(options_.path);
+
+  tracker.Focus("/usr/bin/app0", kMonday + kHour);
+  tracker.Flush(kMonday + kHour + kMinute);
+  // One row of 12 bytes behind a 16 byte block header.
+  EXPECT_EQ(std::filesystem::file_size(options_.path), first + 28);
+  // Nothing new, nothing written.
+  tracker.Focus("", kMonday + kHour + kMinute);
+  tracker.Flush(kMonday + kHour + 2 * kMinute);
+  EXPECT_EQ(std::filesystem::file_size(options_.path), first + 28);
+}
+
+TEST_F(UsageTrackerTest, DropsATornTail) {
+  const int64_t day = [&] {
+    UsageTracker tracker(options_, &zone_);
+    tracker.Focus("/usr/bin/editor", kMonday);
+    tracker.Flush(kMonday + kMinute);
+    return tracker.LocalDay(kMonday);
+  }();
+  const auto intact = std::filesystem::file_size(options_.path);
+  {
+    // The header of a block whose body never made it to disk.
+    const uint32_t torn[4] = {5, 0, 64, 0};
+    std::ofstream(options_.path, std::ios::binary | std::ios::app)
+        .write(reinterpret_cast<const char*>(torn), sizeof(torn));
+  }
+
+  {
+    UsageTracker tracker(options_, &zone_);
+    EXPECT_EQ(tracker.Query(day, day, kMonday).ms,
+              std::vector<int64_t>{kMinute});
+    EXPECT_EQ(std::filesystem::file_size(options_.path), intact);
+    tracker.Focus("/usr/bin/editor", kMonday + kHour);
+    tracker.Flush(kMonday + kHour + kMinute);
+  }
+
+  UsageTracker tracker(options_, &zone_);
+  EXPECT_EQ(tracker.Query(day, day, kMonday).ms,
+            std::vector<int64_t>{2 * kMinute});
+}
+
+TEST_F(UsageTrackerTest, CompactsSupersededRows) {
+  {
+    UsageTracker tracker(options_, &zone_);
+    tracker.Focus("/usr/bin/editor", kMonday);
+    for (int i = 1; i <= 600; ++i) {
+      tracker.Flush(kMonday + i * 1000);
+    }
+  }
+  const auto before = std::filesystem::file_size(options_.path);
+
+  UsageTracker tracker(options_, &zone_);
+  EXPECT_LT(std::filesystem::file_size(options_.path), before / 100);
+  const int64_t day = tracker.LocalDay(kMonday);
+  EXPECT_EQ(tracker.Query(day, day, kMonday).ms,
+            std::vector<int64_t>{10 * kMinute});
+}
+
+}  // namespace
+}  // namespace routine
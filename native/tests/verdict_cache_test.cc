@@ -0,0 +1,91 @@
+#include "core/verdict_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "core/path.h"
+#include "core/policy_store.h"
+
+namespace routine {
+namespace {
+
+uint64_t Key(uint64_t i) {
+  return MixHash(i, 0x1234);
+}
+
+TEST(VerdictCacheTest, RoundsCapacityToWholeSets) {
+  EXPECT_EQ(VerdictCache(1).capacity(), VerdictCache::kWays);
+  EXPECT_EQ(VerdictCache(100).capacity(), 128u);
+  EXPECT_EQ(VerdictCache(4096).capacity(), 4096u);
+}
+
+TEST(VerdictCacheTest, StoresVerdictsPerGeneration) {
+  VerdictCache cache(64);
+  bool blocked = false;
+
+  EXPECT_FALSE(cache.Lookup(Key(1), 1, &blocked));
+  cache.Insert(Key(1), 1, true);
+  cache.Insert(Key(2), 1, false);
+
+  ASSERT_TRUE(cache.Lookup(Key(1), 1, &blocked));
+  EXPECT_TRUE(blocked);
+  ASSERT_TRUE(cache.Lookup(Key(2), 1, &blocked));
+  EXPECT_FALSE(blocked);
+
+  // A new generation invalidates everything at once.
+  EXPECT_FALSE(cache.Lookup(Key(1), 2, &blocked));
+
+  const auto stats = cache.stats();
+  EXPECT_EQ(stats.hits, 2u);
+  EXPECT_EQ(stats.misses, 2u);
+  EXPECT_EQ(stats.evictions, 0u);
+}
+
+TEST(VerdictCacheTest, StaleEntriesAreReusedWithoutEviction) {
+  VerdictCache cache(VerdictCache::kWays);
+  for (uint64_t i = 0; i < VerdictCache::kWays; ++i) {
+    cache.Insert(Key(i), 1, true);
+  }
+  for (uint64_t i = 0; i < VerdictCache::kWays; ++i) {
+    cache.Insert(Key(100 + i), 2, false);
+  }
+  EXPECT_EQ(cache.stats().evictions, 0u);
+}
+
+TEST(VerdictCacheTest, StaysBoundedUnderChurn) {
+  VerdictCache cache(VerdictCache::kWays);
+  bool blocked = false;
+
+  // Keep one entry hot while streaming many cold keys through the set.
+  cache.Insert(Key(0), 1, true);
+  for (uint64_t i = 1; i < 1000; ++i) {
+    ASSERT_TRUE(cache.Lookup(Key(0), 1, &blocked));
+    cache.Insert(Key(i), 1, false);
+  }
+
+  EXPECT_TRUE(cache.Lookup(Key(0), 1, &blocked));
+  EXPECT_TRUE(blocked);
+  EXPECT_GE(cache.stats().evictions, 1000u - VerdictCache::kWays);
+}
+
+TEST(VerdictCacheTest, PolicyStoreCachesVerdicts) {
+  PolicyStore store(64);
+  store.Set(
+      RuleSet::Builder(RuleSet::Options()).AddApp("/usr/bin/steam").Build());
+
+  EXPECT_TRUE(store.IsBlocked("/usr/bin/steam"));
+  EXPECT_TRUE(store.IsBlocked("/usr/bin/steam"));
+  EXPECT_FALSE(store.IsBlocked("/usr/bin/vim"));
+  EXPECT_EQ(store.cache_stats().hits, 1u);
+  EXPECT_EQ(store.cache_stats().misses, 2u);
+
+  // Cached verdicts from the previous policy must not leak through.
+  store.Set(
+      RuleSet::Builder(RuleSet::Options()).AddApp("/usr/bin/vim").Build());
+  EXPECT_FALSE(store.IsBlocked("/usr/bin/steam"));
+  EXPECT_TRUE(store.IsBlocked("/usr/bin/vim"));
+}
+
+}  // namespace
+}  // namespace routine
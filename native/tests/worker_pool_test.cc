@@ -0,0 +1,129 @@
+#include "core/worker_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace routine {
+namespace {
+
+// Stands in for the platform thread: posted tasks queue up until the test
+// runs them.
+class FakePlatformThread {
+ public:
+  WorkerPool::Poster Poster() {
+    return [this](WorkerPool::Task task) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(std::move(task));
+      posted_.notify_all();
+    };
+  }
+
+  // Runs posted tasks until |count| have run in total.
+  void RunUntil(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (ran_ < count) {
+      ASSERT_TRUE(posted_.wait_for(lock, std::chrono::seconds(5),
+                                   [this] { return !tasks_.empty(); }));
+      WorkerPool::Task task = std::move(tasks_.front());
+      tasks_.pop_front();
+      ++ran_;
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable posted_;
+  std::deque<WorkerPool::Task> tasks_;
+  size_t ran_ = 0;
+};
+
+TEST(WorkerPoolTest, PostsRepliesToThePlatformThread) {
+  FakePlatformThread platform;
+  std::vector<std::string> replies;
+  const std::thread::id platform_id = std::this_thread::get_id();
+  {
+    WorkerPool pool(2, platform.Poster());
+    for (int i = 0; i < 3; ++i) {
+      pool.Submit(
+          "kind" + std::to_string(i),
+          [&, i](const CancellationToken&) -> WorkerPool::Task {
+            EXPECT_NE(std::this_thread::get_id(), platform_id);
+            return [&, i] {
+              EXPECT_EQ(std::this_thread::get_id(), platform_id);
+              replies.push_back("reply" + std::to_string(i));
+            };
+          },
+          [] { ADD_FAILURE() << "nothing should be cancelled"; });
+    }
+    platform.RunUntil(3);
+  }
+  EXPECT_EQ(replies.size(), 3u);
+}
+
+TEST(WorkerPoolTest, NewerRequestsCancelOlderOnes) {
+  FakePlatformThread platform;
+  std::atomic<bool> started{false};
+  std::atomic<bool> saw_cancel{false};
+  std::vector<std::string> outcomes;
+
+  WorkerPool pool(1, platform.Poster());
+  auto submit = [&](const std::string& name, bool block) {
+    pool.Submit(
+        "getRunningApplications",
+        [&, name, block](const CancellationToken& token) -> WorkerPool::Task {
+          if (block) {
+            started = true;
+            while (!token.IsCancelled()) {
+              std::this_thread::yield();
+            }
+            saw_cancel = true;
+          }
+          return [&, name] { outcomes.push_back(name + " done"); };
+        },
+        [&, name] { outcomes.push_back(name + " cancelled"); });
+  };
+
+  submit("first", true);
+  while (!started) {
+    std::this_thread::yield();
+  }
+  // "second" is queued behind the running "first" and superseded by
+  // "third" before it starts.
+  submit("second", false);
+  submit("third", false);
+  platform.RunUntil(3);
+
+  EXPECT_TRUE(saw_cancel);
+  EXPECT_EQ(outcomes, (std::vector<std::string>{
+                          "second cancelled", "first cancelled", "third done"}));
+}
+
+TEST(WorkerPoolTest, KindsDoNotCancelEachOther) {
+  FakePlatformThread platform;
+  std::atomic<int> done{0};
+  WorkerPool pool(1, platform.Poster());
+  for (const char* kind : {"a", "b"}) {
+    pool.Submit(
+        kind,
+        [&](const CancellationToken&) -> WorkerPool::Task {
+          return [&] { ++done; };
+        },
+        [] { ADD_FAILURE() << "nothing should be cancelled"; });
+  }
+  platform.RunUntil(2);
+  EXPECT_EQ(done, 2);
+}
+
+}  // namespace
+}  // namespace routine
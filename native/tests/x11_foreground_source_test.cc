@@ -0,0 +1,107 @@
+#include "linux/x11_foreground_source.h"
+
+// gtest must come before Xlib, whose None and Bool macros break it.
+#include <gtest/gtest.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace routine {
+namespace {
+
+// Needs an X server; run under Xvfb, e.g. `xvfb-run ctest`. With no window
+// manager around, the test plays its part and sets _NET_ACTIVE_WINDOW itself.
+class X11ForegroundSourceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (std::getenv("DISPLAY") == nullptr ||
+        (display_ = XOpenDisplay(nullptr)) == nullptr) {
+      GTEST_SKIP() << "No X display available";
+    }
+    root_ = DefaultRootWindow(display_);
+    active_atom_ = XInternAtom(display_, "_NET_ACTIVE_WINDOW", False);
+    pid_atom_ = XInternAtom(display_, "_NET_WM_PID", False);
+  }
+
+  void TearDown() override {
+    if (display_ != nullptr) {
+      XDeleteProperty(display_, root_, active_atom_);
+      XCloseDisplay(display_);
+    }
+  }
+
+  Window CreateWindow(long pid) {
+    Window window =
+        XCreateSimpleWindow(display_, root_, 0, 0, 10, 10, 0, 0, 0);
+    XChangeProperty(display_, window, pid_atom_, XA_CARDINAL, 32,
+                    PropModeReplace, reinterpret_cast<unsigned char*>(&pid),
+                    1);
+    return window;
+  }
+
+  void Activate(Window window) {
+    XChangeProperty(display_, root_, active_atom_, XA_WINDOW, 32,
+                    PropModeReplace, reinterpret_cast<unsigned char*>(&window),
+                    1);
+    XFlush(display_);
+  }
+
+  Display* display_ = nullptr;
+  Window root_ = 0;
+  Atom active_atom_ = 0;
+  Atom pid_atom_ = 0;
+};
+
+TEST_F(X11ForegroundSourceTest, ReportsActiveWindowChanges) {
+  const Window first = CreateWindow(1234);
+  const Window second = CreateWindow(5678);
+  Activate(first);
+
+  X11ForegroundSource source;
+  auto current = source.Current();
+  ASSERT_TRUE(current.has_value());
+  EXPECT_EQ(current->window, first);
+  EXPECT_EQ(current->pid, 1234);
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::vector<ForegroundWindow> events;
+  ASSERT_TRUE(source.Start([&](const ForegroundWindow& window) {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(window);
+    changed.notify_all();
+  }));
+
+  Activate(second);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  ASSERT_TRUE(changed.wait_for(lock, std::chrono::seconds(5),
+                               [&] { return !events.empty(); }));
+  EXPECT_EQ(events.back().window, second);
+  EXPECT_EQ(events.back().pid, 5678);
+  lock.unlock();
+
+  source.Stop();
+}
+
+TEST_F(X11ForegroundSourceTest, SurvivesDestroyedActiveWindow) {
+  const Window window = CreateWindow(42);
+  Activate(window);
+  XDestroyWindow(display_, window);
+  XSync(display_, False);
+
+  X11ForegroundSource source;
+  auto current = source.Current();
+  ASSERT_TRUE(current.has_value());
+  EXPECT_EQ(current->window, window);
+  EXPECT_EQ(current->pid, 0);
+}
+
+}  // namespace
+}  // namespace routine
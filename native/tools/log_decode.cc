@@ -0,0 +1,70 @@
+// Prints the binary logs written by routine::Logger as text, one line per
+// record, oldest file first.
+//
+//   routine_log_decode <log> [<log>...]
+//
+// Accepts the current log and its compressed rotations alike, e.g.
+// `routine_log_decode routine_app.rlog.2.lz routine_app.rlog.1.lz
+// routine_app.rlog`.
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/log_format.h"
+#include "core/mapped_file.h"
+
+namespace {
+
+void Print(const routine::LogRecord& record) {
+  const std::time_t seconds =
+      static_cast<std::time_t>(record.time_us / 1000000);
+  std::tm time{};
+#ifdef _WIN32
+  gmtime_s(&time, &seconds);
+#else
+  gmtime_r(&seconds, &time);
+#endif
+  char stamp[32];
+  std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &time);
+  std::printf("%s.%06lldZ %c %3u %.*s\n", stamp,
+              static_cast<long long>(record.time_us % 1000000),
+              routine::LogLevelLetter(record.level), record.thread,
+              static_cast<int>(record.message.size()),
+              record.message.data());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s <log> [<log>...]\n", argv[0]);
+    return 2;
+  }
+
+  int status = 0;
+  for (int i = 1; i < argc; ++i) {
+    routine::MappedFile file;
+    if (!file.Open(argv[i])) {
+      std::fprintf(stderr, "%s: cannot open\n", argv[i]);
+      status = 1;
+      continue;
+    }
+    std::vector<routine::LogRecord> records;
+    const bool intact = routine::DecodeLog(
+        std::string_view(reinterpret_cast<const char*>(file.data()),
+                         file.size()),
+        &records);
+    for (const auto& record : records) {
+      Print(record);
+    }
+    if (!intact) {
+      std::fprintf(stderr, "%s: not a log, or damaged after %zu records\n",
+                   argv[i], records.size());
+      status = 1;
+    }
+  }
+  return status;
+}
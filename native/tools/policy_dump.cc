@@ -0,0 +1,123 @@
+// Inspects compiled policy blobs (routine::PolicyBlob), and compiles small
+// ones by hand for testing.
+//
+//   routine_policy_dump <blob>
+//       Prints the header and every rule.
+//   routine_policy_dump <blob> --match <path or host>...
+//       Prints the verdict for each executable path or site host.
+//   routine_policy_dump --compile <blob> [--allow-list] [--ignore-case]
+//                       {app:|dir:|exempt:|site:}<value>...
+//       Writes a blob with the given rules.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/mapped_file.h"
+#include "core/path.h"
+#include "core/policy_blob.h"
+
+namespace {
+
+void PrintList(const char* title, const std::vector<std::string>& entries) {
+  std::printf("%s (%zu)\n", title, entries.size());
+  for (const auto& entry : entries) {
+    std::printf("  %s\n", entry.c_str());
+  }
+}
+
+int Compile(int argc, char** argv) {
+  routine::PolicyBlob::Source source;
+  for (int i = 3; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    auto take = [&](std::string_view prefix, std::vector<std::string>* list) {
+      if (arg.substr(0, prefix.size()) != prefix) {
+        return false;
+      }
+      list->emplace_back(arg.substr(prefix.size()));
+      return true;
+    };
+    if (arg == "--allow-list") {
+      source.allow_list = true;
+    } else if (arg == "--ignore-case") {
+      source.ignore_case = true;
+    } else if (!take("app:", &source.apps) &&
+               !take("dir:", &source.directories) &&
+               !take("exempt:", &source.exempt) &&
+               !take("site:", &source.sites)) {
+      std::fprintf(stderr, "unknown rule: %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  const std::string blob = routine::PolicyBlob::Compile(source);
+  std::FILE* file = routine::OpenFile(argv[2], "wb");
+  if (file == nullptr ||
+      std::fwrite(blob.data(), 1, blob.size(), file) != blob.size()) {
+    std::fprintf(stderr, "%s: cannot write\n", argv[2]);
+    if (file != nullptr) {
+      std::fclose(file);
+    }
+    return 1;
+  }
+  std::fclose(file);
+  std::printf("wrote %zu bytes\n", blob.size());
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && std::strcmp(argv[1], "--compile") == 0) {
+    return Compile(argc, argv);
+  }
+  if (argc != 2 && (argc < 4 || std::strcmp(argv[2], "--match") != 0)) {
+    std::fprintf(stderr,
+                 "usage: %s <blob> [--match <path or host>...]\n"
+                 "       %s --compile <blob> [--allow-list] [--ignore-case] "
+                 "{app:|dir:|exempt:|site:}<value>...\n",
+                 argv[0], argv[0]);
+    return 2;
+  }
+
+  routine::MappedFile file;
+  if (!file.Open(argv[1])) {
+    std::fprintf(stderr, "%s: cannot open\n", argv[1]);
+    return 1;
+  }
+  routine::PolicyBlob blob;
+  if (!blob.Open(std::string_view(reinterpret_cast<const char*>(file.data()),
+                                  file.size()))) {
+    std::fprintf(stderr, "%s: not a version %u policy blob, or damaged\n",
+                 argv[1], routine::PolicyBlob::kVersion);
+    return 1;
+  }
+
+  if (argc == 2) {
+    std::printf("version %u, %zu bytes, %s, %s\n",
+                routine::PolicyBlob::kVersion, blob.bytes().size(),
+                blob.allow_list() ? "allow list" : "block list",
+                blob.ignore_case() ? "case-insensitive" : "case-sensitive");
+    PrintList("apps", blob.Apps());
+    PrintList("directories", blob.Directories());
+    PrintList("exempt", blob.Exempt());
+    PrintList("sites", blob.Sites());
+    return 0;
+  }
+
+  for (int i = 3; i < argc; ++i) {
+    const std::string_view query = argv[i];
+    // Hosts have no separators; everything else is taken as a path.
+    if (query.find_first_of("/\\") == std::string_view::npos) {
+      std::printf("%s: site %s\n", argv[i],
+                  blob.MatchesSite(query) ? "listed" : "not listed");
+    } else {
+      const bool blocked =
+          blob.IsBlocked(query, routine::HashPath(query, blob.ignore_case()));
+      std::printf("%s: %s\n", argv[i], blocked ? "blocked" : "allowed");
+    }
+  }
+  return 0;
+}
@@ -1,70 +1,44 @@
-
-#include <mutex>
-#include <unordered_set>
-#include <unordered_map>
+#include <string>
 #include <vector>
 
+#include "core/desktop_session.h"
+#include "core/policy_store.h"
+#include "core/rule_set.h"
+#include "utils.h"
+
 class BlockManager {
 public:
 	static inline void Set(bool a_allow, const std::vector<std::string>& a_apps, const std::vector<std::string>& a_dirs) {
-		std::lock_guard lock{ _mutex };
+        routine::RuleSet::Options options;
+        options.allow_list = a_allow;
+        options.ignore_case = true;
 
-		_allow = a_allow;
-    
-        _cache.clear();
-        _cache.insert({ L"C:\\Windows\\explorer.exe", false });
+        routine::RuleSet::Builder builder{ options };
+        routine::AddWindowsSession(a_allow, &builder);
 
         WCHAR path[MAX_PATH];
         GetModuleFileNameW(NULL, path, MAX_PATH);
 
-        _cache.insert({ std::wstring{ path }, false });
+        builder.AddExempt(Utf8FromUtf16(path));
 
-		_appList.clear();
         for (const auto& app : a_apps) {
-            _appList.insert(std::wstring{ app.begin(), app.end() });
+            builder.AddApp(app);
         }
 
-        _dirList.clear();
-
-        if (a_allow) {
-            _dirList.emplace_back(std::wstring{ L"C:\\Windows\\SystemApps" });
-        }
-        
         for (const auto& dir : a_dirs) {
-            _dirList.emplace_back(std::wstring{ dir.begin(), dir.end() });
+            builder.AddDirectory(dir);
         }
+
+        // Readers keep using the previous policy until the compiled one is
+        // published in a single pointer swap.
+        _policy.Set(builder.Build());
 	}
 	static inline bool IsBlocked(const std::wstring& a_exePath) {
-		std::lock_guard lock{ _mutex };
-		
-        const auto& inCacheList = _cache.find(a_exePath);
-        if (inCacheList != _cache.end()) {
-            return inCacheList->second;
-        }
-
-		const bool inList = _appList.find(a_exePath) != _appList.end() || InDirectories(a_exePath);
-        const bool res = (!_allow && inList) || (_allow && !inList);
-
-		_cache[a_exePath] = res;
-
-		return res;
+        return _policy.IsBlocked(Utf8FromUtf16(a_exePath.c_str()));
+	}
+	static inline routine::VerdictCache::Stats CacheStats() {
+        return _policy.cache_stats();
 	}
 private:
-    static inline bool InDirectories(const std::wstring& a_dir) {
-		for (const auto& dir : _dirList) {
-			if (a_dir.find(dir) != std::wstring::npos) {
-				return true;
-			}
-		}
-
-        return false;
-    }
-
-	static inline std::mutex _mutex;
-	static inline std::unordered_set<std::wstring> _appList;
-    static inline std::vector<std::wstring> _dirList;
-
-    static inline std::unordered_map<std::wstring, bool> _cache;
-
-	static inline bool _allow;
-};
\ No newline at end of file
+	static inline routine::PolicyStore _policy;
+};
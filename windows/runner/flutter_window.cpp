@@ -6,17 +6,18 @@
 #include <flutter/standard_method_codec.h>
 #include <windows.h>
 #include <debugapi.h>
-#include <fstream>
+#include <chrono>
 #include <ctime>
 #include <sstream>
 #include <algorithm>
 #include <string>
 #include <memory>
 #include <optional>
-#include <TlHelp32.h>
 #include <psapi.h>
 #include <unordered_set>
+#include <utility>
 #include <ShlObj.h>
+#include <shellapi.h>
 
 // Add pragma comment to link with version.lib
 #pragma comment(lib, "version.lib")
@@ -25,8 +26,13 @@
 #include "flutter/generated_plugin_registrant.h"
 
 #include "block_manager.h"
-
-const UINT_PTR WINDOW_CHECK_TIMER_ID = 1;
+#include "core/app_event_batcher.h"
+#include "core/enforcement_stats.h"
+#include "core/logger.h"
+#include "core/metadata_cache.h"
+#include "core/process_table.h"
+#include "core/usage_tracker.h"
+#include "foreground_hook.h"
 
 FlutterWindow::FlutterWindow(const flutter::DartProject& project)
     : project_(project) {}
@@ -52,49 +58,107 @@ std::wstring GetAppDataPath() {
     return result;
 }
 
-void LogToFile(const std::wstring& message) {
-    static std::wofstream logFile;
-    if (!logFile.is_open()) {
+// Logging only queues the message; a background thread batches it to disk,
+// rotates the file and compresses old ones. Decode the binary files with
+// routine_log_decode from native/tools.
+routine::Logger& GetLogger() {
+    static routine::Logger logger([] {
+        routine::Logger::Options options;
         std::wstring appDataPath = GetAppDataPath();
         if (!appDataPath.empty()) {
-            std::wstring logFilePath = appDataPath + L"\\routine_app.log";
-            logFile.open(logFilePath, std::ios::app);
+            options.path = Utf8FromUtf16((appDataPath + L"\\routine_app.rlog").c_str());
         } else {
             // Fallback to current directory if app data path couldn't be retrieved
-            logFile.open("routine_app.log", std::ios::app);
+            options.path = "routine_app.rlog";
         }
+        return options;
+    }());
+    return logger;
+}
+
+void LogToFile(routine::Logger::Level level, const std::wstring& message) {
+    routine::Logger& logger = GetLogger();
+    if (logger.IsEnabled(level)) {
+        logger.Log(level, Utf8FromUtf16(message.c_str()));
     }
-    
-    logFile << message << std::endl;
 }
 
-void CALLBACK CheckActiveWindow(HWND hwnd, UINT message, UINT_PTR idTimer, DWORD dwTime) {
-    HWND foregroundWindow = GetForegroundWindow();
-    if (foregroundWindow != NULL) {
-        std::wstringstream logMessage;
-        
-        DWORD processId;
-        GetWindowThreadProcessId(foregroundWindow, &processId);
-        if (processId != 0) {
-            HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
-            if (hProcess != NULL) {
-                wchar_t processPath[MAX_PATH];
-                DWORD size = MAX_PATH;
-                if (QueryFullProcessImageNameW(hProcess, 0, processPath, &size)) {
-                    const std::wstring processPathW{ processPath };
-                    logMessage << L"\nFocused application: " << processPath;
-
-                    if (BlockManager::IsBlocked(processPathW)) {
-                        logMessage << L"\nBlocking application: " << processPath;
-                        ShowWindow(foregroundWindow, SW_MINIMIZE);
-                    }
+void LogToFile(const std::wstring& message) {
+    LogToFile(routine::Logger::Level::kInfo, message);
+}
+
+// What getEnforcementStats reports; recorded into by the foreground hook,
+// the poll timer and EnforceForegroundWindow.
+routine::EnforcementStats& GetEnforcementStats() {
+    static routine::EnforcementStats stats;
+    return stats;
+}
 
-                    LogToFile(logMessage.str());
+int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Foreground time per app and day, fed by EnforceForegroundWindow and
+// ticked by the poll timer. Kept in %APPDATA%\Routine\usage.bin.
+routine::UsageTracker& GetUsageTracker() {
+    static routine::SystemTimeZone zone;
+    static routine::UsageTracker tracker([] {
+        routine::UsageTracker::Options options;
+        std::wstring appDataPath = GetAppDataPath();
+        if (!appDataPath.empty()) {
+            options.path = Utf8FromUtf16((appDataPath + L"\\usage.bin").c_str());
+        }
+        return options;
+    }(), &zone);
+    return tracker;
+}
+
+void EnforceForegroundWindow(const routine::ForegroundWindow& focused) {
+    HWND foregroundWindow = reinterpret_cast<HWND>(focused.window);
+    DWORD processId = static_cast<DWORD>(focused.pid);
+    // What uses up foreground time: not a blocked window, which is gone
+    // before it is used.
+    std::string usedPath;
+    if (foregroundWindow != NULL && processId != 0) {
+        routine::EnforcementStats& stats = GetEnforcementStats();
+        HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+        if (hProcess == NULL) {
+            stats.open_process_failures.Add();
+        }
+        else {
+            wchar_t processPath[MAX_PATH];
+            DWORD size = MAX_PATH;
+            if (QueryFullProcessImageNameW(hProcess, 0, processPath, &size)) {
+                const std::wstring processPathW{ processPath };
+                // Every focus change; only worth formatting when debugging
+                if (GetLogger().IsEnabled(routine::Logger::Level::kDebug)) {
+                    LogToFile(routine::Logger::Level::kDebug, L"Focused application: " + processPathW);
+                }
+
+                bool blocked;
+                {
+                    routine::ScopedLatency latency(&stats.is_blocked, &stats.trace, "isBlocked");
+                    blocked = BlockManager::IsBlocked(processPathW);
+                }
+                if (blocked) {
+                    LogToFile(L"Blocking application: " + processPathW);
+                    ShowWindow(foregroundWindow, SW_MINIMIZE);
+                }
+                else {
+                    usedPath = Utf8FromUtf16(processPath);
                 }
-                CloseHandle(hProcess);
             }
+            else {
+                stats.image_path_failures.Add();
+            }
+            CloseHandle(hProcess);
         }
     }
+    if (GetUsageTracker().Focus(usedPath, NowMs())) {
+        LogToFile(L"Minimising application out of time for today");
+        ShowWindow(foregroundWindow, SW_MINIMIZE);
+    }
 }
 
 std::vector<std::string> ConvertFlutterListToVector(const std::vector<flutter::EncodableValue>& list) {
@@ -107,24 +171,98 @@ std::vector<std::string> ConvertFlutterListToVector(const std::vector<flutter::E
     return items;
 }
 
-// Helper function to get file version info string
-std::string GetFileVersionInfoString(const wchar_t* filePath, const wchar_t* stringName) {
-    DWORD handle;
-    DWORD size = GetFileVersionInfoSizeW(filePath, &handle);
-    if (size == 0) {
-        return "";
+// The standard codec sends Dart ints that fit in 32 bits as int32_t.
+int64_t ReadEncodableInt(const flutter::EncodableMap& map, const char* key, int64_t fallback) {
+    auto it = map.find(flutter::EncodableValue(key));
+    if (it == map.end()) {
+        return fallback;
     }
+    if (const auto* small = std::get_if<int32_t>(&it->second)) {
+        return *small;
+    }
+    if (const auto* large = std::get_if<int64_t>(&it->second)) {
+        return *large;
+    }
+    return fallback;
+}
 
-    std::vector<BYTE> data(size);
-    if (!GetFileVersionInfoW(filePath, handle, size, data.data())) {
-        return "";
+// Epoch milliseconds to seconds, rounded up so a pause is never cut short.
+int64_t CeilSeconds(int64_t milliseconds) {
+    return milliseconds > 0 ? (milliseconds + 999) / 1000 : 0;
+}
+
+bool ReadEncodableBool(const flutter::EncodableMap& map, const char* key) {
+    auto it = map.find(flutter::EncodableValue(key));
+    if (it == map.end()) {
+        return false;
+    }
+    const auto* value = std::get_if<bool>(&it->second);
+    return value && *value;
+}
+
+// One {"id", "days", "start", "end", "pausedUntil", "snoozedUntil", "allow",
+// "apps", "sites", "categories"} entry of updateSchedule; the "until"s are
+// epoch milliseconds.
+bool ReadRoutine(const flutter::EncodableValue& value, std::string* id, routine::RoutineSchedule* schedule,
+                 routine::RoutinePolicy* policy) {
+    const auto* entry = std::get_if<flutter::EncodableMap>(&value);
+    if (!entry) {
+        return false;
+    }
+    auto itId = entry->find(flutter::EncodableValue("id"));
+    if (itId == entry->end() || !std::holds_alternative<std::string>(itId->second)) {
+        return false;
+    }
+    *id = std::get<std::string>(itId->second);
+    schedule->days = static_cast<uint8_t>(ReadEncodableInt(*entry, "days", 0) & 0x7f);
+    schedule->start_minute = static_cast<int32_t>(ReadEncodableInt(*entry, "start", -1));
+    schedule->end_minute = static_cast<int32_t>(ReadEncodableInt(*entry, "end", -1));
+    schedule->paused_until = CeilSeconds(ReadEncodableInt(*entry, "pausedUntil", 0));
+    schedule->snoozed_until = CeilSeconds(ReadEncodableInt(*entry, "snoozedUntil", 0));
+    policy->allow = ReadEncodableBool(*entry, "allow");
+    const std::pair<const char*, std::vector<std::string>*> lists[] = {
+        {"apps", &policy->items.apps},
+        {"sites", &policy->items.sites},
+        {"categories", &policy->items.categories},
+    };
+    for (const auto& [key, items] : lists) {
+        auto it = entry->find(flutter::EncodableValue(key));
+        if (it == entry->end()) {
+            continue;
+        }
+        const auto* list = std::get_if<flutter::EncodableList>(&it->second);
+        if (!list) {
+            return false;
+        }
+        *items = ConvertFlutterListToVector(*list);
     }
+    return true;
+}
+
+flutter::EncodableList ToEncodableList(const std::vector<std::string>& items) {
+    flutter::EncodableList list;
+    list.reserve(items.size());
+    for (const auto& item : items) {
+        list.emplace_back(item);
+    }
+    return list;
+}
+
+flutter::EncodableMap ToEncodable(const routine::PolicyItems& items) {
+    return flutter::EncodableMap{
+        {flutter::EncodableValue("apps"), flutter::EncodableValue(ToEncodableList(items.apps))},
+        {flutter::EncodableValue("sites"), flutter::EncodableValue(ToEncodableList(items.sites))},
+        {flutter::EncodableValue("categories"), flutter::EncodableValue(ToEncodableList(items.categories))},
+    };
+}
 
+// Looks up |stringName| in an already loaded version resource
+std::string QueryVersionString(const std::vector<BYTE>& data, const wchar_t* stringName) {
     struct LANGANDCODEPAGE {
         WORD language;
         WORD codePage;
     } *translations;
-    
+
     UINT translationsLength;
     if (!VerQueryValueW(data.data(), L"\\VarFileInfo\\Translation", (LPVOID*)&translations, &translationsLength)) {
         return "";
@@ -133,26 +271,55 @@ std::string GetFileVersionInfoString(const wchar_t* filePath, const wchar_t* str
     // Try to get the string for each language/codepage
     for (UINT i = 0; i < translationsLength / sizeof(LANGANDCODEPAGE); i++) {
         wchar_t subBlock[128];
-        swprintf_s(subBlock, L"\\StringFileInfo\\%04x%04x\\%s", 
+        swprintf_s(subBlock, L"\\StringFileInfo\\%04x%04x\\%s",
             translations[i].language, translations[i].codePage, stringName);
-        
+
         LPVOID valuePtr;
         UINT valueLength;
         if (VerQueryValueW(data.data(), subBlock, &valuePtr, &valueLength) && valueLength > 0) {
-            // Convert wide string to UTF-8
-            int bufferSize = WideCharToMultiByte(CP_UTF8, 0, (wchar_t*)valuePtr, -1, nullptr, 0, nullptr, nullptr);
-            if (bufferSize > 0) {
-                std::string result(bufferSize, 0);
-                WideCharToMultiByte(CP_UTF8, 0, (wchar_t*)valuePtr, -1, &result[0], bufferSize, nullptr, nullptr);
-                result.resize(bufferSize - 1);  // Remove null terminator
-                return result;
-            }
+            return Utf8FromUtf16(static_cast<const wchar_t*>(valuePtr));
         }
     }
 
     return "";
 }
 
+// Reads everything the picker shows about an executable, loading its
+// version resource only once.
+routine::ExeMetadata ReadExecutableMetadata(const wchar_t* filePath) {
+    routine::ExeMetadata metadata;
+
+    DWORD handle;
+    DWORD size = GetFileVersionInfoSizeW(filePath, &handle);
+    if (size != 0) {
+        std::vector<BYTE> data(size);
+        if (GetFileVersionInfoW(filePath, handle, size, data.data())) {
+            metadata.product_name = QueryVersionString(data, L"ProductName");
+            metadata.version = QueryVersionString(data, L"FileVersion");
+
+            // Fall back to FileDescription if ProductName is not available
+            metadata.display_name = metadata.product_name;
+            if (metadata.display_name.empty()) {
+                metadata.display_name = QueryVersionString(data, L"FileDescription");
+            }
+        }
+    }
+
+    // The picker loads icons straight from executables that carry one
+    if (ExtractIconExW(filePath, -1, nullptr, nullptr, 0) > 0) {
+        metadata.icon = Utf8FromUtf16(filePath);
+    }
+
+    return metadata;
+}
+
+// Display names survive restarts here, so version resources are only read
+// once per executable version.
+routine::MetadataCache& GetMetadataCache() {
+    static routine::MetadataCache cache(Utf8FromUtf16((GetAppDataPath() + L"\\exe_metadata.bin").c_str()));
+    return cache;
+}
+
 // Helper function to get all processes with visible windows
 std::unordered_set<DWORD> GetProcessesWithVisibleWindows() {
     std::unordered_set<DWORD> processesWithWindows;
@@ -191,94 +358,140 @@ std::unordered_set<DWORD> GetProcessesWithVisibleWindows() {
     return processesWithWindows;
 }
 
-flutter::EncodableList GetRunningApplications() {
-    flutter::EncodableList result;
-    
-    // Get all processes with visible windows first
-    std::unordered_set<DWORD> processesWithWindows = GetProcessesWithVisibleWindows();
-    
-    // Create a snapshot of all processes
-    HANDLE hProcessSnap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-    if (hProcessSnap == INVALID_HANDLE_VALUE) {
-        return result;
+// Creation time of a process, which together with its id names it even
+// across pid reuse. Zero if the process cannot be opened.
+uint64_t GetProcessStartTime(DWORD processId) {
+    uint64_t startTime = 0;
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (hProcess != NULL) {
+        FILETIME creation, exit, kernel, user;
+        if (GetProcessTimes(hProcess, &creation, &exit, &kernel, &user)) {
+            startTime = (static_cast<uint64_t>(creation.dwHighDateTime) << 32) | creation.dwLowDateTime;
+        }
+        CloseHandle(hProcess);
     }
-    
-    PROCESSENTRY32 pe32;
-    pe32.dwSize = sizeof(PROCESSENTRY32);
-    
-    // Get the first process
-    if (!Process32First(hProcessSnap, &pe32)) {
-        CloseHandle(hProcessSnap);
-        return result;
+    return startTime;
+}
+
+// Resolves the path and display name of a newly seen process. This is the
+// expensive part of enumeration, so it only runs once per process.
+std::optional<routine::RunningApp> DescribeProcess(const routine::ProcessKey& key) {
+    std::optional<routine::RunningApp> app;
+
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(key.pid));
+    if (hProcess == NULL) {
+        return app;
     }
-    
-    // Iterate through all processes
-    do {
+
+    wchar_t processPath[MAX_PATH];
+    DWORD size = MAX_PATH;
+    if (QueryFullProcessImageNameW(hProcess, 0, processPath, &size)) {
+        std::string processPathStr = Utf8FromUtf16(processPath);
+        if (!processPathStr.empty()) {
+            // Extract the file name from the path
+            std::string fileName = processPathStr;
+            size_t lastSlash = fileName.find_last_of("\\");
+            if (lastSlash != std::string::npos) {
+                fileName = fileName.substr(lastSlash + 1);
+            }
+
+            // Remove .exe extension if present
+            size_t dotPos = fileName.find_last_of(".");
+            if (dotPos != std::string::npos) {
+                fileName = fileName.substr(0, dotPos);
+            }
+
+            // Try to get the display name from version info
+            const routine::ExeMetadata metadata = GetMetadataCache().Get(
+                processPathStr, [&](const std::string&) { return ReadExecutableMetadata(processPath); });
+            std::string displayName = metadata.display_name;
+
+            // If we still don't have a display name, use the file name
+            if (displayName.empty()) {
+                displayName = fileName;
+            }
+
+            app = routine::RunningApp{ fileName, displayName, processPathStr };
+        }
+    }
+
+    CloseHandle(hProcess);
+    return app;
+}
+
+// Both only ever touched from the worker pool's single thread.
+// Persists between calls so that only processes started since the last
+// call are described; the picker calls this repeatedly.
+static routine::ProcessTable runningProcesses;
+// Observes runningProcesses while the running apps stream is listened to.
+static std::unique_ptr<routine::AppEventBatcher> appEvents;
+
+// Small enough that the picker shows its first rows while the rest of the
+// processes are still being described.
+const size_t APP_BATCH_SIZE = 16;
+
+flutter::EncodableValue AppToEncodable(const routine::RunningApp& app) {
+    // Create a map with name, display name, and path
+    flutter::EncodableMap appInfo;
+    appInfo[flutter::EncodableValue("name")] = flutter::EncodableValue(app.name);
+    appInfo[flutter::EncodableValue("displayName")] = flutter::EncodableValue(app.display_name);
+    appInfo[flutter::EncodableValue("path")] = flutter::EncodableValue(app.path);
+    return flutter::EncodableValue(appInfo);
+}
+
+// {"event": "added" | "removed" | "listed", "apps": [...]}
+flutter::EncodableValue AppEventToEncodable(const char* event, const std::vector<routine::RunningApp>& apps) {
+    flutter::EncodableList list;
+    for (const auto& app : apps) {
+        list.push_back(AppToEncodable(app));
+    }
+
+    flutter::EncodableMap value;
+    value[flutter::EncodableValue("event")] = flutter::EncodableValue(event);
+    value[flutter::EncodableValue("apps")] = flutter::EncodableValue(list);
+    return flutter::EncodableValue(value);
+}
+
+// Hands |task| to the platform thread, which runs it in WM_RUN_TASK
+void PostToWindow(HWND window, routine::WorkerPool::Task task) {
+    auto* posted = new routine::WorkerPool::Task(std::move(task));
+    if (!PostMessage(window, FlutterWindow::WM_RUN_TASK, 0, reinterpret_cast<LPARAM>(posted))) {
+        delete posted;
+    }
+}
+
+// Reconciles runningProcesses with the processes running now and flushes
+// the changes to the running apps stream, if anyone listens.
+routine::ProcessTable::Diff UpdateRunningProcesses(const routine::CancellationToken& token) {
+    // Only processes with visible windows are applications
+    std::vector<routine::ProcessKey> current;
+    for (DWORD processId : GetProcessesWithVisibleWindows()) {
         // Skip system processes
-        if (pe32.th32ProcessID == 0 || pe32.th32ProcessID == 4) {
+        if (processId == 0 || processId == 4) {
             continue;
         }
-        
-        // Check if the process has a visible window using our pre-built map
-        if (processesWithWindows.find(pe32.th32ProcessID) == processesWithWindows.end()) {
-            continue; // Skip background processes
-        }
-        
-        HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pe32.th32ProcessID);
-        if (hProcess != NULL) {
-            wchar_t processPath[MAX_PATH];
-            DWORD size = MAX_PATH;
-            
-            if (QueryFullProcessImageNameW(hProcess, 0, processPath, &size)) {
-                // Convert wide string to UTF-8 string properly
-                int bufferSize = WideCharToMultiByte(CP_UTF8, 0, processPath, -1, nullptr, 0, nullptr, nullptr);
-                if (bufferSize > 0) {
-                    std::string processPathStr(bufferSize, 0);
-                    WideCharToMultiByte(CP_UTF8, 0, processPath, -1, &processPathStr[0], bufferSize, nullptr, nullptr);
-                    // Remove null terminator that WideCharToMultiByte includes
-                    processPathStr.resize(bufferSize - 1);
-                    
-                    // Extract the file name from the path
-                    std::string fileName = processPathStr;
-                    size_t lastSlash = fileName.find_last_of("\\");
-                    if (lastSlash != std::string::npos) {
-                        fileName = fileName.substr(lastSlash + 1);
-                    }
-                    
-                    // Remove .exe extension if present
-                    size_t dotPos = fileName.find_last_of(".");
-                    if (dotPos != std::string::npos) {
-                        fileName = fileName.substr(0, dotPos);
-                    }
-                    
-                    // Try to get the display name from version info
-                    std::string displayName = GetFileVersionInfoString(processPath, L"ProductName");
-                    if (displayName.empty()) {
-                        // Try FileDescription if ProductName is not available
-                        displayName = GetFileVersionInfoString(processPath, L"FileDescription");
-                    }
-                    
-                    // If we still don't have a display name, use the file name
-                    if (displayName.empty()) {
-                        displayName = fileName;
-                    }
-                    
-                    // Create a map with name, display name, and path
-                    flutter::EncodableMap appInfo;
-                    appInfo[flutter::EncodableValue("name")] = flutter::EncodableValue(fileName);
-                    appInfo[flutter::EncodableValue("displayName")] = flutter::EncodableValue(displayName);
-                    appInfo[flutter::EncodableValue("path")] = flutter::EncodableValue(processPathStr);
-                    
-                    // Add to result list
-                    result.push_back(flutter::EncodableValue(appInfo));
-                }
-            }
-            
-            CloseHandle(hProcess);
-        }
-    } while (Process32Next(hProcessSnap, &pe32));
-    
-    CloseHandle(hProcessSnap);
+        current.push_back(routine::ProcessKey{ processId, GetProcessStartTime(processId) });
+    }
+
+    const auto diff = runningProcesses.Update(current, DescribeProcess, &token);
+    if (appEvents) {
+        appEvents->Flush();
+    }
+    return diff;
+}
+
+flutter::EncodableList GetRunningApplications(const routine::CancellationToken& token) {
+    flutter::EncodableList result;
+
+    // A cancelled update keeps what it described for the next call
+    if (UpdateRunningProcesses(token).cancelled) {
+        return result;
+    }
+
+    for (const auto& app : runningProcesses.Apps()) {
+        result.push_back(AppToEncodable(app));
+    }
+
     return result;
 }
 
@@ -299,11 +512,18 @@ bool FlutterWindow::OnCreate() {
   }
   RegisterPlugins(flutter_controller_->engine());
 
+  // One worker is enough: it only has to keep slow handlers off the
+  // platform thread. Replies come back through WM_RUN_TASK.
+  HWND window = GetHandle();
+  worker_pool_ = std::make_unique<routine::WorkerPool>(1, [window](routine::WorkerPool::Task task) {
+      PostToWindow(window, std::move(task));
+  });
+
   flutter::MethodChannel<> channel(
       flutter_controller_->engine()->messenger(), "com.solidsoft.routine",
       &flutter::StandardMethodCodec::GetInstance());
   channel.SetMethodCallHandler(
-      [](const flutter::MethodCall<>& call, std::unique_ptr<flutter::MethodResult<>> result) {
+      [this](const flutter::MethodCall<>& call, std::unique_ptr<flutter::MethodResult<>> result) {
           const auto& methodType = call.method_name();
 
           if (methodType == "engineReady") {
@@ -325,12 +545,148 @@ bool FlutterWindow::OnCreate() {
                         std::vector<std::string> dirList = ConvertFlutterListToVector(std::get<flutter::EncodableList>(itDirList->second));
           
                         BlockManager::Set(allow, appList, dirList);
+
+                        // The focused app may have just become blocked.
+                        if (foreground_tracker_) {
+                            foreground_tracker_->Refresh();
+                        }
                         return result->Success(true);
                     }
               }
               
               result->Error("Arguments for updateAppList are invalid");
           }
+          else if (methodType == "updateSchedule") {
+              LogToFile(L"Received updateSchedule");
+
+              const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments());
+              const flutter::EncodableList* list = nullptr;
+              if (arguments) {
+                  auto itRoutines = arguments->find(flutter::EncodableValue("routines"));
+                  if (itRoutines != arguments->end()) {
+                      list = std::get_if<flutter::EncodableList>(&itRoutines->second);
+                  }
+              }
+              const size_t count = list ? list->size() : 0;
+              std::vector<routine::RoutineSchedule> schedules(count);
+              std::vector<routine::RoutinePolicy> policies(count);
+              std::vector<std::string> ids(count);
+              for (size_t i = 0; i < count; ++i) {
+                  if (!ReadRoutine((*list)[i], &ids[i], &schedules[i], &policies[i])) {
+                      list = nullptr;
+                      break;
+                  }
+              }
+              if (!list) {
+                  return result->Error("Arguments for updateSchedule are invalid");
+              }
+              schedule_ = std::make_unique<routine::ScheduleIndex>(schedules);
+
+              // Only routines that changed while on move the policy.
+              const std::unordered_set<std::string> kept(ids.begin(), ids.end());
+              for (const auto& id : schedule_ids_) {
+                  if (kept.count(id) == 0) {
+                      routine_policies_.RemoveRoutine(id);
+                  }
+              }
+              for (size_t i = 0; i < count; ++i) {
+                  routine_policies_.SetRoutine(ids[i], std::move(policies[i]));
+              }
+              schedule_ids_ = std::move(ids);
+              result->Success(EvaluateSchedule(arguments));
+          }
+          else if (methodType == "evaluateSchedule") {
+              result->Success(EvaluateSchedule(std::get_if<flutter::EncodableMap>(call.arguments())));
+          }
+          else if (methodType == "getEnforcementStats") {
+              routine::EnforcementStats& stats = GetEnforcementStats();
+              if (const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments())) {
+                  auto trace = arguments->find(flutter::EncodableValue("trace"));
+                  if (trace != arguments->end() && std::holds_alternative<bool>(trace->second)) {
+                      stats.trace.set_enabled(std::get<bool>(trace->second));
+                  }
+                  auto tracePath = arguments->find(flutter::EncodableValue("tracePath"));
+                  if (tracePath != arguments->end()) {
+                      const auto* path = std::get_if<std::string>(&tracePath->second);
+                      if (path && !stats.trace.WriteTo(*path)) {
+                          return result->Error("trace_failed", "Could not write the trace file");
+                      }
+                  }
+              }
+              routine::EnforcementExtras extras;
+              extras.cache = BlockManager::CacheStats();
+              const routine::Logger::Stats logStats = GetLogger().stats();
+              extras.log_bytes_written = static_cast<int64_t>(logStats.bytes_written);
+              extras.log_messages_dropped = static_cast<int64_t>(logStats.dropped);
+              result->Success(routine::EnforcementStatsJson(stats, extras, std::chrono::steady_clock::now()));
+          }
+          else if (methodType == "setUsageBudgets") {
+              // {"budgets": {path: minutes per day}}
+              const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments());
+              const flutter::EncodableMap* budgets = nullptr;
+              if (arguments) {
+                  auto itBudgets = arguments->find(flutter::EncodableValue("budgets"));
+                  if (itBudgets != arguments->end()) {
+                      budgets = std::get_if<flutter::EncodableMap>(&itBudgets->second);
+                  }
+              }
+              if (!budgets) {
+                  return result->Error("Arguments for setUsageBudgets are invalid");
+              }
+              std::vector<std::pair<std::string, int64_t>> minutes;
+              for (const auto& [path, limit] : *budgets) {
+                  const auto* pathString = std::get_if<std::string>(&path);
+                  if (!pathString) {
+                      continue;
+                  }
+                  if (const auto* small = std::get_if<int32_t>(&limit)) {
+                      minutes.emplace_back(*pathString, *small);
+                  }
+                  else if (const auto* large = std::get_if<int64_t>(&limit)) {
+                      minutes.emplace_back(*pathString, *large);
+                  }
+              }
+              GetUsageTracker().SetBudgets(minutes);
+
+              // The focused app may have just run out of time.
+              if (foreground_tracker_) {
+                  foreground_tracker_->Refresh();
+              }
+              result->Success(true);
+          }
+          else if (methodType == "getUsage") {
+              // {"days": [start of day, epoch ms], "apps": [paths], "ms":
+              //  [foreground ms], "remaining": {path: ms left today}}, one
+              //  row per app and day between "from" and "to".
+              routine::UsageTracker& usage = GetUsageTracker();
+              const int64_t now = NowMs();
+              int64_t from = now;
+              int64_t to = now;
+              if (const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments())) {
+                  from = ReadEncodableInt(*arguments, "from", now);
+                  to = ReadEncodableInt(*arguments, "to", now);
+              }
+              const routine::UsageTracker::Totals totals =
+                  usage.Query(usage.LocalDay(from), usage.LocalDay(to), now);
+              flutter::EncodableList days;
+              flutter::EncodableList apps;
+              flutter::EncodableList ms;
+              for (size_t i = 0; i < totals.days.size(); ++i) {
+                  days.emplace_back(usage.DayStart(totals.days[i]));
+                  apps.emplace_back(totals.apps[i]);
+                  ms.emplace_back(totals.ms[i]);
+              }
+              flutter::EncodableMap remaining;
+              for (const auto& [path, left] : usage.RemainingAll(now)) {
+                  remaining[flutter::EncodableValue(path)] = flutter::EncodableValue(left);
+              }
+              result->Success(flutter::EncodableMap{
+                  {flutter::EncodableValue("days"), flutter::EncodableValue(days)},
+                  {flutter::EncodableValue("apps"), flutter::EncodableValue(apps)},
+                  {flutter::EncodableValue("ms"), flutter::EncodableValue(ms)},
+                  {flutter::EncodableValue("remaining"), flutter::EncodableValue(remaining)},
+              });
+          }
           else if (methodType == "setStartOnLogin") {
               LogToFile(L"Received setStartOnLogin");
               result->Success(true);
@@ -341,15 +697,62 @@ bool FlutterWindow::OnCreate() {
           }
           else if (methodType == "getRunningApplications") {
               LogToFile(L"Received getRunningApplications");
-              result->Success(GetRunningApplications());
+
+              // Enumeration touches every running process; answer from the
+              // worker so the window keeps painting meanwhile.
+              std::shared_ptr<flutter::MethodResult<>> pending = std::move(result);
+              worker_pool_->Submit(methodType,
+                  [pending](const routine::CancellationToken& token) -> routine::WorkerPool::Task {
+                      auto apps = std::make_shared<flutter::EncodableList>(GetRunningApplications(token));
+                      return [pending, apps]() { pending->Success(*apps); };
+                  },
+                  [pending]() { pending->Error("cancelled", "Superseded by a newer request"); });
           }
       });
 
+  apps_channel_ = std::make_unique<flutter::EventChannel<>>(
+      flutter_controller_->engine()->messenger(), "com.solidsoft.routine/running_apps",
+      &flutter::StandardMethodCodec::GetInstance());
+  apps_channel_->SetStreamHandler(std::make_unique<flutter::StreamHandlerFunctions<>>(
+      [this](const flutter::EncodableValue* arguments, std::unique_ptr<flutter::EventSink<>>&& events)
+          -> std::unique_ptr<flutter::StreamHandlerError<>> {
+          LogToFile(L"Listening for running applications");
+          apps_sink_ = std::move(events);
+          ListenRunningApps();
+          return nullptr;
+      },
+      [this](const flutter::EncodableValue* arguments) -> std::unique_ptr<flutter::StreamHandlerError<>> {
+          apps_sink_ = nullptr;
+          worker_pool_->Submit("runningApps.cancel",
+              [](const routine::CancellationToken& token) -> routine::WorkerPool::Task {
+                  runningProcesses.set_observer(nullptr);
+                  appEvents = nullptr;
+                  return []() {};
+              },
+              []() {});
+          return nullptr;
+      }));
 
   SetChildContent(flutter_controller_->view()->GetNativeWindow());
 
-  // Set up the timer to check active window every 200ms
-  SetTimer(GetHandle(), WINDOW_CHECK_TIMER_ID, 200, CheckActiveWindow);
+  // ROUTINE_TRACE=1 records trace spans from startup, for traces of the
+  // first enforcement.
+  if (GetEnvironmentVariableW(L"ROUTINE_TRACE", nullptr, 0) > 0) {
+    GetEnforcementStats().trace.set_enabled(true);
+  }
+
+  // Enforce on foreground changes as they happen. The timer is only a slow
+  // fallback in case the hook misses an event or cannot be installed.
+  foreground_tracker_ = std::make_unique<routine::ForegroundTracker>(
+      std::make_unique<WinEventForegroundSource>(), EnforceForegroundWindow,
+      std::chrono::milliseconds(POLL_INTERVAL_MS), &GetEnforcementStats());
+  // Time on a locked screen, or with nothing in front, counts for no app.
+  foreground_tracker_->set_unfocus_handler(
+      [] { GetUsageTracker().Focus(std::string(), NowMs()); });
+  if (!foreground_tracker_->Start()) {
+    LogToFile(L"[Routine] Foreground hook unavailable, polling only");
+  }
+  SetTimer(GetHandle(), POLL_TIMER_ID, POLL_INTERVAL_MS, nullptr);
 
   flutter_controller_->engine()->SetNextFrameCallback([&]() {
     this->Show();
@@ -363,9 +766,115 @@ bool FlutterWindow::OnCreate() {
   return true;
 }
 
+flutter::EncodableValue FlutterWindow::EvaluateSchedule(const flutter::EncodableMap* arguments) {
+    bool full = false;
+    // Routines whose conditions the app found done; they stay off whatever
+    // their schedule says.
+    std::unordered_set<std::string> done;
+    if (arguments) {
+        full = ReadEncodableBool(*arguments, "full");
+        auto itDone = arguments->find(flutter::EncodableValue("done"));
+        if (itDone != arguments->end()) {
+            if (const auto* list = std::get_if<flutter::EncodableList>(&itDone->second)) {
+                for (auto& id : ConvertFlutterListToVector(*list)) {
+                    done.insert(std::move(id));
+                }
+            }
+        }
+    }
+    const int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    // {"active": [routine ids], "next": epoch ms, or -1 for never,
+    //  "policy": {"allowList", "reset", "added": {"apps", "sites",
+    //  "categories"}, "removed": {...}}}
+    flutter::EncodableList active;
+    int64_t next = routine::ScheduleIndex::kNever;
+    if (schedule_) {
+        std::vector<bool> on(schedule_ids_.size());
+        for (const uint32_t index : schedule_->ActiveAt(now, time_zone_)) {
+            active.emplace_back(schedule_ids_[index]);
+            on[index] = true;
+        }
+        next = schedule_->NextTransition(now, time_zone_);
+        for (size_t i = 0; i < schedule_ids_.size(); ++i) {
+            routine_policies_.SetActive(schedule_ids_[i], on[i] && done.count(schedule_ids_[i]) == 0);
+        }
+    }
+
+    routine::PolicyDelta delta = routine_policies_.TakeDelta();
+    if (full && !delta.reset) {
+        delta.reset = true;
+        delta.added = routine_policies_.Effective();
+        delta.removed = routine::PolicyItems();
+    }
+    flutter::EncodableMap policy{
+        {flutter::EncodableValue("allowList"), flutter::EncodableValue(delta.allow_list)},
+        {flutter::EncodableValue("reset"), flutter::EncodableValue(delta.reset)},
+        {flutter::EncodableValue("added"), flutter::EncodableValue(ToEncodable(delta.added))},
+        {flutter::EncodableValue("removed"), flutter::EncodableValue(ToEncodable(delta.removed))},
+    };
+    return flutter::EncodableValue(flutter::EncodableMap{
+        {flutter::EncodableValue("active"), flutter::EncodableValue(std::move(active))},
+        {flutter::EncodableValue("next"),
+         flutter::EncodableValue(next == routine::ScheduleIndex::kNever ? int64_t{-1} : next * 1000)},
+        {flutter::EncodableValue("policy"), flutter::EncodableValue(std::move(policy))},
+    });
+}
+
+void FlutterWindow::ListenRunningApps() {
+    // Start with what the table already knows, then stream the newcomers as
+    // they are described; "listed" marks the end of the initial listing.
+    HWND window = GetHandle();
+    std::weak_ptr<flutter::EventSink<>> listener = apps_sink_;
+    worker_pool_->Submit("runningApps.listen",
+        [window, listener](const routine::CancellationToken& token) -> routine::WorkerPool::Task {
+            auto events = std::make_unique<routine::AppEventBatcher>(APP_BATCH_SIZE,
+                [window, listener](routine::AppEventBatcher::Batch batch) {
+                    const char* change = batch.change == routine::AppEventBatcher::Change::kAdded ? "added" : "removed";
+                    auto event = std::make_shared<flutter::EncodableValue>(AppEventToEncodable(change, batch.apps));
+                    PostToWindow(window, [listener, event]() {
+                        if (auto sink = listener.lock()) {
+                            sink->Success(*event);
+                        }
+                    });
+                });
+            for (const auto& app : runningProcesses.Apps()) {
+                events->AppAdded(app);
+            }
+            // Swapped in before the previous listener's batcher goes away
+            runningProcesses.set_observer(events.get());
+            appEvents = std::move(events);
+            UpdateRunningProcesses(token);
+
+            return [listener]() {
+                if (auto sink = listener.lock()) {
+                    sink->Success(AppEventToEncodable("listed", {}));
+                }
+            };
+        },
+        []() {});
+}
+
+void FlutterWindow::SubmitAppsRescan() {
+    // Picks up processes that started or exited since the last enumeration;
+    // only the changes reach the listener.
+    worker_pool_->Submit("runningApps.rescan",
+        [](const routine::CancellationToken& token) -> routine::WorkerPool::Task {
+            if (appEvents) {
+                UpdateRunningProcesses(token);
+            }
+            return []() {};
+        },
+        []() {});
+}
+
 void FlutterWindow::OnDestroy() {
-    // Kill the timer when the window is destroyed
-    KillTimer(GetHandle(), WINDOW_CHECK_TIMER_ID);
+    // Kill the timer and unhook when the window is destroyed
+    KillTimer(GetHandle(), POLL_TIMER_ID);
+    foreground_tracker_ = nullptr;
+    apps_sink_ = nullptr;
+    worker_pool_ = nullptr;
+    apps_channel_ = nullptr;
 
     if (flutter_controller_) {
         flutter_controller_ = nullptr;
@@ -397,6 +906,29 @@ FlutterWindow::MessageHandler(HWND hwnd, UINT const message,
     case WM_FONTCHANGE:
       flutter_controller_->engine()->ReloadSystemFonts();
       break;
+
+    case WM_TIMER:
+      if (wparam == POLL_TIMER_ID && foreground_tracker_) {
+        GetEnforcementStats().timer_wakeups.Mark();
+        foreground_tracker_->Poll();
+        // The focused app ran out of time while it had focus.
+        if (GetUsageTracker().Tick(NowMs())) {
+            foreground_tracker_->Refresh();
+        }
+        if (apps_sink_) {
+            SubmitAppsRescan();
+        }
+        return 0;
+      }
+      break;
+
+    case WM_RUN_TASK: {
+      // A reply from the worker pool
+      std::unique_ptr<routine::WorkerPool::Task> task(
+          reinterpret_cast<routine::WorkerPool::Task*>(lparam));
+      (*task)();
+      return 0;
+    }
       
     case WM_POWERBROADCAST:
       if (wparam == PBT_APMRESUMEAUTOMATIC || wparam == PBT_APMRESUMESUSPEND) {
@@ -2,12 +2,22 @@
 #define RUNNER_FLUTTER_WINDOW_H_
 
 #include <flutter/dart_project.h>
+#include <flutter/encodable_value.h>
+#include <flutter/event_channel.h>
+#include <flutter/event_sink.h>
 #include <flutter/flutter_view_controller.h>
 
 #include <memory>
+#include <string>
 #include <unordered_set>
 #include <mutex>
+#include <vector>
 
+#include "core/foreground_tracker.h"
+#include "core/policy_aggregator.h"
+#include "core/schedule_index.h"
+#include "core/time_zone.h"
+#include "core/worker_pool.h"
 #include "win32_window.h"
 
 // A window that does nothing but host a Flutter view.
@@ -18,7 +28,10 @@ class FlutterWindow : public Win32Window {
   virtual ~FlutterWindow();
 
   static const UINT_PTR POLL_TIMER_ID = 1;
-  static const UINT POLL_INTERVAL_MS = 200; // 10 seconds
+  // Fallback poll for foreground changes the WinEvent hook missed.
+  static const UINT POLL_INTERVAL_MS = 2000;
+  // Carries a WorkerPool::Task* to run on the platform thread.
+  static const UINT WM_RUN_TASK = WM_APP + 1;
 
  protected:
   // Win32Window:
@@ -34,6 +47,38 @@ class FlutterWindow : public Win32Window {
   // The Flutter instance hosted by this window.
   std::unique_ptr<flutter::FlutterViewController> flutter_controller_;
 
+  // Enforces the block policy whenever the foreground window changes.
+  std::unique_ptr<routine::ForegroundTracker> foreground_tracker_;
+
+  // Runs slow channel handlers off the platform thread.
+  std::unique_ptr<routine::WorkerPool> worker_pool_;
+
+  // Streams the picker's app list: batches as apps are discovered, then
+  // additions and removals as processes start and exit.
+  std::unique_ptr<flutter::EventChannel<>> apps_channel_;
+
+  // The current listener of apps_channel_, null while nobody listens.
+  // Replaced on every listen, so events queued for an earlier listener find
+  // their sink expired.
+  std::shared_ptr<flutter::EventSink<>> apps_sink_;
+
+  // The routines' schedules, indexed by position in schedule_ids_.
+  // Platform thread only.
+  std::unique_ptr<routine::ScheduleIndex> schedule_;
+  std::vector<std::string> schedule_ids_;
+  // What the routines that are on block, by routine id. Platform thread
+  // only.
+  routine::PolicyAggregator routine_policies_;
+  routine::SystemTimeZone time_zone_;
+
+  // Which routines are on now, when that next changes, and how the
+  // blocking policy changed since the last answer: all of it if |arguments|
+  // has "full", and with the routines its "done" list names off.
+  flutter::EncodableValue EvaluateSchedule(const flutter::EncodableMap* arguments);
+
+  void ListenRunningApps();
+  void SubmitAppsRescan();
+
   void CheckAndBlockApps();
 };
 
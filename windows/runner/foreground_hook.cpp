@@ -0,0 +1,61 @@
+#include "foreground_hook.h"
+
+#include <utility>
+
+WinEventForegroundSource::~WinEventForegroundSource() {
+  Stop();
+}
+
+bool WinEventForegroundSource::Start(Callback callback) {
+  if (hook_ != nullptr || instance_ != nullptr) {
+    return false;
+  }
+
+  callback_ = std::move(callback);
+  instance_ = this;
+  hook_ = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND,
+                          nullptr, OnWinEvent, 0, 0, WINEVENT_OUTOFCONTEXT);
+  if (hook_ == nullptr) {
+    instance_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void WinEventForegroundSource::Stop() {
+  if (hook_ != nullptr) {
+    UnhookWinEvent(hook_);
+    hook_ = nullptr;
+  }
+  if (instance_ == this) {
+    instance_ = nullptr;
+  }
+}
+
+std::optional<routine::ForegroundWindow> WinEventForegroundSource::Current() {
+  return Describe(GetForegroundWindow());
+}
+
+routine::ForegroundWindow WinEventForegroundSource::Describe(HWND window) {
+  routine::ForegroundWindow foreground;
+  if (window != nullptr) {
+    DWORD process_id = 0;
+    GetWindowThreadProcessId(window, &process_id);
+    foreground.window = reinterpret_cast<uint64_t>(window);
+    foreground.pid = process_id;
+  }
+  return foreground;
+}
+
+void CALLBACK WinEventForegroundSource::OnWinEvent(HWINEVENTHOOK hook,
+                                                   DWORD event, HWND window,
+                                                   LONG object_id,
+                                                   LONG child_id,
+                                                   DWORD event_thread,
+                                                   DWORD event_time) {
+  if (event != EVENT_SYSTEM_FOREGROUND || object_id != OBJID_WINDOW ||
+      instance_ == nullptr || !instance_->callback_) {
+    return;
+  }
+  instance_->callback_(Describe(window));
+}
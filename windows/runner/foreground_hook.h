@@ -0,0 +1,36 @@
+#ifndef RUNNER_FOREGROUND_HOOK_H_
+#define RUNNER_FOREGROUND_HOOK_H_
+
+#include <windows.h>
+
+#include <optional>
+
+#include "core/foreground_tracker.h"
+
+// Reports foreground changes through an out-of-context
+// EVENT_SYSTEM_FOREGROUND WinEvent hook. Callbacks are delivered on the
+// thread that called Start(), from its message loop.
+class WinEventForegroundSource : public routine::ForegroundSource {
+ public:
+  WinEventForegroundSource() = default;
+  ~WinEventForegroundSource() override;
+
+  bool Start(Callback callback) override;
+  void Stop() override;
+  std::optional<routine::ForegroundWindow> Current() override;
+
+  static routine::ForegroundWindow Describe(HWND window);
+
+ private:
+  static void CALLBACK OnWinEvent(HWINEVENTHOOK hook, DWORD event, HWND window,
+                                  LONG object_id, LONG child_id,
+                                  DWORD event_thread, DWORD event_time);
+
+  // WinEvent callbacks carry no user data, and only one hook is ever needed.
+  static inline WinEventForegroundSource* instance_ = nullptr;
+
+  HWINEVENTHOOK hook_ = nullptr;
+  Callback callback_;
+};
+
+#endif  // RUNNER_FOREGROUND_HOOK_H_